@@ -13,6 +13,7 @@
 #ifndef __PROCESS_EVENT_HPP__
 #define __PROCESS_EVENT_HPP__
 
+#include <atomic>
 #include <memory> // TODO(benh): Replace shared_ptr with unique_ptr.
 
 #include <process/future.hpp>
@@ -26,6 +27,7 @@
 namespace process {
 
 // Forward declarations.
+class EventQueue;
 class ProcessBase;
 struct MessageEvent;
 struct DispatchEvent;
@@ -47,6 +49,11 @@ struct EventVisitor
 
 struct Event
 {
+  Event() : next(nullptr) {}
+
+  // NOTE: A copy is never on an event queue, so `next` is not copied.
+  Event(const Event&) : next(nullptr) {}
+
   virtual ~Event() {}
 
   virtual void visit(EventVisitor* visitor) const = 0;
@@ -81,6 +88,12 @@ struct Event
     }
     return *result;
   }
+
+private:
+  friend class EventQueue;
+
+  // The next event on the process' event queue (see `EventQueue`).
+  std::atomic<Event*> next;
 };
 
 
@@ -491,6 +491,9 @@ public:
 
   bool contains(const std::string& key) const;
 
+  // Removes the header, returns the number of headers removed.
+  size_t erase(const std::string& key);
+
   size_t size() const;
 
   bool empty() const;
@@ -623,14 +626,23 @@ struct Response
   // already specified.
   //
   // PATH: Attempts to perform a 'sendfile' operation on the file
-  // found at 'path'.
+  // found at 'path'. If the file gets encoded using gzip (as for
+  // BODY), it is instead compressed as it is sent using a "chunked"
+  // 'Transfer-Encoding'.
   //
   // PIPE: Splices data from the Pipe 'reader' using a "chunked"
   // 'Transfer-Encoding'. The writer uses a Pipe::Writer to
   // perform writes and to detect a closed read-end of the Pipe
   // (i.e. nobody is listening any longer). Once the writer is
   // finished, it will close its end of the pipe to signal end
-  // of file to the Reader.
+  // of file to the Reader. Each chunk may be encoded using gzip
+  // if 'Content-Encoding' is not already specified.
+  //
+  // A response can be sent as is in all cases by specifying a
+  // 'Content-Encoding: identity' header, which is not sent itself.
+  // This is useful for streams of small chunks that are sent to many
+  // clients, which compress poorly and would get compressed for
+  // every client.
   //
   // In all cases (BODY, PATH, PIPE), you are expected to properly
   // specify the 'Content-Type' header, but the 'Content-Length' and
@@ -15,7 +15,9 @@
 
 #include <stdint.h>
 
+#include <atomic>
 #include <map>
+#include <memory>
 #include <queue>
 #include <vector>
 
@@ -39,6 +41,7 @@
 namespace process {
 
 // Forward declaration.
+class EventQueue;
 class Logging;
 class Sequence;
 
@@ -371,19 +374,10 @@ protected:
 
   /**
    * Returns the number of events of the given type currently on the event
-   * queue.
+   * queue. This takes constant time and can be called from any thread.
    */
   template <typename T>
-  size_t eventCount()
-  {
-    size_t count = 0U;
-
-    synchronized (mutex) {
-      count = std::count_if(events.begin(), events.end(), isEventType<T>);
-    }
-
-    return count;
-  }
+  size_t eventCount();
 
 private:
   friend class SocketManager;
@@ -392,7 +386,7 @@ private:
   friend void* schedule(void*);
 
   // Process states.
-  enum
+  enum ProcessState
   {
     BOTTOM,
     READY,
@@ -400,17 +394,13 @@ private:
     BLOCKED,
     TERMINATING,
     TERMINATED
-  } state;
-
-  template <typename T>
-  static bool isEventType(const Event* event)
-  {
-    return event->is<T>();
-  }
+  };
 
-  // Mutex protecting internals.
-  // TODO(benh): Consider replacing with a spinlock, on multi-core systems.
-  std::recursive_mutex mutex;
+  // The state is changed without a lock: producers of events only
+  // ever transition a process from BLOCKED to READY (to put it on a
+  // run queue), all other transitions are done by the thread that
+  // is running the process (see `ProcessManager::resume`).
+  std::atomic<ProcessState> state;
 
   // Enqueue the specified message, request, or function call.
   void enqueue(Event* event, bool inject = false);
@@ -468,17 +458,43 @@ private:
   // Static assets(s) to provide.
   std::map<std::string, Asset> assets;
 
-  // Queue of received events, requires lock()ed access!
-  std::deque<Event*> events;
+  // Queue of received events. Any thread can enqueue events but only
+  // the thread running the process can dequeue them.
+  std::unique_ptr<EventQueue> events;
 
   // Active references.
   std::atomic_long refs;
 
+  // Index of the worker thread that last ran this process (or -1 if
+  // it has not run yet), used to enqueue the process on that worker's
+  // run queue the next time it becomes runnable.
+  std::atomic_long worker;
+
   // Process PID.
   UPID pid;
 };
 
 
+template <>
+size_t ProcessBase::eventCount<MessageEvent>();
+
+
+template <>
+size_t ProcessBase::eventCount<DispatchEvent>();
+
+
+template <>
+size_t ProcessBase::eventCount<HttpEvent>();
+
+
+template <>
+size_t ProcessBase::eventCount<ExitedEvent>();
+
+
+template <>
+size_t ProcessBase::eventCount<TerminateEvent>();
+
+
 template <typename T>
 class Process : public virtual ProcessBase {
 public:
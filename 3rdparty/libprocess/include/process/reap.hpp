@@ -19,6 +19,7 @@
 #include <process/id.hpp>
 #include <process/process.hpp>
 
+#include <stout/hashmap.hpp>
 #include <stout/multihashmap.hpp>
 #include <stout/option.hpp>
 #include <stout/result.hpp>
@@ -44,10 +45,24 @@ protected:
 
   void notify(pid_t pid, Result<int> status);
 
+#ifdef __linux__
+  // Watches for the termination of the pid through a pidfd (see
+  // `pidfd_open(2)`), so that the pid doesn't need to be polled.
+  // Returns false if the kernel doesn't support pidfds.
+  bool watch(pid_t pid);
+
+  void _watch(pid_t pid, const Future<short>& poll);
+#endif // __linux__
+
 private:
   const Duration interval();
 
   multihashmap<pid_t, Owned<Promise<Option<int>>>> promises;
+
+#ifdef __linux__
+  // The pidfds of the pids that are watched rather than polled.
+  hashmap<pid_t, int> pidfds;
+#endif // __linux__
 };
 
 
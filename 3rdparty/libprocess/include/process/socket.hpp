@@ -19,6 +19,7 @@
 #endif // __WINDOWS__
 
 #include <memory>
+#include <vector>
 
 #include <process/address.hpp>
 #include <process/future.hpp>
@@ -153,6 +154,29 @@ public:
   virtual Future<size_t> send(const char* data, size_t size) = 0;
   virtual Future<size_t> sendfile(int_fd fd, off_t offset, size_t size) = 0;
 
+  /**
+   * A contiguous region of memory to send, see `send` below.
+   */
+  struct Buffer
+  {
+    const char* data;
+    size_t size;
+  };
+
+  /**
+   * Sends the data of the specified buffers, in order, as if they
+   * were one contiguous region of memory. Implementations can do this
+   * with a single "gathering" write rather than having the caller
+   * copy the data into one region first.
+   *
+   * The default implementation only sends (some of) the data of the
+   * first non-empty buffer.
+   *
+   * @return The number of bytes sent, which may be less than the
+   *     total size of the buffers.
+   */
+  virtual Future<size_t> send(const std::vector<Buffer>& buffers);
+
   /**
    * An overload of `recv`, which receives data based on the specified
    * 'size' parameter.
@@ -372,6 +396,11 @@ public:
     return impl->send(data, size);
   }
 
+  Future<size_t> send(const std::vector<SocketImpl::Buffer>& buffers) const
+  {
+    return impl->send(buffers);
+  }
+
   Future<size_t> sendfile(int_fd fd, off_t offset, size_t size) const
   {
     return impl->sendfile(fd, offset, size);
@@ -12,6 +12,8 @@
 
 #include <glog/logging.h>
 
+#include <algorithm>
+#include <array>
 #include <list>
 #include <map>
 #include <mutex>
@@ -25,6 +27,7 @@
 
 #include <stout/duration.hpp>
 #include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
 #include <stout/lambda.hpp>
 #include <stout/synchronized.hpp>
 #include <stout/try.hpp>
@@ -34,15 +37,350 @@
 
 using std::list;
 using std::map;
+using std::multimap;
 using std::recursive_mutex;
 using std::set;
 
 namespace process {
 
-// We store the timers in a map of lists indexed by the timeout of the
-// timer so that we can have two timers that have the same timeout. We
-// exploit that the map is SORTED!
-static map<Time, list<Timer>>* timers = new map<Time, list<Timer>>();
+// The pending timers, kept in a hierarchical timing wheel (see
+// "Hashed and Hierarchical Timing Wheels" by Varghese and Lauck) so
+// that creating and canceling a timer takes constant time, rather
+// than an insertion into (and a search of) a sorted map.
+//
+// Time is divided into ticks of 2^20 nanoseconds (about a
+// millisecond). Each level of the wheel has 256 slots, a slot of the
+// first level holding the timers of a single tick and a slot of each
+// next level holding the timers of 256 slots of the previous level.
+// When the wheel advances to the start of a slot of a higher level
+// its timers are "cascaded" into the lower levels. The four levels
+// span 2^52 nanoseconds (about 52 days), timers further in the future
+// are kept in a sorted map until they fit in the wheel.
+//
+// Note that the timers within a tick are compared by their exact
+// timeouts, i.e., the wheel does not round the timeouts of timers.
+class Timers
+{
+public:
+  Timers() : position(0), sizes{} {}
+
+  // NOTE: The ID is that of the timer, which is passed separately
+  // since only the `Clock` can access it.
+  void add(uint64_t id, const Timer& timer)
+  {
+    const Time time = timer.timeout().time();
+
+    // An empty wheel starts at the current time (or at the timer if
+    // it is earlier), so that timers don't have to be cascaded (or
+    // even kept in the overflow) for no reason.
+    if (locations.empty()) {
+      position = std::min(ticks(Clock::now(nullptr)), ticks(time));
+      earliest = None();
+    }
+
+    Entry entry{id, timer};
+
+    list<Entry> entries;
+    entries.push_back(entry);
+
+    Location& location = locations[id];
+    location.entry = entries.begin();
+
+    insert(&location, &entries, entries.begin());
+
+    if (earliest.isNone() || time < earliest.get()) {
+      earliest = time;
+    }
+  }
+
+  // Returns true if the timer was pending.
+  bool cancel(uint64_t id)
+  {
+    if (!locations.contains(id)) {
+      return false;
+    }
+
+    const Location& location = locations.at(id);
+
+    if (location.level == LEVELS) {
+      overflow.erase(location.overflow);
+    } else {
+      slots[location.level][location.slot].erase(location.entry);
+      sizes[location.level]--;
+    }
+
+    // NOTE: The earliest time is not updated, it is fine for it to be
+    // too early (see `next()`).
+    locations.erase(id);
+
+    return true;
+  }
+
+  // Removes and returns the timers that have expired at 'now', in
+  // the order of their timeouts.
+  list<Timer> expire(const Time& now)
+  {
+    list<Entry> expired;
+
+    const uint64_t target = ticks(now);
+
+    while (position < target) {
+      // All the timers in the current slot have expired.
+      list<Entry>& slot = slots[0][position & MASK];
+      sizes[0] -= slot.size();
+      expired.splice(expired.end(), slot);
+
+      // Skip to the start of the next slot of the lowest level that
+      // has timers, since no timers need to be cascaded before.
+      uint64_t next = target;
+
+      for (size_t level = 0; level <= LEVELS; level++) {
+        if (level == LEVELS ? !overflow.empty() : sizes[level] > 0) {
+          const size_t bits = SLOT_BITS * level;
+          next = std::min(next, ((position >> bits) + 1) << bits);
+          break;
+        }
+      }
+
+      position = next;
+
+      cascade();
+    }
+
+    // The timers in the current slot might not have expired yet.
+    list<Entry>& slot = slots[0][position & MASK];
+    for (auto it = slot.begin(); it != slot.end();) {
+      auto entry = it++;
+      if (entry->timer.timeout().time() <= now) {
+        expired.splice(expired.end(), slot, entry);
+        sizes[0]--;
+      }
+    }
+
+    // Timers with the same timeout are fired in the order in which
+    // they were created (i.e., by their IDs), since cascading between
+    // the levels of the wheel does not preserve that order.
+    expired.sort([](const Entry& left, const Entry& right) {
+      const Time leftTime = left.timer.timeout().time();
+      const Time rightTime = right.timer.timeout().time();
+
+      return leftTime < rightTime ||
+        (leftTime == rightTime && left.id < right.id);
+    });
+
+    list<Timer> timers;
+    foreach (const Entry& entry, expired) {
+      locations.erase(entry.id);
+      timers.push_back(entry.timer);
+    }
+
+    earliest = first();
+
+    return timers;
+  }
+
+  // Returns the earliest time at which a timer might expire, or None
+  // if there are no timers. Note that this can be earlier than the
+  // timeout of any timer, e.g., if that timer has been canceled or
+  // is in a slot of a higher level of the wheel, in which case the
+  // wheel is advanced (i.e., the timers are cascaded) without any
+  // timers expiring. It is never later than any timeout though.
+  Option<Time> next() const
+  {
+    return earliest;
+  }
+
+  bool empty() const
+  {
+    return locations.empty();
+  }
+
+  void clear()
+  {
+    for (size_t level = 0; level < LEVELS; level++) {
+      foreach (list<Entry>& slot, slots[level]) {
+        slot.clear();
+      }
+
+      sizes[level] = 0;
+    }
+
+    overflow.clear();
+    locations.clear();
+    earliest = None();
+  }
+
+private:
+  static constexpr size_t LEVELS = 4;
+  static constexpr size_t SLOT_BITS = 8;
+  static constexpr size_t SLOTS = 1 << SLOT_BITS;
+  static constexpr uint64_t MASK = SLOTS - 1;
+  static constexpr size_t TICK_BITS = 20;
+
+  struct Entry
+  {
+    uint64_t id;
+    Timer timer;
+  };
+
+  // Where a timer is kept, i.e., the slot of a level of the wheel or
+  // the overflow if the level is `LEVELS`.
+  struct Location
+  {
+    size_t level;
+    size_t slot;
+    list<Entry>::iterator entry;
+    multimap<Time, Entry>::iterator overflow;
+  };
+
+  static uint64_t ticks(const Time& time)
+  {
+    return static_cast<uint64_t>(time.duration().ns()) >> TICK_BITS;
+  }
+
+  static Time time(uint64_t ticks)
+  {
+    return Time::epoch() + Nanoseconds(ticks << TICK_BITS);
+  }
+
+  // Moves the entry from 'entries' into the slot of the wheel (or the
+  // overflow) for its timeout, relative to the current position.
+  void insert(
+      Location* location,
+      list<Entry>* entries,
+      list<Entry>::iterator entry)
+  {
+    // Timers that have already expired are kept in the current slot.
+    const uint64_t tick =
+      std::max(ticks(entry->timer.timeout().time()), position);
+
+    for (size_t level = 0; level < LEVELS; level++) {
+      if (tick - position < (uint64_t(1) << (SLOT_BITS * (level + 1)))) {
+        location->level = level;
+        location->slot = (tick >> (SLOT_BITS * level)) & MASK;
+
+        // NOTE: Splicing keeps the iterator to the entry valid.
+        list<Entry>& slot = slots[level][location->slot];
+        slot.splice(slot.end(), *entries, entry);
+        sizes[level]++;
+        return;
+      }
+    }
+
+    location->level = LEVELS;
+    location->overflow =
+      overflow.emplace(entry->timer.timeout().time(), *entry);
+
+    entries->erase(entry);
+  }
+
+  // Moves the timers of the slots of the higher levels starting at
+  // the current position into the lower levels.
+  void cascade()
+  {
+    for (size_t level = 1; level <= LEVELS; level++) {
+      const size_t bits = SLOT_BITS * level;
+
+      if ((position & ((uint64_t(1) << bits) - 1)) != 0) {
+        break;
+      }
+
+      list<Entry> entries;
+
+      if (level < LEVELS) {
+        entries.swap(slots[level][(position >> bits) & MASK]);
+        sizes[level] -= entries.size();
+      } else {
+        // Move the timers that now fit in the wheel out of the
+        // overflow.
+        const Time end = time(position + (uint64_t(1) << bits));
+
+        auto it = overflow.begin();
+        for (; it != overflow.end() && it->first < end; ++it) {
+          entries.push_back(it->second);
+          locations.at(it->second.id).entry = --entries.end();
+        }
+
+        overflow.erase(overflow.begin(), it);
+      }
+
+      while (!entries.empty()) {
+        insert(&locations.at(entries.front().id), &entries, entries.begin());
+      }
+    }
+  }
+
+  // Returns the earliest time at which a timer might expire.
+  Option<Time> first() const
+  {
+    Option<Time> first;
+
+    // The slots of the first level hold the timers of a single tick,
+    // so the earliest timeout can be determined exactly.
+    if (sizes[0] > 0) {
+      for (size_t i = 0; i < SLOTS; i++) {
+        const list<Entry>& slot = slots[0][(position + i) & MASK];
+        if (!slot.empty()) {
+          foreach (const Entry& entry, slot) {
+            if (first.isNone() || entry.timer.timeout().time() < first.get()) {
+              first = entry.timer.timeout().time();
+            }
+          }
+
+          break;
+        }
+      }
+    }
+
+    // The slots of the other levels are only known to hold timers
+    // that expire after the start of the slot. Note that a slot can
+    // hold timers that expire after a full turn of the level.
+    for (size_t level = 1; level < LEVELS; level++) {
+      if (sizes[level] == 0) {
+        continue;
+      }
+
+      const size_t bits = SLOT_BITS * level;
+
+      for (size_t i = 1; i <= SLOTS; i++) {
+        const uint64_t start = (position >> bits) + i;
+        if (!slots[level][start & MASK].empty()) {
+          if (first.isNone() || time(start << bits) < first.get()) {
+            first = time(start << bits);
+          }
+
+          break;
+        }
+      }
+    }
+
+    if (!overflow.empty() &&
+        (first.isNone() || overflow.begin()->first < first.get())) {
+      first = overflow.begin()->first;
+    }
+
+    return first;
+  }
+
+  // The tick up to which the wheel has advanced, i.e., the timers of
+  // all earlier ticks have expired.
+  uint64_t position;
+
+  std::array<std::array<list<Entry>, SLOTS>, LEVELS> slots;
+
+  // The number of timers in the slots of each level.
+  std::array<size_t, LEVELS> sizes;
+
+  multimap<Time, Entry> overflow;
+
+  // The location of each timer, by the ID of the timer.
+  hashmap<uint64_t, Location> locations;
+
+  Option<Time> earliest;
+};
+
+
+static Timers* timers = new Timers();
 static recursive_mutex* timers_mutex = new recursive_mutex();
 
 
@@ -82,13 +420,10 @@ set<Time>* ticks = new set<Time>();
 // timers are expired. Note that we don't manipulate 'timers' directly
 // so that it's clear from the callsite that the use of 'timers' is
 // within a 'synchronized' block.
-//
-// TODO(benh): Create a generic 'Timers' abstraction which hides this
-// and more away (i.e., all manipulations of 'timers' below).
-Option<Time> next(const map<Time, list<Timer>>& timers)
+Option<Time> next(const Timers& timers)
 {
-  if (!timers.empty()) {
-    Time first = timers.begin()->first;
+  if (timers.next().isSome()) {
+    Time first = timers.next().get();
 
     // If the clock is paused and no timers are expired, the
     // timers cannot fire until the clock is advanced, so we
@@ -116,7 +451,7 @@ void tick(const Time& time);
 // a 'synchronized' block.
 // TODO(bmahler): Consider taking an optional 'now' to avoid
 // excessive syscalls via Clock::now(nullptr).
-void scheduleTick(const map<Time, list<Timer>>& timers, set<Time>* ticks)
+void scheduleTick(const Timers& timers, set<Time>* ticks)
 {
   // Determine when the next 'tick' should fire.
   const Option<Time> next = clock::next(timers);
@@ -151,28 +486,17 @@ void tick(const Time& time)
 
     VLOG(3) << "Handling timers up to " << now;
 
-    foreachkey (const Time& timeout, *timers) {
-      if (timeout > now) {
-        break;
-      }
-
-      VLOG(3) << "Have timeout(s) at " << timeout;
+    timedout = timers->expire(now);
 
-      // Need to toggle 'settling' so that we don't prematurely say
-      // we're settled until after the timers are executed below,
-      // outside of the critical section.
-      if (clock::paused) {
-        clock::settling = true;
-      }
-
-      timedout.splice(timedout.end(), (*timers)[timeout]);
+    // Need to toggle 'settling' so that we don't prematurely say
+    // we're settled until after the timers are executed below,
+    // outside of the critical section.
+    if (clock::paused && !timedout.empty()) {
+      clock::settling = true;
     }
 
-    // Now erase the range of timers that timed out.
-    timers->erase(timers->begin(), timers->upper_bound(now));
-
     // Okay, so the timeout for the next timer should not have fired.
-    CHECK(timers->empty() || (timers->begin()->first > now));
+    CHECK(timers->next().isNone() || (timers->next().get() > now));
 
     // Remove this tick from the scheduled 'ticks', it may have
     // been removed already if the clock was paused / manipulated
@@ -190,8 +514,8 @@ void tick(const Time& time)
   // executing expired timers.
   synchronized (timers_mutex) {
     if (clock::paused &&
-        (timers->size() == 0 ||
-         timers->begin()->first > *clock::current)) {
+        (timers->next().isNone() ||
+         timers->next().get() > *clock::current)) {
       VLOG(3) << "Clock has settled";
       clock::settling = false;
     }
@@ -218,8 +542,8 @@ void Clock::finalize()
 
     // This, along with the `timers_mutex`, is all that is required to clean
     // up any pending timers.  Timers are triggered via "ticks".  However,
-    // we do not need to clear `ticks` because a "tick" with an empty `timers`
-    // map will effectively be a no-op.
+    // we do not need to clear `ticks` because a "tick" with empty `timers`
+    // will effectively be a no-op.
     timers->clear();
   }
 }
@@ -279,17 +603,16 @@ Timer Clock::timer(
 
   // Add the timer.
   synchronized (timers_mutex) {
-    if (timers->size() == 0 ||
-        timer.timeout().time() < timers->begin()->first) {
+    if (timers->next().isNone() ||
+        timer.timeout().time() < timers->next().get()) {
       // Need to interrupt the loop to update/set timer repeat.
-      (*timers)[timer.timeout().time()].push_back(timer);
+      timers->add(timer.id, timer);
 
       // Schedule another "tick" if necessary.
       clock::scheduleTick(*timers, clock::ticks);
     } else {
       // Timer repeat is adequate, just add the timeout.
-      CHECK(timers->size() >= 1);
-      (*timers)[timer.timeout().time()].push_back(timer);
+      timers->add(timer.id, timer);
     }
   }
 
@@ -299,22 +622,12 @@ Timer Clock::timer(
 
 bool Clock::cancel(const Timer& timer)
 {
-  bool canceled = false;
   synchronized (timers_mutex) {
-    // Check if the timeout is still pending, and if so, erase it. In
-    // addition, erase an empty list if we just removed the last
-    // timeout.
-    Time time = timer.timeout().time();
-    if (timers->count(time) > 0) {
-      canceled = true;
-      (*timers)[time].remove(timer);
-      if ((*timers)[time].empty()) {
-        timers->erase(time);
-      }
-    }
+    // Check if the timer is still pending, and if so, erase it.
+    return timers->cancel(timer.id);
   }
 
-  return canceled;
+  UNREACHABLE();
 }
 
 
@@ -458,8 +771,8 @@ bool Clock::settled()
     if (clock::settling) {
       VLOG(3) << "Clock still not settled";
       return false;
-    } else if (timers->size() == 0 ||
-               timers->begin()->first > *clock::current) {
+    } else if (timers->next().isNone() ||
+               timers->next().get() > *clock::current) {
       VLOG(3) << "Clock is settled";
       return true;
     }
@@ -595,6 +595,7 @@ private:
     decoder->response = new http::Response();
     decoder->response->type = http::Response::PIPE;
     decoder->writer = None();
+    decoder->decompressor.reset();
 
     return 0;
   }
@@ -670,12 +671,12 @@ private:
       return 1;
     }
 
-    // We cannot provide streaming gzip decompression!
     Option<std::string> encoding =
       decoder->response->headers.get("Content-Encoding");
+
     if (encoding.isSome() && encoding.get() == "gzip") {
-      decoder->failure = true;
-      return 1;
+      decoder->decompressor =
+        Owned<gzip::Decompressor>(new gzip::Decompressor());
     }
 
     CHECK_NONE(decoder->writer);
@@ -699,7 +700,22 @@ private:
     CHECK_SOME(decoder->writer);
 
     http::Pipe::Writer writer = decoder->writer.get(); // Remove const.
-    writer.write(std::string(data, length));
+
+    std::string body;
+    if (decoder->decompressor.get() != nullptr) {
+      Try<std::string> decompressed =
+        decoder->decompressor->decompress(std::string(data, length));
+
+      if (decompressed.isError()) {
+        return 1;
+      }
+
+      body = std::move(decompressed.get());
+    } else {
+      body = std::string(data, length);
+    }
+
+    writer.write(std::move(body));
 
     return 0;
   }
@@ -711,6 +727,13 @@ private:
     CHECK_SOME(decoder->writer);
 
     http::Pipe::Writer writer = decoder->writer.get(); // Remove const.
+
+    if (decoder->decompressor.get() != nullptr &&
+        !decoder->decompressor->finished()) {
+      writer.fail("Failed to decompress body");
+      return 1;
+    }
+
     writer.close();
 
     decoder->writer = None();
@@ -734,6 +757,7 @@ private:
 
   http::Response* response;
   Option<http::Pipe::Writer> writer;
+  Owned<gzip::Decompressor> decompressor;
 
   std::deque<http::Response*> responses;
 };
@@ -17,22 +17,65 @@
 #include <time.h>
 
 #include <map>
+#include <memory>
 #include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
 
+#include <process/future.hpp>
 #include <process/http.hpp>
 #include <process/process.hpp>
+#include <process/socket.hpp>
 
 #include <stout/foreach.hpp>
 #include <stout/gzip.hpp>
 #include <stout/hashmap.hpp>
+#include <stout/nothing.hpp>
 #include <stout/numify.hpp>
+#include <stout/option.hpp>
 #include <stout/os.hpp>
+#include <stout/strings.hpp>
 
 
 namespace process {
 
 const uint32_t GZIP_MINIMUM_BODY_LENGTH = 1024;
 
+// Reads files in blocks of this size when compressing them.
+const size_t GZIP_FILE_BLOCK_SIZE = 64 * 1024;
+
+namespace internal {
+
+// The compression level and the minimum size of a body for it to get
+// compressed, when the request accepts the gzip encoding. These are
+// set from the `LIBPROCESS_GZIP_LEVEL` and
+// `LIBPROCESS_GZIP_MINIMUM_BODY_LENGTH` environment variables when
+// libprocess is initialized.
+extern int gzip_level;
+extern size_t gzip_minimum_body_length;
+
+
+// Returns whether a response with the given headers may be gzip
+// compressed, i.e., whether its handler neither encoded it already nor
+// asked for it to be sent as is using a 'Content-Encoding: identity'
+// header. The latter header is removed, since 'identity' is not meant
+// to be sent as a content coding.
+inline bool encodable(http::Headers* headers)
+{
+  Option<std::string> encoding = headers->get("Content-Encoding");
+
+  if (encoding.isSome() &&
+      strings::lower(strings::trim(encoding.get())) == "identity") {
+    headers->erase("Content-Encoding");
+    return false;
+  }
+
+  return encoding.isNone();
+}
+
+} // namespace internal {
+
 // Forward declarations.
 class Encoder;
 
@@ -61,8 +104,32 @@ public:
 class DataEncoder : public Encoder
 {
 public:
-  DataEncoder(const std::string& _data)
-    : data(_data), index(0) {}
+  // A region of the data to send, along with shared ownership of the
+  // memory it is in so that the data does not need to be copied into
+  // the encoder (e.g., the body of a response).
+  struct Segment
+  {
+    std::shared_ptr<const void> owner;
+    const char* data;
+    size_t size;
+  };
+
+  DataEncoder(std::string data)
+  {
+    std::shared_ptr<const std::string> owner =
+      std::make_shared<const std::string>(std::move(data));
+
+    segments.push_back({owner, owner->data(), owner->size()});
+    size = owner->size();
+  }
+
+  DataEncoder(std::vector<Segment> _segments)
+    : segments(std::move(_segments))
+  {
+    foreach (const Segment& segment, segments) {
+      size += segment.size;
+    }
+  }
 
   virtual ~DataEncoder() {}
 
@@ -71,12 +138,28 @@ public:
     return Encoder::DATA;
   }
 
-  virtual const char* next(size_t* length)
+  // Returns the remaining data as buffers that can be sent with a
+  // single (gathering) write, which stay valid for as long as the
+  // encoder does.
+  virtual std::vector<network::internal::SocketImpl::Buffer> next(
+      size_t* length)
   {
-    size_t temp = index;
-    index = data.size();
-    *length = data.size() - temp;
-    return data.data() + temp;
+    std::vector<network::internal::SocketImpl::Buffer> buffers;
+
+    size_t skip = index;
+    foreach (const Segment& segment, segments) {
+      if (skip >= segment.size) {
+        skip -= segment.size;
+        continue;
+      }
+
+      buffers.push_back({segment.data + skip, segment.size - skip});
+      skip = 0;
+    }
+
+    *length = size - index;
+    index = size;
+    return buffers;
   }
 
   virtual void backup(size_t length)
@@ -88,12 +171,13 @@ public:
 
   virtual size_t remaining() const
   {
-    return data.size() - index;
+    return size - index;
   }
 
 private:
-  const std::string data;
-  size_t index;
+  std::vector<Segment> segments;
+  size_t size = 0;
+  size_t index = 0;
 };
 
 
@@ -157,19 +241,47 @@ public:
   HttpResponseEncoder(
       const http::Response& response,
       const http::Request& request)
+    : HttpResponseEncoder(
+          std::make_shared<const http::Response>(response),
+          request) {}
+
+  // NOTE: The encoder shares the response rather than copying it,
+  // which avoids copying the body when it is not compressed.
+  HttpResponseEncoder(
+      const std::shared_ptr<const http::Response>& response,
+      const http::Request& request)
     : DataEncoder(encode(response, request)) {}
 
   static std::string encode(
       const http::Response& response,
       const http::Request& request)
+  {
+    std::string encoded;
+
+    foreach (
+        const Segment& segment,
+        encode(std::make_shared<const http::Response>(response), request)) {
+      encoded.append(segment.data, segment.size);
+    }
+
+    return encoded;
+  }
+
+private:
+  // Returns the status line and headers, followed by the body (if
+  // necessary) which shares ownership of either `response` or of the
+  // compressed body.
+  static std::vector<Segment> encode(
+      const std::shared_ptr<const http::Response>& response,
+      const http::Request& request)
   {
     std::ostringstream out;
 
     // TODO(benh): Check version?
 
-    out << "HTTP/1.1 " << response.status << "\r\n";
+    out << "HTTP/1.1 " << response->status << "\r\n";
 
-    auto headers = response.headers;
+    auto headers = response->headers;
 
     // HTTP 1.1 requires the "Date" header. In the future once we
     // start checking the version (above) then we can conditionally
@@ -190,18 +302,21 @@ public:
     headers["Date"] = date;
 
     // Should we compress this response?
-    std::string body = response.body;
+    std::shared_ptr<const std::string> body(response, &response->body);
 
-    if (response.type == http::Response::BODY &&
-        response.body.length() >= GZIP_MINIMUM_BODY_LENGTH &&
-        !headers.contains("Content-Encoding") &&
+    if (internal::encodable(&headers) &&
+        response->type == http::Response::BODY &&
+        response->body.length() >= internal::gzip_minimum_body_length &&
         request.acceptsEncoding("gzip")) {
-      Try<std::string> compressed = gzip::compress(body);
+      Try<std::string> compressed =
+        gzip::compress(response->body, internal::gzip_level);
       if (compressed.isError()) {
         LOG(WARNING) << "Failed to gzip response body: " << compressed.error();
       } else {
-        body = compressed.get();
-        headers["Content-Length"] = stringify(body.length());
+        body = std::make_shared<const std::string>(
+            std::move(compressed.get()));
+
+        headers["Content-Length"] = stringify(body->length());
         headers["Content-Encoding"] = "gzip";
       }
     }
@@ -212,39 +327,46 @@ public:
 
     // Add a Content-Length header if the response is of type "none"
     // or "body" and no Content-Length header has been supplied.
-    if (response.type == http::Response::NONE &&
+    if (response->type == http::Response::NONE &&
         !headers.contains("Content-Length")) {
       out << "Content-Length: 0\r\n";
-    } else if (response.type == http::Response::BODY &&
+    } else if (response->type == http::Response::BODY &&
                !headers.contains("Content-Length")) {
-      out << "Content-Length: " << body.size() << "\r\n";
+      out << "Content-Length: " << body->size() << "\r\n";
     }
 
     // Use a CRLF to mark end of headers.
     out << "\r\n";
 
+    std::shared_ptr<const std::string> head =
+      std::make_shared<const std::string>(out.str());
+
+    std::vector<Segment> segments = {{head, head->data(), head->size()}};
+
     // Add the body if necessary.
-    if (response.type == http::Response::BODY) {
+    if (response->type == http::Response::BODY) {
       // If the Content-Length header was supplied, only write as much data
       // as the length specifies.
       Result<uint32_t> length = numify<uint32_t>(headers.get("Content-Length"));
-      if (length.isSome() && length.get() <= body.length()) {
-        out.write(body.data(), length.get());
+      if (length.isSome() && length.get() <= body->length()) {
+        segments.push_back({body, body->data(), length.get()});
       } else {
-        out.write(body.data(), body.size());
+        segments.push_back({body, body->data(), body->size()});
       }
     }
 
-    return out.str();
+    return segments;
   }
 };
 
 
+// Sends 'size' bytes of a file starting at 'offset' (e.g., a range of
+// the file requested with a 'Range' header).
 class FileEncoder : public Encoder
 {
 public:
-  FileEncoder(int_fd _fd, size_t _size)
-    : fd(_fd), size(_size), index(0) {}
+  FileEncoder(int_fd _fd, size_t _size, off_t _offset = 0)
+    : fd(_fd), size(_offset + _size), index(_offset) {}
 
   virtual ~FileEncoder()
   {
@@ -279,10 +401,38 @@ public:
 
 private:
   int_fd fd;
-  off_t size;
+  off_t size; // The offset right after the last byte to send.
   off_t index;
 };
 
+
+// A `DataEncoder` whose future gets satisfied once all of its data
+// has been sent, or discarded if it could not be (e.g., the socket
+// got closed). This allows a sender to produce more data only once
+// the previous data has been sent (see `HttpProxy::deflate`).
+class NotifyingDataEncoder : public DataEncoder
+{
+public:
+  NotifyingDataEncoder(std::string data) : DataEncoder(std::move(data)) {}
+
+  virtual ~NotifyingDataEncoder()
+  {
+    if (remaining() == 0) {
+      promise.set(Nothing());
+    } else {
+      promise.discard();
+    }
+  }
+
+  Future<Nothing> future() const
+  {
+    return promise.future();
+  }
+
+private:
+  Promise<Nothing> promise;
+};
+
 }  // namespace process {
 
 #endif // __ENCODER_HPP__
@@ -0,0 +1,308 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+
+#ifndef __EVENT_QUEUE_HPP__
+#define __EVENT_QUEUE_HPP__
+
+#include <stddef.h>
+
+#include <atomic>
+
+#include <process/event.hpp>
+
+#include <stout/synchronized.hpp>
+
+namespace process {
+
+// Index of each type of event into the per type counters of an
+// `EventQueue`.
+template <typename T>
+struct EventIndex;
+
+template <>
+struct EventIndex<MessageEvent> { static constexpr size_t value = 0; };
+
+template <>
+struct EventIndex<DispatchEvent> { static constexpr size_t value = 1; };
+
+template <>
+struct EventIndex<HttpEvent> { static constexpr size_t value = 2; };
+
+template <>
+struct EventIndex<ExitedEvent> { static constexpr size_t value = 3; };
+
+template <>
+struct EventIndex<TerminateEvent> { static constexpr size_t value = 4; };
+
+
+// The queue of events delivered to a process (its "mailbox").
+//
+// Any number of threads can enqueue events without blocking: events
+// are linked together intrusively (see `Event::next`) and an enqueue
+// is a single atomic exchange of the head of the queue (this is
+// Dmitry Vyukov's intrusive MPSC node-based queue). Only the thread
+// currently running the process (the "consumer") may dequeue.
+//
+// Injected events (e.g., a `TerminateEvent` from `terminate(pid,
+// true)`) are kept on a separate queue which the consumer drains
+// first, which is equivalent to pushing them onto the front.
+//
+// The number of queued events of each type is kept up to date on
+// every enqueue and dequeue so that `count` is constant time and can
+// be called from any thread.
+class EventQueue
+{
+public:
+  EventQueue()
+  {
+    for (size_t i = 0; i < TYPES; i++) {
+      counts[i].store(0);
+    }
+  }
+
+  ~EventQueue()
+  {
+    Event* event = nullptr;
+    while ((event = dequeue()) != nullptr) {
+      delete event;
+    }
+  }
+
+  // Can be called from any thread.
+  void enqueue(Event* event, bool inject = false)
+  {
+    counts[index(*event)].fetch_add(1, std::memory_order_relaxed);
+
+    if (inject) {
+      injected.push(event);
+    } else {
+      events.push(event);
+    }
+  }
+
+  // Returns the next event, or `nullptr` if no event can currently be
+  // dequeued. Note that an event that is in the middle of being
+  // enqueued by another thread might not be returned yet; that thread
+  // is guaranteed to finish the enqueue shortly after.
+  //
+  // Must only be called by the consumer.
+  Event* dequeue()
+  {
+    Event* event = nullptr;
+
+    synchronized (consumer) {
+      event = injected.pop();
+
+      if (event == nullptr) {
+        event = events.pop();
+      }
+    }
+
+    if (event != nullptr) {
+      counts[index(*event)].fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    return event;
+  }
+
+  // Returns true if `dequeue` would not return an event.
+  //
+  // Must only be called by the consumer.
+  bool empty()
+  {
+    bool result = true;
+
+    synchronized (consumer) {
+      result = injected.empty() && events.empty();
+    }
+
+    return result;
+  }
+
+  // Returns the number of queued events of type `T`.
+  template <typename T>
+  size_t count() const
+  {
+    return counts[EventIndex<T>::value].load(std::memory_order_relaxed);
+  }
+
+  // Visits each queued event in the order it will be dequeued. This
+  // can be called from any thread: the consumer is blocked from
+  // dequeuing (and thus deleting) events while visiting.
+  void visit(EventVisitor* visitor)
+  {
+    synchronized (consumer) {
+      injected.visit(visitor);
+      events.visit(visitor);
+    }
+  }
+
+private:
+  // An intrusive multi-producer single-consumer queue of events.
+  class Queue
+  {
+  public:
+    Queue() : head(&stub), tail(&stub) {}
+
+    void push(Event* event)
+    {
+      event->next.store(nullptr, std::memory_order_relaxed);
+
+      Event* previous = head.exchange(event, std::memory_order_acq_rel);
+
+      // NOTE: Until the previous event is linked to this one the
+      // consumer can not see this event (nor any event enqueued after
+      // it), see `pop`.
+      previous->next.store(event, std::memory_order_release);
+    }
+
+    Event* pop()
+    {
+      Event* first = tail;
+      Event* next = first->next.load(std::memory_order_acquire);
+
+      if (first == &stub) {
+        if (next == nullptr) {
+          return nullptr;
+        }
+
+        tail = next;
+        first = next;
+        next = next->next.load(std::memory_order_acquire);
+      }
+
+      if (next != nullptr) {
+        tail = next;
+        return first;
+      }
+
+      // If `first` is not the last event then a producer is in the
+      // middle of a `push`, and we can't dequeue until it is done.
+      if (first != head.load(std::memory_order_acquire)) {
+        return nullptr;
+      }
+
+      // Put the stub back behind the last event so that the event can
+      // be dequeued without leaving the queue without a node.
+      push(&stub);
+
+      next = first->next.load(std::memory_order_acquire);
+
+      if (next != nullptr) {
+        tail = next;
+        return first;
+      }
+
+      return nullptr;
+    }
+
+    // Returns true if `pop` would return `nullptr`.
+    bool empty() const
+    {
+      Event* first = tail;
+      Event* next = first->next.load(std::memory_order_acquire);
+
+      if (first == &stub) {
+        if (next == nullptr) {
+          return true;
+        }
+
+        first = next;
+        next = next->next.load(std::memory_order_acquire);
+      }
+
+      if (next != nullptr) {
+        return false;
+      }
+
+      return first != head.load(std::memory_order_acquire);
+    }
+
+    void visit(EventVisitor* visitor) const
+    {
+      const Event* event = tail;
+
+      while (event != nullptr) {
+        if (event != &stub) {
+          event->visit(visitor);
+        }
+
+        event = event->next.load(std::memory_order_acquire);
+      }
+    }
+
+  private:
+    // Placeholder node so that the queue is never without a node.
+    struct Stub : Event
+    {
+      virtual void visit(EventVisitor* visitor) const {}
+    } stub;
+
+    // Producers enqueue at the head, the consumer dequeues at the tail.
+    std::atomic<Event*> head;
+    Event* tail;
+  };
+
+  static size_t index(const Event& event)
+  {
+    struct IndexVisitor : EventVisitor
+    {
+      virtual void visit(const MessageEvent&)
+      {
+        index = EventIndex<MessageEvent>::value;
+      }
+
+      virtual void visit(const DispatchEvent&)
+      {
+        index = EventIndex<DispatchEvent>::value;
+      }
+
+      virtual void visit(const HttpEvent&)
+      {
+        index = EventIndex<HttpEvent>::value;
+      }
+
+      virtual void visit(const ExitedEvent&)
+      {
+        index = EventIndex<ExitedEvent>::value;
+      }
+
+      virtual void visit(const TerminateEvent&)
+      {
+        index = EventIndex<TerminateEvent>::value;
+      }
+
+      size_t index = 0;
+    } visitor;
+
+    event.visit(&visitor);
+
+    return visitor.index;
+  }
+
+  static constexpr size_t TYPES = 5;
+
+  Queue injected;
+  Queue events;
+
+  // Number of queued events of each type, see `EventIndex`.
+  std::atomic_size_t counts[TYPES];
+
+  // Held by the consumer while dequeuing, so that `visit` can safely
+  // walk the queued events from another thread. Producers never
+  // acquire it.
+  std::atomic_flag consumer = ATOMIC_FLAG_INIT;
+};
+
+} // namespace process {
+
+#endif // __EVENT_QUEUE_HPP__
@@ -696,6 +696,12 @@ bool Headers::contains(const string& key) const
 }
 
 
+size_t Headers::erase(const string& key)
+{
+  return headers.erase(key);
+}
+
+
 size_t Headers::size() const
 {
   return headers.size();
@@ -1068,10 +1074,7 @@ Pipe::Reader encode(const Request& request)
 
   // TODO(bmahler): Use a 'Request' and a 'RequestEncoder' here!
   // Currently this does not handle 'gzip' content encoding,
-  // unless the caller manually compresses the 'body'. For
-  // streaming requests we must wipe 'gzip' as an acceptable
-  // encoding as we don't currently have streaming gzip utilities
-  // to support decoding a streaming gzip response!
+  // unless the caller manually compresses the 'body'.
 
   // Emit the headers.
   foreachpair (const string& key, const string& value, headers) {
@@ -1531,8 +1534,8 @@ Future<Nothing> send(network::Socket socket, Encoder* encoder)
       [=]() {
         switch (encoder->kind()) {
           case Encoder::DATA: {
-            const char* data = static_cast<DataEncoder*>(encoder)->next(size);
-            return socket.send(data, *size);
+            return socket.send(
+                static_cast<DataEncoder*>(encoder)->next(size));
           }
           case Encoder::FILE: {
             off_t offset = 0;
@@ -20,11 +20,14 @@
 #include <openssl/ssl.h>
 #include <openssl/err.h>
 
+#include <vector>
+
 #include <process/queue.hpp>
 #include <process/socket.hpp>
 
 #include <process/ssl/flags.hpp>
 
+#include <stout/foreach.hpp>
 #include <stout/net.hpp>
 #include <stout/synchronized.hpp>
 
@@ -69,6 +72,7 @@
 
 using std::queue;
 using std::string;
+using std::vector;
 
 // Specialization of 'synchronize' to use bufferevent with the
 // 'synchronized' macro.
@@ -704,6 +708,23 @@ Future<size_t> LibeventSSLSocketImpl::recv(char* data, size_t size)
 
 Future<size_t> LibeventSSLSocketImpl::send(const char* data, size_t size)
 {
+  return send(vector<Buffer>{{data, size}});
+}
+
+
+Future<size_t> LibeventSSLSocketImpl::send(const vector<Buffer>& buffers)
+{
+  size_t size = 0;
+  foreach (const Buffer& buffer, buffers) {
+    size += buffer.size;
+  }
+
+  // Like `SocketImpl::send`, there is nothing to send if all the
+  // buffers are empty.
+  if (size == 0) {
+    return 0;
+  }
+
   // Optimistically construct a 'SendRequest' and future.
   Owned<SendRequest> request(new SendRequest(size));
   Future<size_t> future = request->promise.future();
@@ -723,10 +744,14 @@ Future<size_t> LibeventSSLSocketImpl::send(const char* data, size_t size)
     std::swap(request, send_request);
   }
 
+  // NOTE: The data of all the buffers is copied into one `evbuffer`
+  // (which is handed to the bufferevent below), the only copy we make.
   evbuffer* buffer = CHECK_NOTNULL(evbuffer_new());
 
-  int result = evbuffer_add(buffer, data, size);
-  CHECK_EQ(0, result);
+  foreach (const Buffer& _buffer, buffers) {
+    int result = evbuffer_add(buffer, _buffer.data, _buffer.size);
+    CHECK_EQ(0, result);
+  }
 
   // Extend the life-time of 'this' through the execution of the
   // lambda in the event loop. Note: The 'self' needs to be explicitly
@@ -21,6 +21,7 @@
 
 #include <atomic>
 #include <memory>
+#include <vector>
 
 #include <process/queue.hpp>
 #include <process/socket.hpp>
@@ -44,6 +45,7 @@ public:
   virtual Future<size_t> recv(char* data, size_t size);
   // Send does not currently support discard. See implementation.
   virtual Future<size_t> send(const char* data, size_t size);
+  virtual Future<size_t> send(const std::vector<Buffer>& buffers);
   virtual Future<size_t> sendfile(int_fd fd, off_t offset, size_t size);
   virtual Try<Nothing> listen(int backlog);
   virtual Future<std::shared_ptr<SocketImpl>> accept();
@@ -14,13 +14,21 @@
 #ifdef __WINDOWS__
 #include <stout/windows.hpp>
 #else
+#include <limits.h>
+#include <string.h>
+
 #include <netinet/tcp.h>
+#include <sys/uio.h>
 #endif // __WINDOWS__
 
+#include <algorithm>
+#include <vector>
+
 #include <process/io.hpp>
 #include <process/network.hpp>
 #include <process/socket.hpp>
 
+#include <stout/foreach.hpp>
 #include <stout/os/sendfile.hpp>
 #include <stout/os/strerror.hpp>
 #include <stout/os.hpp>
@@ -29,6 +37,7 @@
 #include "poll_socket.hpp"
 
 using std::string;
+using std::vector;
 
 namespace process {
 namespace network {
@@ -221,6 +230,69 @@ Future<size_t> socket_send_data(
 }
 
 
+#ifndef __WINDOWS__
+Future<size_t> socket_send_buffers(
+    const std::shared_ptr<PollSocketImpl>& impl,
+    const vector<SocketImpl::Buffer>& buffers)
+{
+  // NOTE: We use `sendmsg` rather than `writev` since only the former
+  // lets us ask for no SIGPIPE, like `net::send` does above. At most
+  // `IOV_MAX` buffers can be sent at once, the caller sends the rest
+  // of the buffers once these have been sent.
+  vector<iovec> iov;
+  iov.reserve(std::min(buffers.size(), static_cast<size_t>(IOV_MAX)));
+
+  foreach (const SocketImpl::Buffer& buffer, buffers) {
+    if (iov.size() == static_cast<size_t>(IOV_MAX)) {
+      break;
+    }
+
+    if (buffer.size > 0) {
+      iov.push_back({const_cast<char*>(buffer.data), buffer.size});
+    }
+  }
+
+  // Like `SocketImpl::send`, there is nothing to send if all the
+  // buffers are empty.
+  if (iov.empty()) {
+    return 0;
+  }
+
+  msghdr message;
+  memset(&message, 0, sizeof(message));
+  message.msg_iov = iov.data();
+  message.msg_iovlen = iov.size();
+
+  while (true) {
+    ssize_t length = ::sendmsg(impl->get(), &message, MSG_NOSIGNAL);
+
+    if (length < 0 && net::is_restartable_error(errno)) {
+      // Interrupted, try again now.
+      continue;
+    } else if (length < 0 && net::is_retryable_error(errno)) {
+      // Might block, try again later.
+      return io::poll(impl->get(), io::WRITE)
+        .then(lambda::bind(&internal::socket_send_buffers, impl, buffers));
+    } else if (length <= 0) {
+      // Socket error or closed.
+      if (length < 0) {
+        const string error = os::strerror(errno);
+        VLOG(1) << "Socket error while sending: " << error;
+        return Failure(ErrnoError("Socket send failed"));
+      } else {
+        VLOG(1) << "Socket closed while sending";
+        return length;
+      }
+    } else {
+      CHECK(length > 0);
+
+      return length;
+    }
+  }
+}
+#endif // __WINDOWS__
+
+
 Future<size_t> socket_send_file(
     const std::shared_ptr<PollSocketImpl>& impl,
     int_fd fd,
@@ -276,6 +348,18 @@ Future<size_t> PollSocketImpl::send(const char* data, size_t size)
 }
 
 
+#ifndef __WINDOWS__
+Future<size_t> PollSocketImpl::send(const vector<Buffer>& buffers)
+{
+  return io::poll(get(), io::WRITE)
+    .then(lambda::bind(
+        &internal::socket_send_buffers,
+        shared(this),
+        buffers));
+}
+#endif // __WINDOWS__
+
+
 Future<size_t> PollSocketImpl::sendfile(int_fd fd, off_t offset, size_t size)
 {
   return io::poll(get(), io::WRITE)
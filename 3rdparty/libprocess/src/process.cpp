@@ -60,6 +60,8 @@
 #include <utility>
 #include <vector>
 
+#include <boost/shared_array.hpp>
+
 #include <process/address.hpp>
 #include <process/check.hpp>
 #include <process/clock.hpp>
@@ -90,6 +92,7 @@
 
 #include <process/ssl/flags.hpp>
 
+#include <stout/bytes.hpp>
 #include <stout/duration.hpp>
 #include <stout/flags.hpp>
 #include <stout/foreach.hpp>
@@ -100,6 +103,7 @@
 #include <stout/os.hpp>
 #include <stout/os/strerror.hpp>
 #include <stout/path.hpp>
+#include <stout/result.hpp>
 #include <stout/stringify.hpp>
 #include <stout/strings.hpp>
 #include <stout/synchronized.hpp>
@@ -110,6 +114,7 @@
 #include "decoder.hpp"
 #include "encoder.hpp"
 #include "event_loop.hpp"
+#include "event_queue.hpp"
 #include "gate.hpp"
 #include "process_reference.hpp"
 
@@ -124,6 +129,7 @@ using process::http::OK;
 using process::http::Request;
 using process::http::Response;
 using process::http::ServiceUnavailable;
+using process::http::Status;
 
 using process::http::authentication::Authenticator;
 using process::http::authentication::AuthenticationResult;
@@ -207,14 +213,73 @@ struct Flags : public virtual flags::FlagsBase
 
           return None();
         });
+
+    add(&Flags::gzip_level,
+        "gzip_level",
+        "The level at which HTTP response bodies are compressed when\n"
+        "the request accepts the gzip encoding, within [-1, 9]. Lower\n"
+        "levels trade compression ratio for throughput; -1 selects\n"
+        "zlib's default level.",
+        [](const Option<int>& value) -> Option<Error> {
+          if (value.isSome()) {
+            if (value.get() != Z_DEFAULT_COMPRESSION &&
+                (value.get() < Z_NO_COMPRESSION ||
+                 value.get() > Z_BEST_COMPRESSION)) {
+              return Error(
+                  "LIBPROCESS_GZIP_LEVEL=" + stringify(value.get()) +
+                  " is not a valid compression level");
+            }
+          }
+
+          return None();
+        });
+
+    add(&Flags::gzip_minimum_body_length,
+        "gzip_minimum_body_length",
+        "The minimum size of an HTTP response body (or of a file being\n"
+        "served) for it to be gzip compressed when the request accepts\n"
+        "the gzip encoding. Files are only compressed if their content\n"
+        "type is textual (e.g., 'text/html' or 'application/json').\n"
+        "Streamed responses are compressed regardless of their size,\n"
+        "since it is not known when their headers are sent.\n"
+        "Defaults to " + stringify(Bytes(GZIP_MINIMUM_BODY_LENGTH)) + ".");
   }
 
   Option<net::IP> ip;
   Option<net::IP> advertise_ip;
   Option<int> port;
   Option<int> advertise_port;
+  Option<int> gzip_level;
+  Option<Bytes> gzip_minimum_body_length;
 };
 
+
+int gzip_level = Z_DEFAULT_COMPRESSION;
+size_t gzip_minimum_body_length = GZIP_MINIMUM_BODY_LENGTH;
+
+
+// Returns whether a file with the given headers is worth compressing,
+// i.e., whether its content type is textual. Other files (e.g.,
+// images or archives) are usually compressed already, and sending
+// them uncompressed allows them to be sent using `sendfile`.
+static bool compressible(const http::Headers& headers)
+{
+  Option<string> type = headers.get("Content-Type");
+  if (type.isNone()) {
+    return false;
+  }
+
+  // Ignore any parameters, e.g., 'text/html; charset=utf-8'.
+  const string mediaType =
+    strings::lower(strings::trim(strings::split(type.get(), ";")[0]));
+
+  return strings::startsWith(mediaType, "text/") ||
+         mediaType == "application/javascript" ||
+         mediaType == "application/json" ||
+         mediaType == "application/xml" ||
+         mediaType == "image/svg+xml";
+}
+
 } // namespace internal {
 
 namespace ID {
@@ -283,6 +348,16 @@ private:
   // Handles stream based responses.
   void stream(const Owned<Request>& request, const Future<string>& chunk);
 
+  // Reads the next block of the current file.
+  void deflate(const Owned<Request>& request);
+
+  // Compresses a block read from the current file and sends it,
+  // continuing with the next block once it has been sent.
+  void _deflate(
+      const Owned<Request>& request,
+      const boost::shared_array<char>& data,
+      const Future<size_t>& length);
+
   Socket socket; // Wrap the socket to keep it from getting closed.
 
   // Describes a queue "item" that wraps the future to the response
@@ -301,6 +376,15 @@ private:
   queue<Item*> items;
 
   Option<http::Pipe::Reader> pipe; // Current pipe, if streaming.
+
+  Option<int_fd> file; // Current file, if being compressed.
+
+  // Current read of the file, if any. The file must not be closed
+  // while it is being read, since its descriptor could get reused.
+  Option<Future<size_t>> reading;
+
+  // Compresses the current pipe or file, if the request accepts gzip.
+  Owned<gzip::Compressor> compressor;
 };
 
 
@@ -387,6 +471,9 @@ public:
   void send(const Response& response,
             const Request& request,
             const Socket& socket);
+  void send(const std::shared_ptr<const Response>& response,
+            const Request& request,
+            const Socket& socket);
   void send(Message* message,
             const SocketImpl::Kind& kind = SocketImpl::DEFAULT_KIND());
 
@@ -533,12 +620,29 @@ private:
   // Gates for waiting threads (protected by processes_mutex).
   map<ProcessBase*, Gate*> gates;
 
-  // Queue of runnable processes (implemented using list).
-  list<ProcessBase*> runq;
-  std::recursive_mutex runq_mutex;
+  // Queue of runnable processes belonging to a single worker thread.
+  // A worker pops from the front of its own queue and, when that is
+  // empty, steals from the back of the other workers' queues. Each
+  // queue has its own lock so workers only contend with each other
+  // when stealing, rather than on every enqueue/dequeue.
+  struct RunQueue
+  {
+    std::mutex mutex;
+    deque<ProcessBase*> processes;
+  };
+
+  // One run queue per worker thread (created in `init_threads`).
+  vector<Owned<RunQueue>> runqs;
 
-  // Number of running processes, to support Clock::settle operation.
-  std::atomic_long running;
+  // Used to spread processes that are enqueued by non-worker threads
+  // (e.g., the event loop) across the run queues.
+  std::atomic_ulong next_runq;
+
+  // Number of processes that are either on a run queue or running,
+  // to support Clock::settle operation. A process is counted from
+  // the moment it is enqueued until `resume` returns, so that there
+  // is never a window where a runnable process is unaccounted for.
+  std::atomic_long pending;
 
   // Stores the thread handles so that we can join during shutdown.
   vector<std::thread*> threads;
@@ -615,6 +719,10 @@ PID<Logging> _logging;
 // Per thread process pointer.
 THREAD_LOCAL ProcessBase* __process__ = nullptr;
 
+// Per thread index of the worker's run queue, -1 if the current
+// thread is not a worker thread.
+static THREAD_LOCAL long __worker__ = -1;
+
 // Per thread executor pointer.
 THREAD_LOCAL Executor* _executor_ = nullptr;
 
@@ -1104,6 +1212,15 @@ bool initialize(
     __address__.port = flags.port.get();
   }
 
+  if (flags.gzip_level.isSome()) {
+    internal::gzip_level = flags.gzip_level.get();
+  }
+
+  if (flags.gzip_minimum_body_length.isSome()) {
+    internal::gzip_minimum_body_length =
+      flags.gzip_minimum_body_length->bytes();
+  }
+
   // Create a "server" socket for communicating.
   Try<Socket> create = Socket::create();
   if (create.isError()) {
@@ -1369,6 +1486,19 @@ void HttpProxy::finalize()
   }
   pipe = None();
 
+  if (file.isSome()) {
+    const int_fd fd = file.get();
+
+    if (reading.isSome()) {
+      reading->discard();
+      reading->onAny([fd]() { os::close(fd); });
+    } else {
+      os::close(fd);
+    }
+  }
+  file = None();
+  reading = None();
+
   while (!items.empty()) {
     Item* item = items.front();
 
@@ -1444,6 +1574,72 @@ void HttpProxy::waited(const Future<Response>& future)
 }
 
 
+// Parses the value of the 'Range' header of a request for a file of
+// the given size (see RFC 7233) into the offsets of the first and the
+// last (inclusive) bytes of the range. Returns None if the header is
+// to be ignored, i.e., if it is invalid or requests multiple ranges
+// (in which case the whole file is sent), or an error if the range is
+// not satisfiable.
+static Result<std::pair<off_t, off_t>> parseRange(
+    const string& value,
+    off_t size)
+{
+  if (!strings::startsWith(value, "bytes=")) {
+    return None();
+  }
+
+  const string spec = strings::trim(value.substr(strlen("bytes=")));
+
+  if (strings::contains(spec, ",")) {
+    return None();
+  }
+
+  size_t index = spec.find('-');
+  if (index == string::npos) {
+    return None();
+  }
+
+  const string first = spec.substr(0, index);
+  const string last = spec.substr(index + 1);
+
+  // A suffix range, i.e., the last bytes of the file.
+  if (first.empty()) {
+    Try<off_t> length = numify<off_t>(last);
+    if (length.isError() || length.get() < 0) {
+      return None();
+    }
+
+    if (length.get() == 0 || size == 0) {
+      return Error("Unsatisfiable suffix range");
+    }
+
+    return std::make_pair(std::max<off_t>(size - length.get(), 0), size - 1);
+  }
+
+  Try<off_t> start = numify<off_t>(first);
+  if (start.isError() || start.get() < 0) {
+    return None();
+  }
+
+  off_t end = size - 1;
+
+  if (!last.empty()) {
+    Try<off_t> _end = numify<off_t>(last);
+    if (_end.isError() || _end.get() < start.get()) {
+      return None();
+    }
+
+    end = std::min(_end.get(), size - 1);
+  }
+
+  if (start.get() >= size) {
+    return Error("Range starts after the end of the file");
+  }
+
+  return std::make_pair(start.get(), end);
+}
+
+
 bool HttpProxy::process(const Future<Response>& future, const Request& request)
 {
   if (!future.isReady()) {
@@ -1465,6 +1661,21 @@ bool HttpProxy::process(const Future<Response>& future, const Request& request)
     return true; // All done, can process next response.
   }
 
+  if (future.get().type != Response::PATH &&
+      future.get().type != Response::PIPE) {
+    // Share the response with the encoder (through a copy of the
+    // future) rather than copying it, since its body can be large.
+    std::shared_ptr<const Future<Response>> shared(
+        new Future<Response>(future));
+
+    socket_manager->send(
+        std::shared_ptr<const Response>(shared, &shared->get()),
+        request,
+        socket);
+
+    return true; // All done, can process next response.
+  }
+
   Response response = future.get();
 
   // If the response specifies a path, try and perform a sendfile.
@@ -1501,6 +1712,111 @@ bool HttpProxy::process(const Future<Response>& future, const Request& request)
         VLOG(1) << "Returning '404 Not Found' for directory '" << path << "'";
         socket_manager->send(NotFound(), request, socket);
       } else {
+        // Only the whole file can be sent for other than successful
+        // responses.
+        if (response.code == Status::OK) {
+          response.headers["Accept-Ranges"] = "bytes";
+        }
+
+        const bool encodable = internal::encodable(&response.headers);
+
+        // A range of the file is sent as is (rather than compressed),
+        // since the range refers to the bytes of the file.
+        Option<string> range = request.headers.get("Range");
+
+        if (response.code == Status::OK && range.isSome()) {
+          Result<std::pair<off_t, off_t>> bytes =
+            parseRange(range.get(), s.st_size);
+
+          if (bytes.isError()) {
+            VLOG(1) << "Returning '"
+                    << Status::string(Status::REQUESTED_RANGE_NOT_SATISFIABLE)
+                    << "' for range '" << range.get() << "' of file at '"
+                    << path << "' with length " << s.st_size << ": "
+                    << bytes.error();
+
+            os::close(fd);
+
+            Response unsatisfiable(Status::REQUESTED_RANGE_NOT_SATISFIABLE);
+            unsatisfiable.headers["Content-Range"] =
+              "bytes */" + stringify(s.st_size);
+
+            socket_manager->send(unsatisfiable, request, socket);
+            return true; // All done, can process next request.
+          }
+
+          if (bytes.isSome()) {
+            const off_t first = bytes->first;
+            const off_t length = bytes->second - first + 1;
+
+            response.code = Status::PARTIAL_CONTENT;
+            response.status = Status::string(Status::PARTIAL_CONTENT);
+            response.headers["Content-Range"] =
+              "bytes " + stringify(first) + "-" + stringify(bytes->second) +
+              "/" + stringify(s.st_size);
+            response.headers["Content-Length"] = stringify(length);
+
+            VLOG(1) << "Sending range '" << response.headers["Content-Range"]
+                    << "' of file at '" << path << "'";
+
+            socket_manager->send(
+                new HttpResponseEncoder(response, request),
+                true,
+                socket);
+
+            // Note the file descriptor gets closed by FileEncoder.
+            socket_manager->send(
+                new FileEncoder(fd, length, first),
+                request.keepAlive,
+                socket);
+
+            return true; // All done, can process next request.
+          }
+        }
+
+        if (encodable &&
+            s.st_size > 0 &&
+            static_cast<size_t>(s.st_size) >=
+              internal::gzip_minimum_body_length &&
+            internal::compressible(response.headers) &&
+            request.acceptsEncoding("gzip")) {
+          // The file is read using `io::read`, which requires a
+          // non-blocking file descriptor.
+          Try<Nothing> nonblock = os::nonblock(fd);
+          if (nonblock.isError()) {
+            VLOG(1) << "Failed to send file at '" << path << "': "
+                    << nonblock.error();
+
+            os::close(fd);
+            socket_manager->send(InternalServerError(), request, socket);
+            return true; // All done, can process next request.
+          }
+
+          // The compressed length is not known up front, so the file
+          // is compressed as it gets sent using a "chunked"
+          // 'Transfer-Encoding'.
+          response.headers.erase("Content-Length");
+          response.headers["Transfer-Encoding"] = "chunked";
+          response.headers["Content-Encoding"] = "gzip";
+
+          VLOG(1) << "Sending gzip compressed file at '" << path << "'"
+                  << " with length " << s.st_size;
+
+          socket_manager->send(
+              new HttpResponseEncoder(response, request),
+              true,
+              socket);
+
+          // Note the file descriptor gets closed once the whole file
+          // has been compressed (see `HttpProxy::deflate`).
+          file = fd;
+          compressor.reset(new gzip::Compressor(internal::gzip_level));
+
+          deflate(Owned<Request>(new Request(request)));
+
+          return false; // Sending, don't process next response (yet)!
+        }
+
         // While the user is expected to properly set a 'Content-Type'
         // header, we fill in (or overwrite) 'Content-Length' header.
         stringstream out;
@@ -1537,6 +1853,20 @@ bool HttpProxy::process(const Future<Response>& future, const Request& request)
     // header, we fill in (or overwrite) 'Transfer-Encoding' header.
     response.headers["Transfer-Encoding"] = "chunked";
 
+    // Compress each chunk as it is read from the pipe if the request
+    // accepts gzip, unless the handler opted out (see `encodable`).
+    // Every chunk is flushed so that the client can decompress it
+    // without waiting for more data (e.g., for event streams). The
+    // minimum body length does not apply, since the length of the
+    // stream is not known when the headers are sent.
+    if (internal::encodable(&response.headers) &&
+        request.acceptsEncoding("gzip")) {
+      response.headers["Content-Encoding"] = "gzip";
+      compressor.reset(new gzip::Compressor(internal::gzip_level));
+    } else {
+      compressor.reset();
+    }
+
     VLOG(3) << "Starting \"chunked\" streaming";
 
     socket_manager->send(
@@ -1559,8 +1889,6 @@ bool HttpProxy::process(const Future<Response>& future, const Request& request)
       .onAny(defer(self(), &Self::stream, request_, lambda::_1));
 
     return false; // Streaming, don't process next response (yet)!
-  } else {
-    socket_manager->send(response, request, socket);
   }
 
   return true; // All done, can process next response.
@@ -1581,15 +1909,41 @@ void HttpProxy::stream(
   if (chunk.isReady()) {
     std::ostringstream out;
 
+    // The data to send in this chunk, compressed if necessary (on
+    // the last chunk this is the remaining compressed data).
+    string data = chunk.get();
+
+    if (compressor.get() != nullptr) {
+      Try<string> compressed = data.empty()
+        ? compressor->finish()
+        : compressor->compress(data);
+
+      if (compressed.isError()) {
+        LOG(WARNING) << "Failed to gzip stream: " << compressed.error();
+
+        // The headers were already sent, close the connection so that
+        // the client sees that the body is incomplete.
+        reader.close();
+        pipe = None();
+        compressor.reset();
+        socket_manager->close(socket);
+        return;
+      }
+
+      data = std::move(compressed.get());
+    }
+
+    if (!data.empty()) {
+      out << std::hex << data.size() << "\r\n";
+      out << data;
+      out << "\r\n";
+    }
+
     if (chunk.get().empty()) {
       // Finished reading.
       out << "0\r\n" << "\r\n";
       finished = true;
     } else {
-      out << std::hex << chunk.get().size() << "\r\n";
-      out << chunk.get();
-      out << "\r\n";
-
       // Keep reading.
       reader.read()
         .onAny(defer(self(), &Self::stream, request, lambda::_1));
@@ -1600,23 +1954,112 @@ void HttpProxy::stream(
         new DataEncoder(out.str()),
         finished ? request->keepAlive : true,
         socket);
-  } else if (chunk.isFailed()) {
-    VLOG(1) << "Failed to read from stream: " << chunk.failure();
-    // TODO(bmahler): Have to close connection if headers were sent!
-    socket_manager->send(InternalServerError(), *request, socket);
-    finished = true;
   } else {
-    VLOG(1) << "Failed to read from stream: discarded";
-    // TODO(bmahler): Have to close connection if headers were sent!
-    socket_manager->send(InternalServerError(), *request, socket);
-    finished = true;
+    VLOG(1) << "Failed to read from stream: "
+            << (chunk.isFailed() ? chunk.failure() : "discarded");
+
+    // The headers were already sent, close the connection so that
+    // the client sees that the body is incomplete.
+    reader.close();
+    pipe = None();
+    compressor.reset();
+    socket_manager->close(socket);
+    return;
   }
 
   if (finished) {
     reader.close();
     pipe = None();
+    compressor.reset();
+    next();
+  }
+}
+
+
+void HttpProxy::deflate(const Owned<Request>& request)
+{
+  CHECK_SOME(file);
+
+  boost::shared_array<char> data(new char[GZIP_FILE_BLOCK_SIZE]);
+
+  reading = io::read(file.get(), data.get(), GZIP_FILE_BLOCK_SIZE);
+
+  reading->onAny(defer(self(), &Self::_deflate, request, data, lambda::_1));
+}
+
+
+void HttpProxy::_deflate(
+    const Owned<Request>& request,
+    const boost::shared_array<char>& data,
+    const Future<size_t>& length)
+{
+  CHECK_SOME(file);
+  CHECK_NOTNULL(compressor.get());
+  CHECK_NOTNULL(request.get());
+
+  reading = None();
+
+  Try<string> compressed = Error(
+      length.isFailed() ? length.failure() : "discarded");
+
+  if (length.isReady()) {
+    compressed = length.get() > 0
+      ? compressor->compress(string(data.get(), length.get()), false)
+      : compressor->finish();
+  }
+
+  if (compressed.isError()) {
+    LOG(WARNING) << "Failed to gzip file: " << compressed.error();
+
+    // The headers were already sent, close the connection so that
+    // the client sees that the body is incomplete.
+    os::close(file.get());
+    file = None();
+    compressor.reset();
+    socket_manager->close(socket);
+    return;
+  }
+
+  const bool finished = length.get() == 0;
+
+  // Read the next block if zlib buffered all of this one.
+  if (compressed->empty() && !finished) {
+    deflate(request);
+    return;
+  }
+
+  std::ostringstream out;
+
+  if (!compressed->empty()) {
+    out << std::hex << compressed->size() << "\r\n";
+    out << compressed.get();
+    out << "\r\n";
+  }
+
+  if (finished) {
+    out << "0\r\n" << "\r\n";
+
+    socket_manager->send(
+        new DataEncoder(out.str()),
+        request->keepAlive,
+        socket);
+
+    os::close(file.get());
+    file = None();
+    compressor.reset();
     next();
+    return;
   }
+
+  // Only hold one compressed block in memory at a time by reading
+  // the next block of the file once this one has been sent. If it
+  // does not get sent the socket was closed, which terminates us.
+  NotifyingDataEncoder* encoder = new NotifyingDataEncoder(out.str());
+  Future<Nothing> sent = encoder->future();
+
+  socket_manager->send(encoder, true, socket);
+
+  sent.onReady(defer(self(), &Self::deflate, request));
 }
 
 
@@ -2004,8 +2447,9 @@ void send(Encoder* encoder, Socket socket)
   switch (encoder->kind()) {
     case Encoder::DATA: {
       size_t size;
-      const char* data = static_cast<DataEncoder*>(encoder)->next(&size);
-      socket.send(data, size)
+      vector<SocketImpl::Buffer> buffers =
+        static_cast<DataEncoder*>(encoder)->next(&size);
+      socket.send(buffers)
         .onAny(lambda::bind(
             &internal::_send,
             lambda::_1,
@@ -2098,13 +2542,22 @@ void SocketManager::send(
     const Response& response,
     const Request& request,
     const Socket& socket)
+{
+  send(std::make_shared<const Response>(response), request, socket);
+}
+
+
+void SocketManager::send(
+    const std::shared_ptr<const Response>& response,
+    const Request& request,
+    const Socket& socket)
 {
   bool persist = request.keepAlive;
 
   // Don't persist the connection if the headers include
   // 'Connection: close'.
-  if (response.headers.contains("Connection")) {
-    if (response.headers.get("Connection").get() == "close") {
+  if (response->headers.contains("Connection")) {
+    if (response->headers.get("Connection").get() == "close") {
       persist = false;
     }
   }
@@ -2609,7 +3062,8 @@ void SocketManager::swap_implementing_socket(
 
 ProcessManager::ProcessManager(const Option<string>& _delegate)
   : delegate(_delegate),
-    running(0),
+    next_runq(0),
+    pending(0),
     joining_threads(false),
     finalizing(false) {}
 
@@ -2730,10 +3184,18 @@ long ProcessManager::init_threads()
 
   threads.reserve(num_worker_threads + 1);
 
-  struct
+  // Create the run queues before any worker starts dequeuing.
+  runqs.reserve(num_worker_threads);
+  for (long i = 0; i < num_worker_threads; i++) {
+    runqs.emplace_back(new RunQueue());
+  }
+
+  struct Worker
   {
     void operator()() const
     {
+      __worker__ = index;
+
       do {
         ProcessBase* process = process_manager->dequeue();
         if (process == nullptr) {
@@ -2761,12 +3223,15 @@ long ProcessManager::init_threads()
     // We hold a constant reference to `joining_threads` to make it clear that
     // this value is only being tested (read), and not manipulated.
     const std::atomic_bool& joining_threads;
-  } worker{joining_threads};
+
+    // Index of this worker's run queue.
+    const long index;
+  };
 
   // Create processing threads.
   for (long i = 0; i < num_worker_threads; i++) {
     // Retain the thread handles so that we can join when shutting down.
-    threads.emplace_back(new std::thread(worker));
+    threads.emplace_back(new std::thread(Worker{joining_threads, i}));
   }
 
   // Create a thread for the event loop.
@@ -3069,6 +3534,12 @@ void ProcessManager::resume(ProcessBase* process)
 {
   __process__ = process;
 
+  // Remember which worker ran this process so that the next time it
+  // becomes runnable it is enqueued on the same worker's run queue.
+  if (__worker__ >= 0) {
+    process->worker.store(__worker__, std::memory_order_relaxed);
+  }
+
   VLOG(2) << "Resuming " << process->pid << " at " << Clock::now();
 
   bool terminate = false;
@@ -3081,23 +3552,41 @@ void ProcessManager::resume(ProcessBase* process)
     process->state = ProcessBase::RUNNING;
     try { process->initialize(); }
     catch (...) { terminate = true; }
+  } else {
+    process->state = ProcessBase::RUNNING;
   }
 
   while (!terminate && !blocked) {
-    Event* event = nullptr;
-
-    synchronized (process->mutex) {
-      if (process->events.size() > 0) {
-        event = process->events.front();
-        process->events.pop_front();
-        process->state = ProcessBase::RUNNING;
-      } else {
-        process->state = ProcessBase::BLOCKED;
+    Event* event = process->events->dequeue();
+
+    if (event == nullptr) {
+      // Block the process, and then check for events again: an event
+      // enqueued after our dequeue above found the process RUNNING
+      // and so its producer did not put the process on a run queue.
+      process->state = ProcessBase::BLOCKED;
+
+      // NOTE: This fence pairs with the one in `ProcessBase::enqueue`.
+      // Storing the state and then loading the queue (while producers
+      // store to the queue and then load the state) is a "store
+      // buffering" pattern: without a sequentially consistent fence
+      // on both sides we might not see the enqueued event while the
+      // producer still sees the process RUNNING, stranding the event
+      // and never scheduling the process again.
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+
+      if (process->events->empty()) {
         blocked = true;
+      } else {
+        // Keep running the process unless a producer has already
+        // transitioned it to READY (and put it on a run queue), in
+        // which case whichever thread dequeues it serves the events.
+        ProcessBase::ProcessState expected = ProcessBase::BLOCKED;
+        if (!process->state.compare_exchange_strong(
+                expected, ProcessBase::RUNNING)) {
+          blocked = true;
+        }
       }
-    }
-
-    if (!blocked) {
+    } else {
       CHECK(event != nullptr);
 
       // Determine if we should filter this event.
@@ -3167,8 +3656,8 @@ void ProcessManager::resume(ProcessBase* process)
 
   __process__ = nullptr;
 
-  CHECK_GE(running.load(), 1);
-  running.fetch_sub(1);
+  CHECK_GE(pending.load(), 1);
+  pending.fetch_sub(1);
 }
 
 
@@ -3186,21 +3675,19 @@ void ProcessManager::cleanup(ProcessBase* process)
   // the process we are cleaning up will get dropped (since it's
   // terminating) and eliminates the potential of enqueueing them on
   // another process that gets spawned with the same PID.
-  deque<Event*> events;
-
-  synchronized (process->mutex) {
-    process->state = ProcessBase::TERMINATING;
-    events = process->events;
-    process->events.clear();
-  }
+  process->state = ProcessBase::TERMINATING;
 
   // Delete pending events.
-  while (!events.empty()) {
-    Event* event = events.front();
-    events.pop_front();
+  Event* event = nullptr;
+  while ((event = process->events->dequeue()) != nullptr) {
     delete event;
   }
 
+  // Events enqueued by threads that saw the process before it was
+  // TERMINATING, which get deleted once we've released the processes
+  // lock below.
+  vector<Event*> events;
+
   // Remove help strings for all installed routes for this process.
   dispatch(help, &Help::remove, process->pid.id);
 
@@ -3216,23 +3703,25 @@ void ProcessManager::cleanup(ProcessBase* process)
 #endif
     }
 
-    synchronized (process->mutex) {
-      CHECK(process->events.empty());
-
-      processes.erase(process->pid.id);
+    // Any thread that enqueues an event holds a reference, so now
+    // that there are no references left no more events can arrive.
+    while ((event = process->events->dequeue()) != nullptr) {
+      events.push_back(event);
+    }
 
-      // Lookup gate to wake up waiting threads.
-      map<ProcessBase*, Gate*>::iterator it = gates.find(process);
-      if (it != gates.end()) {
-        gate = it->second;
-        // N.B. The last thread that leaves the gate also free's it.
-        gates.erase(it);
-      }
+    processes.erase(process->pid.id);
 
-      CHECK(process->refs.load() == 0);
-      process->state = ProcessBase::TERMINATED;
+    // Lookup gate to wake up waiting threads.
+    map<ProcessBase*, Gate*>::iterator it = gates.find(process);
+    if (it != gates.end()) {
+      gate = it->second;
+      // N.B. The last thread that leaves the gate also free's it.
+      gates.erase(it);
     }
 
+    CHECK(process->refs.load() == 0);
+    process->state = ProcessBase::TERMINATED;
+
     // Note that we don't remove the process from the clock during
     // cleanup, but rather the clock is reset for a process when it is
     // created (see ProcessBase::ProcessBase). We do this so that
@@ -3270,6 +3759,10 @@ void ProcessManager::cleanup(ProcessBase* process)
       gate->open();
     }
   }
+
+  foreach (Event* event, events) {
+    delete event;
+  }
 }
 
 
@@ -3348,23 +3841,33 @@ bool ProcessManager::wait(const UPID& pid)
       // Check if it is runnable in order to donate this thread.
       if (process->state == ProcessBase::BOTTOM ||
           process->state == ProcessBase::READY) {
-        synchronized (runq_mutex) {
-          list<ProcessBase*>::iterator it =
-            find(runq.begin(), runq.end(), process);
-          if (it != runq.end()) {
-            // Found it! Remove it from the run queue since we'll be
-            // donating our thread and also increment 'running' before
-            // leaving this 'runq' protected critical section so that
-            // everyone that is waiting for the processes to settle
-            // continue to wait (otherwise they could see nothing in
-            // 'runq' and 'running' equal to 0 between when we exit
-            // this critical section and increment 'running').
-            runq.erase(it);
-            running.fetch_add(1);
-          } else {
-            // Another thread has resumed the process ...
-            process = nullptr;
+        // Look for the process on the run queues. If we find it we
+        // remove it since we'll be donating our thread. Note that we
+        // don't need to touch 'pending' as the process remains
+        // accounted for until `resume` returns.
+        bool found = false;
+
+        foreach (const Owned<RunQueue>& runq, runqs) {
+          synchronized (runq->mutex) {
+            deque<ProcessBase*>::iterator it = find(
+                runq->processes.begin(),
+                runq->processes.end(),
+                process);
+
+            if (it != runq->processes.end()) {
+              runq->processes.erase(it);
+              found = true;
+            }
           }
+
+          if (found) {
+            break;
+          }
+        }
+
+        if (!found) {
+          // Another thread has resumed the process ...
+          process = nullptr;
         }
       } else {
         // Process is not runnable, so no need to donate ...
@@ -3451,41 +3954,69 @@ void ProcessManager::enqueue(ProcessBase* process)
     return;
   }
 
-  // TODO(benh): Check and see if this process has its own thread. If
-  // it does, push it on that threads runq, and wake up that thread if
-  // it's not running. Otherwise, check and see which thread this
-  // process was last running on, and put it on that threads runq.
+  CHECK(!runqs.empty());
+
+  // Put the process on the run queue of the worker that last ran it
+  // so that it tends to keep running on the same thread. A process
+  // that has never run goes on the current worker's run queue, or, if
+  // we are not on a worker thread, is spread across the run queues.
+  long index = process->worker.load(std::memory_order_relaxed);
 
-  synchronized (runq_mutex) {
-    CHECK(find(runq.begin(), runq.end(), process) == runq.end());
-    runq.push_back(process);
+  if (index < 0) {
+    index = __worker__;
   }
 
-  // Wake up the processing thread if necessary.
+  if (index < 0) {
+    index = static_cast<long>(next_runq.fetch_add(1) % runqs.size());
+  }
+
+  // Account for the process before it becomes visible on a run queue
+  // so that `settle` can never observe it as neither queued nor
+  // running.
+  pending.fetch_add(1);
+
+  RunQueue* runq = runqs[index].get();
+
+  synchronized (runq->mutex) {
+    runq->processes.push_back(process);
+  }
+
+  // Wake up the processing threads if necessary. Any idle worker may
+  // steal the process if its own worker is busy.
   gate->open();
 }
 
 
 ProcessBase* ProcessManager::dequeue()
 {
-  // TODO(benh): Remove a process from this thread's runq. If there
-  // are no processes to run, and this is not a dedicated thread, then
-  // steal one from another threads runq.
-
-  ProcessBase* process = nullptr;
-
-  synchronized (runq_mutex) {
-    if (!runq.empty()) {
-      process = runq.front();
-      runq.pop_front();
-      // Increment the running count of processes in order to support
-      // the Clock::settle() operation (this must be done atomically
-      // with removing the process from the runq).
-      running.fetch_add(1);
+  CHECK_GE(__worker__, 0) << "Only worker threads can dequeue processes";
+
+  const size_t size = runqs.size();
+
+  // Check this worker's run queue first. If it is empty, try to steal
+  // from the other workers, starting with the next one so that the
+  // stealing is spread out across the run queues.
+  for (size_t i = 0; i < size; i++) {
+    RunQueue* runq = runqs[(__worker__ + i) % size].get();
+
+    synchronized (runq->mutex) {
+      if (!runq->processes.empty()) {
+        ProcessBase* process = nullptr;
+
+        if (i == 0) {
+          process = runq->processes.front();
+          runq->processes.pop_front();
+        } else {
+          process = runq->processes.back();
+          runq->processes.pop_back();
+        }
+
+        return process;
+      }
     }
   }
 
-  return process;
+  return nullptr;
 }
 
 
@@ -3495,21 +4026,14 @@ void ProcessManager::settle()
   do {
     done = true; // Assume to start that we are settled.
 
-    synchronized (runq_mutex) {
-      if (!runq.empty()) {
-        done = false;
-        continue;
-      }
-
-      if (running.load() > 0) {
-        done = false;
-        continue;
-      }
+    if (pending.load() > 0) {
+      done = false;
+      continue;
+    }
 
-      if (!Clock::settled()) {
-        done = false;
-        continue;
-      }
+    if (!Clock::settled()) {
+      done = false;
+      continue;
     }
   } while (!done);
 }
@@ -3582,11 +4106,7 @@ Future<Response> ProcessManager::__processes__(const Request&)
         JSON::Array* events;
       } visitor(&events);
 
-      synchronized (process->mutex) {
-        foreach (Event* event, process->events) {
-          event->visit(&visitor);
-        }
-      }
+      process->events->visit(&visitor);
 
       object.values["events"] = events;
       array.values.push_back(object);
@@ -3598,6 +4118,7 @@ Future<Response> ProcessManager::__processes__(const Request&)
 
 
 ProcessBase::ProcessBase(const string& id)
+  : events(new EventQueue())
 {
   process::initialize();
 
@@ -3605,6 +4126,8 @@ ProcessBase::ProcessBase(const string& id)
 
   refs = 0;
 
+  worker = -1;
+
   pid.id = id != "" ? id : ID::generate();
   pid.address = __address__;
 
@@ -3624,29 +4147,66 @@ void ProcessBase::enqueue(Event* event, bool inject)
 {
   CHECK(event != nullptr);
 
-  synchronized (mutex) {
-    if (state != TERMINATING && state != TERMINATED) {
-      if (!inject) {
-        events.push_back(event);
-      } else {
-        events.push_front(event);
-      }
+  ProcessState old = state.load();
 
-      if (state == BLOCKED) {
-        state = READY;
-        process_manager->enqueue(this);
-      }
+  if (old == TERMINATING || old == TERMINATED) {
+    delete event;
+    return;
+  }
 
-      CHECK(state == BOTTOM ||
-            state == READY ||
-            state == RUNNING);
-    } else {
-      delete event;
-    }
+  // NOTE: The process might start terminating after we've checked the
+  // state above, in which case `ProcessManager::cleanup` deletes the
+  // event (we're holding a reference to the process, see `use`).
+  events->enqueue(event, inject);
+
+  // Make sure that either the consumer sees the event we just
+  // enqueued or we see that it's BLOCKED, see the fence in `resume`.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  // If the process is blocked waiting for events put it on a run
+  // queue. Only one producer succeeds in transitioning it to READY.
+  ProcessState expected = BLOCKED;
+  if (state.compare_exchange_strong(expected, READY)) {
+    process_manager->enqueue(this);
   }
 }
 
 
+template <>
+size_t ProcessBase::eventCount<MessageEvent>()
+{
+  return events->count<MessageEvent>();
+}
+
+
+template <>
+size_t ProcessBase::eventCount<DispatchEvent>()
+{
+  return events->count<DispatchEvent>();
+}
+
+
+template <>
+size_t ProcessBase::eventCount<HttpEvent>()
+{
+  return events->count<HttpEvent>();
+}
+
+
+template <>
+size_t ProcessBase::eventCount<ExitedEvent>()
+{
+  return events->count<ExitedEvent>();
+}
+
+
+template <>
+size_t ProcessBase::eventCount<TerminateEvent>()
+{
+  return events->count<TerminateEvent>();
+}
+
+
 void ProcessBase::inject(
     const UPID& from,
     const string& name,
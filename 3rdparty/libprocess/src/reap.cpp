@@ -12,20 +12,28 @@
 
 #include <glog/logging.h>
 
+#include <algorithm>
+
 #include <sys/types.h>
 #ifndef __WINDOWS__
 #include <sys/wait.h>
 #endif
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 
+#include <process/defer.hpp>
 #include <process/delay.hpp>
 #include <process/future.hpp>
 #include <process/id.hpp>
+#include <process/io.hpp>
 #include <process/once.hpp>
 #include <process/owned.hpp>
 #include <process/reap.hpp>
 
 #include <stout/check.hpp>
 #include <stout/foreach.hpp>
+#include <stout/lambda.hpp>
 #include <stout/multihashmap.hpp>
 #include <stout/none.hpp>
 #include <stout/option.hpp>
@@ -33,12 +41,19 @@
 #include <stout/result.hpp>
 #include <stout/try.hpp>
 
+#ifdef __linux__
+// The system call was added in Linux 5.3 and has the same number on
+// all architectures, but older C libraries don't define it.
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+#endif // __linux__
+
 namespace process {
 
 
-// TODO(bmahler): This can be optimized to use a thread per pid, where
-// each thread makes a blocking call to waitpid. This eliminates the
-// unfortunate poll delay.
+// NOTE: On Linux 5.3 and later the pids are watched through pidfds
+// (see `ReaperProcess::watch`) and are only polled if that fails.
 //
 // Simple bounded linear model for computing the poll interval.
 // Values were chosen such that at (50 pids, 100 ms) the CPU usage is
@@ -70,8 +85,17 @@ Future<Option<int>> ReaperProcess::reap(pid_t pid)
 {
   // Check to see if this pid exists.
   if (os::exists(pid)) {
+    const bool reaping = promises.contains(pid);
+
     Owned<Promise<Option<int>>> promise(new Promise<Option<int>>());
     promises.put(pid, promise);
+
+#ifdef __linux__
+    if (!reaping) {
+      watch(pid);
+    }
+#endif // __linux__
+
     return promise->future();
   } else {
     return None();
@@ -98,6 +122,12 @@ void ReaperProcess::wait()
   // between waitpid and the (!exists) conditional it will still exist as a
   // zombie; it will be reaped by us on the next loop.
   foreach (pid_t pid, promises.keys()) {
+#ifdef __linux__
+    if (pidfds.contains(pid)) {
+      continue;
+    }
+#endif // __linux__
+
     int status;
     Result<pid_t> child_pid = os::waitpid(pid, &status, WNOHANG);
     if (child_pid.isSome()) {
@@ -128,10 +158,71 @@ void ReaperProcess::notify(pid_t pid, Result<int> status)
 }
 
 
+#ifdef __linux__
+bool ReaperProcess::watch(pid_t pid)
+{
+  // NOTE: The pidfd is always close-on-exec.
+  const int fd = ::syscall(SYS_pidfd_open, pid, 0);
+  if (fd < 0) {
+    // The kernel doesn't support pidfds (ENOSYS) or the pid has
+    // already been reaped (ESRCH), in which case polling the pid
+    // notifies with the appropriate status.
+    VLOG(2) << "Polling pid " << pid << " since a pidfd could not be"
+            << " opened: " << os::strerror(errno);
+    return false;
+  }
+
+  pidfds[pid] = fd;
+
+  // The pidfd becomes readable once the process has terminated (i.e.,
+  // once it is a zombie, for our children).
+  io::poll(fd, io::READ)
+    .onAny(defer(self(), &ReaperProcess::_watch, pid, lambda::_1));
+
+  return true;
+}
+
+
+void ReaperProcess::_watch(pid_t pid, const Future<short>& poll)
+{
+  CHECK(pidfds.contains(pid));
+
+  os::close(pidfds.at(pid));
+  pidfds.erase(pid);
+
+  if (!poll.isReady()) {
+    LOG(WARNING) << "Polling pid " << pid << " since its pidfd could not be"
+                 << " polled: "
+                 << (poll.isFailed() ? poll.failure() : "discarded");
+    return;
+  }
+
+  int status;
+  Result<pid_t> child_pid = os::waitpid(pid, &status, WNOHANG);
+  if (child_pid.isSome()) {
+    // We have reaped a child.
+    notify(pid, status);
+  } else if (child_pid.isError()) {
+    // The process has terminated but is not our child, so it will be
+    // reaped by someone else (see `wait()`).
+    notify(pid, None());
+  }
+
+  // Otherwise the child has not terminated (which is unexpected) and
+  // will be polled.
+}
+#endif // __linux__
+
+
 const Duration ReaperProcess::interval()
 {
   size_t count = promises.size();
 
+#ifdef __linux__
+  // Only the pids that are not watched are polled.
+  count -= std::min(count, pidfds.size());
+#endif // __linux__
+
   if (count <= LOW_PID_COUNT) {
     return MIN_REAP_INTERVAL();
   } else if (count >= HIGH_PID_COUNT) {
@@ -12,6 +12,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <boost/shared_array.hpp>
 
@@ -21,6 +22,7 @@
 
 #include <process/ssl/flags.hpp>
 
+#include <stout/foreach.hpp>
 #include <stout/os.hpp>
 #include <stout/unreachable.hpp>
 
@@ -30,6 +32,7 @@
 #include "poll_socket.hpp"
 
 using std::string;
+using std::vector;
 
 namespace process {
 namespace network {
@@ -240,6 +243,18 @@ Future<Nothing> SocketImpl::send(const string& _data)
     .then(lambda::bind(&_send, shared_from_this(), data, 0, lambda::_1));
 }
 
+
+Future<size_t> SocketImpl::send(const vector<Buffer>& buffers)
+{
+  foreach (const Buffer& buffer, buffers) {
+    if (buffer.size > 0) {
+      return send(buffer.data, buffer.size);
+    }
+  }
+
+  return 0;
+}
+
 } // namespace internal {
 } // namespace network {
 } // namespace process {
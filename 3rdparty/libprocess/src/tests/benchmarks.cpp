@@ -14,34 +14,52 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <unistd.h>
+
+#include <sys/wait.h>
+
 #include <gtest/gtest.h>
 
 #include <gmock/gmock.h>
 
+#include <algorithm>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include <process/clock.hpp>
 #include <process/collect.hpp>
+#include <process/dispatch.hpp>
 #include <process/future.hpp>
 #include <process/gmock.hpp>
 #include <process/gtest.hpp>
 #include <process/owned.hpp>
 #include <process/process.hpp>
+#include <process/reap.hpp>
+#include <process/timer.hpp>
 
 #include <stout/duration.hpp>
 #include <stout/gtest.hpp>
 #include <stout/hashset.hpp>
+#include <stout/nothing.hpp>
+#include <stout/os.hpp>
 #include <stout/stopwatch.hpp>
+#include <stout/synchronized.hpp>
 
 namespace http = process::http;
 
+using process::Clock;
 using process::Future;
+using process::MAX_REAP_INTERVAL;
 using process::Owned;
+using process::PID;
 using process::Process;
 using process::ProcessBase;
 using process::Promise;
+using process::Timer;
 using process::UPID;
 
 using std::cout;
@@ -369,3 +387,356 @@ TEST(ProcessTest, Process_BENCHMARK_LargeNumberOfLinks)
     delete process;
   }
 }
+
+
+// A process that bounces dispatches off of a peer process a fixed
+// number of times.
+class DispatchProcess : public Process<DispatchProcess>
+{
+public:
+  explicit DispatchProcess(size_t _remaining) : remaining(_remaining) {}
+
+  virtual ~DispatchProcess() {}
+
+  Future<Nothing> run(const PID<DispatchProcess>& _peer)
+  {
+    peer = _peer;
+
+    dispatch(peer, &DispatchProcess::ping, self());
+
+    return promise.future();
+  }
+
+  void ping(const PID<DispatchProcess>& from)
+  {
+    dispatch(from, &DispatchProcess::pong);
+  }
+
+  void pong()
+  {
+    if (--remaining == 0) {
+      promise.set(Nothing());
+      return;
+    }
+
+    dispatch(peer, &DispatchProcess::ping, self());
+  }
+
+private:
+  size_t remaining;
+  PID<DispatchProcess> peer;
+  Promise<Nothing> promise;
+};
+
+
+class ProcessDispatch_BENCHMARK_Test
+  : public ::testing::TestWithParam<size_t> {};
+
+
+// The number of pairs of processes dispatching to each other
+// concurrently. Each pair can keep at most two worker threads
+// busy, so this should be run with different values of the
+// `LIBPROCESS_NUM_WORKER_THREADS` environment variable to see
+// how dispatch throughput scales with the number of workers.
+INSTANTIATE_TEST_CASE_P(
+    Pairs,
+    ProcessDispatch_BENCHMARK_Test,
+    ::testing::Values(1U, 2U, 4U, 8U, 16U, 32U, 64U));
+
+
+// Measures the total dispatch throughput of many independent pairs
+// of processes bouncing dispatches off of each other. This stresses
+// the run queues since every dispatch makes a process runnable.
+TEST_P(ProcessDispatch_BENCHMARK_Test, Throughput)
+{
+  const size_t numPairs = GetParam();
+  const size_t numRoundTrips = 10000;
+
+  vector<Owned<DispatchProcess>> clients;
+  vector<Owned<DispatchProcess>> servers;
+
+  for (size_t i = 0; i < numPairs; i++) {
+    clients.push_back(Owned<DispatchProcess>(
+        new DispatchProcess(numRoundTrips)));
+
+    servers.push_back(Owned<DispatchProcess>(
+        new DispatchProcess(numRoundTrips)));
+
+    spawn(clients.back().get());
+    spawn(servers.back().get());
+  }
+
+  Stopwatch watch;
+  watch.start();
+
+  list<Future<Nothing>> futures;
+  for (size_t i = 0; i < numPairs; i++) {
+    futures.push_back(dispatch(
+        clients[i]->self(),
+        &DispatchProcess::run,
+        servers[i]->self()));
+  }
+
+  AWAIT_READY(collect(futures));
+
+  Duration elapsed = watch.elapsed();
+
+  // Each round trip consists of two dispatches.
+  double throughput = (2 * numRoundTrips * numPairs) / elapsed.secs();
+
+  cout << "Dispatched " << 2 * numRoundTrips * numPairs << " events across "
+       << numPairs << " pairs of processes in " << elapsed
+       << " (" << throughput << " dispatches / sec)" << endl;
+
+  foreach (const Owned<DispatchProcess>& process, clients) {
+    terminate(process.get());
+    wait(process.get());
+  }
+
+  foreach (const Owned<DispatchProcess>& process, servers) {
+    terminate(process.get());
+    wait(process.get());
+  }
+}
+
+
+// A process that counts the dispatches it receives.
+class CountingProcess : public Process<CountingProcess>
+{
+public:
+  explicit CountingProcess(size_t _expected)
+    : expected(_expected), count(0) {}
+
+  virtual ~CountingProcess() {}
+
+  void increment()
+  {
+    if (++count == expected) {
+      promise.set(Nothing());
+    }
+  }
+
+  Future<Nothing> done() { return promise.future(); }
+
+private:
+  const size_t expected;
+  size_t count;
+  Promise<Nothing> promise;
+};
+
+
+class ProcessEventQueue_BENCHMARK_Test
+  : public ::testing::TestWithParam<size_t> {};
+
+
+// The number of threads concurrently dispatching to a single process.
+INSTANTIATE_TEST_CASE_P(
+    Producers,
+    ProcessEventQueue_BENCHMARK_Test,
+    ::testing::Values(1U, 2U, 4U, 8U, 16U, 32U));
+
+
+// Measures how fast many threads can deliver dispatches to a single
+// process, which stresses the process' event queue (e.g., the master
+// or the allocator receiving dispatches from many other processes).
+TEST_P(ProcessEventQueue_BENCHMARK_Test, ManyProducersOneConsumer)
+{
+  const size_t numProducers = GetParam();
+  const size_t numDispatches = 1000000;
+  const size_t dispatchesPerProducer = numDispatches / numProducers;
+
+  CountingProcess process(dispatchesPerProducer * numProducers);
+  const PID<CountingProcess> pid = spawn(process);
+
+  Future<Nothing> done = process.done();
+
+  Stopwatch watch;
+  watch.start();
+
+  vector<std::thread> producers;
+  for (size_t i = 0; i < numProducers; i++) {
+    producers.emplace_back([=]() {
+      for (size_t j = 0; j < dispatchesPerProducer; j++) {
+        dispatch(pid, &CountingProcess::increment);
+      }
+    });
+  }
+
+  foreach (std::thread& producer, producers) {
+    producer.join();
+  }
+
+  Duration enqueued = watch.elapsed();
+
+  AWAIT_READY(done);
+
+  Duration elapsed = watch.elapsed();
+
+  cout << numProducers << " producers enqueued "
+       << dispatchesPerProducer * numProducers << " dispatches in "
+       << enqueued << " and they were served in " << elapsed
+       << " (" << (dispatchesPerProducer * numProducers) / elapsed.secs()
+       << " dispatches / sec)" << endl;
+
+  terminate(process);
+  wait(process);
+}
+
+
+class Clock_BENCHMARK_Test
+  : public ::testing::TestWithParam<size_t> {};
+
+
+// The number of threads concurrently creating and canceling timers.
+INSTANTIATE_TEST_CASE_P(
+    Threads,
+    Clock_BENCHMARK_Test,
+    ::testing::Values(1U, 2U, 4U, 8U));
+
+
+// Measures how fast timers can be created and canceled while many of
+// them are pending (e.g., the timeouts of offers or of requests that
+// mostly complete in time).
+TEST_P(Clock_BENCHMARK_Test, TimersCreateAndCancel)
+{
+  const size_t numThreads = GetParam();
+  const size_t numTimers = 1000000;
+  const size_t timersPerThread = numTimers / numThreads;
+
+  // The clock is not used by a process here, which would initialize
+  // libprocess (and the event loop the clock relies on).
+  process::initialize();
+
+  vector<vector<Timer>> timers(numThreads);
+  vector<Duration> created(numThreads);
+  vector<size_t> canceled(numThreads, 0);
+
+  Stopwatch watch;
+  watch.start();
+
+  vector<std::thread> threads;
+  for (size_t i = 0; i < numThreads; i++) {
+    threads.emplace_back([&, i]() {
+      Stopwatch stopwatch;
+      stopwatch.start();
+
+      timers[i].reserve(timersPerThread);
+
+      // Spread the timeouts over (up to) ten minutes.
+      for (size_t j = 0; j < timersPerThread; j++) {
+        timers[i].push_back(Clock::timer(
+            Minutes(1) + Milliseconds((i * timersPerThread + j) % 540000),
+            []() {}));
+      }
+
+      created[i] = stopwatch.elapsed();
+
+      foreach (const Timer& timer, timers[i]) {
+        if (Clock::cancel(timer)) {
+          canceled[i]++;
+        }
+      }
+    });
+  }
+
+  foreach (std::thread& thread, threads) {
+    thread.join();
+  }
+
+  Duration elapsed = watch.elapsed();
+
+  for (size_t i = 0; i < numThreads; i++) {
+    EXPECT_EQ(timersPerThread, canceled[i]);
+  }
+
+  cout << numThreads << " threads created " << timersPerThread * numThreads
+       << " timers in " << *std::max_element(created.begin(), created.end())
+       << ", creating and canceling them took " << elapsed << endl;
+}
+
+
+// Measures how long it takes to be notified of the termination of
+// children while many children are being reaped (e.g., the executors
+// of a busy agent).
+TEST(ReapTest, Reap_BENCHMARK_ExitNotification)
+{
+  const size_t numChildren = 1000;
+
+  // Each child exits once it reads a byte from the pipe.
+  int pipes[2];
+  ASSERT_EQ(0, ::pipe(pipes));
+
+  vector<pid_t> children;
+  for (size_t i = 0; i < numChildren; i++) {
+    pid_t pid = ::fork();
+    ASSERT_NE(-1, pid);
+
+    if (pid == 0) {
+      // NOTE: Only async-signal-safe functions are used in the child.
+      ::close(pipes[1]);
+
+      char c;
+      while (::read(pipes[0], &c, 1) < 0 && errno == EINTR);
+
+      ::_exit(0);
+    }
+
+    children.push_back(pid);
+  }
+
+  ::close(pipes[0]);
+
+  Stopwatch watch;
+  watch.start();
+
+  std::mutex mutex;
+  vector<Duration> notified;
+
+  list<Future<Option<int>>> statuses;
+  foreach (pid_t pid, children) {
+    statuses.push_back(process::reap(pid)
+      .onAny([&]() {
+        synchronized (mutex) {
+          notified.push_back(watch.elapsed());
+        }
+      }));
+  }
+
+  // Let the reaper settle into watching all the children (e.g., into
+  // the poll interval for this many pids) before they exit.
+  os::sleep(MAX_REAP_INTERVAL() * 2);
+
+  // Let the children exit one at a time, spread over a second.
+  vector<Duration> exited;
+  for (size_t i = 0; i < numChildren; i++) {
+    ASSERT_EQ(1, ::write(pipes[1], "x", 1));
+    exited.push_back(watch.elapsed());
+    os::sleep(Milliseconds(1));
+  }
+
+  ::close(pipes[1]);
+
+  Future<list<Option<int>>> collected = process::collect(statuses);
+  AWAIT_READY_FOR(collected, Minutes(1));
+
+  foreach (const Option<int>& status, collected.get()) {
+    ASSERT_SOME(status);
+    EXPECT_TRUE(WIFEXITED(status.get()));
+  }
+
+  // NOTE: The notifications are matched with the exits in order,
+  // since it is not known which child read which byte.
+  std::sort(notified.begin(), notified.end());
+
+  Duration total = Duration::zero();
+  Duration max = Duration::zero();
+  for (size_t i = 0; i < numChildren; i++) {
+    const Duration latency = notified[i] - exited[i];
+    total += latency;
+    max = std::max(max, latency);
+  }
+
+  cout << "Notified of the termination of " << numChildren
+       << " children after " << total / numChildren << " on average"
+       << " (at most " << max << ")" << endl;
+}
@@ -13,6 +13,7 @@
 #include <gmock/gmock.h>
 
 #include <deque>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -31,6 +32,8 @@ using process::HttpResponseEncoder;
 using process::Owned;
 using process::ResponseDecoder;
 
+using process::network::internal::SocketImpl;
+
 using std::deque;
 using std::string;
 using std::vector;
@@ -69,6 +72,39 @@ TEST(EncoderTest, Response)
 }
 
 
+// Verifies that the encoder shares the body of a response (rather
+// than copying it) and only copies the status line and the headers.
+TEST(EncoderTest, SharedBody)
+{
+  http::Request request;
+  std::shared_ptr<const http::Response> response =
+    std::make_shared<const http::OK>(string(4096, 'x'));
+
+  HttpResponseEncoder encoder(response, request);
+
+  size_t length = 0;
+  vector<SocketImpl::Buffer> buffers = encoder.next(&length);
+
+  ASSERT_EQ(2u, buffers.size());
+  EXPECT_EQ(response->body.data(), buffers[1].data);
+  EXPECT_EQ(response->body.size(), buffers[1].size);
+  EXPECT_EQ(buffers[0].size + buffers[1].size, length);
+  EXPECT_EQ(0u, encoder.remaining());
+
+  // Backing up into the body only sends the rest of the body.
+  encoder.backup(100);
+  EXPECT_EQ(100u, encoder.remaining());
+
+  buffers = encoder.next(&length);
+
+  ASSERT_EQ(1u, buffers.size());
+  EXPECT_EQ(response->body.data() + response->body.size() - 100,
+            buffers[0].data);
+  EXPECT_EQ(100u, buffers[0].size);
+  EXPECT_EQ(100u, length);
+}
+
+
 TEST(EncoderTest, AcceptableEncodings)
 {
   // Create requests that do not accept gzip encoding.
@@ -19,9 +19,12 @@
 #ifndef __WINDOWS__
 #include <netinet/in.h>
 #include <netinet/tcp.h>
+
+#include <sys/resource.h>
 #endif // __WINDOWS__
 
 #include <algorithm>
+#include <iostream>
 #include <string>
 #include <vector>
 
@@ -39,12 +42,15 @@
 #include <process/ssl/gtest.hpp>
 
 #include <stout/base64.hpp>
+#include <stout/bytes.hpp>
 #include <stout/gtest.hpp>
 #include <stout/hashset.hpp>
 #include <stout/none.hpp>
 #include <stout/nothing.hpp>
 #include <stout/option.hpp>
 #include <stout/os.hpp>
+#include <stout/path.hpp>
+#include <stout/stopwatch.hpp>
 #include <stout/stringify.hpp>
 
 #include <stout/tests/utils.hpp>
@@ -75,6 +81,8 @@ using process::http::URL;
 using process::network::inet::Address;
 using process::network::inet::Socket;
 
+using std::cout;
+using std::endl;
 using std::string;
 using std::vector;
 
@@ -803,6 +811,239 @@ TEST_P(HTTPTest, StreamingGetFailure)
 }
 
 
+// Tests that a streamed response is compressed chunk by chunk when the
+// request accepts gzip, so that each chunk can be decompressed as soon
+// as it is received.
+TEST_P(HTTPTest, StreamingGetGzip)
+{
+  Http http;
+
+  http::Pipe pipe;
+  http::OK ok;
+  ok.type = http::Response::PIPE;
+  ok.reader = pipe.reader();
+
+  EXPECT_CALL(*http.process, pipe(_))
+    .WillOnce(Return(ok));
+
+  http::Headers headers;
+  headers["Accept-Encoding"] = "gzip";
+
+  Future<http::Response> response = http::streaming::get(
+      http.process->self(), "pipe", None(), headers, GetParam());
+
+  AWAIT_READY(response);
+
+  EXPECT_SOME_EQ("chunked", response->headers.get("Transfer-Encoding"));
+  EXPECT_SOME_EQ("gzip", response->headers.get("Content-Encoding"));
+  ASSERT_EQ(http::Response::PIPE, response->type);
+  ASSERT_SOME(response->reader);
+
+  http::Pipe::Reader reader = response->reader.get();
+
+  http::Pipe::Writer writer = pipe.writer();
+  EXPECT_TRUE(writer.write("hello"));
+  AWAIT_EQ("hello", reader.read());
+
+  EXPECT_TRUE(writer.write("goodbye"));
+  AWAIT_EQ("goodbye", reader.read());
+
+  // Complete the response.
+  EXPECT_TRUE(writer.close());
+  AWAIT_EQ("", reader.read()); // EOF.
+}
+
+
+// Tests that a streamed response is sent as is when its handler asks
+// for it using 'Content-Encoding: identity', even if the request
+// accepts gzip.
+TEST_P(HTTPTest, StreamingGetIdentity)
+{
+  Http http;
+
+  http::Pipe pipe;
+  http::OK ok;
+  ok.type = http::Response::PIPE;
+  ok.reader = pipe.reader();
+  ok.headers["Content-Encoding"] = "identity";
+
+  EXPECT_CALL(*http.process, pipe(_))
+    .WillOnce(Return(ok));
+
+  http::Headers headers;
+  headers["Accept-Encoding"] = "gzip";
+
+  Future<http::Response> response = http::streaming::get(
+      http.process->self(), "pipe", None(), headers, GetParam());
+
+  AWAIT_READY(response);
+
+  EXPECT_SOME_EQ("chunked", response->headers.get("Transfer-Encoding"));
+  EXPECT_NONE(response->headers.get("Content-Encoding"));
+  ASSERT_EQ(http::Response::PIPE, response->type);
+  ASSERT_SOME(response->reader);
+
+  http::Pipe::Reader reader = response->reader.get();
+
+  http::Pipe::Writer writer = pipe.writer();
+  EXPECT_TRUE(writer.write("hello"));
+  AWAIT_EQ("hello", reader.read());
+
+  // Complete the response.
+  EXPECT_TRUE(writer.close());
+  AWAIT_EQ("", reader.read()); // EOF.
+}
+
+
+// Tests that a textual file is compressed as it gets sent when the
+// request accepts gzip, and is otherwise sent as is.
+TEST_P(HTTPTest, PathGzip)
+{
+  Http http;
+
+  string data;
+  while (data.size() < Kilobytes(512).bytes()) {
+    data += "Lorem ipsum dolor sit amet " + stringify(data.size()) + "\n";
+  }
+
+  const string path = path::join(os::getcwd(), "file");
+  ASSERT_SOME(os::write(path, data));
+
+  http::OK ok;
+  ok.type = http::Response::PATH;
+  ok.path = path;
+  ok.headers["Content-Type"] = "text/plain; charset=utf-8";
+
+  EXPECT_CALL(*http.process, body(_))
+    .WillRepeatedly(Return(ok));
+
+  http::Headers headers;
+  headers["Accept-Encoding"] = "gzip";
+
+  Future<http::Response> response = http::get(
+      http.process->self(), "body", None(), headers, GetParam());
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(http::OK().status, response);
+  EXPECT_SOME_EQ("chunked", response->headers.get("Transfer-Encoding"));
+  EXPECT_SOME_EQ("gzip", response->headers.get("Content-Encoding"));
+  EXPECT_NONE(response->headers.get("Content-Length"));
+  EXPECT_EQ(data, response->body);
+
+  response = http::get(http.process->self(), "body", None(), None(), GetParam());
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(http::OK().status, response);
+  EXPECT_NONE(response->headers.get("Content-Encoding"));
+  EXPECT_SOME_EQ(
+      stringify(data.size()),
+      response->headers.get("Content-Length"));
+  EXPECT_EQ(data, response->body);
+
+  // Files of other content types are sent as is (e.g., they are
+  // likely to be compressed already).
+  ok.headers["Content-Type"] = "application/octet-stream";
+
+  EXPECT_CALL(*http.process, body(_))
+    .WillRepeatedly(Return(ok));
+
+  response = http::get(
+      http.process->self(), "body", None(), headers, GetParam());
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(http::OK().status, response);
+  EXPECT_NONE(response->headers.get("Content-Encoding"));
+  EXPECT_SOME_EQ(
+      stringify(data.size()),
+      response->headers.get("Content-Length"));
+  EXPECT_EQ(data, response->body);
+}
+
+
+// Tests that a range of a file is sent when requested with a 'Range'
+// header, even if the request accepts gzip.
+TEST_P(HTTPTest, PathRange)
+{
+  Http http;
+
+  string data;
+  while (data.size() < Kilobytes(512).bytes()) {
+    data += "Lorem ipsum dolor sit amet " + stringify(data.size()) + "\n";
+  }
+
+  const string path = path::join(os::getcwd(), "file");
+  ASSERT_SOME(os::write(path, data));
+
+  http::OK ok;
+  ok.type = http::Response::PATH;
+  ok.path = path;
+
+  EXPECT_CALL(*http.process, body(_))
+    .WillRepeatedly(Return(ok));
+
+  const string size = stringify(data.size());
+
+  http::Headers headers;
+  headers["Accept-Encoding"] = "gzip";
+  headers["Range"] = "bytes=10-19";
+
+  Future<http::Response> response = http::get(
+      http.process->self(), "body", None(), headers, GetParam());
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(
+      http::Status::string(http::Status::PARTIAL_CONTENT),
+      response);
+
+  EXPECT_NONE(response->headers.get("Content-Encoding"));
+  EXPECT_SOME_EQ("bytes 10-19/" + size, response->headers.get("Content-Range"));
+  EXPECT_EQ(data.substr(10, 10), response->body);
+
+  // The end of the range is capped at the end of the file.
+  headers["Range"] = "bytes=1000-" + stringify(data.size() * 2);
+
+  response = http::get(
+      http.process->self(), "body", None(), headers, GetParam());
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(
+      http::Status::string(http::Status::PARTIAL_CONTENT),
+      response);
+
+  EXPECT_EQ(data.substr(1000), response->body);
+
+  // The last bytes of the file.
+  headers["Range"] = "bytes=-5";
+
+  response = http::get(
+      http.process->self(), "body", None(), headers, GetParam());
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(
+      http::Status::string(http::Status::PARTIAL_CONTENT),
+      response);
+
+  EXPECT_EQ(data.substr(data.size() - 5), response->body);
+
+  // A range starting after the end of the file is not satisfiable.
+  headers["Range"] = "bytes=" + size + "-";
+
+  response = http::get(
+      http.process->self(), "body", None(), headers, GetParam());
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(
+      http::Status::string(http::Status::REQUESTED_RANGE_NOT_SATISFIABLE),
+      response);
+
+  EXPECT_SOME_EQ("bytes */" + size, response->headers.get("Content-Range"));
+
+  // Multiple ranges are ignored, i.e., the whole file is sent.
+  headers.erase("Accept-Encoding");
+  headers["Range"] = "bytes=0-1,5-6";
+
+  response = http::get(
+      http.process->self(), "body", None(), headers, GetParam());
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(http::OK().status, response);
+  EXPECT_SOME_EQ("bytes", response->headers.get("Accept-Ranges"));
+  EXPECT_EQ(data, response->body);
+}
+
+
 TEST_P(HTTPTest, PipeEquality)
 {
   // Pipes are shared objects, like Futures. Copies are considered
@@ -2226,3 +2467,155 @@ TEST_F(HttpServeTest, Unix)
   AWAIT_READY(serve);
 }
 #endif // __WINDOWS__
+
+
+#ifndef __WINDOWS__
+// Parameterized by the size of the body of the responses.
+class HTTPResponse_BENCHMARK_Test
+  : public ::testing::Test,
+    public WithParamInterface<size_t> {};
+
+
+INSTANTIATE_TEST_CASE_P(
+    BodySize,
+    HTTPResponse_BENCHMARK_Test,
+    ::testing::Values(
+        Megabytes(1).bytes(),
+        Megabytes(10).bytes(),
+        Megabytes(50).bytes()));
+
+
+// Measures the throughput of serving responses with a large body, and
+// how much the peak memory usage grows while doing so (which includes
+// decoding the responses on the client side).
+TEST_P(HTTPResponse_BENCHMARK_Test, LargeBody)
+{
+  const size_t size = GetParam();
+  const size_t requests = 20;
+
+  Http http;
+
+  // NOTE: Every request gets (a copy of) the same future, so that the
+  // body is not copied by the handler.
+  Future<http::Response> response = http::OK(string(size, 'x'));
+
+  EXPECT_CALL(*http.process, body(_))
+    .WillRepeatedly(Return(response));
+
+  http::URL url = http::URL(
+      "http",
+      http.process->self().address.ip,
+      http.process->self().address.port,
+      http.process->self().id + "/body");
+
+  Future<http::Connection> connect = http::connect(url);
+  AWAIT_READY(connect);
+
+  http::Connection connection = connect.get();
+
+  http::Request request;
+  request.method = "GET";
+  request.url = url;
+  request.keepAlive = true;
+
+  struct rusage usage;
+  ASSERT_EQ(0, ::getrusage(RUSAGE_SELF, &usage));
+  const long before = usage.ru_maxrss;
+
+  Stopwatch watch;
+  watch.start();
+
+  for (size_t i = 0; i < requests; i++) {
+    Future<http::Response> received = connection.send(request);
+    AWAIT_READY(received);
+    ASSERT_EQ(size, received->body.size());
+  }
+
+  watch.stop();
+
+  ASSERT_EQ(0, ::getrusage(RUSAGE_SELF, &usage));
+
+  // NOTE: The maximum resident set size is in kilobytes on Linux, but
+  // in bytes on OS X.
+#ifdef __APPLE__
+  const Bytes growth = Bytes(usage.ru_maxrss - before);
+#else
+  const Bytes growth = Kilobytes(usage.ru_maxrss - before);
+#endif // __APPLE__
+
+  const double throughput =
+    (static_cast<double>(size) * requests / Megabytes(1).bytes()) /
+    watch.elapsed().secs();
+
+  cout << "Received " << requests << " responses of " << Bytes(size)
+       << " in " << watch.elapsed() << " (" << throughput << " MB/s),"
+       << " peak memory usage grew by " << growth << endl;
+
+  AWAIT_READY(connection.disconnect());
+}
+
+
+// Measures the throughput of streaming a response that gets gzip
+// compressed chunk by chunk, including the decompression on the
+// client side.
+TEST_P(HTTPResponse_BENCHMARK_Test, GzipStream)
+{
+  const size_t size = GetParam();
+  const size_t requests = 5;
+  const size_t chunkSize = Kilobytes(64).bytes();
+
+  // Somewhat compressible data to stream.
+  string chunk;
+  while (chunk.size() < chunkSize) {
+    chunk += "Lorem ipsum dolor sit amet " + stringify(chunk.size()) + "\n";
+  }
+  chunk.resize(chunkSize);
+
+  Http http;
+
+  EXPECT_CALL(*http.process, pipe(_))
+    .WillRepeatedly(Invoke([&](const http::Request&) {
+      http::Pipe pipe;
+      http::Pipe::Writer writer = pipe.writer();
+
+      for (size_t written = 0; written < size; written += chunkSize) {
+        writer.write(chunk);
+      }
+      writer.close();
+
+      http::OK ok;
+      ok.type = http::Response::PIPE;
+      ok.reader = pipe.reader();
+      return ok;
+    }));
+
+  http::Headers headers;
+  headers["Accept-Encoding"] = "gzip";
+
+  Stopwatch watch;
+  watch.start();
+
+  for (size_t i = 0; i < requests; i++) {
+    Future<http::Response> response = http::streaming::get(
+        http.process->self(), "pipe", None(), headers);
+
+    AWAIT_READY(response);
+    ASSERT_SOME_EQ("gzip", response->headers.get("Content-Encoding"));
+    ASSERT_SOME(response->reader);
+
+    Future<string> body = http::Pipe::Reader(response->reader.get()).readAll();
+    AWAIT_READY(body);
+    ASSERT_LE(size, body->size());
+  }
+
+  watch.stop();
+
+  const double throughput =
+    (static_cast<double>(size) * requests / Megabytes(1).bytes()) /
+    watch.elapsed().secs();
+
+  cout << "Streamed " << requests << " gzip compressed responses of "
+       << Bytes(size) << " in " << watch.elapsed()
+       << " (" << throughput << " MB/s)" << endl;
+}
+#endif // __WINDOWS__
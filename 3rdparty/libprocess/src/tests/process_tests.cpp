@@ -73,6 +73,7 @@ using process::async;
 using process::Clock;
 using process::defer;
 using process::Deferred;
+using process::DispatchEvent;
 using process::Event;
 using process::Executor;
 using process::ExitedEvent;
@@ -84,6 +85,7 @@ using process::Owned;
 using process::PID;
 using process::Process;
 using process::ProcessBase;
+using process::Promise;
 using process::run;
 using process::Subprocess;
 using process::TerminateEvent;
@@ -613,6 +615,51 @@ TEST_TEMP_DISABLED_ON_WINDOWS(ProcessTest, Delay)
 }
 
 
+// Tests that timers with the same timeout fire in the order in which
+// they were created, even if the timer created first gets cascaded
+// between the levels of the timing wheel that keeps the timers (see
+// clock.cpp) after the timer created last.
+TEST(ProcessTest, TimersOrder)
+{
+  Clock::pause();
+
+  // The wheel has ticks of 2^20 nanoseconds and 256 slots per level.
+  auto ticks = [](const Time& time) -> uint64_t {
+    return static_cast<uint64_t>(time.duration().ns()) >> 20;
+  };
+
+  auto time = [](uint64_t ticks) {
+    return Time::epoch() + Nanoseconds(static_cast<int64_t>(ticks << 20));
+  };
+
+  // The start of a slot of the second level of the wheel, with the
+  // timeout of the timers towards its end.
+  const uint64_t start = ((ticks(Clock::now()) >> 8) + 2) << 8;
+  const Time timeout = time(start + 200);
+
+  vector<int> order;
+
+  // The first timer is kept in the second level of the wheel until
+  // the wheel advances to the start of its slot.
+  Clock::timer(timeout - Clock::now(), [&order]() { order.push_back(1); });
+
+  // Advance the wheel to just before that, so that the second timer
+  // is kept in the first level of the wheel.
+  Clock::timer(time(start - 10) - Clock::now(), []() {});
+  Clock::advance(time(start - 10) - Clock::now());
+  Clock::settle();
+
+  Clock::timer(timeout - Clock::now(), [&order]() { order.push_back(2); });
+
+  Clock::advance(timeout - Clock::now());
+  Clock::settle();
+
+  EXPECT_EQ(vector<int>({1, 2}), order);
+
+  Clock::resume();
+}
+
+
 class OrderProcess : public Process<OrderProcess>
 {
 public:
@@ -1193,6 +1240,68 @@ TEST_TEMP_DISABLED_ON_WINDOWS(ProcessTest, Settle)
 }
 
 
+class EventCountProcess : public Process<EventCountProcess>
+{
+public:
+  explicit EventCountProcess(const Future<Nothing>& _unblock)
+    : unblock(_unblock) {}
+
+  // Blocks the process until `unblock` is satisfied so that any
+  // events delivered in the meantime remain queued.
+  void block()
+  {
+    blocked.set(Nothing());
+    unblock.await();
+  }
+
+  void noop() {}
+
+  size_t dispatches() { return eventCount<DispatchEvent>(); }
+  size_t messages() { return eventCount<MessageEvent>(); }
+
+  Promise<Nothing> blocked;
+
+private:
+  const Future<Nothing> unblock;
+};
+
+
+TEST(ProcessTest, EventCount)
+{
+  Promise<Nothing> unblock;
+
+  EventCountProcess process(unblock.future());
+  PID<EventCountProcess> pid = spawn(process);
+
+  dispatch(pid, &EventCountProcess::block);
+
+  AWAIT_READY(process.blocked.future());
+
+  for (int i = 0; i < 3; i++) {
+    dispatch(pid, &EventCountProcess::noop);
+  }
+
+  for (int i = 0; i < 2; i++) {
+    post(pid, "message");
+  }
+
+  EXPECT_EQ(3u, process.dispatches());
+  EXPECT_EQ(2u, process.messages());
+
+  unblock.set(Nothing());
+
+  // The events are served in order, so once this dispatch is done
+  // all the events above have been dequeued.
+  AWAIT_READY(dispatch(pid, &EventCountProcess::dispatches));
+
+  EXPECT_EQ(0u, process.dispatches());
+  EXPECT_EQ(0u, process.messages());
+
+  terminate(process);
+  wait(process);
+}
+
+
 // GTEST_IS_THREADSAFE is not defined on Windows. See MESOS-5903.
 TEST_TEMP_DISABLED_ON_WINDOWS(ProcessTest, Pid)
 {
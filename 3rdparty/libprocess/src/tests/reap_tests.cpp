@@ -28,6 +28,7 @@
 #include <stout/os/fork.hpp>
 #include <stout/os/pstree.hpp>
 #include <stout/try.hpp>
+#include <stout/version.hpp>
 
 using process::Clock;
 using process::Future;
@@ -177,3 +178,47 @@ TEST(ReapTest, TerminatedChildProcess)
 
   Clock::resume();
 }
+
+
+#ifdef __linux__
+// This test checks that the termination of a child process is noticed
+// without polling (i.e., without advancing the clock) on kernels that
+// support pidfds.
+TEST(ReapTest, ChildProcessWithoutPolling)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  // The child process sleeps and will be killed by the parent.
+  Try<ProcessTree> tree = Fork(None(),
+                               Exec("sleep 10"))();
+
+  ASSERT_SOME(tree);
+  pid_t child = tree.get();
+
+  // Pidfds are supported since Linux 5.3.
+  Try<Version> release = os::release();
+  ASSERT_SOME(release);
+
+  if (release.get() < Version(5, 3, 0)) {
+    LOG(WARNING) << "Skipping test since pidfds are not supported";
+
+    EXPECT_EQ(0, kill(child, SIGKILL));
+    AWAIT_EXPECT_WTERMSIG_EQ(SIGKILL, process::reap(child));
+    return;
+  }
+
+  // The clock is paused so that the reaper doesn't poll the child.
+  Clock::pause();
+
+  // Reap the child process.
+  Future<Option<int>> status = process::reap(child);
+
+  // Now kill the child.
+  EXPECT_EQ(0, kill(child, SIGKILL));
+
+  // Check if the status is correct.
+  AWAIT_EXPECT_WTERMSIG_EQ(SIGKILL, status);
+
+  Clock::resume();
+}
+#endif // __linux__
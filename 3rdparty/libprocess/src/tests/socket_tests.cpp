@@ -11,6 +11,7 @@
 // limitations under the License
 
 #include <string>
+#include <vector>
 
 #include <gmock/gmock.h>
 
@@ -38,7 +39,10 @@ using process::READWRITE_HTTP_AUTHENTICATION_REALM;
 using process::network::inet::Address;
 using process::network::inet::Socket;
 
+using process::network::internal::SocketImpl;
+
 using std::string;
+using std::vector;
 
 using testing::WithParamInterface;
 
@@ -242,4 +246,38 @@ TEST_P(NetSocketTest, EOFAfterRecv)
 
   AWAIT_EXPECT_EQ(string(), receive);
 }
+
+
+// This test verifies that sending buffers that are all empty sends
+// nothing, rather than failing.
+TEST_P(NetSocketTest, SendEmptyBuffers)
+{
+  Try<Socket> client = Socket::create();
+  ASSERT_SOME(client);
+
+  const string data = "Lorem ipsum dolor sit amet";
+
+  Try<Socket> server = Socket::create();
+  ASSERT_SOME(server);
+
+  Try<Address> server_address = server->bind(Address::ANY_ANY());
+  ASSERT_SOME(server_address);
+
+  ASSERT_SOME(server->listen(1));
+  Future<Socket> server_accept = server->accept();
+
+  AWAIT_READY(
+      client->connect(Address(process::address().ip, server_address->port)));
+
+  AWAIT_READY(server_accept);
+
+  Socket server_socket = server_accept.get();
+
+  vector<SocketImpl::Buffer> buffers = {{data.data(), 0}, {nullptr, 0}};
+  AWAIT_EXPECT_EQ(0u, server_socket.send(buffers));
+
+  buffers = {{nullptr, 0}, {data.data(), data.size()}};
+  AWAIT_EXPECT_EQ(data.size(), server_socket.send(buffers));
+  AWAIT_EXPECT_EQ(data, client->recv(data.size()));
+}
 #endif // __WINDOWS__
@@ -25,7 +25,6 @@
 
 
 // Compression utilities.
-// TODO(bmahler): Provide streaming compression as well.
 namespace gzip {
 
 namespace internal {
@@ -169,6 +168,131 @@ private:
 };
 
 
+// Provides the ability to incrementally compress a stream of input
+// data into a single gzip stream. Each call to `compress` returns the
+// compressed data that is available so far, and `finish` returns the
+// remaining compressed data along with the gzip trailer.
+//
+// The compression level should be within the range [-1, 9], see
+// `gzip::compress` below.
+class Compressor
+{
+public:
+  explicit Compressor(int level = Z_DEFAULT_COMPRESSION)
+    : _finished(false)
+  {
+    stream.zalloc = Z_NULL;
+    stream.zfree = Z_NULL;
+    stream.opaque = Z_NULL;
+    stream.next_in = Z_NULL;
+    stream.avail_in = 0;
+
+    int code = deflateInit2(
+        &stream,
+        level,          // Compression level.
+        Z_DEFLATED,     // Compression method.
+        MAX_WBITS + 16, // Zlib magic for gzip compression / decompression.
+        8,              // Default memLevel value.
+        Z_DEFAULT_STRATEGY);
+
+    if (code != Z_OK) {
+      Error error = internal::GzipError("Failed to deflateInit2", stream, code);
+      ABORT(error.message);
+    }
+  }
+
+  Compressor(const Compressor&) = delete;
+  Compressor& operator=(const Compressor&) = delete;
+
+  ~Compressor()
+  {
+    // NOTE: `deflateEnd` returns Z_DATA_ERROR if the stream was freed
+    // before it was finished, which is expected when the consumer of
+    // the stream goes away early.
+    int code = deflateEnd(&stream);
+    if (code != Z_OK && code != Z_DATA_ERROR) {
+      ABORT("Failed to deflateEnd");
+    }
+  }
+
+  // Returns the next compressed chunk of data, or an Error if
+  // compression fails. When `flush` is true all of the input is
+  // flushed to an (incomplete) output block so that the receiver can
+  // decompress everything provided so far, at the cost of a slightly
+  // worse compression ratio. Otherwise zlib may buffer the input and
+  // the returned chunk may be empty.
+  Try<std::string> compress(const std::string& decompressed, bool flush = true)
+  {
+    if (_finished) {
+      return Error("Stream is already finished");
+    }
+
+    stream.next_in =
+      const_cast<Bytef*>(reinterpret_cast<const Bytef*>(decompressed.data()));
+    stream.avail_in = decompressed.length();
+
+    return deflate(flush ? Z_SYNC_FLUSH : Z_NO_FLUSH);
+  }
+
+  // Returns the remaining compressed data, including the gzip
+  // trailer. No more data can be compressed afterwards.
+  Try<std::string> finish()
+  {
+    if (_finished) {
+      return Error("Stream is already finished");
+    }
+
+    stream.next_in = Z_NULL;
+    stream.avail_in = 0;
+
+    Try<std::string> result = deflate(Z_FINISH);
+
+    _finished = result.isSome();
+
+    return result;
+  }
+
+  // Returns whether the compression stream is finished.
+  bool finished() const
+  {
+    return _finished;
+  }
+
+private:
+  Try<std::string> deflate(int flush)
+  {
+    // Build up the compressed result.
+    Bytef buffer[GZIP_BUFFER_SIZE];
+    std::string result;
+
+    // NOTE: zlib indicates that there may be more output pending
+    // by completely filling the output buffer.
+    do {
+      stream.next_out = buffer;
+      stream.avail_out = GZIP_BUFFER_SIZE;
+
+      int code = ::deflate(&stream, flush);
+
+      // Z_BUF_ERROR is not fatal, it only means that no progress was
+      // possible (e.g., there was no input and nothing to flush).
+      if (code != Z_OK && code != Z_STREAM_END && code != Z_BUF_ERROR) {
+        return internal::GzipError("Failed to deflate", stream, code);
+      }
+
+      // Consume output.
+      result.append(
+          reinterpret_cast<char*>(buffer),
+          GZIP_BUFFER_SIZE - stream.avail_out);
+    } while (stream.avail_out == 0);
+
+    return result;
+  }
+
+  z_stream_s stream;
+  bool _finished;
+};
+
+
 // Returns a gzip compressed version of the provided string.
 // The compression level should be within the range [-1, 9].
 // See zlib.h:
@@ -10,6 +10,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License
 
+#include <algorithm>
 #include <string>
 
 #include <gtest/gtest.h>
@@ -99,4 +100,82 @@ TEST(GzipTest, Decompressor)
 
   ASSERT_EQ(s, decompressed);
 }
+
+
+TEST(GzipTest, Compressor)
+{
+  string s =
+    "Lorem ipsum dolor sit amet, consectetur adipisicing elit, sed do "
+    "eiusmod tempor incididunt ut labore et dolore magna aliqua. Ut enim ad "
+    "minim veniam, quis nostrud exercitation ullamco laboris nisi ut "
+    "aliquip ex ea commodo consequat. Duis aute irure dolor in reprehenderit "
+    "in voluptate velit esse cillum dolore eu fugiat nulla pariatur. "
+    "Excepteur sint occaecat cupidatat non proident, sunt in culpa qui "
+    "officia deserunt mollit anim id est laborum.";
+
+  gzip::Compressor compressor;
+  gzip::Decompressor decompressor;
+
+  // Compress 10 bytes at a time. Since each chunk is flushed, the
+  // data compressed so far can always be fully decompressed.
+  string compressed;
+  string decompressed;
+  size_t i = 0;
+
+  while (i < s.size()) {
+    size_t chunkSize = 10;
+
+    Try<string> compressedChunk = compressor.compress(s.substr(i, chunkSize));
+    ASSERT_SOME(compressedChunk);
+    compressed += compressedChunk.get();
+
+    Try<string> decompressedChunk =
+      decompressor.decompress(compressedChunk.get());
+    ASSERT_SOME(decompressedChunk);
+    decompressed += decompressedChunk.get();
+
+    i += chunkSize;
+
+    EXPECT_EQ(s.substr(0, std::min(i, s.size())), decompressed);
+  }
+
+  EXPECT_FALSE(decompressor.finished());
+
+  Try<string> trailer = compressor.finish();
+  ASSERT_SOME(trailer);
+  compressed += trailer.get();
+
+  EXPECT_TRUE(compressor.finished());
+  EXPECT_ERROR(compressor.compress(s));
+
+  Try<string> decompressedChunk = decompressor.decompress(trailer.get());
+  ASSERT_SOME(decompressedChunk);
+  decompressed += decompressedChunk.get();
+
+  EXPECT_TRUE(decompressor.finished());
+  EXPECT_EQ(s, decompressed);
+
+  // The concatenated chunks form a single valid gzip stream.
+  Try<string> result = gzip::decompress(compressed);
+  ASSERT_SOME(result);
+  EXPECT_EQ(s, result.get());
+
+  // Without flushing, the output can be buffered entirely by zlib.
+  gzip::Compressor buffered(Z_BEST_SPEED);
+
+  compressed = "";
+  for (i = 0; i < s.size(); i += 10) {
+    Try<string> compressedChunk = buffered.compress(s.substr(i, 10), false);
+    ASSERT_SOME(compressedChunk);
+    compressed += compressedChunk.get();
+  }
+
+  trailer = buffered.finish();
+  ASSERT_SOME(trailer);
+  compressed += trailer.get();
+
+  result = gzip::decompress(compressed);
+  ASSERT_SOME(result);
+  EXPECT_EQ(s, result.get());
+}
 #endif // HAVE_LIBZ
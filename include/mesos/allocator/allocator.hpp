@@ -17,6 +17,7 @@
 #ifndef __MESOS_ALLOCATOR_ALLOCATOR_HPP__
 #define __MESOS_ALLOCATOR_ALLOCATOR_HPP__
 
+#include <set>
 #include <string>
 #include <vector>
 
@@ -41,6 +42,28 @@
 namespace mesos {
 namespace allocator {
 
+/**
+ * Options of an allocator, which are passed to `Allocator::initialize`.
+ */
+struct Options
+{
+  /**
+   * The allocate interval for the allocator, see `initialize`.
+   */
+  Duration allocationInterval = Seconds(1);
+
+  /**
+   * Resources (by name) that will be excluded from a role's fair share.
+   */
+  Option<std::set<std::string>> fairnessExcludeResourceNames = None();
+
+  /**
+   * The number of threads the allocator may use to compute allocations.
+   */
+  size_t allocationParallelism = 1;
+};
+
+
 /**
  * Basic model of an allocator: resources are allocated to a framework
  * in the form of offers. A framework can refuse some resources in
@@ -98,6 +121,34 @@ public:
       const Option<std::set<std::string>>&
         fairnessExcludeResourceNames = None()) = 0;
 
+  /**
+   * Initializes the allocator with the given options, see above. This
+   * is how the master initializes the allocator.
+   *
+   * NOTE: By default this calls the overload above, i.e., allocators
+   * that do not override it ignore the options that the overload does
+   * not take (e.g., `allocationParallelism`).
+   */
+  virtual void initialize(
+      const Options& options,
+      const lambda::function<
+          void(const FrameworkID&,
+               const hashmap<std::string, hashmap<SlaveID, Resources>>&)>&
+                   offerCallback,
+      const lambda::function<
+          void(const FrameworkID&,
+               const hashmap<SlaveID, UnavailableResources>&)>&
+        inverseOfferCallback,
+      const hashmap<std::string, double>& weights)
+  {
+    initialize(
+        options.allocationInterval,
+        offerCallback,
+        inverseOfferCallback,
+        weights,
+        options.fairnessExcludeResourceNames);
+  }
+
   /**
    * Informs the allocator of the recovered state from the master.
    *
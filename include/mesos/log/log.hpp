@@ -160,7 +160,14 @@ public:
     // time. A writer becomes invalid if either Writer::append or
     // Writer::truncate return None, in which case, the writer (or
     // another writer) must be restarted.
-    explicit Writer(Log* log);
+    //
+    // Up to 'window' appends and truncates are written to the
+    // replicas concurrently (further ones wait for earlier ones to
+    // complete), and they complete in the order in which they were
+    // made. If one of them returns None (or fails) so do all the
+    // ones made after it. With a window of 1 an append or truncate
+    // made while another one is in progress fails.
+    explicit Writer(Log* log, size_t window = 1);
     ~Writer();
 
     // Attempts to get a promise (from the log's replicas) for
@@ -124,6 +124,17 @@ private:
         std::ostream& stream, const Resource_& resource_);
 
   private:
+    // Returns a hash of the fields of the resource that need to match
+    // for resources to be addable or subtractable (i.e., everything but
+    // the value), see `key`.
+    static size_t hash(const Resource& resource);
+
+    // Returns `key` if it is set, otherwise hashes `resource`.
+    size_t getKey() const { return key.isSome() ? key.get() : hash(resource); }
+
+    // Updates `key` after modifying `resource`.
+    void rehash() { key = hash(resource); }
+
     // The protobuf Resource that is being managed.
     Resource resource;
 
@@ -131,6 +142,18 @@ private:
     // 'resource' is non-shared. This is an int so as to support arithmetic
     // operations involving subtraction.
     Option<int> sharedCount;
+
+    // The hash of the name, type, role, allocation, reservation, disk,
+    // revocable and shared info of `resource`. Resource_ objects with
+    // different keys are never addable nor subtractable, which lets the
+    // arithmetic skip over them without comparing the protobufs.
+    //
+    // This is only set once the Resource_ is stored in a Resources, so
+    // that temporaries in the arithmetic are not hashed unless needed.
+    //
+    // NOTE: This must be updated via `rehash` whenever any of these
+    // fields of a stored `resource` are modified.
+    Option<size_t> key;
   };
 
 public:
@@ -19,6 +19,8 @@
 
 #include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <mesos/log/log.hpp>
 
@@ -51,6 +53,9 @@ public:
       const UUID& uuid);
   virtual process::Future<bool> expunge(const internal::state::Entry& entry);
   virtual process::Future<std::set<std::string>> names();
+  virtual process::Future<bool> transact(
+      const std::vector<std::pair<internal::state::Entry, UUID>>& entries,
+      const std::vector<internal::state::Entry>& expunged);
 
 private:
   LogStorageProcess* process;
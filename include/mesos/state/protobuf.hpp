@@ -18,12 +18,14 @@
 #define __MESOS_STATE_PROTOBUF_HPP__
 
 #include <string>
+#include <vector>
 
 #include <mesos/state/state.hpp>
 #include <mesos/state/storage.hpp>
 
 #include <process/future.hpp>
 
+#include <stout/foreach.hpp>
 #include <stout/lambda.hpp>
 #include <stout/option.hpp>
 #include <stout/protobuf.hpp>
@@ -84,6 +86,13 @@ public:
   template <typename T>
   process::Future<Option<Variable<T>>> store(const Variable<T>& variable);
 
+  // Atomically stores and expunges the specified variables, see
+  // 'mesos::state::State::store' for the semantics.
+  template <typename T>
+  process::Future<Option<std::vector<Variable<T>>>> store(
+      const std::vector<Variable<T>>& variables,
+      const std::vector<Variable<T>>& expunged);
+
   // Expunges the variable from the state.
   template <typename T>
   process::Future<bool> expunge(const Variable<T>& variable);
@@ -100,6 +109,11 @@ private:
   static process::Future<Option<Variable<T>>> _store(
       const T& t,
       const Option<mesos::state::Variable>& variable);
+
+  template <typename T>
+  static process::Future<Option<std::vector<Variable<T>>>> __store(
+      const std::vector<T>& ts,
+      const Option<std::vector<mesos::state::Variable>>& variables);
 };
 
 
@@ -152,6 +166,53 @@ process::Future<Option<Variable<T>>> State::_store(
 }
 
 
+template <typename T>
+process::Future<Option<std::vector<Variable<T>>>> State::store(
+    const std::vector<Variable<T>>& variables,
+    const std::vector<Variable<T>>& expunged)
+{
+  std::vector<mesos::state::Variable> mutated;
+  std::vector<T> ts;
+
+  foreach (const Variable<T>& variable, variables) {
+    Try<std::string> value = ::protobuf::serialize(variable.t);
+
+    if (value.isError()) {
+      return process::Failure(value.error());
+    }
+
+    mutated.push_back(variable.variable.mutate(value.get()));
+    ts.push_back(variable.t);
+  }
+
+  std::vector<mesos::state::Variable> expunges;
+  foreach (const Variable<T>& variable, expunged) {
+    expunges.push_back(variable.variable);
+  }
+
+  return mesos::state::State::store(mutated, expunges)
+    .then(lambda::bind(&State::template __store<T>, ts, lambda::_1));
+}
+
+
+template <typename T>
+process::Future<Option<std::vector<Variable<T>>>> State::__store(
+    const std::vector<T>& ts,
+    const Option<std::vector<mesos::state::Variable>>& variables)
+{
+  if (variables.isNone()) {
+    return None();
+  }
+
+  std::vector<Variable<T>> result;
+  for (size_t i = 0; i < ts.size(); i++) {
+    result.push_back(Variable<T>(variables.get()[i], ts[i]));
+  }
+
+  return Some(result);
+}
+
+
 template <typename T>
 process::Future<bool> State::expunge(const Variable<T>& variable)
 {
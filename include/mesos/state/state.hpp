@@ -19,12 +19,15 @@
 
 #include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <mesos/state/storage.hpp>
 
 #include <process/deferred.hpp> // TODO(benh): This is required by Clang.
 #include <process/future.hpp>
 
+#include <stout/foreach.hpp>
 #include <stout/lambda.hpp>
 #include <stout/none.hpp>
 #include <stout/option.hpp>
@@ -102,6 +105,16 @@ public:
   // was no longer valid, or an error if one occurs.
   process::Future<Option<Variable>> store(const Variable& variable);
 
+  // Atomically stores and expunges the specified variables, i.e.,
+  // either all of them are stored (expunged) or none of them is.
+  // Returns the stored variables (in the order specified) if
+  // successful, otherwise returns none if the version of any of the
+  // variables was no longer valid, or an error if one occurs (e.g.,
+  // if the storage does not support transactions).
+  process::Future<Option<std::vector<Variable>>> store(
+      const std::vector<Variable>& variables,
+      const std::vector<Variable>& expunged);
+
   // Returns true if successfully expunged the variable from the state.
   process::Future<bool> expunge(const Variable& variable);
 
@@ -120,6 +133,10 @@ private:
       const internal::state::Entry& entry,
       const bool& b); // TODO(benh): Remove 'const &' after fixing libprocess.
 
+  static process::Future<Option<std::vector<Variable>>> __store(
+      const std::vector<internal::state::Entry>& entries,
+      const bool& b); // TODO(benh): Remove 'const &' after fixing libprocess.
+
   Storage* storage;
 };
 
@@ -178,6 +195,54 @@ inline process::Future<Option<Variable>> State::_store(
 }
 
 
+inline process::Future<Option<std::vector<Variable>>> State::store(
+    const std::vector<Variable>& variables,
+    const std::vector<Variable>& expunged)
+{
+  std::vector<std::pair<internal::state::Entry, UUID>> entries;
+  std::vector<internal::state::Entry> stored;
+
+  // Like 'store' above, create a new entry for each variable which
+  // replaces the existing entry provided the UUID matches.
+  foreach (const Variable& variable, variables) {
+    internal::state::Entry entry;
+    entry.set_name(variable.entry.name());
+    entry.set_uuid(UUID::random().toBytes());
+    entry.set_value(variable.entry.value());
+
+    entries.push_back(std::make_pair(
+        entry,
+        UUID::fromBytes(variable.entry.uuid()).get()));
+
+    stored.push_back(entry);
+  }
+
+  std::vector<internal::state::Entry> expunges;
+  foreach (const Variable& variable, expunged) {
+    expunges.push_back(variable.entry);
+  }
+
+  return storage->transact(entries, expunges)
+    .then(lambda::bind(&State::__store, stored, lambda::_1));
+}
+
+
+inline process::Future<Option<std::vector<Variable>>> State::__store(
+    const std::vector<internal::state::Entry>& entries,
+    const bool& b) // TODO(benh): Remove 'const &' after fixing libprocess.
+{
+  if (b) {
+    std::vector<Variable> variables;
+    foreach (const internal::state::Entry& entry, entries) {
+      variables.push_back(Variable(entry));
+    }
+    return Some(variables);
+  }
+
+  return None();
+}
+
+
 inline process::Future<bool> State::expunge(const Variable& variable)
 {
   return storage->expunge(variable.entry);
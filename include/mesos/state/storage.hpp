@@ -19,6 +19,8 @@
 
 #include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <mesos/state/state.pb.h>
 
@@ -52,6 +54,21 @@ public:
 
   // Returns the collection of variable names in the state.
   virtual process::Future<std::set<std::string>> names() = 0;
+
+  // Atomically sets and expunges the specified entries, i.e., either
+  // all of them are applied or none of them is. Like 'set', each
+  // entry is only set if the existing entry (if any) has the
+  // accompanying UUID, and like 'expunge', each expunged entry must
+  // exist with the same UUID. Returns false (without having changed
+  // anything) if any of these checks fail.
+  // NOTE: Storage implementations are not required to support
+  // transactions, by default a failure is returned.
+  virtual process::Future<bool> transact(
+      const std::vector<std::pair<internal::state::Entry, UUID>>& entries,
+      const std::vector<internal::state::Entry>& expunged)
+  {
+    return process::Failure("Transactions are not supported");
+  }
 };
 
 } // namespace state {
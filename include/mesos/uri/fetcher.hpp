@@ -26,6 +26,7 @@
 #include <process/shared.hpp>
 
 #include <stout/hashmap.hpp>
+#include <stout/lambda.hpp>
 #include <stout/nothing.hpp>
 
 #include <mesos/uri/uri.hpp>
@@ -44,6 +45,13 @@ namespace uri {
 class Fetcher
 {
 public:
+  /**
+   * Consumes a chunk of the content of a URI that is being streamed.
+   * The next chunk is only read once the returned future is ready.
+   */
+  typedef lambda::function<process::Future<Nothing>(const std::string&)>
+    Consumer;
+
   /**
    * Represents a fetcher plugin that handles one or more URI schemes.
    */
@@ -73,6 +81,19 @@ public:
     virtual process::Future<Nothing> fetch(
         const URI& uri,
         const std::string& directory) const = 0;
+
+    /**
+     * Fetches a URI and streams its content to `consume` as it
+     * arrives, rather than writing it to a directory. The returned
+     * future fails if `consume` fails. By default, plugins do not
+     * support streaming.
+     *
+     * @param uri the URI to fetch
+     * @param consume the function the content is streamed to
+     */
+    virtual process::Future<Nothing> stream(
+        const URI& uri,
+        const Consumer& consume) const;
   };
 
   /**
@@ -107,6 +128,18 @@ public:
       const std::string& directory,
       const std::string& name) const;
 
+  /**
+   * Fetches a URI and streams its content to `consume` as it arrives.
+   * This method will dispatch the call to the corresponding plugin
+   * based on uri.scheme.
+   *
+   * @param uri the URI to fetch
+   * @param consume the function the content is streamed to
+   */
+  process::Future<Nothing> stream(
+      const URI& uri,
+      const Consumer& consume) const;
+
 private:
   Fetcher(const Fetcher&) = delete; // Not copyable.
   Fetcher& operator=(const Fetcher&) = delete; // Not assignable.
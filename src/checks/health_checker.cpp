@@ -23,20 +23,28 @@
 #include <unistd.h>
 #endif // __WINDOWS__
 
+#include <algorithm>
+#include <condition_variable>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <mesos/mesos.hpp>
 
+#include <process/async.hpp>
 #include <process/collect.hpp>
 #include <process/delay.hpp>
 #include <process/dispatch.hpp>
 #include <process/http.hpp>
 #include <process/io.hpp>
+#include <process/socket.hpp>
 #include <process/subprocess.hpp>
 
 #include <stout/duration.hpp>
+#include <stout/ip.hpp>
 #include <stout/json.hpp>
 #include <stout/jsonify.hpp>
 #include <stout/option.hpp>
@@ -47,6 +55,8 @@
 #include <stout/try.hpp>
 #include <stout/unreachable.hpp>
 
+#include <stout/os/close.hpp>
+#include <stout/os/int_fd.hpp>
 #include <stout/os/killtree.hpp>
 
 #include "common/status_utils.hpp"
@@ -56,6 +66,8 @@
 #include "linux/ns.hpp"
 #endif
 
+namespace inet = process::network::inet;
+
 using process::delay;
 using process::dispatch;
 using process::Clock;
@@ -65,6 +77,8 @@ using process::Owned;
 using process::Subprocess;
 using process::Time;
 
+using process::network::internal::SocketImpl;
+
 using std::map;
 using std::string;
 using std::tuple;
@@ -75,13 +89,15 @@ namespace internal {
 namespace checks {
 
 #ifndef __WINDOWS__
-constexpr char TCP_CHECK_COMMAND[] = "mesos-tcp-connect";
 constexpr char HTTP_CHECK_COMMAND[] = "curl";
 #else
-constexpr char TCP_CHECK_COMMAND[] = "mesos-tcp-connect.exe";
 constexpr char HTTP_CHECK_COMMAND[] = "curl.exe";
 #endif // __WINDOWS__
 
+// The maximum length of the status line of the response to an
+// in-process HTTP health check.
+constexpr size_t MAX_HTTP_STATUS_LINE_LENGTH = 4096;
+
 static const string DEFAULT_HTTP_SCHEME = "http";
 
 // Use '127.0.0.1' instead of 'localhost', because the host
@@ -119,6 +135,156 @@ pid_t cloneWithSetns(
 #endif
 
 
+#ifdef __linux__
+// Creates sockets in the network namespace of a task. Since a socket
+// stays in the network namespace it was created in, a dedicated
+// thread enters the namespace once and then creates the sockets of
+// all health checks, rather than forking a helper into the namespace
+// for each health check (or switching the namespace of the calling
+// thread back and forth).
+class NetworkNamespace
+{
+public:
+  explicit NetworkNamespace(pid_t _pid)
+    : pid(_pid),
+      requested(false),
+      stopping(false) {}
+
+  ~NetworkNamespace()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+
+    condition.notify_all();
+
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+
+  // Creates a non-blocking TCP socket in the network namespace,
+  // entering the namespace first if that has not succeeded yet.
+  //
+  // NOTE: This blocks the calling thread and must not be called
+  // concurrently, which holds since the health checker process only
+  // has a single call outstanding at a time.
+  Try<int_fd> socket()
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    if (entered.isNone()) {
+      const string path = path::join("/proc", stringify(pid), "ns", "net");
+
+      thread = std::thread(&NetworkNamespace::run, this, path);
+
+      condition.wait(lock, [this]() { return entered.isSome(); });
+
+      if (entered->isError()) {
+        const string error = entered->error();
+
+        // Allow a later health check to enter the namespace again.
+        entered = None();
+
+        lock.unlock();
+        thread.join();
+
+        return Error(
+            "Failed to enter the network namespace of task (pid: '" +
+            stringify(pid) + "'): " + error);
+      }
+
+      VLOG(1) << "Entered the network namespace of task (pid: '" << pid
+              << "') successfully";
+    }
+
+    requested = true;
+    condition.notify_all();
+
+    condition.wait(lock, [this]() { return result.isSome(); });
+
+    Try<int_fd> socket = result.get();
+    result = None();
+
+    return socket;
+  }
+
+private:
+  void run(const string& path)
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    // NOTE: Only the calling thread enters the network namespace,
+    // which is allowed while other threads exist (as opposed to,
+    // e.g., the mount namespace).
+    entered = ns::setns(path, "net", false);
+    condition.notify_all();
+
+    if (entered->isError()) {
+      return;
+    }
+
+    while (true) {
+      condition.wait(lock, [this]() { return stopping || requested; });
+
+      if (stopping) {
+        return;
+      }
+
+      requested = false;
+
+      int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+      if (fd < 0) {
+        result = Try<int_fd>(ErrnoError("Failed to create socket"));
+      } else {
+        result = fd;
+      }
+
+      condition.notify_all();
+    }
+  }
+
+  const pid_t pid;
+
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::thread thread;
+
+  Option<Try<Nothing>> entered;
+  bool requested;
+  bool stopping;
+  Option<Try<int_fd>> result;
+};
+#endif // __linux__
+
+
+// Receives from the socket until the first line of the response (i.e.,
+// the status line of an HTTP response) has been received.
+static Future<string> receiveLine(inet::Socket socket, const string& data)
+{
+  size_t index = data.find("\r\n");
+  if (index != string::npos) {
+    return data.substr(0, index);
+  }
+
+  if (data.length() > MAX_HTTP_STATUS_LINE_LENGTH) {
+    return Failure("Unexpected response '" + data + "'");
+  }
+
+  return socket.recv()
+    .then([socket, data](const string& received) -> Future<string> {
+      if (received.empty()) {
+        return Failure(
+            "Connection closed before receiving the response" +
+            (data.empty() ? string() : " (received '" + data + "')"));
+      }
+
+      return receiveLine(socket, data + received);
+    });
+}
+
+
 Try<Owned<HealthChecker>> HealthChecker::create(
     const HealthCheck& check,
     const string& launcherDir,
@@ -135,7 +301,6 @@ Try<Owned<HealthChecker>> HealthChecker::create(
 
   Owned<HealthCheckerProcess> process(new HealthCheckerProcess(
       check,
-      launcherDir,
       callback,
       taskId,
       taskPid,
@@ -170,14 +335,12 @@ void HealthChecker::stop()
 
 HealthCheckerProcess::HealthCheckerProcess(
     const HealthCheck& _check,
-    const string& _launcherDir,
     const lambda::function<void(const TaskHealthStatus&)>& _callback,
     const TaskID& _taskId,
     const Option<pid_t>& _taskPid,
     const vector<string>& _namespaces)
   : ProcessBase(process::ID::generate("health-checker")),
     check(_check),
-    launcherDir(_launcherDir),
     healthUpdateCallback(_callback),
     taskId(_taskId),
     taskPid(_taskPid),
@@ -207,6 +370,12 @@ HealthCheckerProcess::HealthCheckerProcess(
   if (!namespaces.empty()) {
     clone = lambda::bind(&cloneWithSetns, lambda::_1, taskPid, namespaces);
   }
+
+  if (taskPid.isSome() &&
+      std::find(namespaces.begin(), namespaces.end(), "net") !=
+        namespaces.end()) {
+    network.reset(new NetworkNamespace(taskPid.get()));
+  }
 #endif
 }
 
@@ -429,6 +598,72 @@ Future<Nothing> HealthCheckerProcess::httpHealthCheck()
   const string url = scheme + "://" + DEFAULT_DOMAIN + ":" +
                      stringify(http.port()) + path;
 
+  // HTTPS health checks are delegated to curl, which (as opposed to
+  // libprocess) does not need to be built with SSL support.
+  if (scheme != DEFAULT_HTTP_SCHEME) {
+    return curlHealthCheck(url);
+  }
+
+  VLOG(1) << "Performing HTTP health check '" << url << "'";
+
+  const inet::Address address(
+      net::IP::parse(DEFAULT_DOMAIN, AF_INET).get(),
+      http.port());
+
+  // NOTE: Redirects are not followed (as opposed to the curl based
+  // health check), a 3xx response code is considered healthy.
+  const string request =
+    "GET " + (path.empty() ? "/" : path) + " HTTP/1.1\r\n"
+    "Host: " + stringify(address) + "\r\n"
+    "Connection: close\r\n"
+    "\r\n";
+
+  const Duration timeout = checkTimeout;
+
+  return socket()
+    .then([address, request](inet::Socket socket) {
+      return socket.connect(address)
+        .then([socket, request]() mutable {
+          return socket.send(request);
+        })
+        .then([socket]() {
+          return receiveLine(socket, "");
+        });
+    })
+    .after(timeout, [timeout](Future<string> future) {
+      future.discard();
+
+      return Failure(
+          "HTTP health check has not returned after " + stringify(timeout) +
+          "; aborting");
+    })
+    .then([](const string& line) -> Future<Nothing> {
+      // The status line is 'HTTP-Version SP Status-Code SP Reason'.
+      vector<string> tokens = strings::tokenize(line, " ");
+      if (tokens.size() < 2 || !strings::startsWith(tokens[0], "HTTP/")) {
+        return Failure("Unexpected status line '" + line + "'");
+      }
+
+      Try<int> code = numify<int>(tokens[1]);
+      if (code.isError()) {
+        return Failure(
+            "Unexpected status line '" + line + "': " + code.error());
+      }
+
+      if (code.get() < process::http::Status::OK ||
+          code.get() >= process::http::Status::BAD_REQUEST) {
+        return Failure(
+            "Unexpected HTTP response code: " +
+            process::http::Status::string(code.get()));
+      }
+
+      return Nothing();
+    });
+}
+
+
+Future<Nothing> HealthCheckerProcess::curlHealthCheck(const string& url)
+{
   VLOG(1) << "Launching HTTP health check '" << url << "'";
 
   const vector<string> argv = {
@@ -485,11 +720,11 @@ Future<Nothing> HealthCheckerProcess::httpHealthCheck()
           string(HTTP_CHECK_COMMAND) + " has not returned after " +
           stringify(timeout) + "; aborting");
     })
-    .then(defer(self(), &Self::_httpHealthCheck, lambda::_1));
+    .then(defer(self(), &Self::_curlHealthCheck, lambda::_1));
 }
 
 
-Future<Nothing> HealthCheckerProcess::_httpHealthCheck(
+Future<Nothing> HealthCheckerProcess::_curlHealthCheck(
     const tuple<
         Future<Option<int>>,
         Future<string>,
@@ -553,102 +788,103 @@ Future<Nothing> HealthCheckerProcess::tcpHealthCheck()
   CHECK_EQ(HealthCheck::TCP, check.type());
   CHECK(check.has_tcp());
 
-  // TCP_CHECK_COMMAND should be reachable.
-  CHECK(os::exists(launcherDir));
-
   const HealthCheck::TCPCheckInfo& tcp = check.tcp();
 
-  VLOG(1) << "Launching TCP health check at port '" << tcp.port() << "'";
+  VLOG(1) << "Performing TCP health check at port '" << tcp.port() << "'";
 
-  const string tcpConnectPath = path::join(launcherDir, TCP_CHECK_COMMAND);
+  const inet::Address address(
+      net::IP::parse(DEFAULT_DOMAIN, AF_INET).get(),
+      tcp.port());
 
-  const vector<string> tcpConnectArguments = {
-    tcpConnectPath,
-    "--ip=" + DEFAULT_DOMAIN,
-    "--port=" + stringify(tcp.port())
-  };
-
-  // TODO(alexr): Consider launching the helper binary once per task lifetime,
-  // see MESOS-6766.
-  Try<Subprocess> s = subprocess(
-      tcpConnectPath,
-      tcpConnectArguments,
-      Subprocess::PATH("/dev/null"),
-      Subprocess::PIPE(),
-      Subprocess::PIPE(),
-      nullptr,
-      None(),
-      clone);
-
-  if (s.isError()) {
-    return Failure(
-        "Failed to create the " + string(TCP_CHECK_COMMAND) +
-        " subprocess: " + s.error());
-  }
-
-  pid_t tcpConnectPid = s->pid();
   const Duration timeout = checkTimeout;
 
-  return await(
-      s->status(),
-      process::io::read(s->out().get()),
-      process::io::read(s->err().get()))
-    .after(
-        timeout,
-        [timeout, tcpConnectPid](Future<tuple<Future<Option<int>>,
-                                              Future<string>,
-                                              Future<string>>> future) {
-      future.discard();
-
-      if (tcpConnectPid != -1) {
-        // Cleanup the TCP_CHECK_COMMAND process.
-        VLOG(1) << "Killing the TCP health check process " << tcpConnectPid;
+  return socket()
+    .then([address](inet::Socket socket) {
+      return socket.connect(address)
+        .then([socket, address]() -> Future<Nothing> {
+          VLOG(1) << "Successfully established TCP connection to "
+                  << address;
 
-        os::killtree(tcpConnectPid, SIGKILL);
-      }
+          return Nothing();
+        });
+    })
+    .after(timeout, [timeout](Future<Nothing> future) {
+      future.discard();
 
       return Failure(
-          string(TCP_CHECK_COMMAND) + " has not returned after " +
-          stringify(timeout) + "; aborting");
+          "TCP health check has not returned after " + stringify(timeout) +
+          "; aborting");
     })
-    .then(defer(self(), &Self::_tcpHealthCheck, lambda::_1));
+    .repair([address](const Future<Nothing>& future) {
+      return Failure(
+          "Failed to establish TCP connection to " + stringify(address) +
+          ": " + future.failure());
+    });
 }
 
 
-Future<Nothing> HealthCheckerProcess::_tcpHealthCheck(
-    const tuple<
-        Future<Option<int>>,
-        Future<string>,
-        Future<string>>& t)
+Future<inet::Socket> HealthCheckerProcess::socket()
 {
-  Future<Option<int>> status = std::get<0>(t);
-  if (!status.isReady()) {
-    return Failure(
-        "Failed to get the exit status of the " + string(TCP_CHECK_COMMAND) +
-        " process: " + (status.isFailed() ? status.failure() : "discarded"));
-  }
-
-  if (status->isNone()) {
-    return Failure(
-        "Failed to reap the " + string(TCP_CHECK_COMMAND) + " process");
-  }
-
-  int statusCode = status->get();
-  if (statusCode != 0) {
-    Future<string> error = std::get<2>(t);
-    if (!error.isReady()) {
+#ifdef __linux__
+  if (network.get() != nullptr) {
+    // Entering the network namespace and creating the socket blocks,
+    // hence it is done on a libprocess worker rather than on this
+    // process. At most one such call is outstanding per health
+    // checker, so a namespace that does not respond ties up a single
+    // worker rather than one per health check.
+    if (pendingSocket.isSome() && pendingSocket->isPending()) {
       return Failure(
-          string(TCP_CHECK_COMMAND) + " returned " +
-          WSTRINGIFY(statusCode) + "; reading stderr failed: " +
-          (error.isFailed() ? error.failure() : "discarded"));
+          "Creating a socket in the network namespace of the task has not"
+          " returned yet");
     }
 
-    return Failure(
-        string(TCP_CHECK_COMMAND) + " returned " +
-        WSTRINGIFY(statusCode) + ": " + error.get());
+    std::shared_ptr<NetworkNamespace> _network = network;
+
+    pendingSocket = process::async([_network]() {
+      return _network->socket();
+    });
+
+    const Duration timeout = checkTimeout;
+
+    return pendingSocket.get()
+      .after(timeout, [timeout](Future<Try<int_fd>> future) {
+        // The call can not be interrupted, close the socket once it
+        // has been created since no health check is waiting for it.
+        future.onReady([](const Try<int_fd>& fd) {
+          if (fd.isSome()) {
+            os::close(fd.get());
+          }
+        });
+
+        return Failure(
+            "Creating a socket in the network namespace of the task has not"
+            " returned after " + stringify(timeout) + "; aborting");
+      })
+      .then([](const Try<int_fd>& fd) -> Future<inet::Socket> {
+        if (fd.isError()) {
+          return Failure(fd.error());
+        }
+
+        Try<inet::Socket> socket =
+          inet::Socket::create(fd.get(), SocketImpl::Kind::POLL);
+        if (socket.isError()) {
+          os::close(fd.get());
+          return Failure("Failed to create socket: " + socket.error());
+        }
+
+        return socket.get();
+      });
   }
+#endif // __linux__
 
-  return Nothing();
+  // NOTE: The other namespaces (e.g., the mount namespace) do not
+  // matter to HTTP and TCP health checks.
+  Try<inet::Socket> socket = inet::Socket::create(SocketImpl::Kind::POLL);
+  if (socket.isError()) {
+    return Failure("Failed to create socket: " + socket.error());
+  }
+
+  return socket.get();
 }
 
 
@@ -17,6 +17,7 @@
 #ifndef __HEALTH_CHECKER_HPP__
 #define __HEALTH_CHECKER_HPP__
 
+#include <memory>
 #include <string>
 #include <tuple>
 #include <vector>
@@ -28,12 +29,17 @@
 #include <process/pid.hpp>
 #include <process/process.hpp>
 #include <process/protobuf.hpp>
+#include <process/socket.hpp>
 #include <process/time.hpp>
 
 #include <stout/duration.hpp>
 #include <stout/lambda.hpp>
 #include <stout/nothing.hpp>
+#include <stout/option.hpp>
 #include <stout/stopwatch.hpp>
+#include <stout/try.hpp>
+
+#include <stout/os/int_fd.hpp>
 
 #include "messages/messages.hpp"
 
@@ -43,6 +49,7 @@ namespace checks {
 
 // Forward declarations.
 class HealthCheckerProcess;
+class NetworkNamespace;
 
 class HealthChecker
 {
@@ -53,6 +60,9 @@ public:
    *
    * @param check The protobuf message definition of health check.
    * @param launcherDir A directory where Mesos helper binaries are located.
+   *     Deprecated and ignored, since TCP health checks are performed
+   *     in-process rather than by running `mesos-tcp-connect`. It will be
+   *     removed along with that binary.
    * @param callback A callback HealthChecker uses to send health status
    *     updates to its owner (usually an executor).
    * @param taskId The TaskID of the target task.
@@ -92,7 +102,6 @@ class HealthCheckerProcess : public ProtobufProcess<HealthCheckerProcess>
 public:
   HealthCheckerProcess(
       const HealthCheck& _check,
-      const std::string& _launcherDir,
       const lambda::function<void(const TaskHealthStatus&)>& _callback,
       const TaskID& _taskId,
       const Option<pid_t>& _taskPid,
@@ -116,7 +125,9 @@ private:
 
   process::Future<Nothing> httpHealthCheck();
 
-  process::Future<Nothing> _httpHealthCheck(
+  process::Future<Nothing> curlHealthCheck(const std::string& url);
+
+  process::Future<Nothing> _curlHealthCheck(
       const std::tuple<
           process::Future<Option<int>>,
           process::Future<std::string>,
@@ -124,11 +135,9 @@ private:
 
   process::Future<Nothing> tcpHealthCheck();
 
-  process::Future<Nothing> _tcpHealthCheck(
-      const std::tuple<
-          process::Future<Option<int>>,
-          process::Future<std::string>,
-          process::Future<std::string>>& t);
+  // Creates the socket of an in-process HTTP or TCP health check, in
+  // the network namespace of the task if it is to be entered.
+  process::Future<process::network::inet::Socket> socket();
 
   void scheduleNext(const Duration& duration);
 
@@ -138,15 +147,21 @@ private:
   Duration checkGracePeriod;
   Duration checkTimeout;
 
-  // Contains a binary for TCP health checks.
-  const std::string launcherDir;
-
   const lambda::function<void(const TaskHealthStatus&)> healthUpdateCallback;
   const TaskID taskId;
   const Option<pid_t> taskPid;
   const std::vector<std::string> namespaces;
   Option<lambda::function<pid_t(const lambda::function<int()>&)>> clone;
 
+  // The network namespace of the task, entered once (on the first
+  // in-process health check) for all subsequent health checks. It is
+  // shared with the call creating a socket in it, which may outlive
+  // this process.
+  std::shared_ptr<NetworkNamespace> network;
+
+  // The outstanding call creating a socket in the network namespace.
+  Option<process::Future<Try<int_fd>>> pendingSocket;
+
   uint32_t consecutiveFailures;
   process::Time startTime;
   bool initializing;
@@ -43,6 +43,11 @@ using std::string;
 // and can be used as a TCP health checker. It returns `EXIT_SUCCESS` iff
 // the TCP handshake was successful and `EXIT_FAILURE` otherwise.
 //
+// NOTE: This binary is deprecated and will be removed in a future
+// release. Mesos no longer uses it, since the health checker performs
+// TCP health checks in-process. It is still installed for the users
+// (e.g., custom executors) that run it directly.
+//
 // TODO(alexr): Support TCP half-open, see MESOS-6116.
 //
 // TODO(alexr): Add support for Windows, see MESOS-6117.
@@ -132,6 +137,9 @@ int main(int argc, char *argv[])
     return EXIT_SUCCESS;
   }
 
+  cerr << "WARNING: mesos-tcp-connect is deprecated and will be removed "
+       << "in a future release" << endl;
+
   if (flags.ip.isNone()) {
     cerr << flags.usage("Missing required option --ip") << endl;
     return EXIT_FAILURE;
@@ -102,13 +102,24 @@ Try<Owned<Docker>> Docker::create(
     const string& path,
     const string& socket,
     bool validate,
-    const Option<JSON::Object>& config)
+    const Option<JSON::Object>& config,
+    bool api)
 {
   if (!path::absolute(socket)) {
     return Error("Invalid Docker socket path: " + socket);
   }
 
-  Owned<Docker> docker(new Docker(path, socket, config));
+  Option<Owned<docker::Engine>> engine;
+  if (api) {
+    Try<Owned<docker::Engine>> create = docker::Engine::create(socket);
+    if (create.isError()) {
+      return Error(create.error());
+    }
+
+    engine = create.get();
+  }
+
+  Owned<Docker> docker(new Docker(path, socket, config, engine));
   if (!validate) {
     return docker;
   }
@@ -143,6 +154,25 @@ void commandDiscarded(const Subprocess& s, const string& cmd)
 
 Future<Version> Docker::version() const
 {
+  if (engine.isSome()) {
+    // NOTE: This is the version of the daemon rather than the CLI.
+    return engine.get()->send("GET", "/version")
+      .then([](const string& output) -> Future<Version> {
+        Try<JSON::Object> json = JSON::parse<JSON::Object>(output);
+        if (json.isError()) {
+          return Failure("Failed to parse JSON: " + json.error());
+        }
+
+        Result<JSON::String> version = json->find<JSON::String>("Version");
+        if (!version.isSome()) {
+          return Failure("Unable to find docker version in output");
+        }
+
+        // Parse it the same as the output of 'docker --version'.
+        return __version("Docker version " + version->value);
+      });
+  }
+
   string cmd = path + " -H " + socket + " --version";
 
   Try<Subprocess> s = subprocess(
@@ -902,6 +932,25 @@ Future<Nothing> Docker::stop(
                    stringify(timeoutSecs));
   }
 
+  if (engine.isSome()) {
+    Future<string> stop = engine.get()->send(
+        "POST",
+        "/containers/" + containerName + "/stop",
+        {{"t", stringify(timeoutSecs)}});
+
+    if (!remove) {
+      return stop.then([]() { return Nothing(); });
+    }
+
+    const Docker docker = *this;
+
+    return stop.then([]() { return true; })
+      .repair([](const Future<bool>&) { return false; })
+      .then([=](bool stopped) {
+        return docker.rm(containerName, !stopped);
+      });
+  }
+
   string cmd = path + " -H " + socket + " stop -t " + stringify(timeoutSecs) +
                " " + containerName;
 
@@ -949,6 +998,14 @@ Future<Nothing> Docker::kill(
     const string& containerName,
     int signal) const
 {
+  if (engine.isSome()) {
+    return engine.get()->send(
+        "POST",
+        "/containers/" + containerName + "/kill",
+        {{"signal", stringify(signal)}})
+      .then([]() { return Nothing(); });
+  }
+
   const string cmd =
     path + " -H " + socket +
     " kill --signal=" + stringify(signal) + " " + containerName;
@@ -973,6 +1030,17 @@ Future<Nothing> Docker::rm(
     const string& containerName,
     bool force) const
 {
+  if (engine.isSome()) {
+    // Remove the Docker volumes that may be present, as below.
+    hashmap<string, string> query = {{"v", "1"}};
+    if (force) {
+      query["force"] = "1";
+    }
+
+    return engine.get()->send("DELETE", "/containers/" + containerName, query)
+      .then([]() { return Nothing(); });
+  }
+
   // The `-v` flag removes Docker volumes that may be present.
   const string cmd =
     path + " -H " + socket +
@@ -1000,6 +1068,11 @@ Future<Docker::Container> Docker::inspect(
 {
   Owned<Promise<Docker::Container>> promise(new Promise<Docker::Container>());
 
+  if (engine.isSome()) {
+    _inspect(engine.get(), containerName, promise, retryInterval);
+    return promise->future();
+  }
+
   const string cmd =  path + " -H " + socket + " inspect " + containerName;
   _inspect(cmd, promise, retryInterval);
 
@@ -1130,10 +1203,133 @@ void Docker::___inspect(
 }
 
 
+void Docker::_inspect(
+    const Owned<docker::Engine>& engine,
+    const string& containerName,
+    const Owned<Promise<Docker::Container>>& promise,
+    const Option<Duration>& retryInterval)
+{
+  if (promise->future().hasDiscard()) {
+    promise->discard();
+    return;
+  }
+
+  // Start waiting for the next event about the container before
+  // inspecting it, so that a change in between is not missed.
+  Future<Nothing> changed = Nothing();
+  if (retryInterval.isSome()) {
+    changed = engine->changed(containerName);
+  }
+
+  const string path = "/containers/" + containerName + "/json";
+
+  engine->send("GET", path)
+    .onAny([=](const Future<string>& output) {
+      Future<Nothing> _changed = changed; // Remove const.
+
+      if (promise->future().hasDiscard()) {
+        _changed.discard();
+        promise->discard();
+        return;
+      }
+
+      Option<Try<Docker::Container>> container;
+      if (output.isReady()) {
+        // The API returns a single object rather than the array
+        // printed by 'docker inspect'.
+        container = Docker::Container::create("[" + output.get() + "]");
+      }
+
+      if (retryInterval.isSome() &&
+          (container.isNone() ||
+           (container->isSome() && !container->get().started))) {
+        VLOG(1) << "Retrying inspect of '" << containerName << "' "
+                << (container.isNone()
+                    ? "after failure: " +
+                      (output.isFailed() ? output.failure() : "discarded")
+                    : string("since container not yet started"))
+                << ", interval: " << stringify(retryInterval.get());
+
+        _changed
+          .after(retryInterval.get(), [](Future<Nothing> future) {
+            future.discard();
+            return Nothing();
+          })
+          .onAny([=]() {
+            _inspect(engine, containerName, promise, retryInterval);
+          });
+
+        return;
+      }
+
+      _changed.discard();
+
+      if (container.isNone()) {
+        promise->fail(output.isFailed() ? output.failure() : "discarded");
+      } else if (container->isError()) {
+        promise->fail("Unable to create container: " + container->error());
+      } else {
+        promise->set(container->get());
+      }
+    });
+}
+
+
 Future<list<Docker::Container>> Docker::ps(
     bool all,
     const Option<string>& prefix) const
 {
+  if (engine.isSome()) {
+    hashmap<string, string> query;
+    if (all) {
+      query["all"] = "1";
+    }
+
+    const Docker docker = *this;
+
+    return engine.get()->send("GET", "/containers/json", query)
+      .then([=](const string& output) -> Future<list<Docker::Container>> {
+        Try<JSON::Array> json = JSON::parse<JSON::Array>(output);
+        if (json.isError()) {
+          return Failure("Failed to parse JSON: " + json.error());
+        }
+
+        // Inspect the containers by name, as for the output of
+        // 'docker ps'.
+        Owned<vector<string>> names(new vector<string>());
+
+        foreach (const JSON::Value& value, json->values) {
+          if (!value.is<JSON::Object>()) {
+            return Failure("Unexpected container '" + stringify(value) + "'");
+          }
+
+          Result<JSON::Array> _names =
+            value.as<JSON::Object>().find<JSON::Array>("Names");
+
+          if (!_names.isSome() || _names->values.empty() ||
+              !_names->values.front().is<JSON::String>()) {
+            return Failure("Unable to find Names in container");
+          }
+
+          // NOTE: The names are prefixed with '/'.
+          names->push_back(strings::remove(
+              _names->values.front().as<JSON::String>().value,
+              "/",
+              strings::PREFIX));
+        }
+
+        Owned<list<Docker::Container>> containers(
+            new list<Docker::Container>());
+
+        Owned<Promise<list<Docker::Container>>> promise(
+            new Promise<list<Docker::Container>>());
+
+        inspectBatches(containers, names, promise, docker, prefix);
+
+        return promise->future();
+      });
+  }
+
   string cmd = path + " -H " + socket + (all ? " ps -a" : " ps");
 
   VLOG(1) << "Running " << cmd;
@@ -37,9 +37,19 @@
 
 #include "mesos/resources.hpp"
 
+#include "docker/engine.hpp"
+
 
 // Abstraction for working with Docker (modeled on CLI).
 //
+// If 'api' is set when creating the abstraction, containers are
+// inspected, listed, stopped, killed and removed using the Docker
+// Engine API on the socket (see `docker::Engine`) rather than the
+// CLI, and inspecting a container until it starts waits for its
+// events rather than polling. Running containers and pulling images
+// always uses the CLI, which streams the output of the container and
+// handles the registry credentials.
+//
 // TODO(benh): Make futures returned by functions be discardable.
 class Docker
 {
@@ -49,7 +59,8 @@ public:
       const std::string& path,
       const std::string& socket,
       bool validate = true,
-      const Option<JSON::Object>& config = None());
+      const Option<JSON::Object>& config = None(),
+      bool api = false);
 
   virtual ~Docker() {}
 
@@ -210,10 +221,12 @@ protected:
   // Uses the specified path to the Docker CLI tool.
   Docker(const std::string& _path,
          const std::string& _socket,
-         const Option<JSON::Object>& _config)
+         const Option<JSON::Object>& _config,
+         const Option<process::Owned<docker::Engine>>& _engine = None())
        : path(_path),
          socket("unix://" + _socket),
-         config(_config) {}
+         config(_config),
+         engine(_engine) {}
 
 private:
   static process::Future<Version> _version(
@@ -248,6 +261,16 @@ private:
       const Option<Duration>& retryInterval,
       const process::Future<std::string>& output);
 
+  // Inspects the container using the Docker Engine API. If
+  // retryInterval is set, the next inspect happens as soon as an
+  // event about the container is received or after retryInterval,
+  // whichever comes first.
+  static void _inspect(
+      const process::Owned<docker::Engine>& engine,
+      const std::string& containerName,
+      const process::Owned<process::Promise<Container>>& promise,
+      const Option<Duration>& retryInterval);
+
   static process::Future<std::list<Container>> _ps(
       const Docker& docker,
       const std::string& cmd,
@@ -307,6 +330,9 @@ private:
   const std::string path;
   const std::string socket;
   const Option<JSON::Object> config;
+
+  // The Docker Engine API client, if enabled.
+  const Option<process::Owned<docker::Engine>> engine;
 };
 
 #endif // __DOCKER_HPP__
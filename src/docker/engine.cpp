@@ -0,0 +1,359 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <list>
+#include <string>
+
+#include <glog/logging.h>
+
+#include <process/address.hpp>
+#include <process/defer.hpp>
+#include <process/delay.hpp>
+#include <process/dispatch.hpp>
+#include <process/http.hpp>
+#include <process/id.hpp>
+#include <process/process.hpp>
+
+#include <stout/foreach.hpp>
+#include <stout/json.hpp>
+#include <stout/lambda.hpp>
+#include <stout/option.hpp>
+#include <stout/result.hpp>
+
+#include "docker/engine.hpp"
+
+namespace http = process::http;
+namespace unix = process::network::unix;
+
+using std::list;
+using std::string;
+
+using process::Failure;
+using process::Future;
+using process::Owned;
+using process::Process;
+using process::Promise;
+
+using process::defer;
+using process::delay;
+using process::dispatch;
+using process::spawn;
+using process::terminate;
+
+namespace docker {
+
+// The interval after which a failed (or ended) subscription to the
+// events of the daemon is retried.
+constexpr Duration EVENTS_RETRY_INTERVAL = Seconds(1);
+
+
+class EngineProcess : public Process<EngineProcess>
+{
+public:
+  explicit EngineProcess(const unix::Address& _address)
+    : ProcessBase(process::ID::generate("docker-engine")),
+      address(_address) {}
+
+  virtual ~EngineProcess() {}
+
+  Future<string> send(
+      const string& method,
+      const string& path,
+      const hashmap<string, string>& query)
+  {
+    http::Request request;
+    request.method = method;
+    request.url = http::URL("http", "docker", 80, path, query);
+    request.keepAlive = false;
+
+    return http::connect(address, http::Scheme::HTTP)
+      .then([request](http::Connection connection) {
+        return connection.send(request)
+          .onAny([connection]() mutable { connection.disconnect(); });
+      })
+      .then([method, path](const http::Response& response) -> Future<string> {
+        if ((response.code >= 200 && response.code < 300) ||
+            response.code == 304) {
+          return response.body;
+        }
+
+        // The daemon describes errors as '{"message": "..."}'.
+        string message = response.body;
+
+        Try<JSON::Object> json = JSON::parse<JSON::Object>(response.body);
+        if (json.isSome()) {
+          Result<JSON::String> _message =
+            json->find<JSON::String>("message");
+
+          if (_message.isSome()) {
+            message = _message->value;
+          }
+        }
+
+        return Failure(
+            "Failed to " + method + " '" + path + "': " +
+            response.status + ": " + message);
+      });
+  }
+
+  Future<Nothing> changed(const string& container)
+  {
+    Owned<Promise<Nothing>> promise(new Promise<Nothing>());
+    waiters[container].push_back(promise);
+
+    Future<Nothing> future = promise->future();
+    future.onDiscard(defer(self(), &Self::discarded, container));
+
+    return future;
+  }
+
+protected:
+  virtual void initialize()
+  {
+    subscribe();
+  }
+
+  virtual void finalize()
+  {
+    if (connection.isSome()) {
+      connection->disconnect();
+    }
+
+    foreachvalue (const list<Owned<Promise<Nothing>>>& promises, waiters) {
+      foreach (const Owned<Promise<Nothing>>& promise, promises) {
+        promise->discard();
+      }
+    }
+  }
+
+private:
+  void subscribe()
+  {
+    http::Request request;
+    request.method = "GET";
+    request.url = http::URL(
+        "http",
+        "docker",
+        80,
+        "/events",
+        {{"filters", "{\"type\":[\"container\"]}"}});
+
+    request.keepAlive = true;
+
+    http::connect(address, http::Scheme::HTTP)
+      .then(defer(self(), [=](http::Connection connection) {
+        this->connection = connection;
+        return connection.send(request, true);
+      }))
+      .onAny(defer(self(), &Self::_subscribe, lambda::_1));
+  }
+
+  void _subscribe(const Future<http::Response>& response)
+  {
+    if (!response.isReady()) {
+      resubscribe(
+          response.isFailed() ? response.failure() : "discarded");
+      return;
+    }
+
+    if (response->code != http::Status::OK ||
+        response->type != http::Response::PIPE) {
+      resubscribe("Unexpected response '" + response->status + "'");
+      return;
+    }
+
+    CHECK_SOME(response->reader);
+
+    VLOG(1) << "Subscribed to the events of the docker daemon at '"
+            << address << "'";
+
+    reader = response->reader.get();
+    read();
+  }
+
+  void read()
+  {
+    CHECK_SOME(reader);
+
+    reader->read()
+      .onAny(defer(self(), &Self::_read, lambda::_1));
+  }
+
+  void _read(const Future<string>& chunk)
+  {
+    if (!chunk.isReady()) {
+      resubscribe(chunk.isFailed() ? chunk.failure() : "discarded");
+      return;
+    }
+
+    if (chunk->empty()) {
+      resubscribe("End of stream");
+      return;
+    }
+
+    // The daemon sends each event as a JSON object followed by a
+    // newline, possibly across (or combined in) chunks.
+    buffer += chunk.get();
+
+    size_t index;
+    while ((index = buffer.find('\n')) != string::npos) {
+      event(buffer.substr(0, index));
+      buffer.erase(0, index + 1);
+    }
+
+    read();
+  }
+
+  void event(const string& line)
+  {
+    Try<JSON::Object> json = JSON::parse<JSON::Object>(line);
+    if (json.isError()) {
+      VLOG(1) << "Ignoring unexpected docker event '" << line << "': "
+              << json.error();
+      return;
+    }
+
+    // NOTE: The name of the container is only part of events since
+    // Docker 1.10.
+    Result<JSON::String> id = json->find<JSON::String>("id");
+    Result<JSON::String> name =
+      json->find<JSON::String>("Actor.Attributes.name");
+
+    if (id.isSome()) {
+      notify(id->value);
+    }
+
+    if (name.isSome()) {
+      notify(name->value);
+    }
+  }
+
+  void notify(const string& container)
+  {
+    if (waiters.contains(container)) {
+      foreach (const Owned<Promise<Nothing>>& promise, waiters[container]) {
+        promise->set(Nothing());
+      }
+
+      waiters.erase(container);
+    }
+  }
+
+  void discarded(const string& container)
+  {
+    if (waiters.contains(container)) {
+      waiters[container].remove_if(
+          [](const Owned<Promise<Nothing>>& promise) {
+            if (promise->future().hasDiscard()) {
+              promise->discard();
+              return true;
+            }
+
+            return false;
+          });
+
+      if (waiters[container].empty()) {
+        waiters.erase(container);
+      }
+    }
+  }
+
+  void resubscribe(const string& message)
+  {
+    LOG(WARNING) << "Lost the subscription to the events of the docker "
+                 << "daemon at '" << address << "': " << message;
+
+    if (connection.isSome()) {
+      connection->disconnect();
+      connection = None();
+    }
+
+    reader = None();
+    buffer.clear();
+
+    // Events might have been missed, so wake up all waiters so that
+    // they can check the containers again.
+    foreachvalue (const list<Owned<Promise<Nothing>>>& promises, waiters) {
+      foreach (const Owned<Promise<Nothing>>& promise, promises) {
+        promise->set(Nothing());
+      }
+    }
+
+    waiters.clear();
+
+    delay(EVENTS_RETRY_INTERVAL, self(), &Self::subscribe);
+  }
+
+  const unix::Address address;
+
+  Option<http::Connection> connection;
+  Option<http::Pipe::Reader> reader;
+
+  // The unprocessed (i.e., incomplete) line of the event stream.
+  string buffer;
+
+  // The callers waiting for the next event, by container name or ID.
+  hashmap<string, list<Owned<Promise<Nothing>>>> waiters;
+};
+
+
+Try<Owned<Engine>> Engine::create(const string& socket)
+{
+  // Validate the path of the socket, which is converted again when
+  // spawning the process.
+  Try<unix::Address> address = unix::Address::create(socket);
+  if (address.isError()) {
+    return Error(
+        "Invalid Docker socket path '" + socket + "': " + address.error());
+  }
+
+  return Owned<Engine>(new Engine(socket));
+}
+
+
+Engine::Engine(const string& socket)
+{
+  process = new EngineProcess(unix::Address::create(socket).get());
+
+  // NOTE: The process is garbage collected once terminated, since
+  // copies of an `Owned<Engine>` captured by the callbacks of its
+  // own futures might be the last to be destroyed, possibly on the
+  // thread running the process (on which it can't be waited for).
+  spawn(process, true);
+}
+
+
+Engine::~Engine()
+{
+  terminate(process);
+}
+
+
+Future<string> Engine::send(
+    const string& method,
+    const string& path,
+    const hashmap<string, string>& query) const
+{
+  return dispatch(process, &EngineProcess::send, method, path, query);
+}
+
+
+Future<Nothing> Engine::changed(const string& container) const
+{
+  return dispatch(process, &EngineProcess::changed, container);
+}
+
+} // namespace docker {
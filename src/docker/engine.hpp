@@ -0,0 +1,79 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __DOCKER_ENGINE_HPP__
+#define __DOCKER_ENGINE_HPP__
+
+#include <string>
+
+#include <process/future.hpp>
+#include <process/owned.hpp>
+
+#include <stout/duration.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/nothing.hpp>
+#include <stout/try.hpp>
+
+namespace docker {
+
+// Forward declaration.
+class EngineProcess;
+
+
+// A client of the Docker Engine API served by the docker daemon on a
+// unix socket. This avoids forking the docker CLI (which in turn
+// talks to the same API) for each request.
+//
+// The client also keeps a subscription to the container events of
+// the daemon so that callers can wait for a container to change
+// (e.g., to start) rather than polling it.
+class Engine
+{
+public:
+  static Try<process::Owned<Engine>> create(const std::string& socket);
+
+  ~Engine();
+
+  // Sends a request for 'path' (e.g., "/containers/json") and returns
+  // the body of the response. Returns a failure, including the
+  // message of the daemon if any, unless the response is successful.
+  // Note that a "304 Not Modified" (e.g., when stopping a container
+  // that is already stopped) is considered successful.
+  process::Future<std::string> send(
+      const std::string& method,
+      const std::string& path,
+      const hashmap<std::string, std::string>& query =
+        hashmap<std::string, std::string>()) const;
+
+  // Returns a future that is satisfied when the next event about the
+  // container with the given name (or ID) is received. The future is
+  // also satisfied if the subscription to the events is interrupted,
+  // since events might have been missed. The caller can discard the
+  // future to stop waiting.
+  process::Future<Nothing> changed(const std::string& container) const;
+
+private:
+  explicit Engine(const std::string& socket);
+
+  Engine(const Engine&) = delete;
+  Engine& operator=(const Engine&) = delete;
+
+  EngineProcess* process;
+};
+
+} // namespace docker {
+
+#endif // __DOCKER_ENGINE_HPP__
@@ -48,6 +48,12 @@ struct Flags : public virtual mesos::internal::logging::Flags
         "The UNIX socket path to be used by docker CLI for accessing docker\n"
         "daemon.");
 
+    add(&Flags::docker_engine_api,
+        "docker_engine_api",
+        "Whether to use the Docker Engine API on the socket rather than\n"
+        "the docker CLI, except for running the container.",
+        false);
+
     add(&Flags::sandbox_directory,
         "sandbox_directory",
         "The path to the container sandbox holding stdout and stderr files\n"
@@ -78,6 +84,7 @@ struct Flags : public virtual mesos::internal::logging::Flags
   Option<std::string> container;
   Option<std::string> docker;
   Option<std::string> docker_socket;
+  bool docker_engine_api;
   Option<std::string> sandbox_directory;
   Option<std::string> mapped_directory;
   Option<std::string> launcher_dir;
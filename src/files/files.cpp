@@ -20,6 +20,10 @@
 
 #include <sys/stat.h>
 
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif // __linux__
+
 #include <algorithm>
 #include <map>
 #include <string>
@@ -27,6 +31,8 @@
 
 #include <boost/shared_array.hpp>
 
+#include <process/after.hpp>
+#include <process/clock.hpp>
 #include <process/defer.hpp>
 #include <process/deferred.hpp> // TODO(benh): This is required by Clang.
 #include <process/dispatch.hpp>
@@ -34,9 +40,12 @@
 #include <process/help.hpp>
 #include <process/http.hpp>
 #include <process/io.hpp>
+#include <process/loop.hpp>
 #include <process/mime.hpp>
 #include <process/process.hpp>
 
+#include <stout/bytes.hpp>
+#include <stout/duration.hpp>
 #include <stout/error.hpp>
 #include <stout/hashmap.hpp>
 #include <stout/json.hpp>
@@ -74,12 +83,17 @@ using mesos::Authorizer;
 
 using process::AUTHENTICATION;
 using process::AUTHORIZATION;
+using process::Break;
+using process::Clock;
+using process::Continue;
+using process::ControlFlow;
 using process::defer;
 using process::DESCRIPTION;
 using process::Failure;
 using process::Future;
 using process::HELP;
 using process::Process;
+using process::Time;
 using process::TLDR;
 using process::wait; // Necessary on some OS's to disambiguate.
 
@@ -92,6 +106,94 @@ using std::vector;
 namespace mesos {
 namespace internal {
 
+// The maximum time a binary read of the end of a file waits for the
+// file to grow (i.e., the maximum 'timeout' of a long-poll).
+constexpr Duration MAX_READ_TIMEOUT = Minutes(1);
+
+// The interval at which the size of a file is checked while waiting
+// for it to grow, where inotify is not available.
+constexpr Duration READ_POLL_INTERVAL = Milliseconds(100);
+
+
+// Returns a future that is satisfied once the file at the given path
+// is larger than 'size', or once the timeout has elapsed, by checking
+// its size periodically.
+static Future<Nothing> polled(
+    const string& path,
+    off_t size,
+    const Duration& timeout)
+{
+  const Time deadline = Clock::now() + timeout;
+
+  return process::loop(
+      [=]() {
+        return process::after(
+            std::min(READ_POLL_INTERVAL, deadline - Clock::now()));
+      },
+      [=](const Nothing&) -> ControlFlow<Nothing> {
+        Try<Bytes> current = os::stat::size(path);
+        if (current.isError() ||
+            current->bytes() > static_cast<uint64_t>(size) ||
+            Clock::now() >= deadline) {
+          return Break();
+        }
+
+        return Continue();
+      });
+}
+
+
+// Returns a future that is satisfied once the file at the given path
+// is larger than 'size' (or might be, e.g., once it has been written
+// to), or once the timeout has elapsed.
+static Future<Nothing> grown(
+    const string& path,
+    off_t size,
+    const Duration& timeout)
+{
+#ifdef __linux__
+  // If the file cannot be watched (e.g., because the limit of inotify
+  // instances was reached) we fall back to polling its size rather
+  // than failing, which would make clients retry right away.
+  int fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd < 0) {
+    VLOG(1) << ErrnoError("Failed to initialize inotify").message
+            << "; polling the size of '" << path << "' instead";
+
+    return polled(path, size, timeout);
+  }
+
+  if (::inotify_add_watch(
+          fd,
+          path.c_str(),
+          IN_MODIFY | IN_CLOSE_WRITE | IN_MOVE_SELF | IN_DELETE_SELF) < 0) {
+    VLOG(1) << ErrnoError("Failed to watch '" + path + "'").message
+            << "; polling its size instead";
+
+    os::close(fd);
+    return polled(path, size, timeout);
+  }
+
+  // The file might have grown before it was watched.
+  Try<Bytes> current = os::stat::size(path);
+  if (current.isError() || current->bytes() > static_cast<uint64_t>(size)) {
+    os::close(fd);
+    return Nothing();
+  }
+
+  return io::poll(fd, io::READ)
+    .then([]() { return Nothing(); })
+    .after(timeout, [](Future<Nothing> future) {
+      future.discard();
+      return Nothing();
+    })
+    .onAny([fd]() { os::close(fd); });
+#else
+  return polled(path, size, timeout);
+#endif // __linux__
+}
+
+
 class FilesProcess : public Process<FilesProcess>
 {
 public:
@@ -153,6 +255,19 @@ private:
       const http::Request& request,
       const Option<string>& principal);
 
+  // Returns the raw contents of a file, or the range of it requested
+  // with the 'Range' header, for `__read()` with 'format=binary'.
+  // Waits for the file to grow first if the range starts at the end of
+  // the file and a 'timeout' is given (i.e., a long-poll).
+  Future<http::Response> readBinary(
+      const http::Request& request,
+      const Option<string>& principal);
+
+  Future<http::Response> _readBinary(
+      const string& path,
+      const Option<off_t>& start,
+      const Option<Duration>& timeout);
+
   // Returns the raw file contents for a given path.
   // Requests have the following parameters:
   //   path: The directory to browse. Required.
@@ -462,14 +577,25 @@ const string FilesProcess::READ_HELP = HELP(
         "Reads data from a file."),
     DESCRIPTION(
         "This endpoint reads data from a file at a given offset and for",
-        "a given length."
+        "a given length.",
+        "",
+        "With 'format=binary' the raw data of the file is returned",
+        "instead (rather than JSON), and a range of it is requested",
+        "with the 'Range' header (e.g., 'Range: bytes=1024-') rather",
+        "than with 'offset' and 'length'. If a 'timeout' is given and",
+        "the range starts at the end of the file, the response is only",
+        "returned once the file grows (or the timeout elapses), which",
+        "allows following a file that is being appended to.",
         "",
         "Query parameters:",
         "",
         ">        path=VALUE          The path of directory to browse.",
         ">        offset=VALUE        Value added to base address to obtain "
         "a second address",
-        ">        length=VALUE        Length of file to read."),
+        ">        length=VALUE        Length of file to read.",
+        ">        format=VALUE        Either 'json' (default) or 'binary'.",
+        ">        timeout=VALUE       How long to wait for the file to grow "
+        "(at most 1mins), e.g., '30secs'."),
     AUTHENTICATION(true),
     AUTHORIZATION(
         "Reading files requires that the request principal is",
@@ -492,6 +618,16 @@ Future<http::Response> FilesProcess::__read(
     return BadRequest("Expecting 'path=value' in query.\n");
   }
 
+  Option<string> format = request.url.query.get("format");
+
+  if (format.isSome() && format.get() != "json" && format.get() != "binary") {
+    return BadRequest("Unsupported format '" + format.get() + "'.\n");
+  }
+
+  if (format == string("binary")) {
+    return readBinary(request, principal);
+  }
+
   off_t offset = -1;
 
   if (request.url.query.get("offset").isSome()) {
@@ -580,6 +716,109 @@ Future<http::Response> FilesProcess::__read(
 }
 
 
+Future<http::Response> FilesProcess::readBinary(
+    const http::Request& request,
+    const Option<string>& principal)
+{
+  const string path = request.url.query.get("path").get();
+
+  Option<Duration> timeout;
+
+  if (request.url.query.get("timeout").isSome()) {
+    Try<Duration> result =
+      Duration::parse(request.url.query.get("timeout").get());
+
+    if (result.isError()) {
+      return BadRequest("Failed to parse timeout: " + result.error() + ".\n");
+    }
+
+    timeout = std::min(result.get(), MAX_READ_TIMEOUT);
+  }
+
+  // The start of the requested range, if any, to determine whether to
+  // wait for the file to grow. The range itself is served (or found
+  // to be invalid or unsatisfiable) by libprocess.
+  Option<off_t> start;
+
+  Option<string> range = request.headers.get("Range");
+
+  if (timeout.isSome() &&
+      range.isSome() &&
+      strings::startsWith(range.get(), "bytes=")) {
+    vector<string> tokens =
+      strings::split(range->substr(strlen("bytes=")), "-");
+
+    if (tokens.size() == 2) {
+      Try<off_t> first = numify<off_t>(strings::trim(tokens[0]));
+      if (first.isSome() && first.get() >= 0) {
+        start = first.get();
+      }
+    }
+  }
+
+  return authorize(path, principal)
+    .then(defer(self(),
+        [this, path, start, timeout](bool authorized)
+          -> Future<http::Response> {
+      if (!authorized) {
+        return Forbidden();
+      }
+
+      return _readBinary(path, start, timeout);
+    }));
+}
+
+
+Future<http::Response> FilesProcess::_readBinary(
+    const string& path,
+    const Option<off_t>& start,
+    const Option<Duration>& timeout)
+{
+  Result<string> resolvedPath = resolve(path);
+
+  if (resolvedPath.isError()) {
+    return BadRequest(resolvedPath.error() + ".\n");
+  } else if (!resolvedPath.isSome()) {
+    return NotFound();
+  }
+
+  // Don't read directories.
+  if (os::stat::isdir(resolvedPath.get())) {
+    return BadRequest("Cannot read a directory.\n");
+  }
+
+  // The file is sent by libprocess (using sendfile), which also serves
+  // the range requested with the 'Range' header.
+  OK response;
+  response.type = response.PATH;
+  response.path = resolvedPath.get();
+  response.headers["Content-Type"] = "application/octet-stream";
+
+  if (start.isNone() || timeout.isNone()) {
+    return response;
+  }
+
+  Try<Bytes> size = os::stat::size(resolvedPath.get());
+  if (size.isError() || size->bytes() > static_cast<uint64_t>(start.get())) {
+    return response;
+  }
+
+  // Wait for the file to grow, after which the range is satisfiable.
+  // If it does not grow before the timeout the range is still not
+  // satisfiable, which libprocess responds to accordingly.
+  return grown(resolvedPath.get(), start.get(), timeout.get())
+    .then([response]() -> http::Response {
+      return response;
+    })
+    .repair([path, response](const Future<http::Response>& future) {
+      LOG(WARNING) << "Failed to wait for '" << path << "' to grow: "
+                   << future.failure();
+
+      return response;
+    });
+}
+
+
 Future<Try<tuple<size_t, string>, FilesError>> FilesProcess::read(
     const size_t offset,
     const Option<size_t>& length,
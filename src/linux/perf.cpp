@@ -18,7 +18,10 @@
 #include <stdlib.h>
 #include <unistd.h>
 
+#include <linux/perf_event.h>
+
 #include <sys/prctl.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 
@@ -36,9 +39,14 @@
 #include <process/process.hpp>
 #include <process/subprocess.hpp>
 
+#include <stout/numify.hpp>
 #include <stout/os.hpp>
 #include <stout/strings.hpp>
 
+#include <stout/os/close.hpp>
+#include <stout/os/fcntl.hpp>
+#include <stout/os/open.hpp>
+#include <stout/os/read.hpp>
 #include <stout/os/signals.hpp>
 
 #include "common/status_utils.hpp"
@@ -51,6 +59,7 @@ using process::await;
 
 using std::list;
 using std::ostringstream;
+using std::pair;
 using std::set;
 using std::string;
 using std::tuple;
@@ -189,6 +198,124 @@ private:
   Option<Subprocess> perf;
 };
 
+
+// Returns the `perf_event_attr` type and config of the (normalized)
+// events that `Counters` can count, i.e., the generalized events
+// listed by `perf list` which have a field in PerfStatistics.
+static const hashmap<string, pair<uint32_t, uint64_t>>& events()
+{
+  static const hashmap<string, pair<uint32_t, uint64_t>>* events = [] {
+    hashmap<string, pair<uint32_t, uint64_t>>* events =
+      new hashmap<string, pair<uint32_t, uint64_t>>({
+        {"cycles", {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES}},
+        {"instructions", {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS}},
+        {"cache_references",
+         {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES}},
+        {"cache_misses", {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES}},
+        {"branches",
+         {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS}},
+        {"branch_misses", {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES}},
+        {"bus_cycles", {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BUS_CYCLES}},
+        {"stalled_cycles_frontend",
+         {PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_FRONTEND}},
+        {"stalled_cycles_backend",
+         {PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND}},
+        {"ref_cycles", {PERF_TYPE_HARDWARE, PERF_COUNT_HW_REF_CPU_CYCLES}},
+        {"cpu_clock", {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_CLOCK}},
+        {"task_clock", {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK}},
+        {"page_faults", {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS}},
+        {"minor_faults",
+         {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS_MIN}},
+        {"major_faults",
+         {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS_MAJ}},
+        {"context_switches",
+         {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES}},
+        {"cpu_migrations",
+         {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS}},
+        {"alignment_faults",
+         {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_ALIGNMENT_FAULTS}},
+        {"emulation_faults",
+         {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_EMULATION_FAULTS}},
+      });
+
+    // Hardware cache events are named '<cache>-<operation>[-misses]',
+    // see the 'perf_event_open' man page for their encoding.
+    const vector<pair<string, uint64_t>> caches = {
+      {"l1_dcache", PERF_COUNT_HW_CACHE_L1D},
+      {"l1_icache", PERF_COUNT_HW_CACHE_L1I},
+      {"llc", PERF_COUNT_HW_CACHE_LL},
+      {"dtlb", PERF_COUNT_HW_CACHE_DTLB},
+      {"itlb", PERF_COUNT_HW_CACHE_ITLB},
+      {"branch", PERF_COUNT_HW_CACHE_BPU},
+      {"node", PERF_COUNT_HW_CACHE_NODE},
+    };
+
+    const vector<pair<string, uint64_t>> operations = {
+      {"load", PERF_COUNT_HW_CACHE_OP_READ},
+      {"store", PERF_COUNT_HW_CACHE_OP_WRITE},
+      {"prefetch", PERF_COUNT_HW_CACHE_OP_PREFETCH},
+    };
+
+    const google::protobuf::Descriptor* descriptor =
+      mesos::PerfStatistics::descriptor();
+
+    foreach (const auto& cache, caches) {
+      foreach (const auto& operation, operations) {
+        const uint64_t config = cache.second | (operation.second << 8);
+
+        const string accesses = cache.first + "_" + operation.first + "s";
+        const string misses = cache.first + "_" + operation.first + "_misses";
+
+        if (descriptor->FindFieldByName(accesses) != nullptr) {
+          (*events)[accesses] = {
+            PERF_TYPE_HW_CACHE,
+            config | (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16)};
+        }
+
+        if (descriptor->FindFieldByName(misses) != nullptr) {
+          (*events)[misses] = {
+            PERF_TYPE_HW_CACHE,
+            config | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)};
+        }
+      }
+    }
+
+    return events;
+  }();
+
+  return *events;
+}
+
+
+// Returns the online CPUs, e.g., "0-3,6" in
+// /sys/devices/system/cpu/online.
+static Try<vector<int>> cpus()
+{
+  Try<string> read = os::read("/sys/devices/system/cpu/online");
+  if (read.isError()) {
+    return Error(read.error());
+  }
+
+  vector<int> cpus;
+
+  foreach (const string& range, strings::tokenize(read.get(), ",\n")) {
+    vector<string> bounds = strings::split(range, "-");
+
+    Try<int> first = numify<int>(bounds.front());
+    Try<int> last = numify<int>(bounds.back());
+
+    if (bounds.size() > 2 || first.isError() || last.isError()) {
+      return Error("Unexpected CPU range '" + range + "'");
+    }
+
+    for (int cpu = first.get(); cpu <= last.get(); cpu++) {
+      cpus.push_back(cpu);
+    }
+  }
+
+  return cpus;
+}
+
 } // namespace internal {
 
 
@@ -346,6 +473,189 @@ bool valid(const set<string>& events)
 }
 
 
+bool Counters::supported(const set<string>& events)
+{
+  // Counting a cgroup requires the same kernel support as `perf stat`
+  // does, see `supported(const Version&)`.
+  Try<Version> release = os::release();
+  if (release.isError()) {
+    LOG(ERROR) << "Failed to get the kernel release: " << release.error();
+    return false;
+  }
+
+  if (!perf::supported(release.get())) {
+    return false;
+  }
+
+  foreach (const string& event, events) {
+    if (!internal::events().contains(internal::normalize(event))) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+Try<size_t> Counters::descriptors(const set<string>& events)
+{
+  Try<vector<int>> cpus = internal::cpus();
+  if (cpus.isError()) {
+    return Error("Failed to get the online CPUs: " + cpus.error());
+  }
+
+  return events.size() * cpus->size();
+}
+
+
+Try<Owned<Counters>> Counters::create(
+    const set<string>& events,
+    const string& cgroup)
+{
+  Try<vector<int>> cpus = internal::cpus();
+  if (cpus.isError()) {
+    return Error("Failed to get the online CPUs: " + cpus.error());
+  }
+
+  Try<int> fd = os::open(cgroup, O_RDONLY | O_CLOEXEC);
+  if (fd.isError()) {
+    return Error("Failed to open '" + cgroup + "': " + fd.error());
+  }
+
+  Owned<Counters> counters(new Counters());
+
+  foreach (const string& event, events) {
+    const string field = internal::normalize(event);
+
+    if (!internal::events().contains(field)) {
+      os::close(fd.get());
+      return Error("Unsupported event '" + event + "'");
+    }
+
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+
+    attr.size = sizeof(attr);
+    attr.type = internal::events().at(field).first;
+    attr.config = internal::events().at(field).second;
+    attr.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    counters->counters.push_back({field, {}, {}});
+
+    Counter& counter = counters->counters.back();
+
+    // A cgroup counter counts the tasks of the cgroup on one CPU,
+    // hence we need one per CPU (as `perf stat --all-cpus` does).
+    foreach (int cpu, cpus.get()) {
+      int counterFd = ::syscall(
+          __NR_perf_event_open,
+          &attr,
+          fd.get(),
+          cpu,
+          -1,
+          PERF_FLAG_PID_CGROUP);
+
+      if (counterFd < 0) {
+        ErrnoError error(
+            "Failed to open counter for event '" + event + "' on CPU " +
+            stringify(cpu));
+
+        os::close(fd.get());
+        return error;
+      }
+
+      counter.fds.push_back(counterFd);
+      counter.previous.push_back({0, 0, 0});
+
+      Try<Nothing> cloexec = os::cloexec(counterFd);
+      if (cloexec.isError()) {
+        os::close(fd.get());
+        return Error("Failed to set FD_CLOEXEC: " + cloexec.error());
+      }
+    }
+  }
+
+  os::close(fd.get());
+
+  counters->previous = Clock::now();
+
+  return counters;
+}
+
+
+Counters::~Counters()
+{
+  foreach (const Counter& counter, counters) {
+    foreach (int fd, counter.fds) {
+      os::close(fd);
+    }
+  }
+}
+
+
+Try<mesos::PerfStatistics> Counters::sample()
+{
+  const Time now = Clock::now();
+
+  mesos::PerfStatistics statistics;
+  statistics.set_timestamp(previous.secs());
+  statistics.set_duration((now - previous).secs());
+
+  const google::protobuf::Reflection* reflection =
+    statistics.GetReflection();
+
+  foreach (Counter& counter, counters) {
+    double count = 0;
+
+    for (size_t i = 0; i < counter.fds.size(); i++) {
+      Reading reading;
+
+      ssize_t length = ::read(counter.fds[i], &reading, sizeof(reading));
+      if (length != sizeof(reading)) {
+        return ErrnoError("Failed to read counter for '" + counter.field + "'");
+      }
+
+      const Reading& previous = counter.previous[i];
+
+      // Scale the count to account for the time the counter was not
+      // running due to multiplexing (if it did not run at all, the
+      // event was "not counted" and counts as zero).
+      if (reading.running > previous.running) {
+        count += static_cast<double>(reading.value - previous.value) *
+          (reading.enabled - previous.enabled) /
+          (reading.running - previous.running);
+      }
+
+      counter.previous[i] = reading;
+    }
+
+    const google::protobuf::FieldDescriptor* field =
+      statistics.GetDescriptor()->FindFieldByName(counter.field);
+
+    CHECK_NOTNULL(field);
+
+    switch (field->type()) {
+      case google::protobuf::FieldDescriptor::TYPE_DOUBLE:
+        // The clock events count nanoseconds, which `perf stat`
+        // reports in milliseconds.
+        reflection->SetDouble(&statistics, field, count / 1000000);
+        break;
+      case google::protobuf::FieldDescriptor::TYPE_UINT64:
+        reflection->SetUInt64(
+            &statistics, field, static_cast<uint64_t>(count + 0.5));
+        break;
+      default:
+        return Error("Unsupported field type for '" + counter.field + "'");
+    }
+  }
+
+  previous = now;
+
+  return statistics;
+}
+
+
 struct Sample
 {
   const string value;
@@ -17,15 +17,20 @@
 #ifndef __PERF_HPP__
 #define __PERF_HPP__
 
+#include <stdint.h>
 #include <unistd.h>
 
 #include <set>
 #include <string>
+#include <vector>
 
 #include <process/future.hpp>
+#include <process/owned.hpp>
+#include <process/time.hpp>
 
 #include <stout/duration.hpp>
 #include <stout/hashmap.hpp>
+#include <stout/try.hpp>
 #include <stout/version.hpp>
 
 // For PerfStatistics protobuf.
@@ -47,6 +52,70 @@ process::Future<hashmap<std::string, mesos::PerfStatistics>> sample(
 bool valid(const std::set<std::string>& events);
 
 
+// Counters for a set of events of the process(es) in a perf_event
+// cgroup, which are opened once (on each online CPU) using
+// `perf_event_open` and then read in-process, as opposed to `sample`
+// which forks `perf stat` for each sample.
+//
+// The counters are not grouped, so if there are more events than
+// hardware counters the kernel multiplexes them; the counts are
+// scaled by the fraction of time each counter was actually running,
+// as `perf stat` does.
+class Counters
+{
+public:
+  // Returns whether all the events can be counted by `Counters`,
+  // i.e., they are generalized hardware, software or hardware cache
+  // events with a field in the PerfStatistics protobuf, and the
+  // kernel supports counting cgroups (>= 2.6.39).
+  static bool supported(const std::set<std::string>& events);
+
+  // Returns the number of file descriptors taken by the counters of
+  // the events of a cgroup, i.e., one per event and online CPU.
+  static Try<size_t> descriptors(const std::set<std::string>& events);
+
+  // Opens counters for the events of the cgroup at 'cgroup', which
+  // is the absolute path of the cgroup, e.g.,
+  // /sys/fs/cgroup/perf_event/mesos/test.
+  static Try<process::Owned<Counters>> create(
+      const std::set<std::string>& events,
+      const std::string& cgroup);
+
+  ~Counters();
+
+  // Returns the counts of the events since the previous call to
+  // `sample` (or since the counters were opened).
+  Try<mesos::PerfStatistics> sample();
+
+private:
+  // The value of a counter along with the time the counter was
+  // enabled and running (i.e., not multiplexed out), in nanoseconds.
+  struct Reading
+  {
+    uint64_t value;
+    uint64_t enabled;
+    uint64_t running;
+  };
+
+  struct Counter
+  {
+    // The name of the PerfStatistics field of the event.
+    std::string field;
+
+    // The counter on each CPU, and its reading as of the previous
+    // sample.
+    std::vector<int> fds;
+    std::vector<Reading> previous;
+  };
+
+  Counters() = default;
+
+  std::vector<Counter> counters;
+
+  process::Time previous;
+};
+
+
 // Returns whether perf is supported on this host. Returns false if
 // the kernel is too old (requires >= 2.6.39).
 bool supported();
@@ -16,13 +16,16 @@
 
 #include <stdint.h>
 
+#include <algorithm>
 #include <list>
+#include <set>
 
 #include <process/collect.hpp>
 #include <process/id.hpp>
 #include <process/process.hpp>
 #include <process/timer.hpp>
 
+#include <stout/foreach.hpp>
 #include <stout/lambda.hpp>
 #include <stout/stringify.hpp>
 
@@ -34,11 +37,142 @@
 using namespace process;
 
 using std::list;
+using std::set;
 
 namespace mesos {
 namespace internal {
 namespace log {
 
+// The number of positions fetched (from other replicas) at once by
+// the bulk catch-up process.
+static const uint64_t FETCH_BATCH_SIZE = 1024;
+
+
+// Fetches the learned actions in a range of positions from the other
+// replicas (see 'FetchRequest'). The response of the first replica
+// that returns learned actions is used, replicas that are not VOTING
+// or don't have any learned action in the range are ignored. If none
+// of the replicas has learned actions in the range, the result is an
+// empty response.
+class FetchProcess : public Process<FetchProcess>
+{
+public:
+  FetchProcess(
+      const Shared<Network>& _network,
+      const FetchRequest& _request,
+      const UPID& _replica)
+    : ProcessBase(ID::generate("log-fetch")),
+      network(_network),
+      request(_request),
+      replica(_replica) {}
+
+  virtual ~FetchProcess() {}
+
+  Future<FetchResponse> future() { return promise.future(); }
+
+protected:
+  virtual void initialize()
+  {
+    // Stop when no one cares.
+    promise.future().onDiscard(lambda::bind(
+        static_cast<void(*)(const UPID&, bool)>(terminate), self(), true));
+
+    // There is no point in fetching from the replica catching up.
+    set<UPID> filter;
+    filter.insert(replica);
+
+    network->broadcast(protocol::fetch, request, filter)
+      .onAny(defer(self(), &Self::broadcasted, lambda::_1));
+  }
+
+  virtual void finalize()
+  {
+    // We no longer care about the responses from the other replicas
+    // once we have got one with learned actions.
+    discard(responses);
+
+    promise.discard();
+  }
+
+private:
+  void broadcasted(const Future<set<Future<FetchResponse>>>& future)
+  {
+    if (!future.isReady()) {
+      promise.fail(
+          future.isFailed() ?
+          "Failed to broadcast the fetch request: " + future.failure() :
+          "Not expecting discarded future");
+      terminate(self());
+      return;
+    }
+
+    responses = future.get();
+
+    if (responses.empty()) {
+      empty();
+      return;
+    }
+
+    foreach (const Future<FetchResponse>& response, responses) {
+      response.onAny(defer(self(), &Self::received, lambda::_1));
+    }
+  }
+
+  void received(const Future<FetchResponse>& response)
+  {
+    if (response.isReady() &&
+        response.get().type() == FetchResponse::ACCEPT &&
+        response.get().actions_size() > 0) {
+      promise.set(response.get());
+
+      // The remaining responses will be discarded in 'finalize'.
+      terminate(self());
+      return;
+    }
+
+    if (++responsesReceived == responses.size()) {
+      empty();
+    }
+  }
+
+  void empty()
+  {
+    FetchResponse response;
+    response.set_type(FetchResponse::ACCEPT);
+
+    promise.set(response);
+    terminate(self());
+  }
+
+  const Shared<Network> network;
+  const FetchRequest request;
+  const UPID replica;
+
+  set<Future<FetchResponse>> responses;
+  size_t responsesReceived = 0;
+
+  process::Promise<FetchResponse> promise;
+};
+
+
+static Future<FetchResponse> fetch(
+    const Shared<Replica>& replica,
+    const Shared<Network>& network,
+    uint64_t from,
+    uint64_t to)
+{
+  FetchRequest request;
+  request.set_from(from);
+  request.set_to(to);
+
+  FetchProcess* process = new FetchProcess(network, request, replica->pid());
+
+  Future<FetchResponse> future = process->future();
+  spawn(process, true);
+  return future;
+}
+
+
 class CatchUpProcess : public Process<CatchUpProcess>
 {
 public:
@@ -165,6 +299,12 @@ static Future<uint64_t> catchup(
 }
 
 
+// The bulk catch-up process first fetches the learned actions in a
+// batch of positions from the other replicas, and persists them with
+// a single write. The positions in the batch that are still missing
+// (e.g., not learned yet by any replica) are then caught-up one by
+// one, which is a no-op for the fetched positions.
+//
 // TODO(jieyu): Our current implementation catches-up each position in
 // the set sequentially. In the future, we may want to parallelize it
 // to improve the performance. Also, we may want to implement rate
@@ -200,12 +340,14 @@ protected:
 
     // Catch-up sequentially.
     current = positions.lower();
+    fetched = current;
 
     catchup();
   }
 
   virtual void finalize()
   {
+    fetching.discard();
     catching.discard();
 
     // TODO(benh): Discard our promise only after 'catching' has
@@ -214,9 +356,90 @@ protected:
   }
 
 private:
-  static void timedout(Future<uint64_t> catching)
+  template <typename T>
+  static void timedout(Future<T> future)
   {
-    catching.discard();
+    future.discard();
+  }
+
+  void fetch()
+  {
+    const uint64_t to =
+      std::min(current + FETCH_BATCH_SIZE, positions.upper()) - 1;
+
+    fetching = replica->missing(current, to)
+      .then(defer(self(), &Self::_fetch, current, to, lambda::_1))
+      .onAny(defer(self(), &Self::__fetch, to));
+
+    Clock::timer(timeout, lambda::bind(&Self::timedout<uint64_t>, fetching));
+  }
+
+  Future<uint64_t> _fetch(
+      uint64_t from,
+      uint64_t to,
+      const IntervalSet<uint64_t>& missing)
+  {
+    if (missing.empty()) {
+      return to;
+    }
+
+    return log::fetch(replica, network, from, to)
+      .then(defer(self(), &Self::learn, missing, lambda::_1));
+  }
+
+  Future<uint64_t> learn(
+      const IntervalSet<uint64_t>& missing,
+      const FetchResponse& response)
+  {
+    if (response.actions_size() == 0) {
+      return Failure("No learned actions");
+    }
+
+    LearnedMessage message;
+
+    foreach (const Action& action, response.actions()) {
+      if (missing.contains(action.position()) &&
+          action.has_learned() && action.learned()) {
+        if (!message.has_action()) {
+          message.mutable_action()->CopyFrom(action);
+        } else {
+          message.add_actions()->CopyFrom(action);
+        }
+      }
+    }
+
+    if (message.has_action()) {
+      // The fetched actions are learned by the local replica like the
+      // actions learned by the fill in 'CatchUpProcess' (i.e., through
+      // a learned message), but in a single batch. The positions that
+      // the replica fails to persist are caught-up one by one later.
+      process::post(replica->pid(), message);
+    }
+
+    // The response covers the positions up to its last action.
+    return response.actions(response.actions_size() - 1).position();
+  }
+
+  void __fetch(uint64_t to)
+  {
+    if (fetching.isReady()) {
+      fetched = std::max(current, fetching.get()) + 1;
+    } else {
+      // Fall back to catching-up the positions in the batch one by
+      // one. If the fetch timed out (e.g., none of the other replicas
+      // supports fetch requests) we don't try to fetch again.
+      if (fetching.isDiscarded()) {
+        LOG(INFO) << "Unable to fetch positions " << current
+                  << " -> " << to << " in " << timeout
+                  << ", catching them up one by one";
+
+        fetchable = false;
+      }
+
+      fetched = to + 1;
+    }
+
+    catchup();
   }
 
   void catchup()
@@ -229,6 +452,11 @@ private:
       return;
     }
 
+    if (fetchable && current >= fetched) {
+      fetch();
+      return;
+    }
+
     // Store the future so that we can discard it if the user wants to
     // cancel the catch-up operation.
     catching = log::catchup(quorum, replica, network, proposal, current)
@@ -236,7 +464,7 @@ private:
       .onFailed(defer(self(), &Self::failed))
       .onReady(defer(self(), &Self::succeeded));
 
-    Clock::timer(timeout, lambda::bind(&Self::timedout, catching));
+    Clock::timer(timeout, lambda::bind(&Self::timedout<uint64_t>, catching));
   }
 
 
@@ -280,7 +508,13 @@ private:
   uint64_t proposal;
   uint64_t current;
 
+  // The positions before 'fetched' have been fetched (or failed to
+  // be), the ones still missing are caught-up one by one.
+  uint64_t fetched;
+  bool fetchable = true;
+
   process::Promise<Nothing> promise;
+  Future<uint64_t> fetching;
   Future<uint64_t> catching;
 };
 
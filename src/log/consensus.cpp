@@ -18,6 +18,7 @@
 #include <stdlib.h>
 
 #include <set>
+#include <vector>
 
 #include <process/defer.hpp>
 #include <process/delay.hpp>
@@ -37,6 +38,7 @@
 using namespace process;
 
 using std::set;
+using std::vector;
 
 namespace mesos {
 namespace internal {
@@ -859,6 +861,27 @@ Future<Nothing> learn(const Shared<Network>& network, const Action& action)
 }
 
 
+Future<Nothing> learn(
+    const Shared<Network>& network,
+    const vector<Action>& actions)
+{
+  CHECK(!actions.empty());
+
+  LearnedMessage message;
+
+  foreach (const Action& action, actions) {
+    Action* learned = message.has_action()
+      ? message.add_actions()
+      : message.mutable_action();
+
+    learned->CopyFrom(action);
+    learned->set_learned(true);
+  }
+
+  return network->broadcast(message);
+}
+
+
 Future<Action> fill(
     size_t quorum,
     const Shared<Network>& network,
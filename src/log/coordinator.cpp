@@ -17,15 +17,20 @@
 #include <stdint.h>
 
 #include <algorithm>
+#include <deque>
+#include <vector>
 
 #include <mesos/type_utils.hpp>
 
 #include <process/defer.hpp>
 #include <process/dispatch.hpp>
 #include <process/id.hpp>
+#include <process/owned.hpp>
 #include <process/process.hpp>
 
+#include <stout/foreach.hpp>
 #include <stout/none.hpp>
+#include <stout/stringify.hpp>
 
 #include "log/catchup.hpp"
 #include "log/consensus.hpp"
@@ -35,7 +40,9 @@
 
 using namespace process;
 
+using std::deque;
 using std::string;
+using std::vector;
 
 namespace mesos {
 namespace internal {
@@ -47,14 +54,19 @@ public:
   CoordinatorProcess(
       size_t _quorum,
       const Shared<Replica>& _replica,
-      const Shared<Network>& _network)
+      const Shared<Network>& _network,
+      size_t _window)
     : ProcessBase(ID::generate("log-coordinator")),
       quorum(_quorum),
       replica(_replica),
       network(_network),
+      window(_window),
       state(INITIAL),
       proposal(0),
-      index(0) {}
+      index(0)
+  {
+    CHECK_GT(window, 0u);
+  }
 
   virtual ~CoordinatorProcess() {}
 
@@ -68,7 +80,18 @@ protected:
   virtual void finalize()
   {
     electing.discard();
-    writing.discard();
+
+    if (learning.isSome()) {
+      learning->discard();
+    }
+
+    foreach (const Owned<Write>& write, writes) {
+      if (write->writing.isSome()) {
+        write->writing->discard();
+      }
+
+      write->promise.discard();
+    }
   }
 
 private:
@@ -93,21 +116,26 @@ private:
   /////////////////////////////////
 
   Future<Option<uint64_t>> write(const Action& action);
-  Future<WriteResponse> runWritePhase(const Action& action);
-  Future<Option<uint64_t>> checkWritePhase(
-      const Action& action,
-      const WriteResponse& response);
-  Future<Nothing> runLearnPhase(const Action& action);
-  Future<bool> checkLearnPhase(const Action& action);
-  Future<Option<uint64_t>> updateIndexAfterWritten(bool missing);
-  void writingFinished();
-  void writingFailed();
+  void runWritePhases();
+  void checkWritePhase(
+      uint64_t position,
+      const Future<WriteResponse>& response);
+  void runLearnPhase();
+  Future<IntervalSet<uint64_t>> checkLearnPhase(uint64_t from, uint64_t to);
+  void updateIndexAfterLearned(
+      uint64_t to,
+      const Future<IntervalSet<uint64_t>>& missing);
+  void writingDemoted();
+  void writingFailed(const string& message);
   void writingAborted();
 
   const size_t quorum;
   const Shared<Replica> replica;
   const Shared<Network> network;
 
+  // The maximum number of writes that are run concurrently.
+  const size_t window;
+
   // The current state of the coordinator. A coordinator needs to be
   // elected first to perform append and truncate operations. If one
   // tries to do an append or a truncate while the coordinator is not
@@ -131,7 +159,29 @@ private:
   uint64_t index;
 
   Future<Option<uint64_t>> electing;
-  Future<Option<uint64_t>> writing;
+
+  // A write (i.e., an append or a truncate) that has not completed.
+  struct Write
+  {
+    explicit Write(const Action& _action) : action(_action) {}
+
+    const Action action;
+    process::Promise<Option<uint64_t>> promise;
+
+    // The write phase, once the write is within the window.
+    Option<Future<WriteResponse>> writing;
+  };
+
+  // The writes that have not completed, in the order of their
+  // positions. The writes complete in this order, i.e., a write
+  // completes once it and all the writes before it are learned.
+  deque<Owned<Write>> writes;
+
+  // The learn phase of the writes at the front of 'writes' that have
+  // been accepted by a quorum, if any. Only one learn phase is run at
+  // a time, the writes accepted in the meantime are learned at once
+  // in the next learn phase.
+  Option<Future<IntervalSet<uint64_t>>> learning;
 };
 
 
@@ -307,7 +357,7 @@ Future<Option<uint64_t>> CoordinatorProcess::append(const string& bytes)
 {
   if (state == INITIAL || state == ELECTING) {
     return None();
-  } else if (state == WRITING) {
+  } else if (state == WRITING && window == 1) {
     return Failure("Coordinator is currently writing");
   }
 
@@ -327,7 +377,7 @@ Future<Option<uint64_t>> CoordinatorProcess::truncate(uint64_t to)
 {
   if (state == INITIAL || state == ELECTING) {
     return None();
-  } else if (state == WRITING) {
+  } else if (state == WRITING && window == 1) {
     return Failure("Coordinator is currently writing");
   }
 
@@ -348,93 +398,257 @@ Future<Option<uint64_t>> CoordinatorProcess::write(const Action& action)
   LOG(INFO) << "Coordinator attempting to write " << action.type()
             << " action at position " << action.position();
 
-  CHECK_EQ(state, ELECTED);
+  CHECK(state == ELECTED || state == WRITING);
   CHECK(action.has_performed() && action.has_type());
+  CHECK_EQ(action.position(), index);
 
   state = WRITING;
 
-  writing = runWritePhase(action)
-    .then(defer(self(), &Self::checkWritePhase, action, lambda::_1))
-    .onReady(defer(self(), &Self::writingFinished))
-    .onFailed(defer(self(), &Self::writingFailed))
-    .onDiscarded(defer(self(), &Self::writingAborted));
+  // The next write goes to the next position, whether or not this
+  // write has completed yet.
+  index++;
 
-  return writing;
+  Owned<Write> write(new Write(action));
+  writes.push_back(write);
+
+  // Demote the coordinator if a write operation is discarded since we
+  // don't actually know the write was successful or not and we really
+  // need to "catch-up" that position before we try and do another
+  // write (see MESOS-1038 for more details).
+  write->promise.future()
+    .onDiscard(defer(self(), &Self::writingAborted));
+
+  runWritePhases();
+
+  return write->promise.future();
 }
 
 
-Future<WriteResponse> CoordinatorProcess::runWritePhase(const Action& action)
+void CoordinatorProcess::runWritePhases()
 {
-  return log::write(quorum, network, proposal, action);
+  size_t running = 0;
+
+  foreach (const Owned<Write>& write, writes) {
+    if (running++ == window) {
+      break;
+    }
+
+    if (write->writing.isNone()) {
+      write->writing =
+        log::write(quorum, network, proposal, write->action);
+
+      write->writing->onAny(defer(
+          self(),
+          &Self::checkWritePhase,
+          write->action.position(),
+          lambda::_1));
+    }
+  }
 }
 
 
-Future<Option<uint64_t>> CoordinatorProcess::checkWritePhase(
-    const Action& action,
-    const WriteResponse& response)
+void CoordinatorProcess::checkWritePhase(
+    uint64_t position,
+    const Future<WriteResponse>& response)
 {
-  if (!response.okay()) {
-    // Received a NACK. Save the proposal number.
-    CHECK_LE(proposal, response.proposal());
-    proposal = response.proposal();
+  // Ignore the response if the write is no longer pending, i.e., the
+  // writes have been aborted (or failed) in the meantime.
+  if (writes.empty() ||
+      position < writes.front()->action.position() ||
+      position - writes.front()->action.position() >= writes.size()) {
+    return;
+  }
 
-    return None();
+  const Owned<Write>& write =
+    writes.at(position - writes.front()->action.position());
+
+  if (write->writing.isNone() || write->writing.get() != response) {
+    return;
   }
 
-  return runLearnPhase(action)
-    .then(defer(self(), &Self::checkLearnPhase, action))
-    .then(defer(self(), &Self::updateIndexAfterWritten, lambda::_1));
+  if (response.isDiscarded()) {
+    // Only discarded when aborted, see above.
+    return;
+  } else if (response.isFailed()) {
+    writingFailed(response.failure());
+    return;
+  }
+
+  if (!response->okay()) {
+    // Received a NACK. Save the proposal number.
+    CHECK_LE(proposal, response->proposal());
+    proposal = response->proposal();
+  }
+
+  runLearnPhase();
 }
 
 
-Future<Nothing> CoordinatorProcess::runLearnPhase(const Action& action)
+void CoordinatorProcess::runLearnPhase()
 {
-  return log::learn(network, action);
+  if (learning.isSome()) {
+    return;
+  }
+
+  // Learn the writes at the front that have been accepted by a quorum.
+  vector<Action> actions;
+
+  foreach (const Owned<Write>& write, writes) {
+    if (write->writing.isNone() ||
+        !write->writing->isReady() ||
+        !write->writing->get().okay()) {
+      break;
+    }
+
+    actions.push_back(write->action);
+  }
+
+  if (actions.empty()) {
+    if (!writes.empty() &&
+        writes.front()->writing.isSome() &&
+        writes.front()->writing->isReady()) {
+      // The first write was rejected.
+      writingDemoted();
+    }
+
+    return;
+  }
+
+  const uint64_t from = actions.front().position();
+  const uint64_t to = actions.back().position();
+
+  learning = log::learn(network, actions)
+    .then(defer(self(), &Self::checkLearnPhase, from, to));
+
+  learning->onAny(
+      defer(self(), &Self::updateIndexAfterLearned, to, lambda::_1));
 }
 
 
-Future<bool> CoordinatorProcess::checkLearnPhase(const Action& action)
+Future<IntervalSet<uint64_t>> CoordinatorProcess::checkLearnPhase(
+    uint64_t from,
+    uint64_t to)
 {
   // Make sure that the local replica has learned the newly written
-  // log entry. Since messages are delivered and dispatched in order
-  // locally, we should always have the new entry learned by now.
-  return replica->missing(action.position());
+  // log entries. Since messages are delivered and dispatched in order
+  // locally, we should always have the new entries learned by now.
+  return replica->missing(from, to);
 }
 
 
-Future<Option<uint64_t>> CoordinatorProcess::updateIndexAfterWritten(
-    bool missing)
+void CoordinatorProcess::updateIndexAfterLearned(
+    uint64_t to,
+    const Future<IntervalSet<uint64_t>>& missing)
 {
-  CHECK(!missing) << "Not expecting local replica to be missing position "
-                  << index << " after the writing is done";
+  // Ignore the learn phase if the writes have been aborted (or
+  // failed) in the meantime.
+  if (learning.isNone() || learning.get() != missing) {
+    return;
+  }
+
+  learning = None();
+
+  if (missing.isDiscarded()) {
+    return;
+  } else if (missing.isFailed()) {
+    writingFailed(missing.failure());
+    return;
+  }
 
-  return index++;
+  CHECK(missing->empty())
+    << "Not expecting local replica to be missing positions "
+    << stringify(missing.get()) << " after the writing is done";
+
+  deque<Owned<Write>> learned;
+  while (!writes.empty() && writes.front()->action.position() <= to) {
+    learned.push_back(writes.front());
+    writes.pop_front();
+  }
+
+  if (writes.empty()) {
+    state = ELECTED;
+  } else {
+    runWritePhases();
+    runLearnPhase();
+  }
+
+  foreach (const Owned<Write>& write, learned) {
+    write->promise.set(Option<uint64_t>(write->action.position()));
+  }
 }
 
 
-void CoordinatorProcess::writingFinished()
+void CoordinatorProcess::writingDemoted()
 {
   CHECK_EQ(state, WRITING);
-  state = ELECTED;
+
+  // Another coordinator has been elected, so none of the pending
+  // writes can be learned by this coordinator (they might still be
+  // learned, i.e., filled, by the other coordinator).
+  state = INITIAL;
+
+  foreach (const Owned<Write>& write, writes) {
+    if (write->writing.isSome()) {
+      write->writing->discard();
+    }
+
+    write->promise.set(Option<uint64_t>::none());
+  }
+
+  writes.clear();
 }
 
 
-void CoordinatorProcess::writingFailed()
+void CoordinatorProcess::writingFailed(const string& message)
 {
   CHECK_EQ(state, WRITING);
   state = INITIAL;
+
+  if (learning.isSome()) {
+    learning->discard();
+    learning = None();
+  }
+
+  foreach (const Owned<Write>& write, writes) {
+    if (write->writing.isSome()) {
+      write->writing->discard();
+    }
+
+    write->promise.fail(message);
+  }
+
+  writes.clear();
 }
 
 
 void CoordinatorProcess::writingAborted()
 {
-  CHECK_EQ(state, WRITING);
+  // The writes might have completed (or been aborted) already.
+  if (state != WRITING) {
+    return;
+  }
 
   // Demote the coordinator if a write operation is discarded since we
   // don't actually know the write was successful or not and we really
   // need to "catch-up" that position before we try and do another
-  // write (see MESOS-1038 for more details).
+  // write (see MESOS-1038 for more details). The other pending writes
+  // are discarded as well since they can't complete before it.
   state = INITIAL;
+
+  if (learning.isSome()) {
+    learning->discard();
+    learning = None();
+  }
+
+  foreach (const Owned<Write>& write, writes) {
+    if (write->writing.isSome()) {
+      write->writing->discard();
+    }
+
+    write->promise.discard();
+  }
+
+  writes.clear();
 }
 
 
@@ -446,9 +660,10 @@ void CoordinatorProcess::writingAborted()
 Coordinator::Coordinator(
     size_t quorum,
     const Shared<Replica>& replica,
-    const Shared<Network>& network)
+    const Shared<Network>& network,
+    size_t window)
 {
-  process = new CoordinatorProcess(quorum, replica, network);
+  process = new CoordinatorProcess(quorum, replica, network, window);
   spawn(process);
 }
 
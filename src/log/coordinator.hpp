@@ -40,10 +40,16 @@ class CoordinatorProcess;
 class Coordinator
 {
 public:
+  // Up to 'window' writes (i.e., appends and truncates) are run
+  // concurrently, further writes are queued until earlier writes
+  // complete. Writes complete in the order in which they were made.
+  // With a window of 1 a write made while another write is in
+  // progress fails instead, as writes are not pipelined.
   Coordinator(
       size_t quorum,
       const process::Shared<Replica>& replica,
-      const process::Shared<Network>& network);
+      const process::Shared<Network>& network,
+      size_t window = 1);
 
   ~Coordinator();
 
@@ -60,13 +66,15 @@ public:
 
   // Appends the specified bytes to the end of the log. Returns the
   // position of the appended entry if the operation succeeds or none
-  // if the coordinator was demoted.
+  // if the coordinator was demoted. If an earlier write fails (or is
+  // discarded, or the coordinator was demoted) so does this one.
   process::Future<Option<uint64_t>> append(const std::string& bytes);
 
   // Removes all log entries preceding the log entry at the given
   // position (to). Returns the position at which the truncate
   // operation is written if the operation succeeds or none if the
-  // coordinator was demoted.
+  // coordinator was demoted. If an earlier write fails (or is
+  // discarded, or the coordinator was demoted) so does this one.
   process::Future<Option<uint64_t>> truncate(uint64_t to);
 
 private:
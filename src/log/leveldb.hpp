@@ -21,6 +21,8 @@
 
 #include <stdint.h>
 
+#include <list>
+
 #include <stout/option.hpp>
 
 #include "log/storage.hpp"
@@ -40,8 +42,13 @@ public:
   virtual Try<Nothing> persist(const Metadata& metadata);
   virtual Try<Nothing> persist(const Action& action);
   virtual Try<Action> read(uint64_t position);
+  virtual Try<Nothing> persist(const std::list<Action>& actions);
+  virtual Try<std::list<Action>> read(uint64_t from, uint64_t to);
 
 private:
+  // Deletes the positions before 'to' (best-effort).
+  void truncate(uint64_t to);
+
   leveldb::DB* db;
 
   // First position still in leveldb, used during truncation.
@@ -23,6 +23,7 @@
 #include <process/dispatch.hpp>
 #include <process/id.hpp>
 
+#include <stout/bytes.hpp>
 #include <stout/check.hpp>
 #include <stout/error.hpp>
 #include <stout/exit.hpp>
@@ -54,10 +55,16 @@ namespace protocol {
 Protocol<PromiseRequest, PromiseResponse> promise;
 Protocol<WriteRequest, WriteResponse> write;
 Protocol<RecoverRequest, RecoverResponse> recover;
+Protocol<FetchRequest, FetchResponse> fetch;
 
 } // namespace protocol {
 
 
+// The size of the actions in a fetch response above which no more
+// actions are added to it.
+static const Bytes MAX_FETCH_RESPONSE_SIZE = Megabytes(4);
+
+
 class ReplicaProcess : public ProtobufProcess<ReplicaProcess>
 {
 public:
@@ -114,13 +121,25 @@ private:
   // Handles a request from a recover process.
   void recover(const UPID& from, const RecoverRequest& request);
 
-  // Handles a message notifying of a learned action.
-  void learned(const UPID& from, const Action& action);
+  // Handles a message notifying of learned actions.
+  void learned(const UPID& from, const LearnedMessage& message);
+
+  // Handles a request for the learned actions in a range of positions
+  // (e.g., from a replica catching up).
+  void fetch(const UPID& from, const FetchRequest& request);
 
   // Persists the specified action to storage. Returns true on success
   // and false otherwise.
   bool persist(const Action& action);
 
+  // Persists the specified actions to storage in a single batch.
+  // Returns true on success and false otherwise.
+  bool persist(const list<Action>& actions);
+
+  // Updates the positions of the log (e.g., holes, unlearned) after
+  // the specified action has been persisted.
+  void _persist(const Action& action);
+
   // Updates the highest promise this replica has given. The update
   // will be persisted to storage. Returns true on success and false
   // otherwise.
@@ -171,8 +190,10 @@ ReplicaProcess::ReplicaProcess(const string& path)
       &ReplicaProcess::recover);
 
   install<LearnedMessage>(
-      &ReplicaProcess::learned,
-      &LearnedMessage::action);
+      &ReplicaProcess::learned);
+
+  install<FetchRequest>(
+      &ReplicaProcess::fetch);
 }
 
 
@@ -224,21 +245,17 @@ Future<list<Action>> ReplicaProcess::read(uint64_t from, uint64_t to)
   VLOG(2) << "Starting read from '" << stringify(from) << "' to '"
           << stringify(to) << "'";
 
-  list<Action> actions;
+  // Holes are not in storage, hence they are skipped by the range
+  // read (like they are by 'read(position)' above).
+  Try<list<Action>> actions = storage->read(from, to);
 
-  for (uint64_t position = from; position <= to; position++) {
-    Result<Action> result = read(position);
-
-    if (result.isError()) {
-      process::Promise<list<Action>> promise;
-      promise.fail(result.error());
-      return promise.future();
-    } else if (result.isSome()) {
-      actions.push_back(result.get());
-    }
+  if (actions.isError()) {
+    process::Promise<list<Action>> promise;
+    promise.fail(actions.error());
+    return promise.future();
   }
 
-  return actions;
+  return actions.get();
 }
 
 
@@ -688,25 +705,124 @@ void ReplicaProcess::recover(const UPID& from, const RecoverRequest& request)
 }
 
 
-void ReplicaProcess::learned(const UPID& from, const Action& action)
+void ReplicaProcess::learned(const UPID& from, const LearnedMessage& message)
 {
   LOG(INFO) << "Replica received learned notice for position "
-            << action.position() << " from " << from;
+            << message.action().position()
+            << (message.actions_size() > 0
+                ? " (and " + stringify(message.actions_size()) + " more)"
+                : "")
+            << " from " << from;
+
+  CHECK(message.action().learned());
+
+  list<Action> actions = {message.action()};
+
+  foreach (const Action& action, message.actions()) {
+    CHECK(action.learned());
+    actions.push_back(action);
+  }
+
+  persist(actions);
+}
+
+
+void ReplicaProcess::fetch(const UPID& from, const FetchRequest& request)
+{
+  FetchResponse response;
+
+  // Ignore fetch requests if this replica is not in VOTING status; we
+  // also inform the requester, so that it doesn't wait for us.
+  if (status() != Metadata::VOTING) {
+    LOG(INFO) << "Replica ignoring fetch request from " << from
+              << " as it is in " << status() << " status";
+
+    response.set_type(FetchResponse::IGNORED);
+    reply(response);
+    return;
+  }
+
+  LOG(INFO) << "Replica received fetch request from " << from
+            << " for positions " << request.from()
+            << " -> " << request.to();
+
+  response.set_type(FetchResponse::ACCEPT);
+
+  uint64_t position = request.from();
+  Bytes size = 0;
 
-  CHECK(action.learned());
-  persist(action);
+  // Like for promise requests, truncated positions are learned
+  // no-ops (see 'ReplicaProcess::promise' above).
+  for (; position < begin && position <= request.to(); position++) {
+    if (size >= MAX_FETCH_RESPONSE_SIZE) {
+      break;
+    }
+
+    Action* action = response.add_actions();
+    action->set_position(position);
+    action->set_promised(promised()); // Use the last promised proposal.
+    action->set_performed(promised()); // Use the last promised proposal.
+    action->set_learned(true);
+    action->set_type(Action::NOP);
+    action->mutable_nop();
+
+    size += action->ByteSize();
+  }
+
+  if (size < MAX_FETCH_RESPONSE_SIZE &&
+      position <= request.to() &&
+      position <= end) {
+    // NOTE: All the requested positions are read from storage, only
+    // the response is bounded (requesters ask for small batches).
+    Try<list<Action>> actions =
+      storage->read(position, std::min(request.to(), end));
+
+    if (actions.isError()) {
+      LOG(ERROR) << "Error reading from log: " << actions.error();
+      return;
+    }
+
+    foreach (const Action& action, actions.get()) {
+      if (size >= MAX_FETCH_RESPONSE_SIZE) {
+        break;
+      }
+
+      if (action.has_learned() && action.learned()) {
+        response.add_actions()->CopyFrom(action);
+        size += action.ByteSize();
+      }
+    }
+  }
+
+  reply(response);
 }
 
 
 bool ReplicaProcess::persist(const Action& action)
 {
-  Try<Nothing> persisted = storage->persist(action);
+  return persist(list<Action>({action}));
+}
+
+
+bool ReplicaProcess::persist(const list<Action>& actions)
+{
+  Try<Nothing> persisted = storage->persist(actions);
 
   if (persisted.isError()) {
     LOG(ERROR) << "Error writing to log: " << persisted.error();
     return false;
   }
 
+  foreach (const Action& action, actions) {
+    _persist(action);
+  }
+
+  return true;
+}
+
+
+void ReplicaProcess::_persist(const Action& action)
+{
   VLOG(1) << "Persisted action " << action.type()
           << " at position " << action.position();
 
@@ -744,8 +860,6 @@ bool ReplicaProcess::persist(const Action& action)
 
   // And update the end position.
   end = std::max(end, action.position());
-
-  return true;
 }
 
 
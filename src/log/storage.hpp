@@ -19,6 +19,7 @@
 
 #include <stdint.h>
 
+#include <list>
 #include <string>
 
 #include <stout/interval.hpp>
@@ -54,6 +55,15 @@ public:
   virtual Try<Nothing> persist(const Metadata& metadata) = 0;
   virtual Try<Nothing> persist(const Action& action) = 0;
   virtual Try<Action> read(uint64_t position) = 0;
+
+  // Persists the specified actions atomically, with a single sync of
+  // the underlying storage for all of them.
+  virtual Try<Nothing> persist(const std::list<Action>& actions) = 0;
+
+  // Returns the actions stored in the range [from, to], in the order
+  // of their positions. Positions without an action (i.e., holes)
+  // are skipped.
+  virtual Try<std::list<Action>> read(uint64_t from, uint64_t to) = 0;
 };
 
 } // namespace log {
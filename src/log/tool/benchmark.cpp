@@ -17,25 +17,39 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
+#include <list>
+#include <set>
 #include <sstream>
+#include <vector>
 
 #include <mesos/log/log.hpp>
 
 #include <process/clock.hpp>
 #include <process/future.hpp>
+#include <process/owned.hpp>
+#include <process/pid.hpp>
 #include <process/process.hpp>
+#include <process/shared.hpp>
 #include <process/time.hpp>
 
 #include <stout/bytes.hpp>
 #include <stout/error.hpp>
 #include <stout/foreach.hpp>
+#include <stout/interval.hpp>
+#include <stout/numify.hpp>
 #include <stout/os.hpp>
 #include <stout/stopwatch.hpp>
+#include <stout/stringify.hpp>
 #include <stout/strings.hpp>
 #include <stout/os/read.hpp>
 
+#include "log/catchup.hpp"
+#include "log/network.hpp"
+#include "log/replica.hpp"
+
 #include "log/tool/initialize.hpp"
 #include "log/tool/benchmark.hpp"
 
@@ -46,7 +60,9 @@ using namespace process;
 using std::cout;
 using std::endl;
 using std::ifstream;
+using std::list;
 using std::ofstream;
+using std::set;
 using std::string;
 using std::vector;
 
@@ -75,6 +91,19 @@ Benchmark::Flags::Flags()
       "znode",
       "ZooKeeper znode");
 
+  add(&Flags::replicas,
+      "replicas",
+      "Number of replicas to run in this process (including the one\n"
+      "at --path, the others are at --path with a suffix), instead of\n"
+      "finding the replicas through ZooKeeper (see --servers)");
+
+  add(&Flags::windows,
+      "windows",
+      "Comma separated list of the numbers of appends to write\n"
+      "concurrently (see mesos::log::Log::Writer). The trace is\n"
+      "replayed for each of them",
+      "1");
+
   add(&Flags::input,
       "input",
       "Path to the input trace file. Each line in the trace file\n"
@@ -107,8 +136,11 @@ Try<Nothing> Benchmark::execute(int argc, char** argv)
       "This command is used to do performance test on the\n"
       "replicated log. It takes a trace file of write sizes\n"
       "and replay that trace to measure the latency of each\n"
-      "write. The data to be written for each write can be\n"
-      "specified using the --type flag.\n"
+      "write and the throughput of the writes. The data to be\n"
+      "written for each write can be specified using the --type\n"
+      "flag. It then measures reading the log back and, if the\n"
+      "replicas run in this process (see --replicas), catching\n"
+      "up an empty replica.\n"
       "\n");
 
   // Configure the tool by parsing command line arguments.
@@ -139,12 +171,16 @@ Try<Nothing> Benchmark::execute(int argc, char** argv)
     return Error(flags.usage("Missing required option --path"));
   }
 
-  if (flags.servers.isNone()) {
-    return Error(flags.usage("Missing required option --servers"));
-  }
+  if (flags.replicas.isNone()) {
+    if (flags.servers.isNone()) {
+      return Error(flags.usage("Missing required option --servers"));
+    }
 
-  if (flags.znode.isNone()) {
-    return Error(flags.usage("Missing required option --znode"));
+    if (flags.znode.isNone()) {
+      return Error(flags.usage("Missing required option --znode"));
+    }
+  } else if (flags.replicas.get() < flags.quorum.get()) {
+    return Error(flags.usage("Fewer --replicas than the --quorum"));
   }
 
   if (flags.input.isNone()) {
@@ -155,43 +191,59 @@ Try<Nothing> Benchmark::execute(int argc, char** argv)
     return Error(flags.usage("Missing required option --output"));
   }
 
+  vector<size_t> windows;
+  foreach (const string& token, strings::split(flags.windows, ",")) {
+    Try<size_t> window = numify<size_t>(strings::trim(token));
+    if (window.isError() || window.get() == 0) {
+      return Error(flags.usage("Invalid window '" + token + "'"));
+    }
+
+    windows.push_back(window.get());
+  }
+
+  // The paths of the replicas to run in this process, the first one
+  // being the replica of the log.
+  vector<string> paths = {flags.path.get()};
+  for (size_t i = 1; i < flags.replicas.getOrElse(1); i++) {
+    paths.push_back(flags.path.get() + "." + stringify(i));
+  }
+
   // Initialize the log.
   if (flags.initialize) {
-    Initialize initialize;
-    initialize.flags.path = flags.path;
-
-    Try<Nothing> execution = initialize.execute();
-    if (execution.isError()) {
-      return Error(execution.error());
+    foreach (const string& path, paths) {
+      Initialize initialize;
+      initialize.flags.path = path;
+
+      Try<Nothing> execution = initialize.execute();
+      if (execution.isError()) {
+        return Error(execution.error());
+      }
     }
   }
 
   // Create the log.
-  Log log(
-      flags.quorum.get(),
-      flags.path.get(),
-      flags.servers.get(),
-      Seconds(10),
-      flags.znode.get());
-
-  // Create the log writer.
-  Log::Writer writer(&log);
-
-  Future<Option<Log::Position>> position = writer.start();
-
-  if (!position.await(Seconds(15))) {
-    return Error("Failed to start a log writer: timed out");
-  } else if (!position.isReady()) {
-    return Error("Failed to start a log writer: " +
-                 (position.isFailed()
-                  ? position.failure()
-                  : "Discarded future"));
+  Owned<Log> log;
+  vector<Owned<Replica>> replicas;
+
+  if (flags.replicas.isSome()) {
+    set<UPID> pids;
+    for (size_t i = 1; i < paths.size(); i++) {
+      replicas.push_back(Owned<Replica>(new Replica(paths[i])));
+      pids.insert(replicas.back()->pid());
+    }
+
+    log.reset(new Log(flags.quorum.get(), flags.path.get(), pids));
+  } else {
+    log.reset(new Log(
+        flags.quorum.get(),
+        flags.path.get(),
+        flags.servers.get(),
+        Seconds(10),
+        flags.znode.get()));
   }
 
   // Statistics to output.
   vector<Bytes> sizes;
-  vector<Duration> durations;
-  vector<Time> timestamps;
 
   // Read sizes from the input trace file.
   ifstream input(flags.input.get().c_str());
@@ -223,43 +275,182 @@ Try<Nothing> Benchmark::execute(int argc, char** argv)
     }
   }
 
-  Stopwatch stopwatch;
-  stopwatch.start();
+  // Ouput statistics.
+  ofstream output(flags.output.get().c_str());
+  if (!output.is_open()) {
+    return Error("Failed to open the output file " + flags.output.get());
+  }
 
-  for (size_t i = 0; i < sizes.size(); i++) {
-    Stopwatch stopwatch;
-    stopwatch.start();
+  foreach (size_t window, windows) {
+    // Create the log writer.
+    Log::Writer writer(log.get(), window);
 
-    position = writer.append(data[i]);
+    Future<Option<Log::Position>> position = writer.start();
 
-    if (!position.await(Seconds(10))) {
-      return Error("Failed to append: timed out");
+    if (!position.await(Seconds(15))) {
+      return Error("Failed to start a log writer: timed out");
     } else if (!position.isReady()) {
-      return Error("Failed to append: " +
+      return Error("Failed to start a log writer: " +
                    (position.isFailed()
                     ? position.failure()
                     : "Discarded future"));
     } else if (position.get().isNone()) {
-      return Error("Failed to append: exclusive write promise lost");
+      return Error("Failed to start a log writer: not elected");
+    }
+
+    // The times at which each append was made and completed.
+    vector<Time> started(sizes.size());
+    vector<Time> finished(sizes.size());
+
+    vector<Future<Option<Log::Position>>> positions(sizes.size());
+
+    Stopwatch stopwatch;
+    stopwatch.start();
+
+    // Keep up to 'window' appends outstanding, the latency of each
+    // append is measured from when it was made to when it completed.
+    size_t completed = 0;
+
+    for (size_t i = 0; i <= sizes.size(); i++) {
+      while (completed < i && (i - completed == window || i == sizes.size())) {
+        position = positions[completed++];
+
+        if (!position.await(Seconds(10))) {
+          return Error("Failed to append: timed out");
+        } else if (!position.isReady()) {
+          return Error("Failed to append: " +
+                       (position.isFailed()
+                        ? position.failure()
+                        : "Discarded future"));
+        } else if (position.get().isNone()) {
+          return Error("Failed to append: exclusive write promise lost");
+        }
+      }
+
+      if (i < sizes.size()) {
+        started[i] = Clock::now();
+
+        Time* time = &finished[i];
+        positions[i] = writer.append(data[i])
+          .onAny([time]() { *time = Clock::now(); });
+      }
+    }
+
+    const Duration elapsed = stopwatch.elapsed();
+
+    Duration total;
+    Duration max;
+    for (size_t i = 0; i < sizes.size(); i++) {
+      const Duration latency = finished[i] - started[i];
+      total += latency;
+      max = std::max(max, latency);
+
+      output << finished[i]
+             << " Appended " << sizes[i].bytes() << " bytes"
+             << " in " << latency.ms() << " ms"
+             << " with a window of " << window << endl;
     }
 
-    durations.push_back(stopwatch.elapsed());
-    timestamps.push_back(Clock::now());
+    cout << "Window: " << window << endl;
+    cout << "  Total number of appends: " << sizes.size() << endl;
+    cout << "  Total time used: " << elapsed << endl;
+
+    if (!sizes.empty()) {
+      cout << "  Throughput: "
+           << static_cast<uint64_t>(sizes.size() / elapsed.secs())
+           << " appends/s" << endl;
+      cout << "  Latency: " << total / sizes.size() << " on average, "
+           << max << " at most" << endl;
+    }
   }
 
-  cout << "Total number of appends: " << sizes.size() << endl;
-  cout << "Total time used: " << stopwatch.elapsed() << endl;
+  // Read the log back.
+  Log::Reader reader(log.get());
 
-  // Ouput statistics.
-  ofstream output(flags.output.get().c_str());
-  if (!output.is_open()) {
-    return Error("Failed to open the output file " + flags.output.get());
+  Future<Log::Position> beginning = reader.beginning();
+  Future<Log::Position> ending = reader.ending();
+
+  if (!beginning.await(Seconds(10)) || !ending.await(Seconds(10))) {
+    return Error("Failed to get the positions of the log: timed out");
+  } else if (!beginning.isReady() || !ending.isReady()) {
+    return Error("Failed to get the positions of the log");
   }
 
-  for (size_t i = 0; i < sizes.size(); i++) {
-    output << timestamps[i]
-           << " Appended " << sizes[i].bytes() << " bytes"
-           << " in " << durations[i].ms() << " ms" << endl;
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  Future<list<Log::Entry>> entries =
+    reader.read(beginning.get(), ending.get());
+
+  if (!entries.await(Minutes(1))) {
+    return Error("Failed to read the log: timed out");
+  } else if (!entries.isReady()) {
+    return Error("Failed to read the log: " +
+                 (entries.isFailed()
+                  ? entries.failure()
+                  : "Discarded future"));
+  }
+
+  cout << "Read " << entries->size() << " entries in "
+       << stopwatch.elapsed() << endl;
+
+  // Catch-up an empty replica from the replicas in this process.
+  if (flags.replicas.isSome() && !replicas.empty()) {
+    Future<uint64_t> end = replicas.front()->ending();
+
+    if (!end.await(Seconds(10)) || !end.isReady()) {
+      return Error("Failed to get the ending position of the log");
+    }
+
+    const string path = flags.path.get() + ".catchup";
+
+    Try<Nothing> rmdir = os::rmdir(path);
+    if (rmdir.isError() && os::exists(path)) {
+      return Error("Failed to remove '" + path + "': " + rmdir.error());
+    }
+
+    Shared<Replica> replica(new Replica(path));
+
+    set<UPID> pids = {replica->pid()};
+    foreach (const Owned<Replica>& replica, replicas) {
+      pids.insert(replica->pid());
+    }
+
+    Shared<Network> network(new Network(pids));
+
+    IntervalSet<uint64_t> positions;
+    positions += (Bound<uint64_t>::closed(0),
+                  Bound<uint64_t>::closed(end.get()));
+
+    stopwatch.start(); // Restart the stopwatch.
+
+    Future<Nothing> catching = catchup(
+        flags.quorum.get(),
+        replica,
+        network,
+        None(),
+        positions);
+
+    if (!catching.await(Minutes(5))) {
+      return Error("Failed to catch-up a replica: timed out");
+    } else if (!catching.isReady()) {
+      return Error("Failed to catch-up a replica: " +
+                   (catching.isFailed()
+                    ? catching.failure()
+                    : "Discarded future"));
+    }
+
+    const Duration elapsed = stopwatch.elapsed();
+
+    cout << "Caught-up " << positions.size() << " positions in "
+         << elapsed;
+
+    if (elapsed > Duration::zero()) {
+      cout << " (" << static_cast<uint64_t>(positions.size() / elapsed.secs())
+           << " positions/s)";
+    }
+
+    cout << endl;
   }
 
   return Nothing();
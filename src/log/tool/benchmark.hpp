@@ -41,6 +41,8 @@ public:
     Option<std::string> path;
     Option<std::string> servers;
     Option<std::string> znode;
+    Option<size_t> replicas;
+    std::string windows;
     Option<std::string> input;
     Option<std::string> output;
     std::string type;
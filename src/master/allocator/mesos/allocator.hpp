@@ -60,6 +60,18 @@ public:
       const Option<std::set<std::string>>&
         fairnessExcludeResourceNames = None());
 
+  void initialize(
+      const mesos::allocator::Options& options,
+      const lambda::function<
+          void(const FrameworkID&,
+               const hashmap<std::string, hashmap<SlaveID, Resources>>&)>&
+                   offerCallback,
+      const lambda::function<
+          void(const FrameworkID&,
+               const hashmap<SlaveID, UnavailableResources>&)>&
+        inverseOfferCallback,
+      const hashmap<std::string, double>& weights);
+
   void recover(
       const int expectedAgentCount,
       const hashmap<std::string, Quota>& quotas);
@@ -182,7 +194,7 @@ public:
   using process::ProcessBase::initialize;
 
   virtual void initialize(
-      const Duration& allocationInterval,
+      const mesos::allocator::Options& options,
       const lambda::function<
           void(const FrameworkID&,
                const hashmap<std::string, hashmap<SlaveID, Resources>>&)>&
@@ -191,9 +203,7 @@ public:
           void(const FrameworkID&,
                const hashmap<SlaveID, UnavailableResources>&)>&
         inverseOfferCallback,
-      const hashmap<std::string, double>& weights,
-      const Option<std::set<std::string>>&
-        fairnessExcludeResourceNames = None()) = 0;
+      const hashmap<std::string, double>& weights) = 0;
 
   virtual void recover(
       const int expectedAgentCount,
@@ -336,15 +346,35 @@ inline void MesosAllocator<AllocatorProcess>::initialize(
       inverseOfferCallback,
     const hashmap<std::string, double>& weights,
     const Option<std::set<std::string>>& fairnessExcludeResourceNames)
+{
+  mesos::allocator::Options options;
+  options.allocationInterval = allocationInterval;
+  options.fairnessExcludeResourceNames = fairnessExcludeResourceNames;
+
+  initialize(options, offerCallback, inverseOfferCallback, weights);
+}
+
+
+template <typename AllocatorProcess>
+inline void MesosAllocator<AllocatorProcess>::initialize(
+    const mesos::allocator::Options& options,
+    const lambda::function<
+        void(const FrameworkID&,
+             const hashmap<std::string, hashmap<SlaveID, Resources>>&)>&
+                 offerCallback,
+    const lambda::function<
+        void(const FrameworkID&,
+              const hashmap<SlaveID, UnavailableResources>&)>&
+      inverseOfferCallback,
+    const hashmap<std::string, double>& weights)
 {
   process::dispatch(
       process,
       &MesosAllocatorProcess::initialize,
-      allocationInterval,
+      options,
       offerCallback,
       inverseOfferCallback,
-      weights,
-      fairnessExcludeResourceNames);
+      weights);
 }
 
 
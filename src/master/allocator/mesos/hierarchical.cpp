@@ -17,8 +17,12 @@
 #include "master/allocator/mesos/hierarchical.hpp"
 
 #include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
 #include <set>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -124,6 +128,101 @@ private:
 };
 
 
+// A fixed set of threads that run the shards of a computation along
+// with the calling thread, see `HierarchicalAllocatorProcess::eligibilities`.
+// The threads are kept for the lifetime of the allocator, rather than
+// created for every allocation run.
+class AllocationWorkers
+{
+public:
+  explicit AllocationWorkers(size_t count)
+  {
+    for (size_t i = 0; i < count; i++) {
+      threads.emplace_back(&AllocationWorkers::work, this, i + 1);
+    }
+  }
+
+  ~AllocationWorkers()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+
+    start.notify_all();
+
+    foreach (std::thread& thread, threads) {
+      thread.join();
+    }
+  }
+
+  // Calls `shard` with each of 0, ..., `threads.size()` and returns
+  // once all the calls returned. The calling thread runs shard 0.
+  void run(const std::function<void(size_t)>& shard)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      task = &shard;
+      pending = threads.size();
+      generation++;
+    }
+
+    start.notify_all();
+
+    shard(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this]() { return pending == 0; });
+    task = nullptr;
+  }
+
+private:
+  void work(size_t index)
+  {
+    uint64_t last = 0;
+
+    while (true) {
+      const std::function<void(size_t)>* shard = nullptr;
+
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        start.wait(lock, [&]() { return stopping || generation != last; });
+
+        if (stopping) {
+          return;
+        }
+
+        last = generation;
+        shard = task;
+      }
+
+      (*shard)(index);
+
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending--;
+      }
+
+      done.notify_one();
+    }
+  }
+
+  std::vector<std::thread> threads;
+
+  std::mutex mutex;
+  std::condition_variable start;
+  std::condition_variable done;
+
+  // The shards of the current run (if any), identified by `generation`,
+  // and the number of them that the threads have yet to complete.
+  const std::function<void(size_t)>* task = nullptr;
+  uint64_t generation = 0;
+  size_t pending = 0;
+
+  bool stopping = false;
+};
+
+
 HierarchicalAllocatorProcess::Framework::Framework(
     const FrameworkInfo& frameworkInfo)
   : roles(protobuf::framework::getRoles(frameworkInfo)),
@@ -132,7 +231,7 @@ HierarchicalAllocatorProcess::Framework::Framework(
 
 
 void HierarchicalAllocatorProcess::initialize(
-    const Duration& _allocationInterval,
+    const mesos::allocator::Options& options,
     const lambda::function<
         void(const FrameworkID&,
              const hashmap<string, hashmap<SlaveID, Resources>>&)>&
@@ -141,17 +240,24 @@ void HierarchicalAllocatorProcess::initialize(
         void(const FrameworkID&,
              const hashmap<SlaveID, UnavailableResources>&)>&
       _inverseOfferCallback,
-    const hashmap<string, double>& _weights,
-    const Option<set<string>>& _fairnessExcludeResourceNames)
+    const hashmap<string, double>& _weights)
 {
-  allocationInterval = _allocationInterval;
+  allocationInterval = options.allocationInterval;
+  allocationParallelism = std::max<size_t>(options.allocationParallelism, 1);
   offerCallback = _offerCallback;
   inverseOfferCallback = _inverseOfferCallback;
   weights = _weights;
-  fairnessExcludeResourceNames = _fairnessExcludeResourceNames;
+  fairnessExcludeResourceNames = options.fairnessExcludeResourceNames;
   initialized = true;
   paused = false;
 
+  // The allocator's own thread runs one of the shards, so no threads
+  // are needed for a serial allocation.
+  if (allocationParallelism > 1) {
+    workers = Owned<AllocationWorkers>(
+        new AllocationWorkers(allocationParallelism - 1));
+  }
+
   // Resources for quota'ed roles are allocated separately and prior to
   // non-quota'ed roles, hence a dedicated sorter for quota'ed roles is
   // necessary.
@@ -487,6 +593,7 @@ void HierarchicalAllocatorProcess::addSlave(
   slave.total = total;
   slave.allocated = Resources::sum(used);
   slave.activated = true;
+  slave.dirty = true;
   slave.hostname = slaveInfo.hostname();
 
   // NOTE: We currently implement maintenance in the allocator to be able to
@@ -575,6 +682,7 @@ void HierarchicalAllocatorProcess::updateSlave(
   // TODO(alexr): Update this math once the source of revocable resources
   // is extended beyond oversubscription.
   slave.total = slave.total.nonRevocable() + oversubscribed;
+  slave.dirty = true;
 
   // Update the total resources in the `roleSorter` by removing the
   // previous oversubscribed resources and adding the new
@@ -756,6 +864,7 @@ void HierarchicalAllocatorProcess::updateAllocation(
   // Update the per-slave allocation.
   slave.allocated -= offeredResources;
   slave.allocated += updatedOfferedResources;
+  slave.dirty = true;
 
   // Update the allocation in the framework sorter.
   frameworkSorter->update(
@@ -1060,6 +1169,7 @@ void HierarchicalAllocatorProcess::recoverResources(
     CHECK(slave.allocated.contains(resources));
 
     slave.allocated -= resources;
+    slave.dirty = true;
 
     VLOG(1) << "Recovered " << resources
             << " (total: " << slave.total
@@ -1419,11 +1529,14 @@ void HierarchicalAllocatorProcess::__allocate()
   slaveIds.reserve(allocationCandidates.size());
 
   // Filter out non-whitelisted, removed, and deactivated slaves
-  // in order not to send offers for them.
+  // in order not to send offers for them. We also skip slaves that
+  // have not changed since an earlier allocation run left nothing
+  // allocatable on them (see `Slave::dirty`).
   foreach (const SlaveID& slaveId, allocationCandidates) {
     if (isWhitelisted(slaveId) &&
         slaves.contains(slaveId) &&
-        slaves.at(slaveId).activated) {
+        slaves.at(slaveId).activated &&
+        slaves.at(slaveId).dirty) {
       slaveIds.push_back(slaveId);
     }
   }
@@ -1461,11 +1574,30 @@ void HierarchicalAllocatorProcess::__allocate()
   // allocated in the current cycle.
   hashmap<SlaveID, Resources> offeredSharedResources;
 
+  // The order of the clients of a sorter only changes when resources
+  // are allocated to them, so rather than sorting the roles and the
+  // frameworks for every slave we cache the sorted clients of each
+  // sorter and only sort again once the sorter has allocated resources.
+  //
+  // NOTE: A stale order is only replaced when it is next requested,
+  // which never happens while iterating over it.
+  hashmap<const Sorter*, vector<string>> sorted;
+  hashset<const Sorter*> stale;
+
+  auto sort = [&sorted, &stale](Sorter* sorter) -> const vector<string>& {
+    if (!sorted.contains(sorter) || stale.contains(sorter)) {
+      sorted[sorter] = sorter->sort();
+      stale.erase(sorter);
+    }
+
+    return sorted.at(sorter);
+  };
+
   // Quota comes first and fair share second. Here we process only those
   // roles, for which quota is set (quota'ed roles). Such roles form a
   // special allocation group with a dedicated sorter.
   foreach (const SlaveID& slaveId, slaveIds) {
-    foreach (const string& role, quotaRoleSorter->sort()) {
+    foreach (const string& role, sort(quotaRoleSorter.get())) {
       CHECK(quotas.contains(role));
 
       const Quota& quota = quotas.at(role);
@@ -1512,7 +1644,7 @@ void HierarchicalAllocatorProcess::__allocate()
       CHECK(frameworkSorters.contains(role));
       const Owned<Sorter>& frameworkSorter = frameworkSorters.at(role);
 
-      foreach (const string& frameworkId_, frameworkSorter->sort()) {
+      foreach (const string& frameworkId_, sort(frameworkSorter.get())) {
         FrameworkID frameworkId;
         frameworkId.set_value(frameworkId_);
 
@@ -1604,6 +1736,10 @@ void HierarchicalAllocatorProcess::__allocate()
         frameworkSorter->allocated(frameworkId_, slaveId, resources);
         roleSorter->allocated(role, slaveId, resources);
         quotaRoleSorter->allocated(role, slaveId, resources);
+
+        stale.insert(frameworkSorter.get());
+        stale.insert(roleSorter.get());
+        stale.insert(quotaRoleSorter.get());
       }
     }
   }
@@ -1664,71 +1800,86 @@ void HierarchicalAllocatorProcess::__allocate()
   // (typically by using `Resources::createStrippedScalarQuantity`).
   Resources allocatedStage2;
 
+  // When allocating in parallel we first determine which frameworks the
+  // slaves would be offered to (in parallel), and then allocate serially
+  // as usual but skip over the frameworks that are known to be ineligible
+  // for a slave. Since the eligibility only depends on the state of the
+  // slave (and the framework's filters), it remains valid until resources
+  // of the slave get allocated in the loop below. So do the resources to
+  // offer to the eligible framework, which are not computed again.
+  vector<vector<Eligibility>> eligible;
+  vector<Resources> eligibleResources;
+  hashmap<string, hashmap<string, size_t>> candidateIndices;
+
+  if (allocationParallelism > 1 && slaveIds.size() > 1) {
+    vector<std::pair<string, vector<string>>> candidates;
+    size_t index = 0;
+
+    foreach (const string& role, sort(roleSorter.get())) {
+      CHECK(frameworkSorters.contains(role));
+      const vector<string>& frameworkIds =
+        sort(frameworkSorters.at(role).get());
+
+      candidates.push_back({role, frameworkIds});
+
+      foreach (const string& frameworkId, frameworkIds) {
+        candidateIndices[role][frameworkId] = index++;
+      }
+    }
+
+    eligible = eligibilities(
+        slaveIds, candidates, offeredSharedResources, &eligibleResources);
+  }
+
   // At this point resources for quotas are allocated or accounted for.
   // Proceed with allocating the remaining free pool.
-  foreach (const SlaveID& slaveId, slaveIds) {
+  for (size_t i = 0; i < slaveIds.size(); i++) {
+    const SlaveID& slaveId = slaveIds[i];
+
     // If there are no resources available for the second stage, stop.
     if (!allocatable(remainingClusterResources - allocatedStage2)) {
       break;
     }
 
-    foreach (const string& role, roleSorter->sort()) {
+    // Whether resources of this slave have been allocated in this stage.
+    bool allocated = false;
+
+    foreach (const string& role, sort(roleSorter.get())) {
       // NOTE: Suppressed frameworks are not included in the sort.
       CHECK(frameworkSorters.contains(role));
       const Owned<Sorter>& frameworkSorter = frameworkSorters.at(role);
 
-      foreach (const string& frameworkId_, frameworkSorter->sort()) {
+      foreach (const string& frameworkId_, sort(frameworkSorter.get())) {
         FrameworkID frameworkId;
         frameworkId.set_value(frameworkId_);
 
         CHECK(slaves.contains(slaveId));
         CHECK(frameworks.contains(frameworkId));
 
-        const Framework& framework = frameworks.at(frameworkId);
         Slave& slave = slaves.at(slaveId);
 
-        // Only offer resources from slaves that have GPUs to
-        // frameworks that are capable of receiving GPUs.
-        // See MESOS-5634.
-        if (!framework.capabilities.gpuResources &&
-            slave.total.gpus().getOrElse(0) > 0) {
-          continue;
-        }
-
-        // Calculate the currently available resources on the slave, which
-        // is the difference in non-shared resources between total and
-        // allocated, plus all shared resources on the agent (if applicable).
-        // Since shared resources are offerable even when they are in use, we
-        // make one copy of the shared resources available regardless of the
-        // past allocations.
-        Resources available = slave.available().nonShared();
-
-        // Offer a shared resource only if it has not been offered in
-        // this offer cycle to a framework.
-        if (framework.capabilities.sharedResources) {
-          available += slave.total.shared();
-          if (offeredSharedResources.contains(slaveId)) {
-            available -= offeredSharedResources[slaveId];
+        // Use the eligibility determined in parallel, unless resources of
+        // the slave have been allocated since.
+        Eligibility result = Eligibility::UNKNOWN;
+
+        if (!eligible.empty() && !allocated) {
+          auto indices = candidateIndices.find(role);
+          if (indices != candidateIndices.end()) {
+            auto index = indices->second.find(frameworkId_);
+            if (index != indices->second.end() &&
+                index->second < eligible[i].size()) {
+              result = eligible[i][index->second];
+            }
           }
         }
 
-        // The resources we offer are the unreserved resources as well as the
-        // reserved resources for this particular role. This is necessary to
-        // ensure that we don't offer resources that are reserved for another
-        // role.
-        //
-        // NOTE: Currently, frameworks are allowed to have '*' role.
-        // Calling reserved('*') returns an empty Resources object.
-        //
-        // NOTE: We do not offer roles with quota any more non-revocable
-        // resources once their quota is satisfied. However, note that this is
-        // not strictly true due to the coarse-grained nature (per agent) of the
-        // allocation algorithm in stage 1.
-        //
-        // TODO(mpark): Offer unreserved resources as revocable beyond quota.
-        Resources resources = available.reserved(role);
-        if (!quotas.contains(role)) {
-          resources += available.unreserved();
+        Resources resources;
+
+        if (result == Eligibility::ELIGIBLE) {
+          resources = eligibleResources[i];
+        } else if (result == Eligibility::UNKNOWN) {
+          result = eligibility(
+              frameworkId, role, slaveId, offeredSharedResources, &resources);
         }
 
         // It is safe to break here, because all frameworks under a role would
@@ -1736,29 +1887,11 @@ void HierarchicalAllocatorProcess::__allocate()
         // resources, we don't have to check for other frameworks under the
         // same role. We only break out of the innermost loop, so the next step
         // will use the same slaveId, but a different role.
-        //
-        // The difference to the second `allocatable` check is that here we also
-        // check for revocable resources, which can be disabled on a per frame-
-        // work basis, which requires us to go through all frameworks in case we
-        // have allocatable revocable resources.
-        if (!allocatable(resources)) {
+        if (result == Eligibility::EXHAUSTED) {
           break;
         }
 
-        // Remove revocable resources if the framework has not opted for them.
-        if (!framework.capabilities.revocableResources) {
-          resources = resources.nonRevocable();
-        }
-
-        // If the resources are not allocatable, ignore. We cannot break
-        // here, because another framework under the same role could accept
-        // revocable resources and breaking would skip all other frameworks.
-        if (!allocatable(resources)) {
-          continue;
-        }
-
-        // If the framework filters these resources, ignore.
-        if (isFiltered(frameworkId, role, slaveId, resources)) {
+        if (result == Eligibility::INELIGIBLE) {
           continue;
         }
 
@@ -1792,11 +1925,15 @@ void HierarchicalAllocatorProcess::__allocate()
         allocatedStage2 += scalarQuantity;
 
         slave.allocated += resources;
+        allocated = true;
 
         frameworkSorter->add(slaveId, resources);
         frameworkSorter->allocated(frameworkId_, slaveId, resources);
         roleSorter->allocated(role, slaveId, resources);
 
+        stale.insert(frameworkSorter.get());
+        stale.insert(roleSorter.get());
+
         if (quotas.contains(role)) {
           // See comment at `quotaRoleSorter` declaration regarding
           // non-revocable.
@@ -1806,6 +1943,17 @@ void HierarchicalAllocatorProcess::__allocate()
     }
   }
 
+  // Slaves on which nothing is left to allocate can be skipped by
+  // subsequent allocation runs until their resources change.
+  //
+  // NOTE: Shared resources remain offerable even when they are in use.
+  foreach (const SlaveID& slaveId, slaveIds) {
+    Slave& slave = slaves.at(slaveId);
+
+    slave.dirty =
+      allocatable(slave.available().nonShared() + slave.total.shared());
+  }
+
   if (offerable.empty()) {
     VLOG(1) << "No allocations performed";
   } else {
@@ -2087,6 +2235,164 @@ bool HierarchicalAllocatorProcess::allocatable(
 }
 
 
+HierarchicalAllocatorProcess::Eligibility
+HierarchicalAllocatorProcess::eligibility(
+    const FrameworkID& frameworkId,
+    const string& role,
+    const SlaveID& slaveId,
+    const hashmap<SlaveID, Resources>& offeredSharedResources,
+    Resources* resources) const
+{
+  CHECK(frameworks.contains(frameworkId));
+  CHECK(slaves.contains(slaveId));
+
+  const Framework& framework = frameworks.at(frameworkId);
+  const Slave& slave = slaves.at(slaveId);
+
+  // Only offer resources from slaves that have GPUs to
+  // frameworks that are capable of receiving GPUs.
+  // See MESOS-5634.
+  if (!framework.capabilities.gpuResources &&
+      slave.total.gpus().getOrElse(0) > 0) {
+    return Eligibility::INELIGIBLE;
+  }
+
+  // Calculate the currently available resources on the slave, which
+  // is the difference in non-shared resources between total and
+  // allocated, plus all shared resources on the agent (if applicable).
+  // Since shared resources are offerable even when they are in use, we
+  // make one copy of the shared resources available regardless of the
+  // past allocations.
+  Resources available = slave.available().nonShared();
+
+  // Offer a shared resource only if it has not been offered in
+  // this offer cycle to a framework.
+  if (framework.capabilities.sharedResources) {
+    available += slave.total.shared();
+    if (offeredSharedResources.contains(slaveId)) {
+      available -= offeredSharedResources.at(slaveId);
+    }
+  }
+
+  // The resources we offer are the unreserved resources as well as the
+  // reserved resources for this particular role. This is necessary to
+  // ensure that we don't offer resources that are reserved for another
+  // role.
+  //
+  // NOTE: Currently, frameworks are allowed to have '*' role.
+  // Calling reserved('*') returns an empty Resources object.
+  //
+  // NOTE: We do not offer roles with quota any more non-revocable
+  // resources once their quota is satisfied. However, note that this is
+  // not strictly true due to the coarse-grained nature (per agent) of the
+  // allocation algorithm in stage 1.
+  //
+  // TODO(mpark): Offer unreserved resources as revocable beyond quota.
+  *resources = available.reserved(role);
+  if (!quotas.contains(role)) {
+    *resources += available.unreserved();
+  }
+
+  // The difference to the second `allocatable` check is that here we also
+  // check for revocable resources, which can be disabled on a per frame-
+  // work basis, which requires us to go through all frameworks in case we
+  // have allocatable revocable resources.
+  if (!allocatable(*resources)) {
+    return Eligibility::EXHAUSTED;
+  }
+
+  // Remove revocable resources if the framework has not opted for them.
+  if (!framework.capabilities.revocableResources) {
+    *resources = resources->nonRevocable();
+  }
+
+  // If the resources are not allocatable, ignore. We cannot stop
+  // here, because another framework under the same role could accept
+  // revocable resources and stopping would skip all other frameworks.
+  if (!allocatable(*resources)) {
+    return Eligibility::INELIGIBLE;
+  }
+
+  // If the framework filters these resources, ignore.
+  if (isFiltered(frameworkId, role, slaveId, *resources)) {
+    return Eligibility::INELIGIBLE;
+  }
+
+  return Eligibility::ELIGIBLE;
+}
+
+
+vector<vector<HierarchicalAllocatorProcess::Eligibility>>
+HierarchicalAllocatorProcess::eligibilities(
+    const vector<SlaveID>& slaveIds,
+    const vector<std::pair<string, vector<string>>>& candidates,
+    const hashmap<SlaveID, Resources>& offeredSharedResources,
+    vector<Resources>* eligibleResources) const
+{
+  vector<vector<Eligibility>> result(slaveIds.size());
+  eligibleResources->assign(slaveIds.size(), Resources());
+
+  // Considers the candidates in order until the first eligible one.
+  //
+  // NOTE: Each slave is considered by exactly one thread, which only
+  // writes to the corresponding element of `result`.
+  auto consider = [&](size_t i) {
+    vector<Eligibility>& eligible = result[i];
+    size_t end = 0;
+
+    foreach (const auto& candidate, candidates) {
+      const string& role = candidate.first;
+
+      foreach (const string& frameworkId_, candidate.second) {
+        FrameworkID frameworkId;
+        frameworkId.set_value(frameworkId_);
+
+        Resources resources;
+        Eligibility outcome = eligibility(
+            frameworkId, role, slaveIds[i], offeredSharedResources, &resources);
+
+        eligible.push_back(outcome);
+
+        if (outcome == Eligibility::ELIGIBLE) {
+          (*eligibleResources)[i] = resources;
+          return;
+        }
+
+        if (outcome == Eligibility::EXHAUSTED) {
+          break;
+        }
+      }
+
+      // The remaining frameworks of an exhausted role are not considered.
+      end += candidate.second.size();
+      eligible.resize(end, Eligibility::UNKNOWN);
+    }
+  };
+
+  if (workers.isNone()) {
+    for (size_t i = 0; i < slaveIds.size(); i++) {
+      consider(i);
+    }
+
+    return result;
+  }
+
+  // NOTE: A shard is empty if there are fewer slaves than threads.
+  const size_t shards = allocationParallelism;
+
+  workers.get()->run([&](size_t shard) {
+    const size_t begin = slaveIds.size() * shard / shards;
+    const size_t end = slaveIds.size() * (shard + 1) / shards;
+
+    for (size_t i = begin; i < end; i++) {
+      consider(i);
+    }
+  });
+
+  return result;
+}
+
+
 double HierarchicalAllocatorProcess::_resources_offered_or_allocated(
     const string& resource)
 {
@@ -2157,6 +2463,7 @@ void HierarchicalAllocatorProcess::updateSlaveTotal(
 
   const Resources oldTotal = slave.total;
   slave.total = total;
+  slave.dirty = true;
 
   // Currently `roleSorter` and `quotaRoleSorter`, being the root-level
   // sorters, maintain all of `slaves[slaveId].total` (or the `nonRevocable()`
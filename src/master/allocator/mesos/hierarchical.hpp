@@ -19,6 +19,8 @@
 
 #include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <mesos/mesos.hpp>
 
@@ -66,6 +68,7 @@ namespace internal {
 // Forward declarations.
 class OfferFilter;
 class InverseOfferFilter;
+class AllocationWorkers;
 
 
 // Implements the basic allocator algorithm - first pick a role by
@@ -79,6 +82,7 @@ public:
       const std::function<Sorter*()>& quotaRoleSorterFactory)
     : initialized(false),
       paused(true),
+      allocationParallelism(1),
       metrics(*this),
       roleSorter(roleSorterFactory()),
       quotaRoleSorter(quotaRoleSorterFactory()),
@@ -92,7 +96,7 @@ public:
   }
 
   void initialize(
-      const Duration& allocationInterval,
+      const mesos::allocator::Options& options,
       const lambda::function<
           void(const FrameworkID&,
                const hashmap<std::string, hashmap<SlaveID, Resources>>&)>&
@@ -101,9 +105,7 @@ public:
           void(const FrameworkID&,
                const hashmap<SlaveID, UnavailableResources>&)>&
         inverseOfferCallback,
-      const hashmap<std::string, double>& weights,
-      const Option<std::set<std::string>>&
-        fairnessExcludeResourceNames = None());
+      const hashmap<std::string, double>& weights);
 
   void recover(
       const int _expectedAgentCount,
@@ -277,6 +279,44 @@ protected:
 
   static bool allocatable(const Resources& resources);
 
+  // Whether the available resources of a slave can be offered to a
+  // framework during the fair share (second) stage of an allocation.
+  enum class Eligibility
+  {
+    UNKNOWN,    // Not determined (yet).
+    EXHAUSTED,  // Nothing is allocatable to the role of the framework.
+    INELIGIBLE, // The framework can not be offered the resources.
+    ELIGIBLE    // The framework can be offered the resources.
+  };
+
+  // Returns whether the available resources of the slave can be
+  // offered to this role of the framework during the fair share stage,
+  // and if so sets `resources` to the resources to be offered.
+  //
+  // NOTE: This does not modify the allocator, so it can be called
+  // from multiple threads at once (see `eligibilities`).
+  Eligibility eligibility(
+      const FrameworkID& frameworkId,
+      const std::string& role,
+      const SlaveID& slaveId,
+      const hashmap<SlaveID, Resources>& offeredSharedResources,
+      Resources* resources) const;
+
+  // Determines the `eligibility` of the candidate frameworks (grouped
+  // by role, in the order the fair share stage considers them) on each
+  // of the slaves, using the `workers`. For each slave the candidates
+  // are considered until the first eligible one, the rest remain
+  // `UNKNOWN`. The result is indexed like `slaveIds` and then by the
+  // position of the framework among all candidates. The resources to
+  // offer to the eligible candidate of each slave are set in
+  // `eligibleResources`, which is indexed like `slaveIds`.
+  std::vector<std::vector<Eligibility>> eligibilities(
+      const std::vector<SlaveID>& slaveIds,
+      const std::vector<std::pair<std::string, std::vector<std::string>>>&
+        candidates,
+      const hashmap<SlaveID, Resources>& offeredSharedResources,
+      std::vector<Resources>* eligibleResources) const;
+
   bool initialized;
   bool paused;
 
@@ -285,6 +325,16 @@ protected:
 
   Duration allocationInterval;
 
+  // Number of threads used to determine the eligibility of frameworks
+  // for the resources of slaves during allocation, see `eligibilities`.
+  // Allocation is serial if this is 1.
+  size_t allocationParallelism;
+
+  // The threads (besides the allocator's own) that determine the
+  // eligibilities, which live as long as the allocator. None if the
+  // allocation is serial.
+  Option<process::Owned<AllocationWorkers>> workers;
+
   lambda::function<
       void(const FrameworkID&,
            const hashmap<std::string, hashmap<SlaveID, Resources>>&)>
@@ -373,6 +423,13 @@ protected:
 
     bool activated;  // Whether to offer resources.
 
+    // Whether the available resources of the slave might be allocatable.
+    // This is set whenever the total or allocated resources of the slave
+    // change, and cleared by an allocation run that leaves nothing
+    // allocatable on the slave. Allocation runs skip slaves that are not
+    // dirty, since nothing can be offered from them until they change.
+    bool dirty;
+
     std::string hostname;
 
     // Represents a scheduled unavailability due to maintenance for a specific
@@ -16,6 +16,7 @@
 
 #include "master/allocator/sorter/drf/sorter.hpp"
 
+#include <algorithm>
 #include <set>
 #include <string>
 #include <vector>
@@ -71,12 +72,11 @@ void DRFSorter::add(const string& name, double weight)
 {
   CHECK(!contains(name));
 
-  Client client(name, 0, 0);
-  clients.insert(client);
-
   allocations[name] = Allocation();
   weights[name] = weight;
 
+  activate(name);
+
   if (metrics.isSome()) {
     metrics->add(name);
   }
@@ -101,11 +101,7 @@ void DRFSorter::remove(const string& name)
 {
   CHECK(contains(name));
 
-  set<Client, DRFComparator>::iterator it = find(name);
-
-  if (it != clients.end()) {
-    clients.erase(it);
-  }
+  deactivate(name);
 
   allocations.erase(name);
   weights.erase(name);
@@ -120,10 +116,20 @@ void DRFSorter::activate(const string& name)
 {
   CHECK(contains(name));
 
-  set<Client, DRFComparator>::iterator it = find(name);
-  if (it == clients.end()) {
-    Client client(name, calculateShare(name), 0);
-    clients.insert(client);
+  if (find(name).isNone()) {
+    active.put(name, Client(name, calculateShare(name), 0));
+
+    Client* client = &active.at(name);
+    client->index = clients.size();
+
+    clients.push_back(client);
+    names.push_back(name);
+
+    // If the total resources have changed, we're going to sort all
+    // the clients, so don't bother positioning this client.
+    if (!dirty) {
+      reposition(client->index);
+    }
   }
 }
 
@@ -132,14 +138,23 @@ void DRFSorter::deactivate(const string& name)
 {
   CHECK(contains(name));
 
-  set<Client, DRFComparator>::iterator it = find(name);
+  Option<Client*> client = find(name);
 
-  if (it != clients.end()) {
+  if (client.isSome()) {
     // TODO(benh): Removing the client is an unfortunate strategy
     // because we lose information such as the number of allocations
     // for this client which means the fairness can be gamed by a
     // framework disconnecting and reconnecting.
-    clients.erase(it);
+    const size_t index = client.get()->index;
+
+    clients.erase(clients.begin() + index);
+    names.erase(names.begin() + index);
+
+    for (size_t i = index; i < clients.size(); i++) {
+      clients[i]->index = i;
+    }
+
+    active.erase(name);
   }
 }
 
@@ -151,22 +166,16 @@ void DRFSorter::allocated(
 {
   CHECK(contains(name));
 
-  set<Client, DRFComparator>::iterator it = find(name);
+  Option<Client*> client = find(name);
 
   // The allocator might notify us about an allocation that has been
   // made to an inactive sorter client. For example, this happens when
   // an agent re-registers that is running tasks for a framework that
   // has not yet re-registered.
-  if (it != clients.end()) {
-    // TODO(benh): Refactor 'update' to be able to reuse it here.
-    Client client(*it);
-
-    // Update the 'allocations' to reflect the allocator decision.
-    client.allocations++;
-
-    // Remove and reinsert it to update the ordering appropriately.
-    clients.erase(it);
-    clients.insert(client);
+  if (client.isSome()) {
+    // Update the 'allocations' to reflect the allocator decision. The
+    // client is moved to its new position by 'update' below.
+    client.get()->allocations++;
   }
 
   // Add shared resources to the allocated quantities when the same
@@ -391,33 +400,32 @@ void DRFSorter::remove(const SlaveID& slaveId, const Resources& resources)
 }
 
 
-vector<string> DRFSorter::sort()
+const vector<string>& DRFSorter::sort()
 {
   if (dirty) {
-    set<Client, DRFComparator> temp;
-
-    foreach (Client client, clients) {
+    foreach (Client* client, clients) {
       // Update the 'share' to get proper sorting.
-      client.share = calculateShare(client.name);
-
-      temp.insert(client);
+      client->share = calculateShare(client->name);
     }
 
-    clients = temp;
+    std::sort(
+        clients.begin(),
+        clients.end(),
+        [](const Client* client1, const Client* client2) {
+          return DRFComparator()(*client1, *client2);
+        });
+
+    for (size_t i = 0; i < clients.size(); i++) {
+      clients[i]->index = i;
+      names[i] = clients[i]->name;
+    }
 
     // Reset dirty to false so as not to re-calculate *all*
     // shares unless another dirtying operation occurs.
     dirty = false;
   }
 
-  vector<string> result;
-  result.reserve(clients.size());
-
-  foreach (const Client& client, clients) {
-    result.push_back(client.name);
-  }
-
-  return result;
+  return names;
 }
 
 
@@ -435,17 +443,13 @@ int DRFSorter::count()
 
 void DRFSorter::update(const string& name)
 {
-  set<Client, DRFComparator>::iterator it = find(name);
-
-  if (it != clients.end()) {
-    Client client(*it);
+  Option<Client*> client = find(name);
 
+  if (client.isSome()) {
     // Update the 'share' to get proper sorting.
-    client.share = calculateShare(client.name);
+    client.get()->share = calculateShare(name);
 
-    // Remove and reinsert it to update the ordering appropriately.
-    clients.erase(it);
-    clients.insert(client);
+    reposition(client.get()->index);
   }
 }
 
@@ -460,21 +464,24 @@ double DRFSorter::calculateShare(const string& name) const
   // currently does not take into account resources that are not
   // scalars.
 
+  //
+  // NOTE: We only look at the resources allocated to the client, which
+  // are usually far fewer than the resources in the total.
   foreachpair (const string& resourceName,
-               const Value::Scalar& scalar,
-               total_.totals) {
+               const Value::Scalar& allocation,
+               allocations.at(name).totals) {
     // Filter out the resources excluded from fair sharing.
     if (fairnessExcludeResourceNames.isSome() &&
         fairnessExcludeResourceNames->count(resourceName) > 0) {
       continue;
     }
 
-    if (scalar.value() > 0.0 &&
-        allocations.at(name).totals.contains(resourceName)) {
-      const double allocation =
-        allocations.at(name).totals.at(resourceName).value();
+    if (total_.totals.contains(resourceName)) {
+      const double total = total_.totals.at(resourceName).value();
 
-      share = std::max(share, allocation / scalar.value());
+      if (total > 0.0) {
+        share = std::max(share, allocation.value() / total);
+      }
     }
   }
 
@@ -482,16 +489,40 @@ double DRFSorter::calculateShare(const string& name) const
 }
 
 
-set<Client, DRFComparator>::iterator DRFSorter::find(const string& name)
+void DRFSorter::reposition(size_t index)
 {
-  set<Client, DRFComparator>::iterator it;
-  for (it = clients.begin(); it != clients.end(); it++) {
-    if (name == it->name) {
-      break;
-    }
+  DRFComparator comparator;
+
+  while (index > 0 && comparator(*clients[index], *clients[index - 1])) {
+    swap(index, index - 1);
+    index--;
+  }
+
+  while (index + 1 < clients.size() &&
+         comparator(*clients[index + 1], *clients[index])) {
+    swap(index, index + 1);
+    index++;
+  }
+}
+
+
+void DRFSorter::swap(size_t index1, size_t index2)
+{
+  std::swap(clients[index1], clients[index2]);
+  names[index1].swap(names[index2]);
+
+  clients[index1]->index = index1;
+  clients[index2]->index = index2;
+}
+
+
+Option<Client*> DRFSorter::find(const string& name)
+{
+  if (!active.contains(name)) {
+    return None();
   }
 
-  return it;
+  return &active.at(name);
 }
 
 } // namespace allocator {
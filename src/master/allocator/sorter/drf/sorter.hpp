@@ -41,9 +41,11 @@ namespace allocator {
 struct Client
 {
   Client(const std::string& _name, double _share, uint64_t _allocations)
-    : name(_name), share(_share), allocations(_allocations) {}
+    : name(_name), share(_share), allocations(_allocations), index(0) {}
 
   std::string name;
+
+  // The cached dominant share of the client, see `calculateShare`.
   double share;
 
   // We store the number of times this client has been chosen for
@@ -54,6 +56,9 @@ struct Client
   // having allocations restart at 0 after a master failover should be
   // sufficient (famous last words.)
   uint64_t allocations;
+
+  // The position of the client in the sorted clients of its sorter.
+  size_t index;
 };
 
 
@@ -119,7 +124,7 @@ public:
 
   virtual void remove(const SlaveID& slaveId, const Resources& resources);
 
-  virtual std::vector<std::string> sort();
+  virtual const std::vector<std::string>& sort();
 
   virtual bool contains(const std::string& name) const;
 
@@ -133,18 +138,34 @@ private:
   // Returns the dominant resource share for the client.
   double calculateShare(const std::string& name) const;
 
+  // Moves the client at the given index in 'clients' to its
+  // position according to 'DRFComparator'.
+  void reposition(size_t index);
+
+  // Swaps the clients at the given indices in 'clients'.
+  void swap(size_t index1, size_t index2);
+
   // Resources (by name) that will be excluded from fair sharing.
   Option<std::set<std::string>> fairnessExcludeResourceNames;
 
-  // Returns an iterator to the specified client, if
-  // it exists in this Sorter.
-  std::set<Client, DRFComparator>::iterator find(const std::string& name);
+  // Returns the specified client if it is active in this Sorter.
+  Option<Client*> find(const std::string& name);
 
   // If true, sort() will recalculate all shares.
   bool dirty = false;
 
-  // A set of Clients (names and shares) sorted by share.
-  std::set<Client, DRFComparator> clients;
+  // The active clients (names and shares). Clients are kept here
+  // so that pointers to them remain valid as clients come and go.
+  hashmap<std::string, Client> active;
+
+  // The active clients sorted by share. Each client knows its index
+  // in this vector, which lets us move a client to its new position
+  // when its share changes without searching for it.
+  std::vector<Client*> clients;
+
+  // The names of the clients in the same order as 'clients'; this
+  // is what sort() returns.
+  std::vector<std::string> names;
 
   // Maps client names to the weights that should be applied to their shares.
   hashmap<std::string, double> weights;
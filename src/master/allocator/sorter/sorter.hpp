@@ -130,7 +130,11 @@ public:
 
   // Returns all of the clients in the order that they should
   // be allocated to, according to this Sorter's policy.
-  virtual std::vector<std::string> sort() = 0;
+  //
+  // NOTE: The returned clients are only valid until the sorter
+  // is next modified, so callers that modify the sorter while
+  // iterating over the clients need to make a copy.
+  virtual const std::vector<std::string>& sort() = 0;
 
   // Returns true if this Sorter contains the specified client,
   // either active or deactivated.
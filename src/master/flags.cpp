@@ -108,6 +108,18 @@ mesos::internal::master::Flags::Flags()
       "after which the operation is considered a failure.",
       Seconds(60));
 
+  add(&Flags::registry_sharded,
+      "registry_sharded",
+      "Whether to store the registry sharded, i.e., as a separate state\n"
+      "entry for each (unreachable) agent and for each of the master,\n"
+      "maintenance, quota and weights sections, rather than as a single\n"
+      "entry. This avoids serializing and storing the entire registry\n"
+      "on every update. Either layout is recovered, and migrated to the\n"
+      "configured one on the first update after recovery.\n"
+      "NOTE: Masters running older versions of Mesos are not able to\n"
+      "recover a sharded registry.",
+      false);
+
   add(&Flags::registry_store_timeout,
       "registry_store_timeout",
       "Duration of time to wait in order to store data in the registry\n"
@@ -196,6 +208,22 @@ mesos::internal::master::Flags::Flags()
       " (batch) allocations (e.g., 500ms, 1sec, etc).",
       DEFAULT_ALLOCATION_INTERVAL);
 
+  add(&Flags::allocation_parallelism,
+      "allocation_parallelism",
+      "The number of threads used to compute allocations. When greater\n"
+      "than 1, the allocator considers the agents of an allocation run in\n"
+      "parallel before allocating their resources serially, which speeds\n"
+      "up allocation runs in large clusters. The resulting offers are the\n"
+      "same as those of a serial allocation. The threads are kept for the\n"
+      "lifetime of the master. Allocator modules may ignore this flag.",
+      DEFAULT_ALLOCATION_PARALLELISM,
+      [](size_t value) -> Option<Error> {
+        if (value < 1) {
+          return Error("Expected `--allocation_parallelism` to be at least 1");
+        }
+        return None();
+      });
+
   add(&Flags::cluster,
       "cluster",
       "Human readable name for the cluster, displayed in the webui.");
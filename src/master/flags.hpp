@@ -51,6 +51,7 @@ public:
   Duration zk_session_timeout;
   bool registry_strict;
   Duration registry_fetch_timeout;
+  bool registry_sharded;
   Duration registry_store_timeout;
   bool log_auto_initialize;
   Duration agent_reregister_timeout;
@@ -61,6 +62,7 @@ public:
   std::string user_sorter;
   std::string framework_sorter;
   Duration allocation_interval;
+  size_t allocation_parallelism;
   Option<std::string> cluster;
   Option<std::string> roles;
   Option<std::string> weights;
@@ -36,8 +36,10 @@
 
 #include <mesos/v1/master/master.hpp>
 
+#include <process/async.hpp>
 #include <process/collect.hpp>
 #include <process/defer.hpp>
+#include <process/dispatch.hpp>
 #include <process/help.hpp>
 #include <process/logging.hpp>
 
@@ -94,8 +96,13 @@ using process::Failure;
 using process::Future;
 using process::HELP;
 using process::Logging;
+using process::Promise;
 using process::TLDR;
 
+using process::async;
+using process::await;
+using process::dispatch;
+
 using process::http::Accepted;
 using process::http::BadRequest;
 using process::http::Conflict;
@@ -687,7 +694,7 @@ Future<Response> Master::Http::subscribe(
       ok.reader = pipe.reader();
 
       HttpConnection http {pipe.writer(), contentType, UUID::random()};
-      master->subscribe(http);
+      master->subscribe(http, tasksApprover);
 
       mesos::master::Event event;
       event.set_type(mesos::master::Event::SUBSCRIBED);
@@ -2596,14 +2603,15 @@ Future<Response> Master::Http::state(
       flagsApprover)
     .then(defer(
         master->self(),
-        [this, request](const tuple<Owned<ObjectApprover>,
-                                    Owned<ObjectApprover>,
-                                    Owned<ObjectApprover>,
-                                    Owned<ObjectApprover>>& approvers)
-          -> Response {
-      // This lambda is consumed before the outer lambda
-      // returns, hence capture by reference is fine here.
-      auto state = [this, &approvers](JSON::ObjectWriter* writer) {
+        [this, request, principal](
+            const tuple<Owned<ObjectApprover>,
+                        Owned<ObjectApprover>,
+                        Owned<ObjectApprover>,
+                        Owned<ObjectApprover>>& approvers)
+          -> Future<Response> {
+      // This lambda is rendered off the master actor after the outer
+      // lambda returns (see `cached`), hence the capture by value.
+      auto state = [this, approvers](JSON::ObjectWriter* writer) {
         // Get approver from tuple.
         Owned<ObjectApprover> frameworksApprover;
         Owned<ObjectApprover> tasksApprover;
@@ -2788,11 +2796,80 @@ Future<Response> Master::Http::state(
         });
       };
 
-      return OK(jsonify(state), request.url.query.get("jsonp"));
+      return cached(
+          &cachedState,
+          principal,
+          [state]() -> string { return jsonify(state); },
+          request.url.query.get("jsonp"));
     }));
 }
 
 
+Future<Response> Master::Http::cached(
+    hashmap<string, CachedState>* cache,
+    const Option<string>& principal,
+    const lambda::function<string()>& render,
+    const Option<string>& jsonp) const
+{
+  // The documents only depend on the principal if there is an
+  // authorizer, otherwise all principals share the same document.
+  const string key =
+    master->authorizer.isSome() ? principal.getOrElse("") : "";
+
+  if (cache->contains(key) &&
+      cache->at(key).generation == master->stateGeneration) {
+    ++master->metrics->state_cache_hits;
+  } else {
+    ++master->metrics->state_cache_misses;
+
+    // Documents rendered for an older state are never served again.
+    foreach (const string& principal, cache->keys()) {
+      if (cache->at(principal).generation != master->stateGeneration) {
+        cache->erase(principal);
+      }
+    }
+
+    Owned<Promise<string>> promise(new Promise<string>());
+
+    cache->put(key, CachedState{master->stateGeneration, promise->future()});
+
+    // Batch all the renderings requested until the master gets to
+    // process the dispatch below.
+    if (renders.empty()) {
+      dispatch(master->self(), [this]() { renderStates(); });
+    }
+
+    renders.push_back(std::make_pair(render, promise));
+  }
+
+  return cache->at(key).json
+    .then([jsonp](const string& json) -> Response {
+      if (jsonp.isSome()) {
+        return OK(jsonp.get() + "(" + json + ");", "text/javascript");
+      }
+
+      return OK(json, APPLICATION_JSON);
+    });
+}
+
+
+void Master::Http::renderStates() const
+{
+  list<Future<string>> futures;
+
+  foreach (const auto& render, renders) {
+    futures.push_back(async(render.first));
+    render.second->associate(futures.back());
+  }
+
+  renders.clear();
+
+  // The renderings read the state of the master, so we block the
+  // master actor until they are done to keep it from changing.
+  await(futures).await();
+}
+
+
 Future<Response> Master::Http::readFile(
     const mesos::master::Call& call,
     const Option<string>& principal,
@@ -3069,10 +3146,13 @@ Future<Response> Master::Http::stateSummary(
   return frameworksApprover
     .then(defer(
         master->self(),
-        [this, request](const Owned<ObjectApprover>& frameworksApprover)
-          -> Response {
+        [this, request, principal](
+            const Owned<ObjectApprover>& frameworksApprover)
+          -> Future<Response> {
+      // This lambda is rendered off the master actor after the outer
+      // lambda returns (see `cached`), hence the capture by value.
       auto stateSummary =
-          [this, &frameworksApprover](JSON::ObjectWriter* writer) {
+          [this, frameworksApprover](JSON::ObjectWriter* writer) {
         writer->field("hostname", master->info().hostname());
 
         if (master->flags.cluster.isSome()) {
@@ -3194,7 +3274,11 @@ Future<Response> Master::Http::stateSummary(
         });
       };
 
-      return OK(jsonify(stateSummary), request.url.query.get("jsonp"));
+      return cached(
+          &cachedStateSummary,
+          principal,
+          [stateSummary]() -> string { return jsonify(stateSummary); },
+          request.url.query.get("jsonp"));
     }));
 }
 
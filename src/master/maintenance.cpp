@@ -42,6 +42,12 @@ UpdateSchedule::UpdateSchedule(
   : schedule(_schedule) {}
 
 
+Option<hashset<SlaveID>> UpdateSchedule::touched() const
+{
+  return hashset<SlaveID>(); // Only mutates the maintenance schedules and machines.
+}
+
+
 Try<bool> UpdateSchedule::perform(
     Registry* registry,
     hashset<SlaveID>* /*slaveIDs*/)
@@ -120,6 +126,12 @@ StartMaintenance::StartMaintenance(
 }
 
 
+Option<hashset<SlaveID>> StartMaintenance::touched() const
+{
+  return hashset<SlaveID>(); // Only mutates the maintenance schedules and machines.
+}
+
+
 Try<bool> StartMaintenance::perform(
     Registry* registry,
     hashset<SlaveID>* /*perform*/)
@@ -149,6 +161,12 @@ StopMaintenance::StopMaintenance(
 }
 
 
+Option<hashset<SlaveID>> StopMaintenance::touched() const
+{
+  return hashset<SlaveID>(); // Only mutates the maintenance schedules and machines.
+}
+
+
 Try<bool> StopMaintenance::perform(
     Registry* registry,
     hashset<SlaveID>* /*slaveIDs*/)
@@ -53,6 +53,8 @@ public:
   explicit UpdateSchedule(
       const mesos::maintenance::Schedule& _schedule);
 
+  Option<hashset<SlaveID>> touched() const;
+
 protected:
   Try<bool> perform(Registry* registry, hashset<SlaveID>* slaveIDs);
 
@@ -74,6 +76,8 @@ public:
   explicit StartMaintenance(
       const google::protobuf::RepeatedPtrField<MachineID>& _ids);
 
+  Option<hashset<SlaveID>> touched() const;
+
 protected:
   Try<bool> perform(Registry* registry, hashset<SlaveID>* slaveIDs);
 
@@ -94,6 +98,8 @@ public:
   explicit StopMaintenance(
       const google::protobuf::RepeatedPtrField<MachineID>& _ids);
 
+  Option<hashset<SlaveID>> touched() const;
+
 protected:
   Try<bool> perform(Registry* registry, hashset<SlaveID>* slaveIDs);
 
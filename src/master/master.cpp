@@ -21,6 +21,7 @@
 #include <fstream>
 #include <iomanip>
 #include <list>
+#include <map>
 #include <memory>
 #include <set>
 #include <sstream>
@@ -94,6 +95,7 @@
 using google::protobuf::RepeatedPtrField;
 
 using std::list;
+using std::map;
 using std::set;
 using std::shared_ptr;
 using std::string;
@@ -704,12 +706,17 @@ void Master::initialize()
   }
 
   // Initialize the allocator.
+  mesos::allocator::Options options;
+  options.allocationInterval = flags.allocation_interval;
+  options.fairnessExcludeResourceNames =
+    flags.fair_sharing_excluded_resource_names;
+  options.allocationParallelism = flags.allocation_parallelism;
+
   allocator->initialize(
-      flags.allocation_interval,
+      options,
       defer(self(), &Master::offer, lambda::_1, lambda::_2),
       defer(self(), &Master::inverseOffer, lambda::_1, lambda::_2),
-      weights,
-      flags.fair_sharing_excluded_resource_names);
+      weights);
 
   // Parse the whitelist. Passing Allocator::updateWhitelist()
   // callback is safe because we shut down the whitelistWatcher in
@@ -728,6 +735,8 @@ void Master::initialize()
   nextSlaveId = 0;
   nextOfferId = 0;
 
+  stateGeneration = 0;
+
   startTime = Clock::now();
 
   install<scheduler::Call>(&Master::receive);
@@ -1655,6 +1664,8 @@ Future<Nothing> Master::recover()
 
 Future<Nothing> Master::_recover(const Registry& registry)
 {
+  stateChanged();
+
   foreach (const Registry::Slave& slave, registry.slaves().slaves()) {
     slaves.recovered.put(slave.info().id(), slave.info());
   }
@@ -1847,6 +1858,8 @@ void Master::_doRegistryGc(
     const hashset<SlaveID>& toRemove,
     const Future<bool>& registrarResult)
 {
+  stateChanged();
+
   CHECK(!registrarResult.isDiscarded());
   CHECK(!registrarResult.isFailed());
 
@@ -1999,6 +2012,8 @@ void Master::_markUnreachableAfterFailover(
     const TimeInfo& unreachableTime,
     const Future<bool>& registrarResult)
 {
+  stateChanged();
+
   CHECK(slaves.markingUnreachable.contains(slaveInfo.id()));
   slaves.markingUnreachable.erase(slaveInfo.id());
 
@@ -2106,6 +2121,8 @@ void Master::lostCandidacy(const Future<Nothing>& lost)
 
 void Master::detected(const Future<Option<MasterInfo>>& _leader)
 {
+  stateChanged();
+
   CHECK(!_leader.isDiscarded());
 
   if (_leader.isFailed()) {
@@ -2550,6 +2567,8 @@ void Master::_subscribe(
     bool force,
     const Future<bool>& authorized)
 {
+  stateChanged();
+
   CHECK(!authorized.isDiscarded());
 
   Option<Error> authorizationError = None();
@@ -2813,6 +2832,8 @@ void Master::_subscribe(
     bool force,
     const Future<bool>& authorized)
 {
+  stateChanged();
+
   CHECK(!authorized.isDiscarded());
 
   Option<Error> authorizationError = None();
@@ -3088,6 +3109,8 @@ void Master::deactivateFramework(
 
 void Master::disconnect(Framework* framework)
 {
+  stateChanged();
+
   CHECK_NOTNULL(framework);
   CHECK(framework->connected());
 
@@ -3115,6 +3138,8 @@ void Master::disconnect(Framework* framework)
 
 void Master::deactivate(Framework* framework, bool rescind)
 {
+  stateChanged();
+
   CHECK_NOTNULL(framework);
   CHECK(framework->active());
 
@@ -3153,6 +3178,8 @@ void Master::deactivate(Framework* framework, bool rescind)
 
 void Master::disconnect(Slave* slave)
 {
+  stateChanged();
+
   CHECK_NOTNULL(slave);
 
   LOG(INFO) << "Disconnecting agent " << *slave;
@@ -3172,6 +3199,8 @@ void Master::disconnect(Slave* slave)
 
 void Master::deactivate(Slave* slave)
 {
+  stateChanged();
+
   CHECK_NOTNULL(slave);
 
   LOG(INFO) << "Deactivating agent " << *slave;
@@ -3617,6 +3646,8 @@ Resources Master::addTask(
     Framework* framework,
     Slave* slave)
 {
+  stateChanged();
+
   CHECK_NOTNULL(framework);
   CHECK_NOTNULL(slave);
   CHECK(slave->connected) << "Adding task " << task.task_id()
@@ -3938,6 +3969,8 @@ void Master::_accept(
     const scheduler::Call::Accept& accept,
     const Future<list<Future<bool>>>& _authorizations)
 {
+  stateChanged();
+
   Framework* framework = getFramework(frameworkId);
 
   // TODO(jieyu): Consider using the 'drop' overload mentioned in
@@ -4946,6 +4979,8 @@ void Master::kill(Framework* framework, const scheduler::Call::Kill& kill)
 {
   CHECK_NOTNULL(framework);
 
+  stateChanged();
+
   const TaskID& taskId = kill.task_id();
   const Option<SlaveID> slaveId =
     kill.has_slave_id() ? Option<SlaveID>(kill.slave_id()) : None();
@@ -5507,6 +5542,8 @@ void Master::reregisterSlave(
     const string& version,
     const vector<SlaveInfo::Capability>& agentCapabilities)
 {
+  stateChanged();
+
   ++metrics->messages_reregister_slave;
 
   if (authenticating.contains(from)) {
@@ -5685,6 +5722,8 @@ void Master::_reregisterSlave(
     const vector<SlaveInfo::Capability>& agentCapabilities,
     const Future<bool>& readmit)
 {
+  stateChanged();
+
   CHECK(slaves.reregistering.contains(slaveInfo.id()));
   slaves.reregistering.erase(slaveInfo.id());
 
@@ -6026,6 +6065,8 @@ void Master::updateSlave(
     const SlaveID& slaveId,
     const Resources& oversubscribedResources)
 {
+  stateChanged();
+
   ++metrics->messages_update_slave;
 
   if (slaves.removed.get(slaveId).isSome()) {
@@ -6454,6 +6495,8 @@ void Master::_markUnreachable(
     const string& message,
     const Future<bool>& registrarResult)
 {
+  stateChanged();
+
   CHECK_NOTNULL(slave);
   CHECK(slaves.markingUnreachable.contains(slave->info.id()));
   slaves.markingUnreachable.erase(slave->info.id());
@@ -6883,6 +6926,8 @@ void Master::offer(
     const FrameworkID& frameworkId,
     const hashmap<string, hashmap<SlaveID, Resources>>& resources)
 {
+  stateChanged();
+
   if (!frameworks.registered.contains(frameworkId) ||
       !frameworks.registered[frameworkId]->active()) {
     LOG(WARNING) << "Master returning resources offered to framework "
@@ -7042,6 +7087,8 @@ void Master::inverseOffer(
     const FrameworkID& frameworkId,
     const hashmap<SlaveID, UnavailableResources>& resources)
 {
+  stateChanged();
+
   if (!frameworks.registered.contains(frameworkId) ||
       !frameworks.registered[frameworkId]->active()) {
     LOG(INFO) << "Master ignoring inverse offers to framework " << frameworkId
@@ -7424,6 +7471,8 @@ void Master::reconcileKnownSlave(
 
 void Master::addFramework(Framework* framework)
 {
+  stateChanged();
+
   CHECK_NOTNULL(framework);
 
   CHECK(!frameworks.registered.contains(framework->id()))
@@ -7498,6 +7547,8 @@ void Master::addFramework(Framework* framework)
 
 void Master::recoverFramework(const FrameworkInfo& info)
 {
+  stateChanged();
+
   CHECK(!frameworks.registered.contains(info.id()));
 
   Framework* framework = new Framework(this, flags, info);
@@ -7528,6 +7579,8 @@ Try<Nothing> Master::activateRecoveredFramework(
     const Option<UPID>& pid,
     const Option<HttpConnection>& http)
 {
+  stateChanged();
+
   // Exactly one of `pid` or `http` must be provided.
   CHECK(pid.isSome() != http.isSome());
 
@@ -7615,6 +7668,8 @@ Try<Nothing> Master::activateRecoveredFramework(
 
 void Master::failoverFramework(Framework* framework, const HttpConnection& http)
 {
+  stateChanged();
+
   CHECK_NOTNULL(framework);
 
   // Notify the old connected framework that it has failed over.
@@ -7661,6 +7716,8 @@ void Master::failoverFramework(Framework* framework, const HttpConnection& http)
 // event of a scheduler failover.
 void Master::failoverFramework(Framework* framework, const UPID& newPid)
 {
+  stateChanged();
+
   CHECK_NOTNULL(framework);
 
   const Option<UPID> oldPid = framework->pid;
@@ -7700,6 +7757,8 @@ void Master::failoverFramework(Framework* framework, const UPID& newPid)
 
 void Master::_failoverFramework(Framework* framework)
 {
+  stateChanged();
+
   // Remove the framework's offers (if they weren't removed before).
   foreach (Offer* offer, utils::copy(framework->offers)) {
     allocator->recoverResources(
@@ -7754,6 +7813,8 @@ void Master::teardown(Framework* framework)
 
 void Master::removeFramework(Framework* framework)
 {
+  stateChanged();
+
   CHECK_NOTNULL(framework);
 
   LOG(INFO) << "Removing framework " << *framework;
@@ -7935,6 +7996,8 @@ void Master::removeFramework(Framework* framework)
 
 void Master::removeFramework(Slave* slave, Framework* framework)
 {
+  stateChanged();
+
   CHECK_NOTNULL(slave);
   CHECK_NOTNULL(framework);
 
@@ -7986,6 +8049,8 @@ void Master::addSlave(
     Slave* slave,
     const vector<Archive::Framework>& completedFrameworks)
 {
+  stateChanged();
+
   CHECK_NOTNULL(slave);
   CHECK(!slaves.registered.contains(slave->id));
   CHECK(!slaves.unreachable.contains(slave->id));
@@ -8151,6 +8216,8 @@ void Master::_removeSlave(
     const string& removalCause,
     Option<Counter> reason)
 {
+  stateChanged();
+
   CHECK_NOTNULL(slave);
   CHECK(slaves.removing.contains(slave->info.id()));
   slaves.removing.erase(slave->info.id());
@@ -8273,6 +8340,8 @@ void Master::_removeSlave(
 
 void Master::updateTask(Task* task, const StatusUpdate& update)
 {
+  stateChanged();
+
   CHECK_NOTNULL(task);
 
   // Get the unacknowledged status.
@@ -8337,8 +8406,13 @@ void Master::updateTask(Task* task, const StatusUpdate& update)
   task->mutable_statuses(task->statuses_size() - 1)->clear_data();
 
   if (sendSubscribersUpdate && !subscribers.subscribed.empty()) {
-    subscribers.send(protobuf::master::event::createTaskUpdated(
-        *task, task->state(), status));
+    Framework* framework = getFramework(task->framework_id());
+
+    subscribers.send(
+        protobuf::master::event::createTaskUpdated(
+            *task, task->state(), status),
+        task,
+        framework != nullptr ? &framework->info : nullptr);
   }
 
   LOG(INFO) << "Updating the state of task " << task->task_id()
@@ -8414,6 +8488,8 @@ void Master::updateTask(Task* task, const StatusUpdate& update)
 
 void Master::removeTask(Task* task)
 {
+  stateChanged();
+
   CHECK_NOTNULL(task);
 
   // The slave owns the Task object and cannot be nullptr.
@@ -8459,6 +8535,8 @@ void Master::removeExecutor(
     const FrameworkID& frameworkId,
     const ExecutorID& executorId)
 {
+  stateChanged();
+
   CHECK_NOTNULL(slave);
   CHECK(slave->hasExecutor(frameworkId, executorId));
 
@@ -8492,6 +8570,8 @@ Future<Nothing> Master::apply(Slave* slave, const Offer::Operation& operation)
 void Master::_apply(Slave* slave, const Offer::Operation& operation) {
   CHECK_NOTNULL(slave);
 
+  stateChanged();
+
   slave->apply(operation);
 
   LOG(INFO) << "Sending checkpointed resources "
@@ -8520,6 +8600,8 @@ void Master::offerTimeout(const OfferID& offerId)
 // 'useOffer()', 'discardOffer()' and 'rescindOffer()' for clarity.
 void Master::removeOffer(Offer* offer, bool rescind)
 {
+  stateChanged();
+
   // Remove from framework.
   Framework* framework = getFramework(offer->framework_id());
   CHECK(framework != nullptr)
@@ -8575,6 +8657,8 @@ void Master::inverseOfferTimeout(const OfferID& inverseOfferId)
 
 void Master::removeInverseOffer(InverseOffer* inverseOffer, bool rescind)
 {
+  stateChanged();
+
   // Remove from framework.
   Framework* framework = getFramework(inverseOffer->framework_id());
   CHECK(framework != nullptr)
@@ -8967,13 +9051,44 @@ static bool isValidFailoverTimeout(const FrameworkInfo& frameworkInfo)
 }
 
 
-void Master::Subscribers::send(const mesos::master::Event& event)
+void Master::Subscribers::send(
+    const mesos::master::Event& event,
+    const Task* task,
+    const FrameworkInfo* frameworkInfo)
 {
   VLOG(1) << "Notifying all active subscribers about " << event.type() << " "
           << "event";
 
+  const v1::master::Event v1Event = evolve(event);
+
+  // The task of a framework that has not re-registered yet (e.g., when
+  // an agent re-registers after a master failover) is authorized as a
+  // task of a framework without a user.
+  const FrameworkInfo unknownFrameworkInfo;
+
+  if (frameworkInfo == nullptr) {
+    frameworkInfo = &unknownFrameworkInfo;
+  }
+
+  // Encoded (and RecordIO framed) event for each content type.
+  map<ContentType, string> encoded;
+
   foreachvalue (const Owned<Subscriber>& subscriber, subscribed) {
-    subscriber->http.send<mesos::master::Event, v1::master::Event>(event);
+    if (task != nullptr &&
+        !approveViewTask(subscriber->tasksApprover, *task, *frameworkInfo)) {
+      continue;
+    }
+
+    const ContentType contentType = subscriber->http.contentType;
+
+    if (encoded.count(contentType) == 0) {
+      ::recordio::Encoder<v1::master::Event> encoder(lambda::bind(
+          serialize, contentType, lambda::_1));
+
+      encoded[contentType] = encoder.encode(v1Event);
+    }
+
+    subscriber->http.write(encoded.at(contentType));
   }
 }
 
@@ -8989,7 +9104,9 @@ void Master::exited(const UUID& id)
 }
 
 
-void Master::subscribe(const HttpConnection& http)
+void Master::subscribe(
+    const HttpConnection& http,
+    const Owned<ObjectApprover>& tasksApprover)
 {
   LOG(INFO) << "Added subscriber: " << http.streamId << " to the "
             << "list of active subscribers";
@@ -9002,7 +9119,8 @@ void Master::subscribe(const HttpConnection& http)
 
   subscribers.subscribed.put(
       http.streamId,
-      Owned<Subscribers::Subscriber>(new Subscribers::Subscriber{http}));
+      Owned<Subscribers::Subscriber>(
+          new Subscribers::Subscriber{http, tasksApprover}));
 }
 
 
@@ -9089,7 +9207,12 @@ void Slave::addTask(Task* task)
   }
 
   if (!master->subscribers.subscribed.empty()) {
-    master->subscribers.send(protobuf::master::event::createTaskAdded(*task));
+    Framework* framework = master->getFramework(frameworkId);
+
+    master->subscribers.send(
+        protobuf::master::event::createTaskAdded(*task),
+        task,
+        framework != nullptr ? &framework->info : nullptr);
   }
 
   LOG(INFO) << "Adding task " << taskId
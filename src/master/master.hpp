@@ -23,6 +23,7 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <boost/circular_buffer.hpp>
@@ -44,6 +45,7 @@
 
 #include <mesos/scheduler/scheduler.hpp>
 
+#include <process/future.hpp>
 #include <process/limiter.hpp>
 #include <process/http.hpp>
 #include <process/owned.hpp>
@@ -58,6 +60,7 @@
 #include <stout/foreach.hpp>
 #include <stout/hashmap.hpp>
 #include <stout/hashset.hpp>
+#include <stout/lambda.hpp>
 #include <stout/linkedhashmap.hpp>
 #include <stout/multihashmap.hpp>
 #include <stout/nothing.hpp>
@@ -289,6 +292,14 @@ struct HttpConnection
     return writer.write(encoder.encode(evolve(message)));
   }
 
+  // Writes data that is already encoded (and RecordIO framed) for the
+  // `contentType` of this connection, so that an event can be encoded
+  // once for all connections with the same content type.
+  bool write(const std::string& data)
+  {
+    return writer.write(data);
+  }
+
   bool close()
   {
     return writer.close();
@@ -857,8 +868,11 @@ private:
       bool force,
       const process::Future<bool>& authorized);
 
-  // Subscribes a client to the 'api/vX' endpoint.
-  void subscribe(const HttpConnection& http);
+  // Subscribes a client to the 'api/vX' endpoint. The client is only
+  // sent the task events that `tasksApprover` approves.
+  void subscribe(
+      const HttpConnection& http,
+      const process::Owned<ObjectApprover>& tasksApprover);
 
   void teardown(Framework* framework);
 
@@ -1515,8 +1529,41 @@ private:
         const Option<std::string>& principal,
         ContentType contentType) const;
 
+    // A document rendered by one of the state endpoints, which is
+    // current for as long as the master's `stateGeneration` is.
+    struct CachedState
+    {
+      uint64_t generation;
+      process::Future<std::string> json;
+    };
+
+    // Returns the response with the document in `cache` for the
+    // principal if it is current. Otherwise the document is rendered
+    // with `render` off the master actor (see `renderStates`), and the
+    // response is returned once the rendering is done. Requests made
+    // in the meantime wait for the same rendering.
+    process::Future<process::http::Response> cached(
+        hashmap<std::string, CachedState>* cache,
+        const Option<std::string>& principal,
+        const lambda::function<std::string()>& render,
+        const Option<std::string>& jsonp) const;
+
+    // Renders the documents queued by `cached` in parallel.
+    void renderStates() const;
+
     Master* master;
 
+    // The documents rendered by the state endpoints, indexed by the
+    // principal they were rendered for if there is an authorizer
+    // (since the documents depend on the principal then).
+    mutable hashmap<std::string, CachedState> cachedState;
+    mutable hashmap<std::string, CachedState> cachedStateSummary;
+
+    // The documents waiting to be rendered by `renderStates`.
+    mutable std::vector<std::pair<
+        lambda::function<std::string()>,
+        process::Owned<process::Promise<std::string>>>> renders;
+
     // NOTE: The quota specific pieces of the Operator API are factored
     // out into this separate class.
     QuotaHandler quotaHandler;
@@ -1749,8 +1796,11 @@ private:
     // might only be interested in a subset of events.
     struct Subscriber
     {
-      Subscriber(const HttpConnection& _http)
-        : http(_http) {}
+      Subscriber(
+          const HttpConnection& _http,
+          const process::Owned<ObjectApprover>& _tasksApprover)
+        : http(_http),
+          tasksApprover(_tasksApprover) {}
 
       // Not copyable, not assignable.
       Subscriber(const Subscriber&) = delete;
@@ -1766,10 +1816,21 @@ private:
       }
 
       HttpConnection http;
+
+      // Approves the tasks whose events are sent to the subscriber.
+      process::Owned<ObjectApprover> tasksApprover;
     };
 
     // Sends the event to all subscribers connected to the 'api/vX' endpoint.
-    void send(const mesos::master::Event& event);
+    // If the event is about a `task` it is only sent to the subscribers
+    // that are authorized to view the task of the framework, if known.
+    //
+    // NOTE: The event is evolved and encoded once per content type in
+    // use, rather than once per subscriber.
+    void send(
+        const mesos::master::Event& event,
+        const Task* task = nullptr,
+        const FrameworkInfo* frameworkInfo = nullptr);
 
     // Active subscribers to the 'api/vX' endpoint keyed by the stream
     // identifier.
@@ -1815,6 +1876,13 @@ private:
   int64_t nextOfferId;     // Used to give each slot offer a unique ID.
   int64_t nextSlaveId;     // Used to give each slave a unique ID.
 
+  // Bumps the `stateGeneration`. This must be called whenever the
+  // state rendered by the state endpoints changes, so that they stop
+  // serving their cached documents (see `Http::cached`).
+  void stateChanged() { ++stateGeneration; }
+
+  uint64_t stateGeneration;
+
   // NOTE: It is safe to use a 'shared_ptr' because 'Metrics' is
   // thread safe.
   // TODO(dhamon): This does not need to be a shared_ptr. Metrics contains
@@ -1900,6 +1968,11 @@ public:
     CHECK(info.has_id()) << "SlaveInfo is missing the 'id' field";
   }
 
+  virtual Option<hashset<SlaveID>> touched() const
+  {
+    return hashset<SlaveID>{info.id()};
+  }
+
 protected:
   virtual Try<bool> perform(Registry* registry, hashset<SlaveID>* slaveIDs)
   {
@@ -1932,6 +2005,11 @@ public:
     CHECK(info.has_id()) << "SlaveInfo is missing the 'id' field";
   }
 
+  virtual Option<hashset<SlaveID>> touched() const
+  {
+    return hashset<SlaveID>{info.id()};
+  }
+
 protected:
   virtual Try<bool> perform(Registry* registry, hashset<SlaveID>* slaveIDs)
   {
@@ -1982,6 +2060,11 @@ public:
     CHECK(info.has_id()) << "SlaveInfo is missing the 'id' field";
   }
 
+  virtual Option<hashset<SlaveID>> touched() const
+  {
+    return hashset<SlaveID>{info.id()};
+  }
+
 protected:
   virtual Try<bool> perform(Registry* registry, hashset<SlaveID>* slaveIDs)
   {
@@ -2035,6 +2118,11 @@ public:
   explicit PruneUnreachable(const hashset<SlaveID>& _toRemove)
     : toRemove(_toRemove) {}
 
+  virtual Option<hashset<SlaveID>> touched() const
+  {
+    return toRemove;
+  }
+
 protected:
   virtual Try<bool> perform(Registry* registry, hashset<SlaveID>* /*slaveIDs*/)
   {
@@ -2080,6 +2168,11 @@ public:
     CHECK(info.has_id()) << "SlaveInfo is missing the 'id' field";
   }
 
+  virtual Option<hashset<SlaveID>> touched() const
+  {
+    return hashset<SlaveID>{info.id()};
+  }
+
 protected:
   virtual Try<bool> perform(Registry* registry, hashset<SlaveID>* slaveIDs)
   {
@@ -176,6 +176,10 @@ Metrics::Metrics(const Master& master)
     event_queue_http_requests(
         "master/event_queue_http_requests",
         defer(master, &Master::_event_queue_http_requests)),
+    state_cache_hits(
+        "master/state_cache_hits"),
+    state_cache_misses(
+        "master/state_cache_misses"),
     slave_registrations(
         "master/slave_registrations"),
     slave_reregistrations(
@@ -278,6 +282,9 @@ Metrics::Metrics(const Master& master)
   process::metrics::add(event_queue_dispatches);
   process::metrics::add(event_queue_http_requests);
 
+  process::metrics::add(state_cache_hits);
+  process::metrics::add(state_cache_misses);
+
   process::metrics::add(slave_registrations);
   process::metrics::add(slave_reregistrations);
   process::metrics::add(slave_removals);
@@ -423,6 +430,9 @@ Metrics::~Metrics()
   process::metrics::remove(event_queue_dispatches);
   process::metrics::remove(event_queue_http_requests);
 
+  process::metrics::remove(state_cache_hits);
+  process::metrics::remove(state_cache_misses);
+
   process::metrics::remove(slave_registrations);
   process::metrics::remove(slave_reregistrations);
   process::metrics::remove(slave_removals);
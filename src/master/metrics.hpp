@@ -171,6 +171,11 @@ struct Metrics
   process::metrics::Gauge event_queue_dispatches;
   process::metrics::Gauge event_queue_http_requests;
 
+  // Requests to the state endpoints served from (or that rendered into)
+  // the cache of their documents, see `Master::Http::cached`.
+  process::metrics::Counter state_cache_hits;
+  process::metrics::Counter state_cache_misses;
+
   // Successful registry operations.
   process::metrics::Counter slave_registrations;
   process::metrics::Counter slave_reregistrations;
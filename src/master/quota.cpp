@@ -41,6 +41,12 @@ UpdateQuota::UpdateQuota(const QuotaInfo& quotaInfo)
   : info(quotaInfo) {}
 
 
+Option<hashset<SlaveID>> UpdateQuota::touched() const
+{
+  return hashset<SlaveID>(); // Only mutates the quotas.
+}
+
+
 Try<bool> UpdateQuota::perform(
     Registry* registry,
     hashset<SlaveID>* /*slaveIDs*/)
@@ -63,6 +69,12 @@ Try<bool> UpdateQuota::perform(
 RemoveQuota::RemoveQuota(const string& _role) : role(_role) {}
 
 
+Option<hashset<SlaveID>> RemoveQuota::touched() const
+{
+  return hashset<SlaveID>(); // Only mutates the quotas.
+}
+
+
 Try<bool> RemoveQuota::perform(
     Registry* registry,
     hashset<SlaveID>* /*slaveIDs*/)
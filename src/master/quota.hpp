@@ -63,6 +63,8 @@ class UpdateQuota : public Operation
 public:
   explicit UpdateQuota(const mesos::quota::QuotaInfo& quotaInfo);
 
+  Option<hashset<SlaveID>> touched() const;
+
 protected:
   Try<bool> perform(Registry* registry, hashset<SlaveID>* slaveIDs);
 
@@ -82,6 +84,8 @@ class RemoveQuota : public Operation
 public:
   explicit RemoveQuota(const std::string& _role);
 
+  Option<hashset<SlaveID>> touched() const;
+
 protected:
   Try<bool> perform(Registry* registry, hashset<SlaveID>* slaveIDs);
 
@@ -14,13 +14,19 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <deque>
+#include <iterator>
+#include <list>
+#include <set>
 #include <string>
+#include <vector>
 
 #include <mesos/type_utils.hpp>
 
 #include <mesos/state/protobuf.hpp>
 
+#include <process/collect.hpp>
 #include <process/defer.hpp>
 #include <process/dispatch.hpp>
 #include <process/future.hpp>
@@ -34,12 +40,16 @@
 #include <process/metrics/metrics.hpp>
 #include <process/metrics/timer.hpp>
 
+#include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/hashset.hpp>
 #include <stout/lambda.hpp>
 #include <stout/none.hpp>
 #include <stout/nothing.hpp>
 #include <stout/option.hpp>
 #include <stout/protobuf.hpp>
 #include <stout/stopwatch.hpp>
+#include <stout/strings.hpp>
 
 #include "master/registrar.hpp"
 #include "master/registry.hpp"
@@ -69,7 +79,9 @@ using process::metrics::Gauge;
 using process::metrics::Timer;
 
 using std::deque;
+using std::list;
 using std::string;
+using std::vector;
 
 namespace mesos {
 namespace internal {
@@ -129,6 +141,11 @@ private:
   public:
     explicit Recover(const MasterInfo& _info) : info(_info) {}
 
+    virtual Option<hashset<SlaveID>> touched() const
+    {
+      return hashset<SlaveID>(); // Only mutates the master.
+    }
+
   protected:
     virtual Try<bool> perform(Registry* registry, hashset<SlaveID>* slaveIDs)
     {
@@ -184,8 +201,8 @@ private:
 
   Future<double> _registry_size_bytes()
   {
-    if (variable.isSome()) {
-      return variable.get().get().ByteSize();
+    if (current.isSome()) {
+      return current.get().ByteSize();
     }
 
     return Failure("Not recovered yet");
@@ -194,14 +211,25 @@ private:
   // Continuations.
   void _recover(
       const MasterInfo& info,
-      const Future<Variable<Registry>>& recovery);
+      const Future<hashmap<string, Variable<Registry>>>& recovery);
   void __recover(const Future<bool>& recover);
   Future<bool> _apply(Owned<Operation> operation);
 
-  // Helper for updating state (performing store).
+  // Helper for fetching (in parallel) all the state entries that
+  // the registry is stored in.
+  Future<hashmap<string, Variable<Registry>>> fetch(
+      const std::set<string>& names);
+
+  // Helpers for updating state (performing store).
   void update();
+  Future<Option<hashmap<string, Variable<Registry>>>> store(
+      const hashmap<string, Registry>& changed,
+      const hashset<string>& removed,
+      const vector<string>& fetching,
+      const list<Variable<Registry>>& fetched);
   void _update(
-      const Future<Option<Variable<Registry>>>& store,
+      const Future<Option<hashmap<string, Variable<Registry>>>>& store,
+      const hashset<string>& removed,
       deque<Owned<Operation>> operations);
 
   // Fails all pending operations and transitions the Registrar
@@ -210,7 +238,13 @@ private:
   // performing more State storage operations.
   void abort(const string& message);
 
-  Option<Variable<Registry>> variable;
+  // The current registry, and the state variables (indexed by name)
+  // that it is stored in, see the comment on 'REGISTRY' below.
+  // NOTE: While 'updating' the registry already includes the
+  // operations being stored.
+  Option<Registry> current;
+  hashmap<string, Variable<Registry>> variables;
+
   deque<Owned<Operation>> operations;
   bool updating; // Used to signify fetching (recovering) or storing.
 
@@ -254,14 +288,274 @@ void fail(deque<Owned<Operation>>* operations, const string& message)
 }
 
 
+// By default the registry is stored as a single state entry named
+// "registry". With '--registry_sharded' it is instead stored as a
+// state entry for each agent, for each unreachable agent and for each
+// of the remaining sections of the registry, all named with the
+// "registry/" prefix. Every shard holds a 'Registry' which only has
+// its part of the registry set, so that the registry can be
+// recovered by merging all the shards, and so that an update only
+// has to store the shards that have changed (atomically, as a single
+// transaction).
+const char REGISTRY[] = "registry";
+const char SHARDS[] = "registry/";
+
+
+// The names of the shards for the sections of the registry other
+// than the (unreachable) agents.
+const char* const SECTIONS[] = {
+  "registry/master",
+  "registry/maintenance",
+  "registry/quotas",
+  "registry/weights",
+};
+
+
+// Returns the shards for the sections of the registry other than the
+// (unreachable) agents, indexed by name.
+// NOTE: Any new section of the registry must be sharded here too, and
+// added to 'SECTIONS'.
+hashmap<string, Registry> sections(const Registry& registry)
+{
+  hashmap<string, Registry> sections;
+
+  if (registry.has_master()) {
+    Registry section;
+    section.mutable_master()->CopyFrom(registry.master());
+    sections.put(string(SHARDS) + "master", section);
+  }
+
+  if (registry.has_machines() || registry.schedules_size() > 0) {
+    Registry section;
+    if (registry.has_machines()) {
+      section.mutable_machines()->CopyFrom(registry.machines());
+    }
+    section.mutable_schedules()->CopyFrom(registry.schedules());
+    sections.put(string(SHARDS) + "maintenance", section);
+  }
+
+  if (registry.quotas_size() > 0) {
+    Registry section;
+    section.mutable_quotas()->CopyFrom(registry.quotas());
+    sections.put(string(SHARDS) + "quotas", section);
+  }
+
+  if (registry.weights_size() > 0) {
+    Registry section;
+    section.mutable_weights()->CopyFrom(registry.weights());
+    sections.put(string(SHARDS) + "weights", section);
+  }
+
+  return sections;
+}
+
+
+// Returns the name of the state entry for the shard of an agent.
+string slaveEntry(const SlaveID& slaveId)
+{
+  return string(SHARDS) + "slaves/" + slaveId.value();
+}
+
+
+// Returns the name of the state entry for the shard of an
+// unreachable agent.
+string unreachableEntry(const SlaveID& slaveId)
+{
+  return string(SHARDS) + "unreachable/" + slaveId.value();
+}
+
+
+string entry(const Registry::Slave& slave)
+{
+  return slaveEntry(slave.info().id());
+}
+
+
+string entry(const Registry::UnreachableSlave& slave)
+{
+  return unreachableEntry(slave.id());
+}
+
+
+const SlaveID& id(const Registry::Slave& slave)
+{
+  return slave.info().id();
+}
+
+
+const SlaveID& id(const Registry::UnreachableSlave& slave)
+{
+  return slave.id();
+}
+
+
+Registry shard(const Registry::Slave& slave)
+{
+  Registry registry;
+  registry.mutable_slaves()->add_slaves()->CopyFrom(slave);
+  return registry;
+}
+
+
+Registry shard(const Registry::UnreachableSlave& slave)
+{
+  Registry registry;
+  registry.mutable_unreachable()->add_slaves()->CopyFrom(slave);
+  return registry;
+}
+
+
+// Returns whether the shard differs from the one stored in the
+// state variables (or isn't stored at all).
+bool differs(
+    const string& name,
+    const Registry& shard,
+    const hashmap<string, Variable<Registry>>& variables)
+{
+  return !variables.contains(name) ||
+    variables.at(name).get().SerializeAsString() != shard.SerializeAsString();
+}
+
+
+// Adds the shards of the 'entities' that need to be stored to
+// 'changed', and the names of all their shards to 'names'. If the
+// 'touched' agents are known only their shards are considered, and
+// are stored without comparing them to the stored ones (they have
+// been mutated by an operation).
+template <typename T>
+void diff(
+    const google::protobuf::RepeatedPtrField<T>& entities,
+    const hashmap<string, Variable<Registry>>& variables,
+    const Option<hashset<SlaveID>>& touched,
+    hashmap<string, Registry>* changed,
+    hashset<string>* names)
+{
+  foreach (const T& entity, entities) {
+    if (touched.isSome() && !touched->contains(id(entity))) {
+      continue;
+    }
+
+    const string name = entry(entity);
+    const Registry registry = shard(entity);
+
+    if (touched.isSome() || differs(name, registry, variables)) {
+      changed->put(name, registry);
+    }
+
+    names->insert(name);
+  }
+}
+
+
+// Determines the shards of 'registry' that need to be stored, and the
+// stored 'variables' that need to be expunged. The sections are
+// always compared as they are small, whereas only the shards of the
+// 'touched' agents are considered if they are known (see
+// 'Operation::touched'). Otherwise all the shards are compared, which
+// also expunges any unsharded registry when migrating.
+void diff(
+    const Registry& registry,
+    const hashmap<string, Variable<Registry>>& variables,
+    const Option<hashset<SlaveID>>& touched,
+    hashmap<string, Registry>* changed,
+    hashset<string>* removed)
+{
+  hashset<string> names;
+
+  foreachpair (const string& name,
+               const Registry& section,
+               sections(registry)) {
+    if (differs(name, section, variables)) {
+      changed->put(name, section);
+    }
+
+    names.insert(name);
+  }
+
+  diff(registry.slaves().slaves(), variables, touched, changed, &names);
+  diff(registry.unreachable().slaves(), variables, touched, changed, &names);
+
+  if (touched.isSome()) {
+    vector<string> candidates(std::begin(SECTIONS), std::end(SECTIONS));
+
+    foreach (const SlaveID& slaveId, touched.get()) {
+      candidates.push_back(slaveEntry(slaveId));
+      candidates.push_back(unreachableEntry(slaveId));
+    }
+
+    foreach (const string& name, candidates) {
+      if (variables.contains(name) && !names.contains(name)) {
+        removed->insert(name);
+      }
+    }
+  } else {
+    foreachkey (const string& name, variables) {
+      if (!names.contains(name)) {
+        removed->insert(name);
+      }
+    }
+  }
+}
+
+
+// Merges the shards of the registry back into a single registry.
+Registry merge(const hashmap<string, Variable<Registry>>& variables)
+{
+  if (variables.contains(REGISTRY)) {
+    CHECK_EQ(1u, variables.size());
+    return variables.at(REGISTRY).get();
+  }
+
+  // Merge the shards in order of their names so that the agents are
+  // recovered in a deterministic order.
+  const hashset<string> keys = variables.keys();
+  vector<string> names(keys.begin(), keys.end());
+  std::sort(names.begin(), names.end());
+
+  Registry registry;
+  vector<Registry::UnreachableSlave> unreachable;
+
+  foreach (const string& name, names) {
+    Registry shard = variables.at(name).get();
+
+    foreach (const Registry::UnreachableSlave& slave,
+             shard.unreachable().slaves()) {
+      unreachable.push_back(slave);
+    }
+
+    shard.clear_unreachable();
+    registry.MergeFrom(shard);
+  }
+
+  // Unreachable agents are expected to be ordered by when they were
+  // added, which sharding doesn't preserve. Hence we order them by
+  // when they were marked unreachable instead, which is the same
+  // order unless there was clock drift between masters.
+  std::stable_sort(
+      unreachable.begin(),
+      unreachable.end(),
+      [](const Registry::UnreachableSlave& left,
+         const Registry::UnreachableSlave& right) {
+        return left.timestamp().nanoseconds() <
+          right.timestamp().nanoseconds();
+      });
+
+  foreach (const Registry::UnreachableSlave& slave, unreachable) {
+    registry.mutable_unreachable()->add_slaves()->CopyFrom(slave);
+  }
+
+  return registry;
+}
+
+
 Future<Response> RegistrarProcess::registry(
     const Request& request,
     const Option<string>& /* principal */)
 {
   JSON::Object result;
 
-  if (variable.isSome()) {
-    result = JSON::protobuf(variable.get().get());
+  if (current.isSome()) {
+    result = JSON::protobuf(current.get());
   }
 
   return OK(result, request.url.query.get("jsonp"));
@@ -329,10 +623,11 @@ Future<Registry> RegistrarProcess::recover(const MasterInfo& info)
     VLOG(1) << "Recovering registrar";
 
     metrics.state_fetch.start();
-    state->fetch<Registry>("registry")
+    state->names()
+      .then(defer(self(), &Self::fetch, lambda::_1))
       .after(flags.registry_fetch_timeout,
              lambda::bind(
-                 &timeout<Variable<Registry>>,
+                 &timeout<hashmap<string, Variable<Registry>>>,
                  "fetch",
                  flags.registry_fetch_timeout,
                  lambda::_1))
@@ -345,9 +640,45 @@ Future<Registry> RegistrarProcess::recover(const MasterInfo& info)
 }
 
 
+Future<hashmap<string, Variable<Registry>>> RegistrarProcess::fetch(
+    const std::set<string>& names)
+{
+  // Only fetch the registry shards if there are any, so that a
+  // registry which has been stored sharded is always recovered as
+  // such (e.g., independent of whether the old entry still exists).
+  vector<string> fetching;
+  foreach (const string& name, names) {
+    if (strings::startsWith(name, SHARDS)) {
+      fetching.push_back(name);
+    }
+  }
+
+  if (fetching.empty() && names.count(REGISTRY) > 0) {
+    fetching.push_back(REGISTRY);
+  }
+
+  list<Future<Variable<Registry>>> futures;
+  foreach (const string& name, fetching) {
+    futures.push_back(state->fetch<Registry>(name));
+  }
+
+  return collect(futures)
+    .then([fetching](const list<Variable<Registry>>& fetched) {
+      hashmap<string, Variable<Registry>> variables;
+
+      auto name = fetching.begin();
+      foreach (const Variable<Registry>& variable, fetched) {
+        variables.put(*name++, variable);
+      }
+
+      return variables;
+    });
+}
+
+
 void RegistrarProcess::_recover(
     const MasterInfo& info,
-    const Future<Variable<Registry>>& recovery)
+    const Future<hashmap<string, Variable<Registry>>>& recovery)
 {
   updating = false;
 
@@ -359,13 +690,15 @@ void RegistrarProcess::_recover(
   } else {
     Duration elapsed = metrics.state_fetch.stop();
 
+    // Save the registry.
+    variables = recovery.get();
+    current = merge(variables);
+
     LOG(INFO) << "Successfully fetched the registry"
-              << " (" << Bytes(recovery.get().get().ByteSize()) << ")"
+              << " (" << Bytes(current.get().ByteSize()) << ")"
+              << " from " << variables.size() << " entries"
               << " in " << elapsed;
 
-    // Save the registry.
-    variable = recovery.get();
-
     // Perform the Recover operation to add the new MasterInfo.
     Owned<Operation> operation(new Recover(info));
     operations.push_back(operation);
@@ -391,11 +724,11 @@ void RegistrarProcess::__recover(const Future<bool>& recover)
   } else {
     LOG(INFO) << "Successfully recovered registrar";
 
-    // At this point _update() has updated 'variable' to contain
+    // At this point _update() has updated 'current' to contain
     // the Registry with the latest MasterInfo.
     // Set the promise and un-gate any pending operations.
-    CHECK_SOME(variable);
-    recovered.get()->set(variable.get().get());
+    CHECK_SOME(current);
+    recovered.get()->set(current.get());
   }
 }
 
@@ -417,7 +750,7 @@ Future<bool> RegistrarProcess::_apply(Owned<Operation> operation)
     return Failure(error.get());
   }
 
-  CHECK_SOME(variable);
+  CHECK_SOME(current);
 
   operations.push_back(operation);
   Future<bool> future = operation->future();
@@ -436,7 +769,7 @@ void RegistrarProcess::update()
 
   CHECK(!updating);
   CHECK_NONE(error);
-  CHECK_SOME(variable);
+  CHECK_SOME(current);
 
   // Time how long it takes to apply the operations.
   Stopwatch stopwatch;
@@ -444,41 +777,167 @@ void RegistrarProcess::update()
 
   updating = true;
 
-  // Create a snapshot of the current registry.
-  Registry registry = variable.get().get();
+  // Apply the operations to the current registry in place rather than
+  // to a copy of it, since the registrar aborts if storing the result
+  // fails (see '_update').
+  Registry* registry = &current.get();
 
   // Create the 'slaveIDs' accumulator.
   hashset<SlaveID> slaveIDs;
-  foreach (const Registry::Slave& slave, registry.slaves().slaves()) {
+  foreach (const Registry::Slave& slave, registry->slaves().slaves()) {
     slaveIDs.insert(slave.info().id());
   }
 
+  // Collect the agents mutated by the operations, if they are known.
+  Option<hashset<SlaveID>> touched = hashset<SlaveID>();
+
   foreach (Owned<Operation>& operation, operations) {
-    // No need to process the result of the operation.
-    (*operation)(&registry, &slaveIDs);
+    Try<bool> result = (*operation)(registry, &slaveIDs);
+
+    if (result.isSome() && result.get() && touched.isSome()) {
+      const Option<hashset<SlaveID>> slaves = operation->touched();
+
+      if (slaves.isSome()) {
+        touched.get() |= slaves.get();
+      } else {
+        touched = None();
+      }
+    }
+  }
+
+  // Determine the state entries that need to be stored and expunged,
+  // including those of the other layout when migrating between them.
+  hashmap<string, Registry> changed;
+  hashset<string> removed;
+
+  if (flags.registry_sharded) {
+    diff(*registry,
+         variables,
+         variables.contains(REGISTRY) ? None() : touched,
+         &changed,
+         &removed);
+  } else {
+    changed.put(REGISTRY, *registry);
+
+    foreachkey (const string& name, variables) {
+      if (name != REGISTRY) {
+        removed.insert(name);
+      }
+    }
   }
 
   LOG(INFO) << "Applied " << operations.size() << " operations in "
-            << stopwatch.elapsed() << "; attempting to update the registry";
+            << stopwatch.elapsed() << "; attempting to update the registry"
+            << " (storing " << changed.size() << " and expunging "
+            << removed.size() << " entries)";
+
+  // Fetch the variables for any new entries first.
+  vector<string> fetching;
+  list<Future<Variable<Registry>>> fetches;
+  foreachkey (const string& name, changed) {
+    if (!variables.contains(name)) {
+      fetching.push_back(name);
+      fetches.push_back(state->fetch<Registry>(name));
+    }
+  }
 
   // Perform the store, and time the operation.
   metrics.state_store.start();
-  state->store(variable.get().mutate(registry))
+  collect(fetches)
+    .then(defer(self(),
+                &Self::store,
+                changed,
+                removed,
+                fetching,
+                lambda::_1))
     .after(flags.registry_store_timeout,
            lambda::bind(
-               &timeout<Option<Variable<Registry>>>,
+               &timeout<Option<hashmap<string, Variable<Registry>>>>,
                "store",
                flags.registry_store_timeout,
                lambda::_1))
-    .onAny(defer(self(), &Self::_update, lambda::_1, operations));
+    .onAny(defer(self(),
+                 &Self::_update,
+                 lambda::_1,
+                 removed,
+                 operations));
 
   // Clear the operations, _update will transition the Promises!
   operations.clear();
 }
 
 
+Future<Option<hashmap<string, Variable<Registry>>>> RegistrarProcess::store(
+    const hashmap<string, Registry>& changed,
+    const hashset<string>& removed,
+    const vector<string>& fetching,
+    const list<Variable<Registry>>& fetched)
+{
+  hashmap<string, Variable<Registry>> fetches;
+
+  auto variable = fetched.begin();
+  foreach (const string& name, fetching) {
+    fetches.put(name, *variable++);
+  }
+
+  vector<string> names;
+  vector<Variable<Registry>> stores;
+
+  foreachpair (const string& name, const Registry& registry, changed) {
+    names.push_back(name);
+    stores.push_back(
+        (variables.contains(name) ? variables.at(name) : fetches.at(name))
+          .mutate(registry));
+  }
+
+  vector<Variable<Registry>> expunges;
+  foreach (const string& name, removed) {
+    CHECK(variables.contains(name));
+    expunges.push_back(variables.at(name));
+  }
+
+  // Helper for indexing the stored variables by name.
+  auto stored = [names](const Option<vector<Variable<Registry>>>& result)
+    -> Option<hashmap<string, Variable<Registry>>> {
+    if (result.isNone()) {
+      return None();
+    }
+
+    hashmap<string, Variable<Registry>> variables;
+    for (size_t i = 0; i < names.size(); i++) {
+      variables.put(names[i], result.get()[i]);
+    }
+
+    return variables;
+  };
+
+  // Nothing to do if none of the entries have changed.
+  if (stores.empty() && expunges.empty()) {
+    return stored(vector<Variable<Registry>>());
+  }
+
+  // Storing a single entry doesn't need a transaction, which also
+  // keeps using (smaller) diffs for the unsharded registry where the
+  // storage supports them.
+  if (stores.size() == 1 && expunges.empty()) {
+    return state->store(stores.front())
+      .then([stored](const Option<Variable<Registry>>& variable) {
+        if (variable.isNone()) {
+          return stored(None());
+        }
+
+        return stored(vector<Variable<Registry>>({variable.get()}));
+      });
+  }
+
+  return state->store(stores, expunges)
+    .then(stored);
+}
+
+
 void RegistrarProcess::_update(
-    const Future<Option<Variable<Registry>>>& store,
+    const Future<Option<hashmap<string, Variable<Registry>>>>& store,
+    const hashset<string>& removed,
     deque<Owned<Operation>> applied)
 {
   updating = false;
@@ -505,7 +964,15 @@ void RegistrarProcess::_update(
 
   LOG(INFO) << "Successfully updated the registry in " << elapsed;
 
-  variable = store.get().get();
+  foreachpair (const string& name,
+               const Variable<Registry>& variable,
+               store.get().get()) {
+    variables.put(name, variable);
+  }
+
+  foreach (const string& name, removed) {
+    variables.erase(name);
+  }
 
   // Remove the operations.
   while (!applied.empty()) {
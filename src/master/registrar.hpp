@@ -18,6 +18,7 @@
 #define __MASTER_REGISTRAR_HPP__
 
 #include <mesos/mesos.hpp>
+#include <mesos/type_utils.hpp>
 
 #include <mesos/state/protobuf.hpp>
 
@@ -26,6 +27,7 @@
 #include <process/pid.hpp>
 
 #include <stout/hashset.hpp>
+#include <stout/option.hpp>
 
 #include "master/flags.hpp"
 #include "master/registry.hpp"
@@ -66,6 +68,12 @@ public:
   // Sets the promise based on whether the operation was successful.
   bool set() { return process::Promise<bool>::set(success); }
 
+  // Returns the agents whose entries in the registry (i.e., in either
+  // 'slaves' or 'unreachable') the operation might mutate, or None if
+  // it might mutate any of them. This lets a sharded registry store
+  // only the shards of these agents instead of comparing all of them.
+  virtual Option<hashset<SlaveID>> touched() const { return None(); }
+
 protected:
   virtual Try<bool> perform(Registry* registry, hashset<SlaveID>* slaveIDs) = 0;
 
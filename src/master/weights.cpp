@@ -25,6 +25,12 @@ UpdateWeights::UpdateWeights(const std::vector<WeightInfo>& _weightInfos)
   : weightInfos(_weightInfos) {}
 
 
+Option<hashset<SlaveID>> UpdateWeights::touched() const
+{
+  return hashset<SlaveID>(); // Only mutates the weights.
+}
+
+
 Try<bool> UpdateWeights::perform(
     Registry* registry,
     hashset<SlaveID>* /*slaveIDs*/)
@@ -52,6 +52,8 @@ class UpdateWeights : public Operation
 public:
   explicit UpdateWeights(const std::vector<WeightInfo>& _weightInfos);
 
+  Option<hashset<SlaveID>> touched() const;
+
 protected:
   Try<bool> perform(Registry* registry, hashset<SlaveID>* slaveIDs);
 
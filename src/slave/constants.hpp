@@ -61,9 +61,24 @@ constexpr Duration DEFAULT_AUTHENTICATION_BACKOFF_FACTOR = Seconds(1);
 constexpr Duration GC_DELAY = Weeks(1);
 constexpr Duration DISK_WATCH_INTERVAL = Minutes(1);
 
+// Default amount of time for which the resource statistics of a
+// container are reused, see '--usage_cache_interval'.
+constexpr Duration USAGE_CACHE_INTERVAL = Seconds(1);
+
 // Minimum free disk capacity enforced by the garbage collector.
 constexpr double GC_DISK_HEADROOM = 0.1;
 
+// Maximum number of paths removed concurrently by the garbage
+// collector. This bounds both the libprocess worker threads blocked
+// on removals and the IO competing with running tasks.
+constexpr size_t GC_MAX_CONCURRENT_REMOVALS = 4;
+
+// Maximum depth of the directories kept open while the garbage
+// collector removes their subdirectories. Deeper directories are
+// reopened by their path instead, which bounds the file descriptors
+// used by each removal.
+constexpr size_t GC_MAX_OPEN_DIRECTORIES = 32;
+
 // Maximum number of completed frameworks to store in memory.
 constexpr size_t MAX_COMPLETED_FRAMEWORKS = 50;
 
@@ -168,7 +168,8 @@ Try<DockerContainerizer*> DockerContainerizer::create(
       flags.docker,
       flags.docker_socket,
       true,
-      flags.docker_config);
+      flags.docker_config,
+      flags.docker_engine_api);
 
   if (create.isError()) {
     return Error("Failed to create docker: " + create.error());
@@ -246,6 +247,7 @@ docker::Flags dockerFlags(
   dockerFlags.sandbox_directory = directory;
   dockerFlags.mapped_directory = flags.sandbox_directory;
   dockerFlags.docker_socket = flags.docker_socket;
+  dockerFlags.docker_engine_api = flags.docker_engine_api;
   dockerFlags.launcher_dir = flags.launcher_dir;
 
   if (taskEnvironment.isSome()) {
@@ -753,9 +755,11 @@ Try<Nothing> DockerContainerizerProcess::checkpoint(
   container->executorPid = pid;
 
   if (container->checkpoint) {
+    const string metaDir = slave::paths::getMetaRootDir(flags.work_dir);
+
     const string& path =
       slave::paths::getForkedPidPath(
-          slave::paths::getMetaRootDir(flags.work_dir),
+          metaDir,
           container->slaveId,
           container->executor.framework_id(),
           container->executor.executor_id(),
@@ -763,6 +767,19 @@ Try<Nothing> DockerContainerizerProcess::checkpoint(
 
     LOG(INFO) << "Checkpointing pid " << pid << " to '" << path <<  "'";
 
+    // Use the checkpoint journal if the agent uses it.
+    if (flags.checkpoint_journal) {
+      Try<std::shared_ptr<slave::state::Journal>> journal =
+        slave::state::Journal::open(slave::paths::getCheckpointJournalPath(
+            metaDir, container->slaveId));
+
+      if (journal.isError()) {
+        return Error(journal.error());
+      }
+
+      return journal.get()->append(path, stringify(pid));
+    }
+
     return slave::state::checkpoint(path, stringify(pid));
   }
 
@@ -1625,10 +1625,13 @@ Future<bool> MesosContainerizerProcess::_launch(
   pid_t pid = forked.get();
   container->pid = pid;
 
-  // Checkpoint the forked pid if requested by the agent.
+  // Checkpoint the forked pid if requested by the agent, to the
+  // checkpoint journal if the agent uses it.
   if (checkpoint) {
+    const string metaDir = slave::paths::getMetaRootDir(flags.work_dir);
+
     const string& path = slave::paths::getForkedPidPath(
-        slave::paths::getMetaRootDir(flags.work_dir),
+        metaDir,
         slaveId,
         container->config.executor_info().framework_id(),
         container->config.executor_info().executor_id(),
@@ -1637,8 +1640,19 @@ Future<bool> MesosContainerizerProcess::_launch(
     LOG(INFO) << "Checkpointing container's forked pid " << pid
               << " to '" << path <<  "'";
 
-    Try<Nothing> checkpointed =
-      slave::state::checkpoint(path, stringify(pid));
+    Try<Nothing> checkpointed = Nothing();
+
+    if (flags.checkpoint_journal) {
+      Try<std::shared_ptr<slave::state::Journal>> journal =
+        slave::state::Journal::open(
+            slave::paths::getCheckpointJournalPath(metaDir, slaveId));
+
+      checkpointed = journal.isError()
+        ? Error(journal.error())
+        : journal.get()->append(path, stringify(pid));
+    } else {
+      checkpointed = slave::state::checkpoint(path, stringify(pid));
+    }
 
     if (checkpointed.isError()) {
       LOG(ERROR) << "Failed to checkpoint container's forked pid to '"
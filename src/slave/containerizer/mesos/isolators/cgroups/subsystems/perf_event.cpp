@@ -14,6 +14,9 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <sys/resource.h>
+
+#include <process/after.hpp>
 #include <process/defer.hpp>
 #include <process/delay.hpp>
 #include <process/id.hpp>
@@ -21,6 +24,7 @@
 
 #include <stout/duration.hpp>
 #include <stout/error.hpp>
+#include <stout/path.hpp>
 
 #include "linux/perf.hpp"
 
@@ -44,10 +48,6 @@ Try<Owned<Subsystem>> PerfEventSubsystem::create(
     const Flags& flags,
     const string& hierarchy)
 {
-  if (!perf::supported()) {
-    return Error("Perf is not supported");
-  }
-
   if (flags.perf_duration > flags.perf_interval) {
     return Error(
         "Sampling perf for duration (" + stringify(flags.perf_duration) + ") > "
@@ -64,26 +64,74 @@ Try<Owned<Subsystem>> PerfEventSubsystem::create(
     events.insert(event);
   }
 
-  if (!perf::valid(events)) {
-    return Error("Invalid perf events: " + stringify(events));
+  // Count the events in-process if possible, which avoids forking
+  // `perf stat` (with an event and cgroup pair for each combination
+  // of event and container) for every sample.
+  const bool inProcess = perf::Counters::supported(events);
+
+  // When counting in-process, `perf stat` is only needed for the
+  // containers whose counters cannot be opened (see `open`), hence
+  // not having it is not an error.
+  bool perfStat = perf::supported();
+
+  if (!inProcess && !perfStat) {
+    return Error("Perf is not supported");
+  }
+
+  if (perfStat && !perf::valid(events)) {
+    if (!inProcess) {
+      return Error("Invalid perf events: " + stringify(events));
+    }
+
+    perfStat = false;
+  }
+
+  // The counters take one file descriptor per event and CPU for each
+  // container, so we bound them to half of the soft limit on open
+  // file descriptors to leave the rest to the agent.
+  Option<size_t> maxDescriptors;
+
+  if (inProcess) {
+    struct rlimit limit;
+    if (::getrlimit(RLIMIT_NOFILE, &limit) != 0) {
+      return ErrnoError("Failed to get the limit on open file descriptors");
+    }
+
+    if (limit.rlim_cur != RLIM_INFINITY) {
+      maxDescriptors = static_cast<size_t>(limit.rlim_cur / 2);
+    }
   }
 
   LOG(INFO) << "perf_event subsystem will profile for "
             << "'" << flags.perf_duration << "' "
             << "every '" << flags.perf_interval << "' "
-            << "for events: " << stringify(events);
-
-  return Owned<Subsystem>(new PerfEventSubsystem(flags, hierarchy, events));
+            << "for events: " << stringify(events)
+            << (inProcess ? " using perf_event_open" : " using perf stat");
+
+  return Owned<Subsystem>(new PerfEventSubsystem(
+      flags,
+      hierarchy,
+      events,
+      inProcess,
+      perfStat,
+      maxDescriptors));
 }
 
 
 PerfEventSubsystem::PerfEventSubsystem(
     const Flags& _flags,
     const string& _hierarchy,
-    const set<string>& _events)
+    const set<string>& _events,
+    bool _inProcess,
+    bool _perfStat,
+    const Option<size_t>& _maxDescriptors)
   : ProcessBase(process::ID::generate("cgroups-perf-event-subsystem")),
     Subsystem(_flags, _hierarchy),
-    events(_events) {}
+    events(_events),
+    inProcess(_inProcess),
+    perfStat(_perfStat),
+    maxDescriptors(_maxDescriptors),
+    descriptors(0) {}
 
 
 void PerfEventSubsystem::initialize()
@@ -103,6 +151,8 @@ Future<Nothing> PerfEventSubsystem::recover(
 
   infos.put(containerId, Owned<Info>(new Info(cgroup)));
 
+  open(infos[containerId].get());
+
   return Nothing();
 }
 
@@ -117,6 +167,8 @@ Future<Nothing> PerfEventSubsystem::prepare(
 
   infos.put(containerId, Owned<Info>(new Info(cgroup)));
 
+  open(infos[containerId].get());
+
   return Nothing();
 }
 
@@ -149,12 +201,59 @@ Future<Nothing> PerfEventSubsystem::cleanup(
     return Nothing();
   }
 
+  // Closing the counters releases their file descriptors.
+  descriptors -= infos[containerId]->descriptors;
+
   infos.erase(containerId);
 
   return Nothing();
 }
 
 
+void PerfEventSubsystem::open(Info* info)
+{
+  if (!inProcess) {
+    return;
+  }
+
+  // NOTE: As with a failed `perf stat` sample, we carry on without
+  // counters for the container rather than failing it.
+  const string fallback = perfStat
+    ? "; sampling it with perf stat instead"
+    : "; no perf statistics will be collected for it";
+
+  Try<size_t> cost = perf::Counters::descriptors(events);
+  if (cost.isError()) {
+    LOG(ERROR) << "Failed to open perf counters for cgroup '"
+               << info->cgroup << "': " << cost.error() << fallback;
+    return;
+  }
+
+  if (maxDescriptors.isSome() &&
+      descriptors + cost.get() > maxDescriptors.get()) {
+    LOG(WARNING) << "Not opening perf counters for cgroup '" << info->cgroup
+                 << "' as their " << cost.get() << " file descriptors would"
+                 << " exceed the bound of " << maxDescriptors.get()
+                 << " (half of RLIMIT_NOFILE)" << fallback;
+    return;
+  }
+
+  Try<Owned<perf::Counters>> counters =
+    perf::Counters::create(events, path::join(hierarchy, info->cgroup));
+
+  if (counters.isError()) {
+    LOG(ERROR) << "Failed to open perf counters for cgroup '"
+               << info->cgroup << "': " << counters.error() << fallback;
+    return;
+  }
+
+  info->counters = counters.get();
+  info->descriptors = cost.get();
+
+  descriptors += cost.get();
+}
+
+
 void PerfEventSubsystem::sample()
 {
   // Collect a perf sample for all cgroups that are not being
@@ -163,24 +262,44 @@ void PerfEventSubsystem::sample()
   set<string> cgroups;
 
   foreachvalue (const Owned<Info>& info, infos) {
-    cgroups.insert(info->cgroup);
+    if (info->counters.get() != nullptr) {
+      // Start the sample of the container by resetting its counters,
+      // the sample is then completed in `_sample`.
+      Try<PerfStatistics> statistics = info->counters->sample();
+      if (statistics.isError()) {
+        LOG(ERROR) << "Failed to sample perf counters for cgroup '"
+                   << info->cgroup << "': " << statistics.error();
+      }
+    } else if (perfStat) {
+      cgroups.insert(info->cgroup);
+    }
   }
 
-  // The discard timeout includes an allowance of twice the
-  // reaper interval to ensure we see the perf process exit.
-  Duration timeout = flags.perf_duration + process::MAX_REAP_INTERVAL() * 2;
-  Duration duration = flags.perf_duration;
+  Future<hashmap<string, PerfStatistics>> statistics;
+
+  if (inProcess && cgroups.empty()) {
+    // Only the counters need to be sampled.
+    statistics = process::after(flags.perf_duration)
+      .then([]() { return hashmap<string, PerfStatistics>(); });
+  } else {
+    // The discard timeout includes an allowance of twice the
+    // reaper interval to ensure we see the perf process exit.
+    Duration timeout = flags.perf_duration + process::MAX_REAP_INTERVAL() * 2;
+    Duration duration = flags.perf_duration;
+
+    statistics = perf::sample(events, cgroups, flags.perf_duration)
+      .after(timeout, [=](Future<hashmap<string, PerfStatistics>> future) {
+        LOG(ERROR) << "Perf sample of " << stringify(duration)
+                   << " failed to complete within " << stringify(timeout)
+                   << "; sampling will be halted";
 
-  perf::sample(events, cgroups, flags.perf_duration)
-    .after(timeout, [=](Future<hashmap<string, PerfStatistics>> future) {
-      LOG(ERROR) << "Perf sample of " << stringify(duration)
-                 << " failed to complete within " << stringify(timeout)
-                 << "; sampling will be halted";
+        future.discard();
 
-      future.discard();
+        return future;
+      });
+  }
 
-      return future;
-    })
+  statistics
     .onAny(defer(PID<PerfEventSubsystem>(this),
                  &PerfEventSubsystem::_sample,
                  Clock::now() + flags.perf_interval,
@@ -192,6 +311,20 @@ void PerfEventSubsystem::_sample(
     const Time& next,
     const Future<hashmap<string, PerfStatistics>>& statistics)
 {
+  // NOTE: The sample of a container prepared in the interim covers
+  // the time since its counters were opened.
+  foreachvalue (const Owned<Info>& info, infos) {
+    if (info->counters.get() != nullptr) {
+      Try<PerfStatistics> sample = info->counters->sample();
+      if (sample.isError()) {
+        LOG(ERROR) << "Failed to sample perf counters for cgroup '"
+                   << info->cgroup << "': " << sample.error();
+      } else {
+        info->statistics = sample.get();
+      }
+    }
+  }
+
   if (!statistics.isReady()) {
     // In case the failure is transient or this is due to a timeout,
     // we continue sampling. Note that since sampling is done on an
@@ -28,6 +28,9 @@
 #include <process/time.hpp>
 
 #include <stout/hashmap.hpp>
+#include <stout/option.hpp>
+
+#include "linux/perf.hpp"
 
 #include "slave/flags.hpp"
 
@@ -78,7 +81,10 @@ private:
   PerfEventSubsystem(
       const Flags& flags,
       const std::string& hierarchy,
-      const std::set<std::string>& events);
+      const std::set<std::string>& events,
+      bool inProcess,
+      bool perfStat,
+      const Option<size_t>& maxDescriptors);
 
   struct Info
   {
@@ -95,8 +101,18 @@ private:
 
     const std::string cgroup;
     PerfStatistics statistics;
+
+    // The counters of the cgroup, when sampling in-process, and the
+    // number of file descriptors they take.
+    process::Owned<perf::Counters> counters;
+    size_t descriptors = 0;
   };
 
+  // Opens the counters of the container's cgroup, when sampling
+  // in-process. If they cannot be opened, the cgroup is sampled by
+  // running `perf stat` instead (if supported).
+  void open(Info* info);
+
   void sample();
 
   void _sample(
@@ -106,6 +122,22 @@ private:
   // Set of events to sample.
   std::set<std::string> events;
 
+  // Whether the events are sampled in-process using `perf::Counters`
+  // rather than by running `perf stat`.
+  const bool inProcess;
+
+  // Whether `perf stat` can be run, which is always the case unless
+  // sampling in-process.
+  const bool perfStat;
+
+  // The bound on the number of file descriptors taken by the counters
+  // of all containers, see `create`. None if unbounded.
+  const Option<size_t> maxDescriptors;
+
+  // The number of file descriptors taken by the counters of all
+  // containers.
+  size_t descriptors;
+
   // Stores cgroups associated information for container.
   hashmap<ContainerID, process::Owned<Info>> infos;
 };
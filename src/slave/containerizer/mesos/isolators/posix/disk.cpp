@@ -14,18 +14,23 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <fnmatch.h>
 #include <signal.h>
+#include <time.h>
 
 #ifdef __linux__
 #include <sys/prctl.h>
 #endif
+#include <sys/stat.h>
 #include <sys/types.h>
 
 #include <deque>
+#include <set>
 #include <tuple>
 
 #include <glog/logging.h>
 
+#include <process/async.hpp>
 #include <process/check.hpp>
 #include <process/collect.hpp>
 #include <process/defer.hpp>
@@ -36,6 +41,7 @@
 
 #include <stout/check.hpp>
 #include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
 #include <stout/lambda.hpp>
 #include <stout/numify.hpp>
 #include <stout/strings.hpp>
@@ -43,6 +49,7 @@
 
 #include <stout/os/exists.hpp>
 #include <stout/os/killtree.hpp>
+#include <stout/os/ls.hpp>
 #include <stout/os/stat.hpp>
 
 #include "common/protobuf_utils.hpp"
@@ -100,7 +107,9 @@ PosixDiskIsolatorProcess::Info::PathInfo::~PathInfo()
 PosixDiskIsolatorProcess::PosixDiskIsolatorProcess(const Flags& _flags)
   : ProcessBase(process::ID::generate("posix-disk-isolator")),
     flags(_flags),
-    collector(flags.container_disk_watch_interval) {}
+    collector(
+        flags.container_disk_watch_interval,
+        flags.container_disk_watch_incremental) {}
 
 
 PosixDiskIsolatorProcess::~PosixDiskIsolatorProcess() {}
@@ -423,12 +432,194 @@ Future<Nothing> PosixDiskIsolatorProcess::cleanup(
 }
 
 
+// An in-process alternative to 'du' for the incremental mode of the
+// collector. The listing of each directory is cached and only read
+// again (with `readdir`) if the modification time of the directory
+// changed, i.e., an entry was added, removed or renamed. Note that
+// writing to a file does not change the modification time of its
+// directory, so every entry is still `lstat`ed on each walk.
+//
+// The usage is computed as by 'du -s': the allocated blocks of each
+// entry (with hard linked files counted once), without following
+// symbolic links except for the root.
+class DiskUsageWalker
+{
+public:
+  Try<Bytes> walk(const string& path, const vector<string>& excludes)
+  {
+    struct stat s;
+    if (::stat(path.c_str(), &s) < 0) {
+      roots.erase(path);
+      return ErrnoError("Failed to stat '" + path + "'");
+    }
+
+    if (!S_ISDIR(s.st_mode)) {
+      return Bytes(s.st_blocks * 512);
+    }
+
+    const time_t now = ::time(nullptr);
+
+    // Drop the cached listings of the trees which are no longer
+    // walked, e.g., the sandboxes of destroyed containers.
+    foreach (const string& root, roots.keys()) {
+      if (now - roots[root]->walked > EXPIRY) {
+        roots.erase(root);
+      }
+    }
+
+    if (!roots.contains(path)) {
+      roots[path] = Owned<Directory>(new Directory());
+    }
+
+    roots[path]->walked = now;
+
+    std::set<std::pair<dev_t, ino_t>> links;
+
+    uint64_t blocks = s.st_blocks + walk(
+        path, s, roots[path].get(), excludes, &links);
+
+    return Bytes(blocks * 512);
+  }
+
+private:
+  struct Directory
+  {
+    // The identity and modification time of the directory as of the
+    // listing of its entries.
+    ino_t inode = 0;
+    struct timespec mtime = {0, 0};
+
+    // Whether the listing can be reused for the same modification
+    // time, see `walk`.
+    bool stable = false;
+
+    vector<string> entries;
+
+    // The cached listings of the subdirectories, by name.
+    hashmap<string, Owned<Directory>> directories;
+
+    // When the tree was last walked (only maintained for the roots).
+    time_t walked = 0;
+  };
+
+  // The number of seconds after which the cached listings of a tree
+  // that was not walked are dropped.
+  static constexpr time_t EXPIRY = 600;
+
+  static bool excluded(
+      const string& path,
+      const string& name,
+      const vector<string>& excludes)
+  {
+    // NOTE: As with 'du --exclude', a pattern is matched against
+    // both the path of an entry and its name.
+    foreach (const string& exclude, excludes) {
+      if (::fnmatch(exclude.c_str(), path.c_str(), 0) == 0 ||
+          ::fnmatch(exclude.c_str(), name.c_str(), 0) == 0) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  // Returns the number of 512-byte blocks of the entries of the
+  // directory at 'path' (recursively).
+  uint64_t walk(
+      const string& path,
+      const struct stat& s,
+      Directory* directory,
+      const vector<string>& excludes,
+      std::set<std::pair<dev_t, ino_t>>* links)
+  {
+#ifdef __APPLE__
+    const struct timespec& mtime = s.st_mtimespec;
+#else
+    const struct timespec& mtime = s.st_mtim;
+#endif
+
+    const bool modified =
+      directory->inode != s.st_ino ||
+      directory->mtime.tv_sec != mtime.tv_sec ||
+      directory->mtime.tv_nsec != mtime.tv_nsec;
+
+    // A listing is only reused if it was read after the timestamp
+    // granularity of the filesystem elapsed since the last
+    // modification, otherwise an entry added right after the listing
+    // might not have changed the modification time.
+    if (modified || !directory->stable) {
+      Try<list<string>> entries = os::ls(path);
+      if (entries.isError()) {
+        // The directory might have been removed since it was listed.
+        VLOG(1) << "Failed to list '" << path << "': " << entries.error();
+        return 0;
+      }
+
+      directory->inode = s.st_ino;
+      directory->mtime = mtime;
+      directory->stable = ::time(nullptr) > mtime.tv_sec + 1;
+      directory->entries.assign(entries->begin(), entries->end());
+
+      // Keep the cached listings of the subdirectories which still
+      // exist.
+      hashmap<string, Owned<Directory>> directories;
+      foreach (const string& entry, directory->entries) {
+        if (directory->directories.contains(entry)) {
+          directories[entry] = directory->directories[entry];
+        }
+      }
+
+      directory->directories = directories;
+    }
+
+    uint64_t blocks = 0;
+
+    foreach (const string& entry, directory->entries) {
+      const string _path = path::join(path, entry);
+
+      if (excluded(_path, entry, excludes)) {
+        continue;
+      }
+
+      struct stat _s;
+      if (::lstat(_path.c_str(), &_s) < 0) {
+        // The entry might have been removed since it was listed.
+        continue;
+      }
+
+      if (S_ISDIR(_s.st_mode)) {
+        if (!directory->directories.contains(entry)) {
+          directory->directories[entry] = Owned<Directory>(new Directory());
+        }
+
+        blocks += _s.st_blocks + walk(
+            _path,
+            _s,
+            directory->directories[entry].get(),
+            excludes,
+            links);
+      } else if (_s.st_nlink <= 1 ||
+                 links->insert({_s.st_dev, _s.st_ino}).second) {
+        blocks += _s.st_blocks;
+      }
+    }
+
+    return blocks;
+  }
+
+  // The cached listings, by the path of the walked tree.
+  hashmap<string, Owned<Directory>> roots;
+};
+
+
 class DiskUsageCollectorProcess : public Process<DiskUsageCollectorProcess>
 {
 public:
-  DiskUsageCollectorProcess(const Duration& _interval)
+  DiskUsageCollectorProcess(const Duration& _interval, bool _incremental)
     : ProcessBase(process::ID::generate("posix-disk-usage-collector")),
-      interval(_interval) {}
+      interval(_interval),
+      incremental(_incremental),
+      walker(new DiskUsageWalker()) {}
   virtual ~DiskUsageCollectorProcess() {}
 
   Future<Bytes> usage(
@@ -482,14 +673,16 @@ private:
     string path;
     vector<string> excludes;
     Option<Subprocess> du;
+    bool walking = false;
     Promise<Bytes> promise;
   };
 
   void discard(const string& path)
   {
     for (auto it = entries.begin(); it != entries.end(); ++it) {
-      // We only cancel those checks whose 'du' haven't been launched.
-      if ((*it)->path == path && (*it)->du.isNone()) {
+      // We only cancel those checks whose 'du' (or walk) haven't been
+      // launched.
+      if ((*it)->path == path && (*it)->du.isNone() && !(*it)->walking) {
         (*it)->promise.discard();
         entries.erase(it);
         break;
@@ -510,6 +703,11 @@ private:
 
     const Owned<Entry>& entry = entries.front();
 
+    if (incremental) {
+      walk();
+      return;
+    }
+
     // Invoke 'du' and report number of 1K-byte blocks. We fix the
     // block size here so that we can get consistent results on all
     // platforms (e.g., OS X uses 512 byte blocks).
@@ -626,16 +824,61 @@ private:
     delay(interval, self(), &Self::schedule);
   }
 
+  // Walks the path of the first entry in the incremental mode. The
+  // walk blocks on the filesystem so it is run asynchronously; since
+  // only a single walk runs at a time the walker needs no locking.
+  void walk()
+  {
+    const Owned<Entry>& entry = entries.front();
+
+    entry->walking = true;
+
+    const string path = entry->path;
+    const vector<string> excludes = entry->excludes;
+    Owned<DiskUsageWalker> walker = this->walker;
+
+    process::async([=]() { return walker->walk(path, excludes); })
+      .onAny(defer(self(), &Self::_walk, lambda::_1));
+  }
+
+  void _walk(const Future<Try<Bytes>>& future)
+  {
+    CHECK(!entries.empty());
+
+    const Owned<Entry>& entry = entries.front();
+    CHECK(entry->walking);
+
+    if (!future.isReady()) {
+      entry->promise.fail(
+          "Failed to walk '" + entry->path + "': " +
+          (future.isFailed() ? future.failure() : "discarded"));
+    } else if (future->isError()) {
+      entry->promise.fail(future->error());
+    } else {
+      entry->promise.set(future->get());
+    }
+
+    entries.pop_front();
+    delay(interval, self(), &Self::schedule);
+  }
+
   const Duration interval;
 
+  // Whether to walk the paths in-process rather than running 'du'.
+  const bool incremental;
+
+  Owned<DiskUsageWalker> walker;
+
   // A queue of pending checks.
   deque<Owned<Entry>> entries;
 };
 
 
-DiskUsageCollector::DiskUsageCollector(const Duration& interval)
+DiskUsageCollector::DiskUsageCollector(
+    const Duration& interval,
+    bool incremental)
 {
-  process = new DiskUsageCollectorProcess(interval);
+  process = new DiskUsageCollectorProcess(interval, incremental);
   spawn(process);
 }
 
@@ -40,10 +40,15 @@ class DiskUsageCollectorProcess;
 
 // Responsible for collecting disk usage for paths, while ensuring
 // that an interval elapses between each collection.
+//
+// By default the usage is collected by running 'du'. If 'incremental'
+// is set the paths are instead walked in-process, reusing the cached
+// listing of each directory that was not modified since the previous
+// walk of the same path.
 class DiskUsageCollector
 {
 public:
-  DiskUsageCollector(const Duration& interval);
+  DiskUsageCollector(const Duration& interval, bool incremental = false);
   ~DiskUsageCollector();
 
   // Returns the disk usage rooted at 'path'. The user can discard the
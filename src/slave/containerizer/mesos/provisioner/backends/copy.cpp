@@ -14,25 +14,61 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <fcntl.h>
+#include <fts.h>
+
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/xattr.h>
+#endif // __linux__
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
 #include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
 
 #include <mesos/docker/spec.hpp>
 
+#include <process/async.hpp>
 #include <process/collect.hpp>
 #include <process/defer.hpp>
 #include <process/dispatch.hpp>
 #include <process/id.hpp>
 #include <process/io.hpp>
+#include <process/owned.hpp>
 #include <process/process.hpp>
 #include <process/subprocess.hpp>
 
 #include <stout/foreach.hpp>
+#include <stout/lambda.hpp>
 #include <stout/os.hpp>
+#include <stout/synchronized.hpp>
+#include <stout/uuid.hpp>
 
 #include "common/status_utils.hpp"
 
+#include "slave/paths.hpp"
+
+#include "slave/containerizer/mesos/provisioner/constants.hpp"
+
 #include "slave/containerizer/mesos/provisioner/backends/copy.hpp"
 
+#ifdef __linux__
+// Defined in <linux/fs.h> since Linux 4.5, which conflicts with
+// <sys/mount.h> with older glibc.
+#ifndef FICLONE
+#define FICLONE _IOW(0x94, 9, int)
+#endif
+#endif // __linux__
+
 using namespace process;
 
 using std::string;
@@ -43,25 +79,63 @@ namespace mesos {
 namespace internal {
 namespace slave {
 
+// The maximum number of threads that copy layers concurrently, across
+// all rootfses being provisioned.
+constexpr size_t COPY_THREADS = 4;
+
+// The maximum number of bytes copied by a single system call.
+constexpr size_t COPY_CHUNK_SIZE = 1024 * 1024;
+
+
 class CopyBackendProcess : public Process<CopyBackendProcess>
 {
 public:
-  CopyBackendProcess()
-    : ProcessBase(process::ID::generate("copy-provisioner-backend")) {}
+  explicit CopyBackendProcess(const string& _trashDir)
+    : ProcessBase(process::ID::generate("copy-provisioner-backend")),
+      trashDir(_trashDir),
+      copying(0) {}
 
   Future<Nothing> provision(const vector<string>& layers, const string& rootfs);
 
   Future<bool> destroy(const string& rootfs);
 
+protected:
+  virtual void initialize();
+
 private:
   Future<Nothing> _provision(string layer, const string& rootfs);
+
+  Future<Nothing> remove(const string& path);
+
+  // Runs the copy job on a libprocess worker once fewer than
+  // `COPY_THREADS` copy jobs are running, so that provisioning many
+  // rootfses at once does not occupy all the workers.
+  Future<Try<Nothing>> copy(const lambda::function<Try<Nothing>()>& job);
+
+  Future<Try<Nothing>> _copy(const lambda::function<Try<Nothing>()>& job);
+
+  void __copy();
+
+  // The directory that rootfses are moved to while being removed.
+  const string trashDir;
+
+  // The number of copy jobs running, and the jobs waiting to run.
+  size_t copying;
+  std::deque<std::pair<
+      lambda::function<Try<Nothing>()>,
+      Owned<Promise<Try<Nothing>>>>> waiting;
 };
 
 
-Try<Owned<Backend>> CopyBackend::create(const Flags&)
+Try<Owned<Backend>> CopyBackend::create(const Flags& flags)
 {
+  const string trashDir = path::join(
+      paths::getProvisionerDir(flags.work_dir),
+      "trash",
+      COPY_BACKEND);
+
   return Owned<Backend>(new CopyBackend(
-      Owned<CopyBackendProcess>(new CopyBackendProcess())));
+      Owned<CopyBackendProcess>(new CopyBackendProcess(trashDir))));
 }
 
 
@@ -127,6 +201,414 @@ Future<Nothing> CopyBackendProcess::provision(
 }
 
 
+#ifndef __WINDOWS__
+// State shared by the threads copying (the top level entries of) a
+// layer.
+struct CopyState
+{
+  CopyState() : reflink(true) {}
+
+  // The entries of the layer (relative paths) left to be copied.
+  std::mutex mutex;
+  std::deque<string> entries;
+
+  // Whether the files might be cloned (i.e., the filesystem has not
+  // refused to clone a file yet).
+  std::atomic_bool reflink;
+
+  // The copies of the files in the layer with multiple (hard) links,
+  // by their device and inode, so that the links are preserved.
+  //
+  // NOTE: If another link to a file is copied concurrently by a
+  // different thread, the file is copied rather than linked.
+  std::map<std::pair<dev_t, ino_t>, string> links;
+};
+
+
+// Copies the owner, the mode, the extended attributes and the times
+// of a file as given by 'stat'.
+static Try<Nothing> copyMetadata(
+    const string& source,
+    const string& target,
+    const struct stat& s)
+{
+  // NOTE: Changing the owner fails when not running as root, in which
+  // case the file is owned by the current user (as with 'cp -a').
+  if (::lchown(target.c_str(), s.st_uid, s.st_gid) < 0 && errno != EPERM) {
+    return ErrnoError("Failed to change the owner of '" + target + "'");
+  }
+
+  // NOTE: The mode is changed after the owner since changing the
+  // owner clears the set-user-ID and set-group-ID bits.
+  if (!S_ISLNK(s.st_mode) && ::chmod(target.c_str(), s.st_mode & 07777) < 0) {
+    return ErrnoError("Failed to change the mode of '" + target + "'");
+  }
+
+#ifdef __linux__
+  // NOTE: The extended attributes (e.g., file capabilities) are set
+  // after the owner since changing the owner clears capabilities.
+  ssize_t size = ::llistxattr(source.c_str(), nullptr, 0);
+
+  if (size > 0) {
+    vector<char> names(size);
+
+    size = ::llistxattr(source.c_str(), names.data(), names.size());
+    if (size < 0) {
+      return ErrnoError(
+          "Failed to list the extended attributes of '" + source + "'");
+    }
+
+    for (ssize_t i = 0; i < size; i += ::strlen(&names[i]) + 1) {
+      const char* name = &names[i];
+
+      ssize_t length = ::lgetxattr(source.c_str(), name, nullptr, 0);
+      if (length < 0) {
+        return ErrnoError(
+            "Failed to get the extended attribute '" + string(name) +
+            "' of '" + source + "'");
+      }
+
+      vector<char> value(length);
+
+      length = ::lgetxattr(source.c_str(), name, value.data(), value.size());
+      if (length < 0) {
+        return ErrnoError(
+            "Failed to get the extended attribute '" + string(name) +
+            "' of '" + source + "'");
+      }
+
+      // NOTE: Some attributes (e.g., 'trusted.*') can only be set by
+      // root, and some filesystems don't support extended attributes
+      // at all, which 'cp -a' ignores as well.
+      if (::lsetxattr(target.c_str(), name, value.data(), length, 0) < 0 &&
+          errno != EPERM &&
+          errno != ENOTSUP) {
+        return ErrnoError(
+            "Failed to set the extended attribute '" + string(name) +
+            "' of '" + target + "'");
+      }
+    }
+  }
+#endif // __linux__
+
+#ifdef __APPLE__
+  struct timespec times[2] = {s.st_atimespec, s.st_mtimespec};
+#else
+  struct timespec times[2] = {s.st_atim, s.st_mtim};
+#endif // __APPLE__
+
+  if (::utimensat(AT_FDCWD, target.c_str(), times, AT_SYMLINK_NOFOLLOW) < 0) {
+    return ErrnoError("Failed to change the times of '" + target + "'");
+  }
+
+  return Nothing();
+}
+
+
+// Copies the contents of the regular file 'source' into the new file
+// 'target', by cloning it if the filesystem supports it (which shares
+// the data blocks until either file is written to).
+static Try<Nothing> copyContents(
+    const string& source,
+    const string& target,
+    CopyState* state)
+{
+  int in = ::open(source.c_str(), O_RDONLY | O_CLOEXEC);
+  if (in < 0) {
+    return ErrnoError("Failed to open '" + source + "'");
+  }
+
+  int out = ::open(
+      target.c_str(),
+      O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+      S_IRUSR | S_IWUSR);
+
+  if (out < 0) {
+    ErrnoError error("Failed to create '" + target + "'");
+    os::close(in);
+    return error;
+  }
+
+  Try<Nothing> result = Nothing();
+
+#ifdef __linux__
+  if (state->reflink.load()) {
+    if (::ioctl(out, FICLONE, in) == 0) {
+      os::close(in);
+      os::close(out);
+      return Nothing();
+    }
+
+    // Stop trying if the filesystem does not support cloning (or the
+    // layer and the rootfs are on different filesystems).
+    if (errno == EOPNOTSUPP || errno == ENOTTY || errno == EXDEV ||
+        errno == EINVAL || errno == ENOSYS) {
+      state->reflink.store(false);
+    } else {
+      result = ErrnoError("Failed to clone '" + source + "'");
+    }
+  }
+#endif // __linux__
+
+  while (result.isSome()) {
+#ifdef __linux__
+    ssize_t length = ::sendfile(out, in, nullptr, COPY_CHUNK_SIZE);
+#else
+    char buffer[BUFSIZ];
+    ssize_t length = ::read(in, buffer, sizeof(buffer));
+
+    if (length > 0) {
+      Try<Nothing> write = os::write(out, string(buffer, length));
+      if (write.isError()) {
+        result = Error(
+            "Failed to write to '" + target + "': " + write.error());
+        break;
+      }
+    }
+#endif // __linux__
+
+    if (length < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      result = ErrnoError(
+          "Failed to copy '" + source + "' to '" + target + "'");
+    }
+
+    if (length <= 0) {
+      break;
+    }
+  }
+
+  os::close(in);
+  os::close(out);
+
+  return result;
+}
+
+
+// Removes whatever is at 'path' in the rootfs so that the entry of
+// the layer replaces it, unless both are directories (whose contents
+// are merged).
+static Try<Nothing> replace(const string& path, bool directory)
+{
+  struct stat s;
+  if (::lstat(path.c_str(), &s) < 0) {
+    if (errno == ENOENT) {
+      return Nothing();
+    }
+
+    return ErrnoError("Failed to stat '" + path + "'");
+  }
+
+  if (S_ISDIR(s.st_mode)) {
+    if (directory) {
+      return Nothing();
+    }
+
+    return os::rmdir(path);
+  }
+
+  return os::rm(path);
+}
+
+
+// Copies the given entry of the layer (and everything under it) to
+// the same path under the rootfs, preserving the metadata as well as
+// the (hard) links between files, and skipping whiteout files.
+static Try<Nothing> copyEntry(
+    const string& layer,
+    const string& entry,
+    const string& rootfs,
+    CopyState* state)
+{
+  string root = path::join(layer, entry);
+  char* roots[] = {const_cast<char*>(root.c_str()), nullptr};
+
+  FTS* tree = ::fts_open(roots, FTS_NOCHDIR | FTS_PHYSICAL, nullptr);
+  if (tree == nullptr) {
+    return ErrnoError("Failed to open '" + root + "'");
+  }
+
+  Try<Nothing> result = Nothing();
+
+  while (result.isSome()) {
+    errno = 0;
+
+    FTSENT* node = ::fts_read(tree);
+    if (node == nullptr) {
+      if (errno != 0) {
+        result = ErrnoError("Failed to traverse '" + root + "'");
+      }
+
+      break;
+    }
+
+    const string source = node->fts_path;
+    const string target = path::join(
+        rootfs,
+        source.substr(layer.length() + 1));
+
+    switch (node->fts_info) {
+      case FTS_D: {
+        result = replace(target, true);
+
+        // NOTE: The directory is created writable, its mode is copied
+        // once its contents have been copied (see below).
+        if (result.isSome() &&
+            ::mkdir(target.c_str(), S_IRWXU) < 0 &&
+            errno != EEXIST) {
+          result = ErrnoError("Failed to create directory '" + target + "'");
+        }
+
+        break;
+      }
+      case FTS_DP: {
+        result = copyMetadata(source, target, *node->fts_statp);
+        break;
+      }
+      case FTS_F: {
+        // Whiteout files have already been applied to the rootfs.
+        if (strings::startsWith(
+                node->fts_name, docker::spec::WHITEOUT_PREFIX)) {
+          break;
+        }
+
+        result = replace(target, false);
+        if (result.isError()) {
+          break;
+        }
+
+        const struct stat& s = *node->fts_statp;
+
+        if (s.st_nlink > 1) {
+          const std::pair<dev_t, ino_t> inode(s.st_dev, s.st_ino);
+
+          Option<string> link;
+
+          synchronized (state->mutex) {
+            if (state->links.count(inode) > 0) {
+              link = state->links[inode];
+            }
+          }
+
+          if (link.isSome()) {
+            if (::link(link->c_str(), target.c_str()) < 0) {
+              result = ErrnoError(
+                  "Failed to link '" + target + "' to '" + link.get() + "'");
+            }
+
+            break;
+          }
+        }
+
+        result = copyContents(source, target, state);
+        if (result.isSome()) {
+          result = copyMetadata(source, target, s);
+        }
+
+        if (result.isSome() && s.st_nlink > 1) {
+          synchronized (state->mutex) {
+            state->links[std::make_pair(s.st_dev, s.st_ino)] = target;
+          }
+        }
+
+        break;
+      }
+      case FTS_SL:
+      case FTS_SLNONE: {
+        result = replace(target, false);
+        if (result.isError()) {
+          break;
+        }
+
+        char buffer[PATH_MAX];
+        ssize_t length = ::readlink(source.c_str(), buffer, sizeof(buffer));
+        if (length < 0) {
+          result = ErrnoError("Failed to read link '" + source + "'");
+          break;
+        }
+
+        if (::symlink(string(buffer, length).c_str(), target.c_str()) < 0) {
+          result = ErrnoError("Failed to create link '" + target + "'");
+          break;
+        }
+
+        result = copyMetadata(source, target, *node->fts_statp);
+        break;
+      }
+      case FTS_DEFAULT: {
+        // Devices, named pipes and sockets.
+        result = replace(target, false);
+        if (result.isError()) {
+          break;
+        }
+
+        const struct stat& s = *node->fts_statp;
+
+        if (::mknod(target.c_str(), s.st_mode, s.st_rdev) < 0) {
+          result = ErrnoError("Failed to create '" + target + "'");
+          break;
+        }
+
+        result = copyMetadata(source, target, s);
+        break;
+      }
+      case FTS_DNR:
+      case FTS_ERR:
+      case FTS_NS: {
+        result = Error(
+            "Failed to read '" + source + "': " +
+            os::strerror(node->fts_errno));
+        break;
+      }
+      default:
+        break;
+    }
+  }
+
+  ::fts_close(tree);
+
+  return result;
+}
+
+
+// Copies the entries of the layer in the queue of 'state' until it is
+// empty. This is run by multiple threads concurrently.
+static Try<Nothing> copyEntries(
+    const string& layer,
+    const string& rootfs,
+    const std::shared_ptr<CopyState>& state)
+{
+  while (true) {
+    Option<string> entry;
+
+    synchronized (state->mutex) {
+      if (!state->entries.empty()) {
+        entry = state->entries.front();
+        state->entries.pop_front();
+      }
+    }
+
+    if (entry.isNone()) {
+      return Nothing();
+    }
+
+    Try<Nothing> copy = copyEntry(layer, entry.get(), rootfs, state.get());
+    if (copy.isError()) {
+      // Stop the other threads as well.
+      synchronized (state->mutex) {
+        state->entries.clear();
+      }
+
+      return copy;
+    }
+  }
+}
+#endif // __WINDOWS__
+
+
 Future<Nothing> CopyBackendProcess::_provision(
     string layer,
     const string& rootfs)
@@ -218,49 +700,89 @@ Future<Nothing> CopyBackendProcess::_provision(
   VLOG(1) << "Copying layer path '" << layer << "' to rootfs '" << rootfs
           << "'";
 
-#if defined(__APPLE__) || defined(__FreeBSD__)
-  if (!strings::endsWith(layer, "/")) {
-    layer += "/";
+  // The layer is copied by multiple threads, which take the entries
+  // to copy from a queue. To balance the work, the entries in the top
+  // level directories of the layer (e.g., '/usr/lib', '/usr/share')
+  // are queued rather than the directories themselves.
+  std::shared_ptr<CopyState> state(new CopyState());
+  vector<string> directories;
+
+  Try<list<string>> entries = os::ls(layer);
+  if (entries.isError()) {
+    return Failure(
+        "Failed to list layer '" + layer + "': " + entries.error());
   }
 
-  // BSD cp doesn't support -T flag, but supports source trailing
-  // slash so we only copy the content but not the folder.
-  vector<string> args{"cp", "-a", layer, rootfs};
-#else
-  vector<string> args{"cp", "-aT", layer, rootfs};
-#endif // __APPLE__ || __FreeBSD__
+  foreach (const string& entry, entries.get()) {
+    struct stat s;
+    if (::lstat(path::join(layer, entry).c_str(), &s) < 0) {
+      return Failure(ErrnoError("Failed to stat '" + entry + "'"));
+    }
 
-  Try<Subprocess> s = subprocess(
-      "cp",
-      args,
-      Subprocess::PATH("/dev/null"),
-      Subprocess::PATH("/dev/null"),
-      Subprocess::PIPE());
+    if (!S_ISDIR(s.st_mode)) {
+      state->entries.push_back(entry);
+      continue;
+    }
 
-  if (s.isError()) {
-    return Failure("Failed to create 'cp' subprocess: " + s.error());
+    const string directory = path::join(rootfs, entry);
+
+    Try<Nothing> clear = replace(directory, true);
+    if (clear.isError()) {
+      return Failure(clear.error());
+    }
+
+    if (::mkdir(directory.c_str(), S_IRWXU) < 0 && errno != EEXIST) {
+      return Failure(
+          ErrnoError("Failed to create directory '" + directory + "'"));
+    }
+
+    Try<list<string>> _entries = os::ls(path::join(layer, entry));
+    if (_entries.isError()) {
+      return Failure(
+          "Failed to list '" + entry + "' in layer '" + layer + "': " +
+          _entries.error());
+    }
+
+    foreach (const string& _entry, _entries.get()) {
+      state->entries.push_back(path::join(entry, _entry));
+    }
+
+    directories.push_back(entry);
   }
 
-  Subprocess cp = s.get();
+  // The metadata of the directories is copied last, since copying
+  // their entries changes their times.
+  directories.push_back(".");
 
-  return cp.status()
-    .then([=](const Option<int>& status) -> Future<Nothing> {
-      if (status.isNone()) {
-        return Failure("Failed to reap subprocess to copy image");
-      } else if (status.get() != 0) {
-        return io::read(cp.err().get())
-          .then([](const string& err) -> Future<Nothing> {
-            return Failure("Failed to copy layer: " + err);
-          });
+  list<Future<Try<Nothing>>> futures;
+
+  for (size_t i = 0; i < std::min(state->entries.size(), COPY_THREADS); i++) {
+    futures.push_back(copy(lambda::bind(&copyEntries, layer, rootfs, state)));
+  }
+
+  return collect(futures)
+    .then([=](const list<Try<Nothing>>& copies) -> Future<Nothing> {
+      foreach (const Try<Nothing>& copy, copies) {
+        if (copy.isError()) {
+          return Failure(
+              "Failed to copy layer '" + layer + "': " + copy.error());
+        }
       }
 
-      // Remove the whiteout files from rootfs.
-      foreach (const string whiteout, whiteouts) {
-        Try<Nothing> rm = os::rm(path::join(rootfs, whiteout));
-        if (rm.isError()) {
+      foreach (const string& directory, directories) {
+        const string source = path::join(layer, directory);
+
+        struct stat s;
+        if (::lstat(source.c_str(), &s) < 0) {
+          return Failure(ErrnoError("Failed to stat '" + source + "'"));
+        }
+
+        Try<Nothing> metadata =
+          copyMetadata(source, path::join(rootfs, directory), s);
+
+        if (metadata.isError()) {
           return Failure(
-              "Failed to remove whiteout file '" +
-              whiteout + "': " + rm.error());
+              "Failed to copy layer '" + layer + "': " + metadata.error());
         }
       }
 
@@ -273,9 +795,107 @@ Future<Nothing> CopyBackendProcess::_provision(
 }
 
 
+Future<Try<Nothing>> CopyBackendProcess::copy(
+    const lambda::function<Try<Nothing>()>& job)
+{
+  if (copying < COPY_THREADS) {
+    return _copy(job);
+  }
+
+  Owned<Promise<Try<Nothing>>> promise(new Promise<Try<Nothing>>());
+  waiting.push_back(std::make_pair(job, promise));
+
+  return promise->future();
+}
+
+
+Future<Try<Nothing>> CopyBackendProcess::_copy(
+    const lambda::function<Try<Nothing>()>& job)
+{
+  copying++;
+
+  return async(job)
+    .onAny(defer(self(), &Self::__copy));
+}
+
+
+void CopyBackendProcess::__copy()
+{
+  CHECK_GT(copying, 0u);
+  copying--;
+
+  if (!waiting.empty()) {
+    std::pair<
+        lambda::function<Try<Nothing>()>,
+        Owned<Promise<Try<Nothing>>>> next = waiting.front();
+
+    waiting.pop_front();
+
+    next.second->associate(_copy(next.first));
+  }
+}
+
+
 Future<bool> CopyBackendProcess::destroy(const string& rootfs)
 {
-  vector<string> argv{"rm", "-rf", rootfs};
+  // Removing a rootfs takes time proportional to its size, so it is
+  // moved to the trash (which is instant) and removed in the
+  // background instead.
+  const string trash = path::join(trashDir, UUID::random().toString());
+
+  Try<Nothing> mkdir = os::mkdir(trashDir);
+  if (mkdir.isError()) {
+    LOG(WARNING) << "Failed to create trash directory '" << trashDir
+                 << "': " << mkdir.error();
+  } else {
+    Try<Nothing> rename = os::rename(rootfs, trash);
+    if (rename.isSome()) {
+      remove(trash)
+        .onFailed([trash](const string& failure) {
+          LOG(ERROR) << "Failed to remove '" << trash << "': " << failure;
+        });
+
+      return true;
+    }
+
+    LOG(WARNING) << "Failed to move rootfs '" << rootfs << "' to the "
+                 << "trash, removing it in place: " << rename.error();
+  }
+
+  return remove(rootfs)
+    .then([]() { return true; });
+}
+
+
+void CopyBackendProcess::initialize()
+{
+  // Remove the rootfses that were left in the trash, e.g., if the
+  // agent was restarted while removing them.
+  if (!os::exists(trashDir)) {
+    return;
+  }
+
+  Try<list<string>> entries = os::ls(trashDir);
+  if (entries.isError()) {
+    LOG(WARNING) << "Failed to list trash directory '" << trashDir << "': "
+                 << entries.error();
+    return;
+  }
+
+  foreach (const string& entry, entries.get()) {
+    const string trash = path::join(trashDir, entry);
+
+    remove(trash)
+      .onFailed([trash](const string& failure) {
+        LOG(ERROR) << "Failed to remove '" << trash << "': " << failure;
+      });
+  }
+}
+
+
+Future<Nothing> CopyBackendProcess::remove(const string& path)
+{
+  vector<string> argv{"rm", "-rf", path};
 
   Try<Subprocess> s = subprocess(
       "rm",
@@ -289,7 +909,7 @@ Future<bool> CopyBackendProcess::destroy(const string& rootfs)
   }
 
   return s.get().status()
-    .then([](const Option<int>& status) -> Future<bool> {
+    .then([](const Option<int>& status) -> Future<Nothing> {
       if (status.isNone()) {
         return Failure("Failed to reap subprocess to destroy rootfs");
       } else if (status.get() != 0) {
@@ -297,7 +917,7 @@ Future<bool> CopyBackendProcess::destroy(const string& rootfs)
                        WSTRINGIFY(status.get()));
       }
 
-      return true;
+      return Nothing();
     });
 }
 
@@ -28,6 +28,9 @@ class CopyBackendProcess;
 
 
 // The backend implementation that copies the layers to the target.
+// The files are copied in-process by multiple threads, and cloned
+// (i.e., reflinked) rather than copied if the filesystem supports it
+// (e.g., btrfs, XFS). Destroyed rootfses are removed in the background.
 // NOTE: Using this backend currently has a few implications:
 // 1) The disk space used by the provisioned rootfs is not counted
 //    towards either the usage by the executor/task or the store
@@ -40,7 +43,7 @@ class CopyBackend : public Backend
 public:
   virtual ~CopyBackend();
 
-  // CopyBackend doesn't use any flag.
+  // CopyBackend only uses the work directory (for its trash).
   static Try<process::Owned<Backend>> create(const Flags&);
 
   // Provisions a rootfs given the layers' paths and target rootfs
@@ -67,6 +67,8 @@ public:
       const spec::ImageReference& reference,
       bool cached);
 
+  Future<Images> images();
+
   // TODO(chenlily): Implement removal of unreferenced images.
 
 private:
@@ -134,6 +136,12 @@ Future<Option<Image>> MetadataManager::get(
 }
 
 
+Future<Images> MetadataManager::images()
+{
+  return dispatch(process.get(), &MetadataManagerProcess::images);
+}
+
+
 Future<Image> MetadataManagerProcess::put(
     const spec::ImageReference& reference,
     const vector<string>& layerIds)
@@ -180,6 +188,18 @@ Future<Option<Image>> MetadataManagerProcess::get(
 }
 
 
+Future<Images> MetadataManagerProcess::images()
+{
+  Images images;
+
+  foreachvalue (const Image& image, storedImages) {
+    images.add_images()->CopyFrom(image);
+  }
+
+  return images;
+}
+
+
 Try<Nothing> MetadataManagerProcess::persist()
 {
   Images images;
@@ -51,8 +51,8 @@ class MetadataManagerProcess;
  * provisioner that are stored on disk. It keeps track of the layers
  * that Docker images are composed of and recovers Image objects
  * upon initialization by checking for dependent layers stored on disk.
- * Currently, image layers are stored indefinitely, with no garbage
- * collection of unreferenced image layers.
+ * The layers that are no longer referenced by any of its images (nor
+ * by a container) are removed by the store, see 'Store::prune'.
  */
 class MetadataManager
 {
@@ -92,6 +92,12 @@ public:
       const ::docker::spec::ImageReference& reference,
       bool cached);
 
+  /**
+   * Retrieve all the Images stored in memory, e.g., to find the
+   * layers that are referenced by any of them.
+   */
+  process::Future<Images> images();
+
 private:
   explicit MetadataManager(process::Owned<MetadataManagerProcess> process);
 
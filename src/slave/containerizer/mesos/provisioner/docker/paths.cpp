@@ -19,6 +19,7 @@
 #include "slave/containerizer/mesos/provisioner/docker/paths.hpp"
 
 #include <stout/path.hpp>
+#include <stout/uuid.hpp>
 
 using std::string;
 
@@ -40,9 +41,15 @@ string getStagingTempDir(const string& storeDir)
 }
 
 
+string getImageLayersPath(const string& storeDir)
+{
+  return path::join(storeDir, "layers");
+}
+
+
 string getImageLayerPath(const string& storeDir, const string& layerId)
 {
-  return path::join(storeDir, "layers", layerId);
+  return path::join(getImageLayersPath(storeDir), layerId);
 }
 
 
@@ -58,6 +65,12 @@ string getImageLayerManifestPath(const string& storeDir, const string& layerId)
 }
 
 
+string getImageLayerBlobSumPath(const string& layerPath)
+{
+  return path::join(layerPath, "blobsum");
+}
+
+
 string getImageLayerRootfsPath(const string& layerPath, const string& backend)
 {
   if (backend == OVERLAY_BACKEND) {
@@ -100,6 +113,22 @@ string getStoredImagesPath(const string& storeDir)
   return path::join(storeDir, "storedImages");
 }
 
+
+string getGcDir(const string& storeDir)
+{
+  return path::join(storeDir, "gc");
+}
+
+
+string getGcLayerPath(const string& storeDir, const string& layerId)
+{
+  // NOTE: The layer might be pulled and removed again before the
+  // previous removal completes, hence the UUID.
+  return path::join(
+      getGcDir(storeDir),
+      layerId + "." + UUID::random().toString());
+}
+
 } // namespace paths {
 } // namespace docker {
 } // namespace slave {
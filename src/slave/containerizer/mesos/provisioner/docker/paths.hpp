@@ -33,13 +33,17 @@ namespace paths {
  *           |-- <layer_id>
  *               |-- rootfs
  *               |-- json(manifest)
+ *               |-- blobsum
  *               |-- VERSION
  *    |--layers
  *       |--<layer_id>
  *           |-- rootfs
  *           |-- json(manifest)
+ *           |-- blobsum (digest of the layer tarball, if pulled)
  *           |-- VERSION
  *    |--storedImages (file holding on cached images)
+ *    |--gc (layers being removed)
+ *       |--<layer_id>.<uuid>
  */
 
 // TODO(gilbert): Clean up any unused method after refactoring.
@@ -49,6 +53,9 @@ std::string getStagingDir(const std::string& storeDir);
 std::string getStagingTempDir(const std::string& storeDir);
 
 
+std::string getImageLayersPath(const std::string& storeDir);
+
+
 std::string getImageLayerPath(
     const std::string& storeDir,
     const std::string& layerId);
@@ -63,6 +70,10 @@ std::string getImageLayerManifestPath(
     const std::string& layerId);
 
 
+std::string getImageLayerBlobSumPath(
+    const std::string& layerPath);
+
+
 std::string getImageLayerRootfsPath(
     const std::string& layerPath,
     const std::string& backend);
@@ -90,6 +101,14 @@ std::string getImageArchiveTarPath(
 
 std::string getStoredImagesPath(const std::string& storeDir);
 
+
+std::string getGcDir(const std::string& storeDir);
+
+
+std::string getGcLayerPath(
+    const std::string& storeDir,
+    const std::string& layerId);
+
 } // namespace paths {
 } // namespace docker {
 } // namespace slave {
@@ -14,19 +14,31 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <array>
+#include <memory>
+
 #include <glog/logging.h>
 
 #include <process/collect.hpp>
 #include <process/defer.hpp>
 #include <process/dispatch.hpp>
 #include <process/http.hpp>
+#include <process/io.hpp>
+#include <process/subprocess.hpp>
+
+#include <stout/strings.hpp>
 
+#include <stout/os/close.hpp>
 #include <stout/os/exists.hpp>
+#include <stout/os/ls.hpp>
+#include <stout/os/fcntl.hpp>
 #include <stout/os/mkdir.hpp>
-#include <stout/os/rm.hpp>
+#include <stout/os/pipe.hpp>
+#include <stout/os/read.hpp>
+#include <stout/os/rmdir.hpp>
 #include <stout/os/write.hpp>
 
-#include "common/command_utils.hpp"
+#include "common/status_utils.hpp"
 
 #include "uri/schemes/docker.hpp"
 
@@ -37,6 +49,7 @@ namespace http = process::http;
 namespace spec = docker::spec;
 
 using std::list;
+using std::shared_ptr;
 using std::string;
 using std::vector;
 
@@ -45,10 +58,12 @@ using process::Future;
 using process::Owned;
 using process::Process;
 using process::Shared;
+using process::Subprocess;
 
 using process::defer;
 using process::dispatch;
 using process::spawn;
+using process::subprocess;
 using process::wait;
 
 namespace mesos {
@@ -75,18 +90,27 @@ private:
       const string& directory,
       const string& backend);
 
-  Future<vector<string>> __pull(
-    const spec::ImageReference& reference,
-    const string& directory,
-    const spec::v2::ImageManifest& manifest,
-    const hashset<string>& blobSums,
-    const string& backend);
+  Future<Nothing> fetchBlob(
+      const spec::ImageReference& reference,
+      const string& directory,
+      const string& blobSum,
+      const vector<string>& layerIds,
+      const string& backend);
 
-  Future<hashset<string>> fetchBlobs(
-    const spec::ImageReference& reference,
-    const string& directory,
-    const spec::v2::ImageManifest& manifest,
-    const string& backend);
+  Future<Nothing> _fetchBlob(
+      const spec::ImageReference& reference,
+      const string& directory,
+      const string& blobSum,
+      const vector<string>& layerIds,
+      const string& backend);
+
+  // Returns the rootfs (for the given backend) of a layer in the
+  // store that was extracted from the blob with the given digest.
+  Option<string> getStoredLayer(const string& blobSum, const string& backend);
+
+  Try<URI> getBlobUri(
+      const spec::ImageReference& reference,
+      const string& blobSum);
 
   RegistryPullerProcess(const RegistryPullerProcess&) = delete;
   RegistryPullerProcess& operator=(const RegistryPullerProcess&) = delete;
@@ -98,6 +122,13 @@ private:
   const http::URL defaultRegistryUrl;
 
   Shared<uri::Fetcher> fetcher;
+
+  // The layers in the store by the digest of the blob that they were
+  // extracted from, which is built from the store when first needed.
+  // Layers with different ids can be extracted from the same blob
+  // (e.g., the empty layer that is part of most images), in which
+  // case the blob does not need to be fetched (nor extracted) again.
+  Option<hashmap<string, string>> storedLayers;
 };
 
 
@@ -277,24 +308,6 @@ Future<vector<string>> RegistryPullerProcess::_pull(
     return Failure("'fsLayers' and 'history' have different size in manifest");
   }
 
-  return fetchBlobs(reference, directory, manifest.get(), backend)
-    .then(defer(self(),
-                &Self::__pull,
-                reference,
-                directory,
-                manifest.get(),
-                lambda::_1,
-                backend));
-}
-
-
-Future<vector<string>> RegistryPullerProcess::__pull(
-    const spec::ImageReference& reference,
-    const string& directory,
-    const spec::v2::ImageManifest& manifest,
-    const hashset<string>& blobSums,
-    const string& backend)
-{
   // Docker reads the layer ids from the disk:
   // https://github.com/docker/docker/blob/v1.13.0/layer/filestore.go#L310
   //
@@ -315,17 +328,23 @@ Future<vector<string>> RegistryPullerProcess::__pull(
   // sure ids are unique.
   hashset<string> uniqueIds;
   vector<string> layerIds;
-  list<Future<Nothing>> futures;
+
+  // The layers that are not in the store yet, by the blob that they
+  // are extracted from.
+  //
+  // NOTE: There might exist duplicated blob sums in 'fsLayers'. We
+  // just need to fetch one of them.
+  hashmap<string, vector<string>> blobs;
 
   // The order of `fslayers` should be [child, parent, ...].
   //
   // The content in the parent will be overwritten by the child if
   // there is a conflict. Therefore, backends expect the following
   // order: [parent, child, ...].
-  for (int i = 0; i < manifest.fslayers_size(); i++) {
-    CHECK(manifest.history(i).has_v1());
-    const spec::v1::ImageManifest& v1 = manifest.history(i).v1();
-    const string& blobSum = manifest.fslayers(i).blobsum();
+  for (int i = 0; i < manifest->fslayers_size(); i++) {
+    CHECK(manifest->history(i).has_v1());
+    const spec::v1::ImageManifest& v1 = manifest->history(i).v1();
+    const string& blobSum = manifest->fslayers(i).blobsum();
 
     // Skip duplicate layer ids.
     if (uniqueIds.contains(v1.id())) {
@@ -344,13 +363,9 @@ Future<vector<string>> RegistryPullerProcess::__pull(
     }
 
     const string layerPath = path::join(directory, v1.id());
-    const string tar = path::join(directory, blobSum);
     const string rootfs = paths::getImageLayerRootfsPath(layerPath, backend);
     const string json = paths::getImageLayerManifestPath(layerPath);
 
-    VLOG(1) << "Extracting layer tar ball '" << tar
-            << " to rootfs '" << rootfs << "'";
-
     // NOTE: This will create 'layerPath' as well.
     Try<Nothing> mkdir = os::mkdir(rootfs, true);
     if (mkdir.isError()) {
@@ -366,107 +381,542 @@ Future<vector<string>> RegistryPullerProcess::__pull(
           v1.id() + "': " + write.error());
     }
 
-    futures.push_back(command::untar(Path(tar), Path(rootfs)));
+    write = os::write(paths::getImageLayerBlobSumPath(layerPath), blobSum);
+    if (write.isError()) {
+      return Failure(
+          "Failed to save the blob sum for layer '" +
+          v1.id() + "': " + write.error());
+    }
+
+    blobs[blobSum].push_back(v1.id());
+  }
+
+  // Each blob is extracted as soon as it has been fetched (rather
+  // than once all the blobs of the image have been fetched), so that
+  // the extraction of the layers overlaps with the fetching.
+  list<Future<Nothing>> futures;
+
+  foreachpair (const string& blobSum, const vector<string>& ids, blobs) {
+    futures.push_back(fetchBlob(reference, directory, blobSum, ids, backend));
   }
 
   return collect(futures)
-    .then([=]() -> Future<vector<string>> {
-      // Remove the tarballs after the extraction.
-      foreach (const string& blobSum, blobSums) {
-        const string tar = path::join(directory, blobSum);
+    .then([layerIds]() { return layerIds; });
+}
 
-        Try<Nothing> rm = os::rm(tar);
-        if (rm.isError()) {
-          return Failure(
-              "Failed to remove '" + tar + "' "
-              "after extraction: " + rm.error());
-        }
+
+namespace {
+
+// The state of the extraction of a blob that is being streamed, see
+// 'extract'.
+struct Extraction
+{
+  ~Extraction()
+  {
+    foreach (int in, ins) {
+      os::close(in);
+    }
+  }
+
+  // The leading bytes of the blob, which are held back until its
+  // compression can be determined.
+  string head;
+
+  // The write ends of the stdin of the subprocesses that the blob is
+  // streamed to (i.e., 'tar' and, if the digest is verified,
+  // 'sha256sum') and their stdout, in the same order.
+  vector<int> ins;
+  list<Future<string>> outputs;
+};
+
+} // namespace {
+
+
+// The number of leading bytes of a blob that determine its compression.
+static const size_t MAGIC_SIZE = 6;
+
+
+// Launches the command 'argv' with its stdin fed through a pipe,
+// whose write end is kept in the extraction along with the stdout of
+// the command once it exits successfully.
+static Try<Nothing> launch(Extraction* extraction, const vector<string>& argv)
+{
+  Try<std::array<int, 2>> pipe = os::pipe();
+  if (pipe.isError()) {
+    return Error("Failed to create pipe: " + pipe.error());
+  }
+
+  // NOTE: The read end is closed once the subprocess is launched.
+  Try<Nothing> cloexec = os::cloexec(pipe->at(1));
+  if (cloexec.isError()) {
+    os::close(pipe->at(0));
+    os::close(pipe->at(1));
+    return Error("Failed to set FD_CLOEXEC: " + cloexec.error());
+  }
+
+  Try<Subprocess> s = subprocess(
+      argv.front(),
+      argv,
+      Subprocess::FD(pipe->at(0), Subprocess::IO::OWNED),
+      Subprocess::PIPE(),
+      Subprocess::PIPE());
+
+  if (s.isError()) {
+    os::close(pipe->at(1));
+    return Error(
+        "Failed to create '" + argv.front() + "' subprocess: " + s.error());
+  }
+
+  const string command = argv.front();
+
+  extraction->ins.push_back(pipe->at(1));
+
+  // NOTE: The output is read as it is written so that the subprocess
+  // never blocks on a full pipe.
+  extraction->outputs.push_back(process::await(
+      s->status(),
+      process::io::read(s->out().get()),
+      process::io::read(s->err().get()))
+    .then([command](const std::tuple<
+        Future<Option<int>>,
+        Future<string>,
+        Future<string>>& t) -> Future<string> {
+      const Future<Option<int>>& status = std::get<0>(t);
+      if (!status.isReady() || status->isNone()) {
+        return Failure("Failed to reap the '" + command + "' subprocess");
+      }
+
+      if (status->get() != 0) {
+        const Future<string>& error = std::get<2>(t);
+        return Failure(
+            "'" + command + "' " + WSTRINGIFY(status->get()) +
+            (error.isReady() ? ": " + error.get() : ""));
       }
 
-      return layerIds;
+      const Future<string>& output = std::get<1>(t);
+      if (!output.isReady()) {
+        return Failure("Failed to read stdout from '" + command + "'");
+      }
+
+      return output.get();
+    }));
+
+  return Nothing();
+}
+
+
+// Launches the subprocesses that the tar ball is streamed to, once
+// its compression can be determined from its leading bytes.
+static Try<Nothing> start(
+    Extraction* extraction,
+    const string& rootfs,
+    const string& blobSum)
+{
+  vector<string> argv = {
+    "tar",
+    "-x",        // Extract/unarchive.
+    "-f", "-",   // Read the archive from stdin.
+    "-C", rootfs
+  };
+
+  // NOTE: Unlike for a file, 'tar' does not detect the compression of
+  // an archive read from stdin.
+  const string& head = extraction->head;
+
+  if (strings::startsWith(head, "\x1f\x8b")) {
+    argv.push_back("-z");
+  } else if (strings::startsWith(head, "BZh")) {
+    argv.push_back("-j");
+  } else if (strings::startsWith(head, "\xfd" "7zXZ")) {
+    argv.push_back("-J");
+  }
+
+  Try<Nothing> untar = launch(extraction, argv);
+  if (untar.isError()) {
+    return untar;
+  }
+
+  // Registries use sha256 digests, other (unknown) algorithms are not
+  // verified.
+  if (strings::startsWith(blobSum, "sha256:")) {
+#ifdef __linux__
+    argv = {"sha256sum"};
+#else
+    argv = {"shasum", "-a", "256"};
+#endif // __linux__
+
+    Try<Nothing> sha256 = launch(extraction, argv);
+    if (sha256.isError()) {
+      return sha256;
+    }
+  }
+
+  return Nothing();
+}
+
+
+// Writes the bytes to the stdin of all the subprocesses.
+static Future<Nothing> write(Extraction* extraction, const string& data)
+{
+  list<Future<Nothing>> futures;
+
+  foreach (int in, extraction->ins) {
+    futures.push_back(process::io::write(in, data));
+  }
+
+  return collect(futures)
+    .then([]() { return Nothing(); });
+}
+
+
+// Closes the stdin of all the subprocesses so that they exit once they
+// have processed the tar ball.
+static void close(Extraction* extraction)
+{
+  foreach (int in, extraction->ins) {
+    os::close(in);
+  }
+
+  extraction->ins.clear();
+}
+
+
+// Streams the next bytes of a blob to the subprocesses, which are
+// launched once the compression of the blob can be determined.
+static Future<Nothing> consume(
+    Extraction* extraction,
+    const string& rootfs,
+    const string& blobSum,
+    const string& data)
+{
+  if (!extraction->outputs.empty()) {
+    return write(extraction, data);
+  }
+
+  extraction->head += data;
+
+  // NOTE: Once the blob has been streamed (i.e., 'data' is empty), the
+  // subprocesses are launched even if it is shorter than that.
+  if (!data.empty() && extraction->head.size() < MAGIC_SIZE) {
+    return Nothing();
+  }
+
+  Try<Nothing> started = start(extraction, rootfs, blobSum);
+  if (started.isError()) {
+    return Failure(started.error());
+  }
+
+  return write(extraction, extraction->head);
+}
+
+
+// Extracts the blob at 'blobUri' to 'rootfs' while it is being
+// fetched: the bytes are streamed to 'tar' (which decompresses and
+// extracts them) as they arrive from the fetcher, rather than once the
+// whole blob is on disk. The digest of the blob is verified on the fly
+// as well.
+static Future<Nothing> extract(
+    const Shared<uri::Fetcher>& fetcher,
+    const URI& blobUri,
+    const string& rootfs,
+    const string& blobSum)
+{
+  shared_ptr<Extraction> extraction(new Extraction());
+
+  return fetcher->stream(
+      blobUri,
+      [=](const string& data) {
+        return consume(extraction.get(), rootfs, blobSum, data);
+      })
+    .then([=]() -> Future<Nothing> {
+      if (extraction->outputs.empty()) {
+        return consume(extraction.get(), rootfs, blobSum, "");
+      }
+
+      return Nothing();
+    })
+    .then([=]() -> Future<Nothing> {
+      close(extraction.get());
+
+      return collect(extraction->outputs)
+        .then([=](const list<string>& outputs) -> Future<Nothing> {
+          // NOTE: The output of 'sha256sum' follows that of 'tar'.
+          if (outputs.size() < 2) {
+            return Nothing();
+          }
+
+          vector<string> tokens = strings::tokenize(outputs.back(), " ");
+          if (tokens.empty()) {
+            return Failure(
+                "Failed to parse the digest '" + outputs.back() + "'");
+          }
+
+          if ("sha256:" + tokens[0] != blobSum) {
+            return Failure(
+                "Unexpected digest 'sha256:" + tokens[0] + "' of blob '" +
+                blobSum + "'");
+          }
+
+          return Nothing();
+        });
+    })
+    .repair([=](const Future<Nothing>& future) -> Future<Nothing> {
+      // The subprocesses exit once their stdin is closed. If one of
+      // them failed (e.g., on a corrupted blob), which is likely why
+      // streaming to it failed, its failure is reported instead.
+      close(extraction.get());
+
+      const string failure =
+        future.isFailed() ? future.failure() : "discarded";
+
+      return collect(extraction->outputs)
+        .then([failure]() -> Future<Nothing> { return Failure(failure); });
+    });
+}
+
+
+// Populates the directory 'target' with the contents of the directory
+// 'source'. On Linux the files are hard linked rather than copied,
+// which is safe since the layers in the store are never modified.
+static Future<Nothing> copy(const string& source, const string& target)
+{
+#ifdef __linux__
+  vector<string> args{"cp", "-alT", source, target};
+#else
+  // BSD cp doesn't support -T flag, but supports source trailing
+  // slash so we only copy the content but not the folder.
+  vector<string> args{"cp", "-a", source + "/", target};
+#endif // __linux__
+
+  Try<Subprocess> s = subprocess(
+      "cp",
+      args,
+      Subprocess::PATH("/dev/null"),
+      Subprocess::PATH("/dev/null"),
+      Subprocess::PIPE());
+
+  if (s.isError()) {
+    return Failure("Failed to create 'cp' subprocess: " + s.error());
+  }
+
+  Subprocess cp = s.get();
+
+  return cp.status()
+    .then([cp](const Option<int>& status) -> Future<Nothing> {
+      if (status.isNone()) {
+        return Failure("Failed to reap subprocess to copy layer");
+      } else if (status.get() != 0) {
+        return process::io::read(cp.err().get())
+          .then([](const string& err) -> Future<Nothing> {
+            return Failure("Failed to copy layer: " + err);
+          });
+      }
+
+      return Nothing();
     });
 }
 
 
-Future<hashset<string>> RegistryPullerProcess::fetchBlobs(
+Future<Nothing> RegistryPullerProcess::fetchBlob(
     const spec::ImageReference& reference,
     const string& directory,
-    const spec::v2::ImageManifest& manifest,
+    const string& blobSum,
+    const vector<string>& layerIds,
     const string& backend)
 {
-  // First, find all the blobs that need to be fetched.
-  //
-  // NOTE: There might exist duplicated blob sums in 'fsLayers'. We
-  // just need to fetch one of them.
-  hashset<string> blobSums;
+  Option<string> stored = getStoredLayer(blobSum, backend);
+  if (stored.isNone()) {
+    return _fetchBlob(reference, directory, blobSum, layerIds, backend);
+  }
 
-  for (int i = 0; i < manifest.fslayers_size(); i++) {
-    CHECK(manifest.history(i).has_v1());
-    const spec::v1::ImageManifest& v1 = manifest.history(i).v1();
+  VLOG(1) << "Copying stored layer '" << stored.get() << "' for blob '"
+          << blobSum << "' of image '" << reference << "'";
 
-    // Check if the layer is in the store or not. If yes, skip the
-    // unnecessary fetching.
-    if (os::exists(
-        paths::getImageLayerRootfsPath(storeDir, v1.id(), backend))) {
-      continue;
-    }
+  list<Future<Nothing>> futures;
+
+  foreach (const string& layerId, layerIds) {
+    futures.push_back(copy(
+        stored.get(),
+        paths::getImageLayerRootfsPath(
+            path::join(directory, layerId),
+            backend)));
+  }
+
+  return collect(futures)
+    .then([]() { return Nothing(); })
+    .repair(defer(self(), [=](const Future<Nothing>& future)
+        -> Future<Nothing> {
+      LOG(WARNING) << "Failed to copy stored layer '" << stored.get()
+                   << "' for blob '" << blobSum << "', fetching it instead: "
+                   << future.failure();
+
+      // Start over from empty rootfs directories.
+      foreach (const string& layerId, layerIds) {
+        const string rootfs = paths::getImageLayerRootfsPath(
+            path::join(directory, layerId),
+            backend);
+
+        Try<Nothing> rmdir = os::rmdir(rootfs);
+        if (rmdir.isError()) {
+          return Failure(
+              "Failed to remove rootfs directory '" + rootfs + "': " +
+              rmdir.error());
+        }
+
+        Try<Nothing> mkdir = os::mkdir(rootfs);
+        if (mkdir.isError()) {
+          return Failure(
+              "Failed to create rootfs directory '" + rootfs + "': " +
+              mkdir.error());
+        }
+      }
 
-    const string& blobSum = manifest.fslayers(i).blobsum();
+      return _fetchBlob(reference, directory, blobSum, layerIds, backend);
+    }));
+}
 
-    VLOG(1) << "Fetching blob '" << blobSum << "' for layer '"
-            << v1.id() << "' of image '" << reference << "'";
 
-    blobSums.insert(blobSum);
+Future<Nothing> RegistryPullerProcess::_fetchBlob(
+    const spec::ImageReference& reference,
+    const string& directory,
+    const string& blobSum,
+    const vector<string>& layerIds,
+    const string& backend)
+{
+  Try<URI> blobUri = getBlobUri(reference, blobSum);
+  if (blobUri.isError()) {
+    return Failure(blobUri.error());
   }
 
-  // Now, actually fetch the blobs.
-  list<Future<Nothing>> futures;
+  CHECK(!layerIds.empty());
 
-  foreach (const string& blobSum, blobSums) {
-    URI blobUri;
+  const string rootfs = paths::getImageLayerRootfsPath(
+      path::join(directory, layerIds.front()),
+      backend);
+
+  VLOG(1) << "Fetching and extracting blob '" << blobSum << "' for layer '"
+          << layerIds.front() << "' of image '" << reference
+          << "' to rootfs '" << rootfs << "'";
 
-    if (reference.has_registry()) {
-      Result<int> port = spec::getRegistryPort(reference.registry());
-      if (port.isError()) {
-        return Failure("Failed to get registry port: " + port.error());
+  return extract(fetcher, blobUri.get(), rootfs, blobSum)
+    .then(defer(self(), [=]() -> Future<Nothing> {
+      // NOTE: The layer is moved to the store once the whole image is
+      // pulled, see 'getStoredLayer' for the validation of the entry.
+      if (storedLayers.isSome()) {
+        storedLayers->put(blobSum, layerIds.front());
       }
 
-      Try<string> scheme = spec::getRegistryScheme(reference.registry());
-      if (scheme.isError()) {
-        return Failure("Failed to get registry scheme: " + scheme.error());
+      // The other layers extracted from the same blob are copied.
+      list<Future<Nothing>> futures;
+
+      for (size_t i = 1; i < layerIds.size(); i++) {
+        futures.push_back(copy(
+            rootfs,
+            paths::getImageLayerRootfsPath(
+                path::join(directory, layerIds[i]),
+                backend)));
       }
 
-      // If users want to use the registry specified in '--docker_image',
-      // an URL scheme must be specified in '--docker_registry', because
-      // there is no scheme allowed in docker image name.
-      blobUri = uri::docker::blob(
-          reference.repository(),
-          blobSum,
-          spec::getRegistryHost(reference.registry()),
-          scheme.get(),
-          port.isSome() ? port.get() : Option<int>());
-    } else {
-      const string registry = defaultRegistryUrl.domain.isSome()
-        ? defaultRegistryUrl.domain.get()
-        : stringify(defaultRegistryUrl.ip.get());
-
-      const Option<int> port = defaultRegistryUrl.port.isSome()
-        ? static_cast<int>(defaultRegistryUrl.port.get())
-        : Option<int>();
-
-      blobUri = uri::docker::blob(
-          reference.repository(),
-          blobSum,
-          registry,
-          defaultRegistryUrl.scheme,
-          port);
+      return collect(futures)
+        .then([]() { return Nothing(); });
+    }));
+}
+
+
+Option<string> RegistryPullerProcess::getStoredLayer(
+    const string& blobSum,
+    const string& backend)
+{
+  if (storedLayers.isNone()) {
+    storedLayers = hashmap<string, string>();
+
+    const string layersPath = paths::getImageLayersPath(storeDir);
+
+    if (os::exists(layersPath)) {
+      Try<list<string>> layerIds = os::ls(layersPath);
+      if (layerIds.isError()) {
+        LOG(WARNING) << "Failed to list the layers in the store: "
+                     << layerIds.error();
+      } else {
+        foreach (const string& layerId, layerIds.get()) {
+          // NOTE: Layers that were not pulled from a registry (or
+          // were pulled before blob sums were saved) have none.
+          Try<string> _blobSum = os::read(paths::getImageLayerBlobSumPath(
+              paths::getImageLayerPath(storeDir, layerId)));
+
+          if (_blobSum.isSome()) {
+            storedLayers->put(_blobSum.get(), layerId);
+          }
+        }
+      }
     }
+  }
 
-    futures.push_back(fetcher->fetch(blobUri, directory));
+  if (!storedLayers->contains(blobSum)) {
+    return None();
   }
 
-  return collect(futures)
-    .then([blobSums]() -> hashset<string> { return blobSums; });
+  const string layerPath =
+    paths::getImageLayerPath(storeDir, storedLayers->at(blobSum));
+
+  // The layer might not be in the store (yet), or not for this
+  // backend.
+  Try<string> _blobSum =
+    os::read(paths::getImageLayerBlobSumPath(layerPath));
+
+  if (_blobSum.isError() || _blobSum.get() != blobSum) {
+    return None();
+  }
+
+  const string rootfs = paths::getImageLayerRootfsPath(layerPath, backend);
+  if (!os::exists(rootfs)) {
+    return None();
+  }
+
+  return rootfs;
+}
+
+
+Try<URI> RegistryPullerProcess::getBlobUri(
+    const spec::ImageReference& reference,
+    const string& blobSum)
+{
+  if (reference.has_registry()) {
+    Result<int> port = spec::getRegistryPort(reference.registry());
+    if (port.isError()) {
+      return Error("Failed to get registry port: " + port.error());
+    }
+
+    Try<string> scheme = spec::getRegistryScheme(reference.registry());
+    if (scheme.isError()) {
+      return Error("Failed to get registry scheme: " + scheme.error());
+    }
+
+    // If users want to use the registry specified in '--docker_image',
+    // an URL scheme must be specified in '--docker_registry', because
+    // there is no scheme allowed in docker image name.
+    return uri::docker::blob(
+        reference.repository(),
+        blobSum,
+        spec::getRegistryHost(reference.registry()),
+        scheme.get(),
+        port.isSome() ? port.get() : Option<int>());
+  }
+
+  const string registry = defaultRegistryUrl.domain.isSome()
+    ? defaultRegistryUrl.domain.get()
+    : stringify(defaultRegistryUrl.ip.get());
+
+  const Option<int> port = defaultRegistryUrl.port.isSome()
+    ? static_cast<int>(defaultRegistryUrl.port.get())
+    : Option<int>();
+
+  return uri::docker::blob(
+      reference.repository(),
+      blobSum,
+      registry,
+      defaultRegistryUrl.scheme,
+      port);
 }
 
 } // namespace docker {
@@ -20,9 +20,11 @@
 #include <glog/logging.h>
 
 #include <stout/hashmap.hpp>
+#include <stout/hashset.hpp>
 #include <stout/json.hpp>
 #include <stout/os.hpp>
 
+#include <process/async.hpp>
 #include <process/collect.hpp>
 #include <process/defer.hpp>
 #include <process/dispatch.hpp>
@@ -73,6 +75,8 @@ public:
       const mesos::Image& image,
       const string& backend);
 
+  Future<Nothing> prune(const hashset<string>& activeLayerPaths);
+
 private:
   Future<Image> _get(
       const spec::ImageReference& reference,
@@ -93,6 +97,10 @@ private:
       const string& layerId,
       const string& backend);
 
+  Future<Nothing> _prune(
+      const hashset<string>& activeLayerPaths,
+      const Images& images);
+
   const Flags flags;
 
   Owned<MetadataManager> metadataManager;
@@ -147,6 +155,12 @@ Try<Owned<slave::Store>> Store::create(
                  mkdir.error());
   }
 
+  mkdir = os::mkdir(paths::getGcDir(flags.docker_store_dir));
+  if (mkdir.isError()) {
+    return Error("Failed to create Docker store gc directory: " +
+                 mkdir.error());
+  }
+
   Try<Owned<MetadataManager>> metadataManager = MetadataManager::create(flags);
   if (metadataManager.isError()) {
     return Error(metadataManager.error());
@@ -186,8 +200,32 @@ Future<ImageInfo> Store::get(
 }
 
 
+Future<Nothing> Store::prune(const hashset<string>& activeLayerPaths)
+{
+  return dispatch(process.get(), &StoreProcess::prune, activeLayerPaths);
+}
+
+
 Future<Nothing> StoreProcess::recover()
 {
+  // Finish removing the layers whose removal was interrupted.
+  const string gcDir = paths::getGcDir(flags.docker_store_dir);
+
+  Try<list<string>> entries = os::ls(gcDir);
+  if (entries.isError()) {
+    return Failure(
+        "Failed to list the gc directory '" + gcDir + "': " +
+        entries.error());
+  }
+
+  foreach (const string& entry, entries.get()) {
+    Try<Nothing> rmdir = os::rmdir(path::join(gcDir, entry));
+    if (rmdir.isError()) {
+      LOG(WARNING) << "Failed to remove layer '" << path::join(gcDir, entry)
+                   << "': " << rmdir.error();
+    }
+  }
+
   return metadataManager->recover();
 }
 
@@ -221,10 +259,9 @@ Future<Image> StoreProcess::_get(
 {
   // NOTE: Here, we assume that image layers are not removed without
   // first removing the metadata in the metadata manager first.
-  // Otherwise, the image we return here might miss some layers. At
-  // the time we introduce cache eviction, we also want to avoid the
-  // situation where a layer was returned to the provisioner but is
-  // later evicted.
+  // Otherwise, the image we return here might miss some layers. The
+  // layers are only pruned once they are referenced by neither an
+  // image nor a container, see 'prune'.
   if (image.isSome()) {
     // It is possible that a layer is missed after recovery if the
     // agent flag `--image_provisioner_backend` is changed from a
@@ -328,6 +365,108 @@ Future<ImageInfo> StoreProcess::__get(
 }
 
 
+Future<Nothing> StoreProcess::prune(const hashset<string>& activeLayerPaths)
+{
+  // The layers of an image that is being pulled are moved to the
+  // store before the image is put in the metadata manager, so the
+  // layers are not pruned while pulling.
+  if (!pulling.empty()) {
+    VLOG(1) << "Skipping pruning the layers while pulling images";
+    return Nothing();
+  }
+
+  return metadataManager->images()
+    .then(defer(self(), &Self::_prune, activeLayerPaths, lambda::_1));
+}
+
+
+Future<Nothing> StoreProcess::_prune(
+    const hashset<string>& activeLayerPaths,
+    const Images& images)
+{
+  if (!pulling.empty()) {
+    VLOG(1) << "Skipping pruning the layers while pulling images";
+    return Nothing();
+  }
+
+  // The number of references to each layer, by the images in the
+  // metadata manager and by the rootfses of containers.
+  hashmap<string, size_t> references;
+
+  foreach (const Image& image, images.images()) {
+    foreach (const string& layerId, image.layer_ids()) {
+      references[layerId]++;
+    }
+  }
+
+  // NOTE: The active layer paths are the rootfses of the layers, see
+  // 'paths::getImageLayerRootfsPath'. The paths of other stores are
+  // ignored.
+  const string layersPath = paths::getImageLayersPath(flags.docker_store_dir);
+
+  foreach (const string& layerPath, activeLayerPaths) {
+    const string layerDir = Path(layerPath).dirname();
+
+    if (Path(layerDir).dirname() == layersPath) {
+      references[Path(layerDir).basename()]++;
+    }
+  }
+
+  Try<list<string>> layerIds = os::ls(layersPath);
+  if (layerIds.isError()) {
+    return Failure(
+        "Failed to list the layers in '" + layersPath + "': " +
+        layerIds.error());
+  }
+
+  list<string> removed;
+
+  foreach (const string& layerId, layerIds.get()) {
+    if (references.contains(layerId)) {
+      continue;
+    }
+
+    // The layer is first moved out of the store, so that it is never
+    // found partially removed (e.g., by the puller reusing the layers
+    // extracted from the same blob).
+    const string source = paths::getImageLayerPath(
+        flags.docker_store_dir,
+        layerId);
+
+    const string target = paths::getGcLayerPath(
+        flags.docker_store_dir,
+        layerId);
+
+    Try<Nothing> rename = os::rename(source, target);
+    if (rename.isError()) {
+      return Failure(
+          "Failed to move layer from '" + source + "' to '" + target +
+          "': " + rename.error());
+    }
+
+    VLOG(1) << "Removing unreferenced layer '" << layerId << "'";
+
+    removed.push_back(target);
+  }
+
+  if (removed.empty()) {
+    return Nothing();
+  }
+
+  return async([removed]() {
+    foreach (const string& path, removed) {
+      Try<Nothing> rmdir = os::rmdir(path);
+      if (rmdir.isError()) {
+        LOG(WARNING) << "Failed to remove layer '" << path << "': "
+                     << rmdir.error();
+      }
+    }
+
+    return Nothing();
+  });
+}
+
+
 Future<vector<string>> StoreProcess::moveLayers(
     const string& staging,
     const vector<string>& layerIds,
@@ -250,6 +250,14 @@ string getBackendDir(
              backend);
 }
 
+
+string getLayersFilePath(
+    const string& provisionerDir,
+    const ContainerID& containerId)
+{
+  return path::join(getContainerDir(provisionerDir, containerId), "layers");
+}
+
 } // namespace paths {
 } // namespace provisioner {
 } // namespace slave {
@@ -40,12 +40,15 @@ namespace paths {
 //                 |-- <backend> (copy, bind, etc.)
 //                     |-- rootfses
 //                         |-- <rootfs_id> (the rootfs)
+//             |-- layers (the image layers the rootfses are made of)
 //             |-- containers (nested containers)
 //                 |-- <container_id>
 //                     |-- backends
 //                         |-- <backend> (copy, bind, etc.)
 //                             |-- rootfses
 //                                 |-- <rootfs_id> (the rootfs)
+//     |-- trash
+//         |-- <backend> (rootfses being removed in the background)
 //
 // There can be multiple backends due to the change of backend flags.
 // Under each backend a rootfs is identified by the 'rootfs_id' which
@@ -82,6 +85,13 @@ std::string getBackendDir(
     const ContainerID& containerId,
     const std::string& backend);
 
+
+// The file that holds the paths of the image layers that the rootfses
+// of the container are made of, one per line.
+std::string getLayersFilePath(
+    const std::string& provisionerDir,
+    const ContainerID& containerId);
+
 } // namespace paths {
 } // namespace provisioner {
 } // namespace slave {
@@ -31,7 +31,9 @@
 #include <stout/hashmap.hpp>
 #include <stout/hashset.hpp>
 #include <stout/os.hpp>
+#include <stout/path.hpp>
 #include <stout/stringify.hpp>
+#include <stout/strings.hpp>
 #include <stout/uuid.hpp>
 
 #ifdef __linux__
@@ -313,7 +315,9 @@ ProvisionerProcess::ProvisionerProcess(
     rootDir(_rootDir),
     defaultBackend(_defaultBackend),
     stores(_stores),
-    backends(_backends) {}
+    backends(_backends),
+    provisioning(0),
+    recovered(false) {}
 
 
 Future<Nothing> ProvisionerProcess::recover(
@@ -360,6 +364,24 @@ Future<Nothing> ProvisionerProcess::recover(
       info->rootfses.put(backend, rootfses.get()[backend]);
     }
 
+    const string layersPath =
+      provisioner::paths::getLayersFilePath(rootDir, containerId);
+
+    if (os::exists(layersPath)) {
+      Try<string> layers = os::read(layersPath);
+      if (layers.isError()) {
+        return Failure(
+            "Failed to read the layers of container " +
+            stringify(containerId) + ": " + layers.error());
+      }
+
+      foreach (const string& layer, strings::tokenize(layers.get(), "\n")) {
+        info->layers->insert(layer);
+      }
+    } else if (!info->rootfses.empty()) {
+      info->layers = None();
+    }
+
     infos.put(containerId, info);
 
     if (knownContainerIds.contains(containerId)) {
@@ -406,10 +428,14 @@ Future<Nothing> ProvisionerProcess::recover(
   // in 'store', which might fail if there still exist unknown
   // containers holding references to them.
   return collect(cleanup, recover)
-    .then([=]() -> Future<Nothing> {
+    .then(defer(self(), [=]() -> Future<Nothing> {
       LOG(INFO) << "Provisioner recovery complete";
+
+      recovered = true;
+      prune();
+
       return Nothing();
-    });
+    }));
 }
 
 
@@ -423,6 +449,8 @@ Future<ProvisionInfo> ProvisionerProcess::provision(
         stringify(image.type()));
   }
 
+  ++provisioning;
+
   // Get and then provision image layers from the store.
   return stores.get(image.type()).get()->get(image, defaultBackend)
     .then(defer(self(),
@@ -430,7 +458,10 @@ Future<ProvisionInfo> ProvisionerProcess::provision(
                 containerId,
                 image,
                 defaultBackend,
-                lambda::_1));
+                lambda::_1))
+    .onAny(defer(self(), [=](const Future<ProvisionInfo>&) {
+      --provisioning;
+    }));
 }
 
 
@@ -462,6 +493,35 @@ Future<ProvisionInfo> ProvisionerProcess::_provision(
 
   infos[containerId]->rootfses[backend].insert(rootfsId);
 
+  // The layers are checkpointed before they are used so that they are
+  // not pruned if the agent restarts while the rootfs is provisioned.
+  Option<hashset<string>>& layers = infos[containerId]->layers;
+
+  if (layers.isSome()) {
+    foreach (const string& layer, imageInfo.layers) {
+      layers->insert(layer);
+    }
+
+    const string layersPath =
+      provisioner::paths::getLayersFilePath(rootDir, containerId);
+
+    Try<Nothing> mkdir = os::mkdir(Path(layersPath).dirname());
+    if (mkdir.isError()) {
+      return Failure(
+          "Failed to create the directory of '" + layersPath + "': " +
+          mkdir.error());
+    }
+
+    Try<Nothing> write =
+      os::write(layersPath, strings::join("\n", layers.get()));
+
+    if (write.isError()) {
+      return Failure(
+          "Failed to checkpoint the layers of container " +
+          stringify(containerId) + ": " + write.error());
+    }
+  }
+
   string backendDir = provisioner::paths::getBackendDir(
       rootDir,
       containerId,
@@ -566,10 +626,41 @@ Future<bool> ProvisionerProcess::_destroy(const ContainerID& containerId)
     ++metrics.remove_container_errors;
   }
 
+  prune();
+
   return true;
 }
 
 
+void ProvisionerProcess::prune()
+{
+  if (!recovered || provisioning > 0) {
+    return;
+  }
+
+  hashset<string> activeLayerPaths;
+
+  foreachpair (const ContainerID& containerId,
+               const Owned<Info>& info,
+               infos) {
+    if (info->layers.isNone()) {
+      VLOG(1) << "Skipping pruning the layers since the layers of container "
+              << containerId << " are unknown";
+      return;
+    }
+
+    activeLayerPaths.insert(info->layers->begin(), info->layers->end());
+  }
+
+  foreachvalue (const Owned<Store>& store, stores) {
+    store->prune(activeLayerPaths)
+      .onFailed([](const string& failure) {
+        LOG(WARNING) << "Failed to prune the image layers: " << failure;
+      });
+  }
+}
+
+
 ProvisionerProcess::Metrics::Metrics()
   : remove_container_errors(
       "containerizer/mesos/provisioner/remove_container_errors")
@@ -137,6 +137,10 @@ private:
 
   process::Future<bool> _destroy(const ContainerID& containerId);
 
+  // Removes the layers in the stores that are no longer referenced
+  // by any image or container, see 'Store::prune'.
+  void prune();
+
   // Absolute path to the provisioner root directory. It can be
   // derived from '--work_dir' but we keep a separate copy here
   // because we converted it into an absolute path so managed rootfs
@@ -158,10 +162,23 @@ private:
   {
     // Mappings: backend -> {rootfsId, ...}
     hashmap<std::string, hashset<std::string>> rootfses;
+
+    // The paths of the image layers that the rootfses are made of,
+    // which are unknown for containers provisioned before they were
+    // checkpointed.
+    Option<hashset<std::string>> layers = hashset<std::string>();
   };
 
   hashmap<ContainerID, process::Owned<Info>> infos;
 
+  // The number of provisions in progress, whose layers are not known
+  // yet. The layers are not pruned while there are any.
+  size_t provisioning;
+
+  // Whether the stores have been recovered, before which the layers
+  // are not pruned either.
+  bool recovered;
+
   struct Metrics
   {
     Metrics();
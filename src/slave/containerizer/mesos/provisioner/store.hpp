@@ -29,6 +29,8 @@
 #include <process/future.hpp>
 #include <process/owned.hpp>
 
+#include <stout/hashset.hpp>
+#include <stout/nothing.hpp>
 #include <stout/try.hpp>
 
 #include "slave/flags.hpp"
@@ -84,6 +86,18 @@ public:
   virtual process::Future<ImageInfo> get(
       const Image& image,
       const std::string& backend) = 0;
+
+  // Remove the stored layers that are no longer referenced, neither
+  // by the images in the store nor by the rootfses of containers
+  // (i.e., 'activeLayerPaths', the layer paths that were returned by
+  // 'get' for the containers that have not been destroyed yet).
+  //
+  // NOTE: By default, stores do not remove any layers.
+  virtual process::Future<Nothing> prune(
+      const hashset<std::string>& activeLayerPaths)
+  {
+    return Nothing();
+  }
 };
 
 } // namespace slave {
@@ -355,8 +355,11 @@ mesos::internal::slave::Flags::Flags()
       "Adjust disk headroom used to calculate maximum executor\n"
       "directory age. Age is calculated by:\n"
       "`gc_delay * max(0.0, (1.0 - gc_disk_headroom - disk usage))`\n"
-      "every `--disk_watch_interval` duration. `gc_disk_headroom` must\n"
-      "be a value between 0.0 and 1.0",
+      "every `--disk_watch_interval` duration. If the disk usage exceeds\n"
+      "`1.0 - gc_disk_headroom`, the oldest executor directories are\n"
+      "removed until enough disk space is reclaimed to get back within\n"
+      "the headroom. `gc_disk_headroom` must be a value between 0.0\n"
+      "and 1.0",
       GC_DISK_HEADROOM);
 
   add(&Flags::disk_watch_interval,
@@ -367,6 +370,16 @@ mesos::internal::slave::Flags::Flags()
       "information and sandboxes.",
       DISK_WATCH_INTERVAL);
 
+  add(&Flags::usage_cache_interval,
+      "usage_cache_interval",
+      "Amount of time for which the resource statistics of a container are\n"
+      "reused by all consumers of resource usage (e.g., the QoS controller,\n"
+      "the resource estimator and the `/monitor/statistics` and\n"
+      "`/containers` endpoints) before they are collected from the\n"
+      "containerizer again. Concurrent requests always share a pending\n"
+      "collection.",
+      USAGE_CACHE_INTERVAL);
+
   add(&Flags::container_logger,
       "container_logger",
       "The name of the container logger to use for logging container\n"
@@ -400,6 +413,18 @@ mesos::internal::slave::Flags::Flags()
       "state as possible is recovered.\n",
       true);
 
+  add(&Flags::checkpoint_journal,
+      "checkpoint_journal",
+      "If `checkpoint_journal=true`, the agent appends the checkpoints of\n"
+      "frameworks, executors and tasks to a journal in the meta directory\n"
+      "(committing the checkpoints of an operation, e.g., all the tasks of\n"
+      "a task group, with a single write) instead of writing each one to\n"
+      "its own file. The journal is periodically compacted. When the agent\n"
+      "restarts with `checkpoint_journal=false`, the journal is written\n"
+      "back to individual files, which is required before downgrading\n"
+      "the agent.",
+      false);
+
   add(&Flags::max_completed_executors_per_framework,
       "max_completed_executors_per_framework",
       "Maximum number of completed executors per framework to store\n"
@@ -472,7 +497,14 @@ mesos::internal::slave::Flags::Flags()
       "Run command `perf list` to see all events. Event names are\n"
       "sanitized by downcasing and replacing hyphens with underscores\n"
       "when reported in the PerfStatistics protobuf, e.g., `cpu-cycles`\n"
-      "becomes `cpu_cycles`; see the PerfStatistics protobuf for all names.");
+      "becomes `cpu_cycles`; see the PerfStatistics protobuf for all names.\n"
+      "If all the events are generalized hardware, software or hardware\n"
+      "cache events with a PerfStatistics field, they are counted in-process\n"
+      "using `perf_event_open` rather than by running `perf stat`. This\n"
+      "takes a file descriptor per event and CPU for each container; the\n"
+      "counters of all containers are bounded to half of the agent's\n"
+      "`RLIMIT_NOFILE` soft limit, beyond which (or if the counters cannot\n"
+      "be opened) containers are sampled with `perf stat` if available.");
 
   add(&Flags::perf_interval,
       "perf_interval",
@@ -614,6 +646,15 @@ mesos::internal::slave::Flags::Flags()
       "(e.g., `3days`, `2weeks`, etc).\n",
       DOCKER_REMOVE_DELAY);
 
+  add(&Flags::docker_engine_api,
+      "docker_engine_api",
+      "Whether the docker containerizer (and the docker executor) should\n"
+      "talk to the docker daemon using the Docker Engine API on\n"
+      "`--docker_socket` to inspect, list, stop, kill and remove\n"
+      "containers, rather than running the docker CLI for each operation.\n"
+      "Running containers and pulling images still uses the docker CLI.",
+      false);
+
   add(&Flags::docker_kill_orphans,
       "docker_kill_orphans",
       "Enable docker containerizer to kill orphaned containers.\n"
@@ -779,6 +820,15 @@ mesos::internal::slave::Flags::Flags()
       "used for the `disk/du` isolator.",
       Seconds(15));
 
+  add(&Flags::container_disk_watch_incremental,
+      "container_disk_watch_incremental",
+      "Whether to collect the disk usage of containers by walking their\n"
+      "sandboxes in the agent rather than running `du`. The listing of each\n"
+      "directory is cached between checks and only read again if the\n"
+      "directory was modified, which is cheaper for sandboxes with many\n"
+      "files. This flag is used for the `disk/du` isolator.",
+      false);
+
   // TODO(jieyu): Consider enabling this flag by default. Remember
   // to update the user doc if we decide to do so.
   add(&Flags::enforce_container_disk_quota,
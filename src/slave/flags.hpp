@@ -80,12 +80,14 @@ public:
   Duration gc_delay;
   double gc_disk_headroom;
   Duration disk_watch_interval;
+  Duration usage_cache_interval;
 
   Option<std::string> container_logger;
 
   std::string recover;
   Duration recovery_timeout;
   bool strict;
+  bool checkpoint_journal;
   Duration register_retry_interval_min;
 #ifdef __linux__
   std::string cgroups_hierarchy;
@@ -121,6 +123,7 @@ public:
   bool docker_kill_orphans;
   std::string docker_socket;
   Option<JSON::Object> docker_config;
+  bool docker_engine_api;
 
 #ifdef WITH_NETWORK_ISOLATOR
   uint16_t ephemeral_ports_per_container;
@@ -136,6 +139,7 @@ public:
   Option<std::string> network_cni_plugins_dir;
   Option<std::string> network_cni_config_dir;
   Duration container_disk_watch_interval;
+  bool container_disk_watch_incremental;
   bool enforce_container_disk_quota;
   Option<Modules> modules;
   Option<std::string> modulesDir;
@@ -14,17 +14,39 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#ifndef __WINDOWS__
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <sys/stat.h>
+#endif // __WINDOWS__
+
+#include <algorithm>
 #include <list>
+#include <vector>
 
+#include <process/async.hpp>
+#include <process/collect.hpp>
+#include <process/defer.hpp>
 #include <process/delay.hpp>
 #include <process/dispatch.hpp>
+#include <process/id.hpp>
+
+#include <process/metrics/metrics.hpp>
 
 #include <stout/foreach.hpp>
+#include <stout/lambda.hpp>
+#include <stout/path.hpp>
+#include <stout/stringify.hpp>
 
+#include <stout/os/close.hpp>
 #include <stout/os/rmdir.hpp>
+#include <stout/os/strerror.hpp>
 
 #include "logging/logging.hpp"
 
+#include "slave/constants.hpp"
 #include "slave/gc.hpp"
 
 using namespace process;
@@ -34,17 +56,191 @@ using process::wait; // Necessary on some OS's to disambiguate.
 using std::list;
 using std::map;
 using std::string;
+using std::vector;
 
 namespace mesos {
 namespace internal {
 namespace slave {
 
+#ifndef __WINDOWS__
+// Returns the disk space freed by removing the file (or directory)
+// with the given status. Note that only removing the last (hard)
+// link to a file frees its disk space.
+static Bytes freed(const struct stat& s)
+{
+  if (!S_ISDIR(s.st_mode) && s.st_nlink > 1) {
+    return Bytes(0);
+  }
+
+  // NOTE: 'st_blocks' is in units of 512 bytes regardless of the
+  // block size of the filesystem.
+  return Bytes(s.st_blocks * 512);
+}
+
+
+// Removes the entries of the directory 'fd' (which is closed) at
+// 'path' recursively, relative to the file descriptors of the
+// directories, so that the kernel doesn't resolve the full path of
+// each entry again. Like `os::rmdir` with 'continueOnError', this
+// logs each error and continues with the next entry. Adds the disk
+// space freed to 'bytes' and the number of errors to 'errors'.
+//
+// NOTE: Only the directories up to 'GC_MAX_OPEN_DIRECTORIES' levels
+// deep are kept open while their subdirectories are removed. Deeper
+// directories are closed and reopened by their path afterwards, so
+// that arbitrarily deep trees can't exhaust the file descriptors.
+static void removeEntries(
+    int fd,
+    const string& path,
+    size_t depth,
+    Bytes* bytes,
+    size_t* errors)
+{
+  auto error = [&](const string& message) {
+    LOG(ERROR) << message << ": " << os::strerror(errno);
+    ++(*errors);
+  };
+
+  DIR* directory = ::fdopendir(fd);
+  if (directory == nullptr) {
+    error("Failed to open directory '" + path + "'");
+    os::close(fd);
+    return;
+  }
+
+  // The entries are read upfront so that the directory can be closed
+  // and reopened without reading any of them twice.
+  vector<string> names;
+
+  while (true) {
+    errno = 0;
+
+    struct dirent* entry = ::readdir(directory);
+    if (entry == nullptr) {
+      if (errno != 0) {
+        error("Failed to read directory '" + path + "'");
+      }
+
+      break;
+    }
+
+    const string name = entry->d_name;
+    if (name != "." && name != "..") {
+      names.push_back(name);
+    }
+  }
+
+  foreach (const string& name, names) {
+    if (directory == nullptr) {
+      fd = ::open(
+          path.c_str(),
+          O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+
+      directory = fd < 0 ? nullptr : ::fdopendir(fd);
+      if (directory == nullptr) {
+        error("Failed to reopen directory '" + path + "'");
+
+        if (fd >= 0) {
+          os::close(fd);
+        }
+
+        return;
+      }
+    }
+
+    const string child = path::join(path, name);
+
+    struct stat s;
+    if (::fstatat(::dirfd(directory), name.c_str(), &s, AT_SYMLINK_NOFOLLOW)) {
+      if (errno != ENOENT) {
+        error("Failed to stat '" + child + "'");
+      }
+
+      continue;
+    }
+
+    if (S_ISDIR(s.st_mode)) {
+      int _fd = ::openat(
+          ::dirfd(directory),
+          name.c_str(),
+          O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+
+      if (_fd < 0) {
+        error("Failed to open directory '" + child + "'");
+        continue;
+      }
+
+      if (depth >= GC_MAX_OPEN_DIRECTORIES) {
+        ::closedir(directory);
+        directory = nullptr;
+      }
+
+      const size_t _errors = *errors;
+
+      removeEntries(_fd, child, depth + 1, bytes, errors);
+
+      // The directory can't be removed if any of its entries can't.
+      if (*errors > _errors) {
+        continue;
+      }
+
+      if (directory == nullptr) {
+        if (::rmdir(child.c_str()) < 0) {
+          if (errno != ENOENT) {
+            error("Failed to remove '" + child + "'");
+          }
+
+          continue;
+        }
+
+        *bytes += freed(s);
+        continue;
+      }
+    }
+
+    if (::unlinkat(
+            ::dirfd(directory),
+            name.c_str(),
+            S_ISDIR(s.st_mode) ? AT_REMOVEDIR : 0) < 0) {
+      if (errno != ENOENT) {
+        error("Failed to remove '" + child + "'");
+      }
+
+      continue;
+    }
+
+    *bytes += freed(s);
+  }
+
+  if (directory != nullptr) {
+    ::closedir(directory);
+  }
+}
+#endif // __WINDOWS__
+
+
+GarbageCollectorProcess::GarbageCollectorProcess()
+  : ProcessBase(process::ID::generate("agent-garbage-collector")),
+    metrics(*this) {}
+
 
 GarbageCollectorProcess::~GarbageCollectorProcess()
 {
   foreachvalue (const PathInfo& info, paths) {
     info.promise->discard();
   }
+
+  foreach (const PathInfo& info, queue) {
+    info.promise->discard();
+  }
+
+  foreachvalue (const PathInfo& info, removing) {
+    info.promise->discard();
+  }
+
+  if (reclamation.isSome()) {
+    reclamation.get()->promise.discard();
+  }
 }
 
 
@@ -57,7 +253,7 @@ Future<Nothing> GarbageCollectorProcess::schedule(
   // If there's an existing schedule for this path, we must remove
   // it here in order to reschedule.
   if (timeouts.contains(path)) {
-    CHECK(unschedule(path));
+    CHECK(unschedule(path).get());
   }
 
   Owned<Promise<Nothing>> promise(new Promise<Nothing>());
@@ -78,32 +274,64 @@ Future<Nothing> GarbageCollectorProcess::schedule(
 }
 
 
-bool GarbageCollectorProcess::unschedule(const string& path)
+Future<bool> GarbageCollectorProcess::unschedule(const string& path)
 {
   LOG(INFO) << "Unscheduling '" << path << "' from gc";
 
-  if (!timeouts.contains(path)) {
-    return false;
-  }
+  bool unscheduled = false;
+
+  if (timeouts.contains(path)) {
+    Timeout timeout = timeouts[path]; // Make a copy, as we erase() below.
+    CHECK(paths.contains(timeout));
+
+    // Locate the path.
+    foreach (const PathInfo& info, paths.get(timeout)) {
+      if (info.path == path) {
+        // Discard the promise.
+        info.promise->discard();
+
+        // Clean up the maps.
+        CHECK(paths.remove(timeout, info));
+        CHECK(timeouts.erase(path) > 0);
 
-  Timeout timeout = timeouts[path]; // Make a copy, as we erase() below.
-  CHECK(paths.contains(timeout));
+        unscheduled = true;
+        break;
+      }
+    }
+
+    if (!unscheduled) {
+      LOG(FATAL) << "Inconsistent state across 'paths' and 'timeouts'";
+    }
+  }
 
-  // Locate the path.
-  foreach (const PathInfo& info, paths.get(timeout)) {
+  // The path might also be due for removal but still wait for other
+  // removals to finish.
+  queue.remove_if([&](const PathInfo& info) {
     if (info.path == path) {
-      // Discard the promise.
       info.promise->discard();
+      unscheduled = true;
+      return true;
+    }
+
+    return false;
+  });
 
-      // Clean up the maps.
-      CHECK(paths.remove(timeout, info));
-      CHECK(timeouts.erase(path) > 0);
+  if (unscheduled) {
+    return true;
+  }
 
-      return true;
+  // If the path is being removed, wait for the removal to finish so
+  // that the caller doesn't recreate (part of) the path meanwhile.
+  if (removing.contains(path)) {
+    list<Future<Nothing>> removals;
+    foreach (const PathInfo& info, removing.get(path)) {
+      removals.push_back(info.promise->future());
     }
+
+    return await(removals)
+      .then([]() { return false; });
   }
 
-  LOG(FATAL) << "Inconsistent state across 'paths' and 'timeouts'";
   return false;
 }
 
@@ -125,32 +353,23 @@ void GarbageCollectorProcess::reset()
 
 void GarbageCollectorProcess::remove(const Timeout& removalTime)
 {
-  // TODO(bmahler): Other dispatches can block waiting for a removal
-  // operation. To fix this, the removal operation can be done
-  // asynchronously in another thread.
-  if (paths.count(removalTime) > 0) {
-    foreach (const PathInfo& info, paths.get(removalTime)) {
-      LOG(INFO) << "Deleting " << info.path;
-
-      // Run rmdir with 'continueOnError = true'. It's possible for
-      // tasks and isolators to lay down files that are not deletable by
-      // GC. In the face of such errors GC needs to free up disk space
-      // wherever it can because it's already re-offered to frameworks.
-      Try<Nothing> rmdir = os::rmdir(info.path, true, true, true);
-
-      if (rmdir.isError()) {
-        LOG(WARNING) << "Failed to delete '" << info.path << "': "
-                     << rmdir.error();
-        info.promise->fail(rmdir.error());
-      } else {
-        LOG(INFO) << "Deleted '" << info.path << "'";
-        info.promise->set(rmdir.get());
-      }
-
-      timeouts.erase(info.path);
+  // All the paths that are due are removed (rather than only those at
+  // 'removalTime'), since paths scheduled in quick succession have
+  // slightly different removal times, which would otherwise each take
+  // a timer (and a dispatch) of their own.
+  bool due = false;
+
+  foreach (const Timeout& timeout, paths.keys()) {
+    if (removalTime < timeout && !timeout.expired()) {
+      break;
     }
 
-    paths.remove(removalTime);
+    enqueue(timeout);
+    due = true;
+  }
+
+  if (due) {
+    drain();
   } else {
     // This occurs when either:
     //   1. The path(s) has already been removed (e.g. by prune()).
@@ -163,15 +382,234 @@ void GarbageCollectorProcess::remove(const Timeout& removalTime)
 }
 
 
+void GarbageCollectorProcess::enqueue(const Timeout& removalTime)
+{
+  foreach (const PathInfo& info, paths.get(removalTime)) {
+    queue.push_back(info);
+    timeouts.erase(info.path);
+  }
+
+  paths.remove(removalTime);
+}
+
+
+void GarbageCollectorProcess::drain()
+{
+  while (!queue.empty() && removing.size() < GC_MAX_CONCURRENT_REMOVALS) {
+    const PathInfo info = queue.front();
+    queue.pop_front();
+
+    LOG(INFO) << "Deleting " << info.path;
+
+    removing.put(info.path, info);
+
+    async(&GarbageCollectorProcess::removePath, info.path)
+      .onAny(defer(self(), &Self::_remove, info, lambda::_1));
+  }
+}
+
+
+void GarbageCollectorProcess::_remove(
+    const PathInfo& info,
+    const Future<Removal>& removal)
+{
+  CHECK(removing.remove(info.path, info));
+
+  Removal result;
+  if (removal.isReady()) {
+    result = removal.get();
+  } else {
+    result.error = removal.isFailed() ? removal.failure() : "discarded";
+  }
+
+  metrics.bytes_reclaimed += result.bytes.bytes();
+
+  if (result.error.isSome()) {
+    LOG(WARNING) << "Failed to delete '" << info.path << "': "
+                 << result.error.get();
+
+    ++metrics.path_removals_failed;
+    info.promise->fail(result.error.get());
+  } else {
+    LOG(INFO) << "Deleted '" << info.path << "'";
+
+    ++metrics.path_removals_succeeded;
+    info.promise->set(Nothing());
+  }
+
+  if (reclamation.isSome()) {
+    reclamation.get()->reclaimed += result.bytes;
+  }
+
+  drain();
+  reclaimNext();
+}
+
+
 void GarbageCollectorProcess::prune(const Duration& d)
 {
   foreach (const Timeout& removalTime, paths.keys()) {
-    if (removalTime.remaining() <= d) {
-      LOG(INFO) << "Pruning directories with remaining removal time "
-                << removalTime.remaining();
-      dispatch(self(), &GarbageCollectorProcess::remove, removalTime);
+    if (removalTime.remaining() > d) {
+      break;
+    }
+
+    LOG(INFO) << "Pruning directories with remaining removal time "
+              << removalTime.remaining();
+
+    enqueue(removalTime);
+  }
+
+  drain();
+  reset(); // Schedule the timer for next event.
+}
+
+
+Future<Bytes> GarbageCollectorProcess::reclaim(const Bytes& bytes)
+{
+  LOG(INFO) << "Reclaiming " << bytes << " of disk space";
+
+  // A reclamation already in progress continues until the larger of
+  // the two amounts has been reclaimed.
+  if (reclamation.isNone()) {
+    reclamation = Owned<Reclamation>(new Reclamation());
+  }
+
+  reclamation.get()->target = std::max(reclamation.get()->target, bytes);
+
+  Future<Bytes> future = reclamation.get()->promise.future();
+
+  reclaimNext();
+
+  return future;
+}
+
+
+void GarbageCollectorProcess::reclaimNext()
+{
+  if (reclamation.isNone()) {
+    return;
+  }
+
+  Owned<Reclamation> current = reclamation.get();
+
+  // Only queue as many paths as can be removed concurrently, since
+  // the disk space reclaimed is only known once they are removed.
+  if (current->reclaimed < current->target &&
+      !paths.empty() &&
+      queue.size() + removing.size() < GC_MAX_CONCURRENT_REMOVALS) {
+    do {
+      const Timeout removalTime = (*paths.begin()).first;
+      const PathInfo info = (*paths.begin()).second;
+
+      CHECK(paths.remove(removalTime, info));
+      CHECK(timeouts.erase(info.path) > 0);
+
+      queue.push_back(info);
+    } while (!paths.empty() &&
+             queue.size() + removing.size() < GC_MAX_CONCURRENT_REMOVALS);
+
+    drain();
+    reset(); // Schedule the timer for next event.
+  }
+
+  if (current->reclaimed >= current->target ||
+      (paths.empty() && queue.empty() && removing.empty())) {
+    LOG(INFO) << "Reclaimed " << current->reclaimed << " of disk space";
+
+    current->promise.set(current->reclaimed);
+    reclamation = None();
+  }
+}
+
+
+GarbageCollectorProcess::Removal GarbageCollectorProcess::removePath(
+    const string& path)
+{
+  Removal removal;
+
+#ifdef __WINDOWS__
+  // Run rmdir with 'continueOnError = true'. It's possible for
+  // tasks and isolators to lay down files that are not deletable by
+  // GC. In the face of such errors GC needs to free up disk space
+  // wherever it can because it's already re-offered to frameworks.
+  Try<Nothing> rmdir = os::rmdir(path, true, true, true);
+  if (rmdir.isError()) {
+    removal.error = rmdir.error();
+  }
+#else
+  struct stat s;
+  if (::lstat(path.c_str(), &s) < 0) {
+    removal.error = ErrnoError("Failed to stat '" + path + "'").message;
+    return removal;
+  }
+
+  // It's possible for tasks and isolators to lay down files that are
+  // not deletable by GC (e.g., busy mount points). In the face of
+  // such errors GC needs to free up disk space wherever it can
+  // because it's already re-offered to frameworks.
+  if (S_ISDIR(s.st_mode)) {
+    int fd = ::open(
+        path.c_str(),
+        O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+
+    if (fd < 0) {
+      removal.error = ErrnoError("Failed to open '" + path + "'").message;
+      return removal;
+    }
+
+    size_t errors = 0;
+    removeEntries(fd, path, 1, &removal.bytes, &errors);
+
+    // The individual errors have already been logged.
+    if (errors > 0) {
+      removal.error =
+        "Failed to remove " + stringify(errors) + " entries under '" +
+        path + "'";
+      return removal;
     }
+
+    if (::rmdir(path.c_str()) < 0) {
+      removal.error = ErrnoError("Failed to remove '" + path + "'").message;
+      return removal;
+    }
+  } else if (::unlink(path.c_str()) < 0) {
+    removal.error = ErrnoError("Failed to remove '" + path + "'").message;
+    return removal;
   }
+
+  removal.bytes += freed(s);
+#endif // __WINDOWS__
+
+  return removal;
+}
+
+
+GarbageCollectorProcess::Metrics::Metrics(const GarbageCollectorProcess& gc)
+  : path_removals_pending(
+        "gc/path_removals_pending",
+        defer(gc, &GarbageCollectorProcess::_path_removals_pending)),
+    path_removals_active(
+        "gc/path_removals_active",
+        defer(gc, &GarbageCollectorProcess::_path_removals_active)),
+    path_removals_succeeded("gc/path_removals_succeeded"),
+    path_removals_failed("gc/path_removals_failed"),
+    bytes_reclaimed("gc/bytes_reclaimed")
+{
+  process::metrics::add(path_removals_pending);
+  process::metrics::add(path_removals_active);
+  process::metrics::add(path_removals_succeeded);
+  process::metrics::add(path_removals_failed);
+  process::metrics::add(bytes_reclaimed);
+}
+
+
+GarbageCollectorProcess::Metrics::~Metrics()
+{
+  process::metrics::remove(path_removals_pending);
+  process::metrics::remove(path_removals_active);
+  process::metrics::remove(path_removals_succeeded);
+  process::metrics::remove(path_removals_failed);
+  process::metrics::remove(bytes_reclaimed);
 }
 
 
@@ -209,6 +647,12 @@ void GarbageCollector::prune(const Duration& d)
   dispatch(process, &GarbageCollectorProcess::prune, d);
 }
 
+
+Future<Bytes> GarbageCollector::reclaim(const Bytes& bytes)
+{
+  return dispatch(process, &GarbageCollectorProcess::reclaim, bytes);
+}
+
 } // namespace slave {
 } // namespace internal {
 } // namespace mesos {
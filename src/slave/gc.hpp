@@ -17,20 +17,26 @@
 #ifndef __SLAVE_GC_HPP__
 #define __SLAVE_GC_HPP__
 
+#include <list>
 #include <string>
 #include <vector>
 
 #include <process/future.hpp>
-#include <process/id.hpp>
 #include <process/owned.hpp>
 #include <process/process.hpp>
 #include <process/timeout.hpp>
 #include <process/timer.hpp>
 
+#include <process/metrics/counter.hpp>
+#include <process/metrics/gauge.hpp>
+
+#include <stout/bytes.hpp>
 #include <stout/duration.hpp>
 #include <stout/hashmap.hpp>
+#include <stout/multihashmap.hpp>
 #include <stout/multimap.hpp>
 #include <stout/nothing.hpp>
+#include <stout/option.hpp>
 #include <stout/try.hpp>
 
 namespace mesos {
@@ -70,7 +76,9 @@ public:
   // Unschedules the specified path for removal.
   // The future will be true if the path has been unscheduled.
   // The future will be false if the path is not scheduled for
-  // removal, or the path has already being removed.
+  // removal, or the path has already being removed. If the path is
+  // being removed, the future is only satisfied once it has been
+  // removed (so that the caller can safely recreate it).
   // Note that you currently cannot discard a returned future.
   virtual process::Future<bool> unschedule(const std::string& path);
 
@@ -78,6 +86,14 @@ public:
   // is within the next 'd' duration of time.
   virtual void prune(const Duration& d);
 
+  // Deletes the directories in the order of their scheduled garbage
+  // collection time until at least the specified amount of disk space
+  // has been reclaimed, or no directories are left. The future is
+  // satisfied with the amount of disk space actually reclaimed.
+  // Note that only a few directories are removed at a time, so that
+  // not many more directories than necessary are removed.
+  virtual process::Future<Bytes> reclaim(const Bytes& bytes);
+
 private:
   GarbageCollectorProcess* process;
 };
@@ -87,8 +103,7 @@ class GarbageCollectorProcess :
     public process::Process<GarbageCollectorProcess>
 {
 public:
-  GarbageCollectorProcess()
-    : ProcessBase(process::ID::generate("agent-garbage-collector")) {}
+  GarbageCollectorProcess();
 
   virtual ~GarbageCollectorProcess();
 
@@ -96,15 +111,13 @@ public:
       const Duration& d,
       const std::string& path);
 
-  bool unschedule(const std::string& path);
+  process::Future<bool> unschedule(const std::string& path);
 
   void prune(const Duration& d);
 
-private:
-  void reset();
-
-  void remove(const process::Timeout& removalTime);
+  process::Future<Bytes> reclaim(const Bytes& bytes);
 
+private:
   struct PathInfo
   {
     PathInfo(const std::string& _path,
@@ -120,6 +133,46 @@ private:
     const process::Owned<process::Promise<Nothing>> promise;
   };
 
+  // The outcome of removing a path. Note that some of the disk space
+  // might have been reclaimed even if the removal failed.
+  struct Removal
+  {
+    Bytes bytes;
+    Option<std::string> error;
+  };
+
+  void reset();
+
+  void remove(const process::Timeout& removalTime);
+
+  // Queues the paths scheduled for removal at the given time.
+  void enqueue(const process::Timeout& removalTime);
+
+  // Removes the queued paths, at most `GC_MAX_CONCURRENT_REMOVALS` at
+  // a time, each of them on a libprocess worker thread (see `async`).
+  void drain();
+
+  void _remove(const PathInfo& info, const process::Future<Removal>& removal);
+
+  // Queues the next scheduled paths for removal if a reclamation
+  // needs more disk space, or completes it otherwise.
+  void reclaimNext();
+
+  // Removes the path (recursively), continuing on errors so that as
+  // much disk space as possible is reclaimed. This is run on a worker
+  // thread rather than on the process.
+  static Removal removePath(const std::string& path);
+
+  double _path_removals_pending()
+  {
+    return static_cast<double>(queue.size());
+  }
+
+  double _path_removals_active()
+  {
+    return static_cast<double>(removing.size());
+  }
+
   // Store all the timeouts and corresponding paths to delete.
   // NOTE: We are using Multimap here instead of Multihashmap, because
   // we need the keys of the map (deletion time) to be sorted.
@@ -130,6 +183,41 @@ private:
   hashmap<std::string, process::Timeout> timeouts;
 
   process::Timer timer;
+
+  // The paths due for removal (in order) which wait for other
+  // removals to finish. These can still be unscheduled.
+  std::list<PathInfo> queue;
+
+  // The paths being removed.
+  multihashmap<std::string, PathInfo> removing;
+
+  // A reclamation of disk space in progress, if any.
+  struct Reclamation
+  {
+    Bytes target;
+    Bytes reclaimed;
+    process::Promise<Bytes> promise;
+  };
+
+  Option<process::Owned<Reclamation>> reclamation;
+
+  struct Metrics
+  {
+    explicit Metrics(const GarbageCollectorProcess& gc);
+    ~Metrics();
+
+    // Paths that are due for removal but wait for other removals.
+    process::metrics::Gauge path_removals_pending;
+
+    // Paths that are being removed.
+    process::metrics::Gauge path_removals_active;
+
+    process::metrics::Counter path_removals_succeeded;
+    process::metrics::Counter path_removals_failed;
+
+    // Disk space reclaimed by the removals (including the failed ones).
+    process::metrics::Counter bytes_reclaimed;
+  } metrics;
 };
 
 } // namespace slave {
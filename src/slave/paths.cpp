@@ -50,6 +50,7 @@ namespace paths {
 // File names.
 const char BOOT_ID_FILE[] = "boot_id";
 const char SLAVE_INFO_FILE[] = "slave.info";
+const char CHECKPOINT_JOURNAL_FILE[] = "checkpoints.journal";
 const char FRAMEWORK_PID_FILE[] = "framework.pid";
 const char FRAMEWORK_INFO_FILE[] = "framework.info";
 const char LIBPROCESS_PID_FILE[] = "libprocess.pid";
@@ -160,6 +161,14 @@ string getSlaveInfoPath(
 }
 
 
+string getCheckpointJournalPath(
+    const string& rootDir,
+    const SlaveID& slaveId)
+{
+  return path::join(getSlavePath(rootDir, slaveId), CHECKPOINT_JOURNAL_FILE);
+}
+
+
 Try<list<string>> getFrameworkPaths(
     const string& rootDir,
     const SlaveID& slaveId)
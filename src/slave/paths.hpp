@@ -69,6 +69,7 @@ namespace paths {
 //   |       |-- latest (symlink)
 //   |       |-- <slave_id>
 //   |           |-- slave.info
+//   |           |-- checkpoints.journal (if '--checkpoint_journal')
 //   |           |-- frameworks
 //   |               |-- <framework_id>
 //   |                   |-- framework.info
@@ -132,6 +133,11 @@ std::string getSlaveInfoPath(
     const SlaveID& slaveId);
 
 
+std::string getCheckpointJournalPath(
+    const std::string& rootDir,
+    const SlaveID& slaveId);
+
+
 std::string getSlavePath(
     const std::string& rootDir,
     const SlaveID& slaveId);
@@ -128,6 +128,7 @@ using process::Failure;
 using process::Future;
 using process::Owned;
 using process::PID;
+using process::Promise;
 using process::Time;
 using process::UPID;
 
@@ -2100,13 +2101,17 @@ void Slave::_run(
       foreach (const TaskInfo& _task, tasks) {
         // Checkpoint the task before we do anything else.
         if (executor->checkpoint) {
-          executor->checkpointTask(_task);
+          executor->checkpointTask(_task, false);
         }
 
         // Queue task if the executor has not yet registered.
         executor->queuedTasks[_task.task_id()] = _task;
       }
 
+      if (executor->checkpoint) {
+        commitCheckpoints();
+      }
+
       if (taskGroup.isSome()) {
         // Queue task group if the executor has not yet registered.
         executor->queuedTaskGroups.push_back(taskGroup.get());
@@ -2120,7 +2125,7 @@ void Slave::_run(
       foreach (const TaskInfo& _task, tasks) {
         // Checkpoint the task before we do anything else.
         if (executor->checkpoint) {
-          executor->checkpointTask(_task);
+          executor->checkpointTask(_task, false);
         }
 
         // Queue task until the containerizer is updated with new
@@ -2128,6 +2133,10 @@ void Slave::_run(
         executor->queuedTasks[_task.task_id()] = _task;
       }
 
+      if (executor->checkpoint) {
+        commitCheckpoints();
+      }
+
       if (taskGroup.isSome()) {
         // Queue task group until the containerizer is updated with new
         // resource limits (MESOS-998).
@@ -2841,7 +2850,7 @@ void Slave::updateFramework(
                 << " '" << framework->pid.getOrElse(UPID()) << "'"
                 << " to '" << path << "'";
 
-        CHECK_SOME(state::checkpoint(path, framework->pid.getOrElse(UPID())));
+        checkpoint(path, framework->pid.getOrElse(UPID()));
       }
 
       // Inform status update manager to immediately resend any pending
@@ -2947,6 +2956,17 @@ void Slave::checkpointResources(const vector<Resource>& _checkpointedResources)
 }
 
 
+void Slave::commitCheckpoints()
+{
+  if (journal.get() != nullptr) {
+    Try<Nothing> commit = journal->commit();
+    if (commit.isError()) {
+      LOG(FATAL) << "Failed to commit checkpoint journal: " << commit.error();
+    }
+  }
+}
+
+
 Try<Nothing> Slave::syncCheckpointedResources(
     const Resources& newCheckpointedResources)
 {
@@ -3228,7 +3248,7 @@ void Slave::subscribe(
 
         LOG(INFO) << "Creating a marker file for HTTP based executor "
                   << *executor << " at path '" << path << "'";
-        CHECK_SOME(os::touch(path));
+        checkpoint(path, string());
       }
 
       // Here, we kill the executor if it no longer has any task or task group
@@ -3467,7 +3487,7 @@ void Slave::registerExecutor(
 
         VLOG(1) << "Checkpointing executor pid '"
                 << executor->pid.get() << "' to '" << path << "'";
-        CHECK_SOME(state::checkpoint(path, executor->pid.get()));
+        checkpoint(path, executor->pid.get());
       }
 
       // Here, we kill the executor if it no longer has any task to run
@@ -4865,6 +4885,8 @@ void Slave::removeExecutor(Framework* framework, Executor* executor)
 
   LOG(INFO) << "Cleaning up executor " << *executor;
 
+  containerUsages.erase(executor->containerId);
+
   CHECK(framework->state == Framework::RUNNING ||
         framework->state == Framework::TERMINATING)
     << framework->state;
@@ -5265,11 +5287,33 @@ void Slave::_checkDiskUsage(const Future<double>& usage)
               << std::setprecision(2) << 100 * usage.get() << "%."
               << " Max allowed age: " << executorDirectoryMaxAllowedAge;
 
-    // We prune all directories whose deletion time is within
-    // the next 'gc_delay - age'. Since a directory is always
-    // scheduled for deletion 'gc_delay' into the future, only directories
-    // that are at least 'age' old are deleted.
-    gc->prune(flags.gc_delay - executorDirectoryMaxAllowedAge);
+    // Beyond the headroom the max allowed age is zero, i.e., all the
+    // directories would be pruned at once (possibly thousands, which
+    // starves running tasks of IO). Instead, only the disk space
+    // beyond the headroom is reclaimed, starting with the directories
+    // that are the closest to their deletion time (i.e., the oldest).
+    Option<Bytes> excess;
+
+    if (usage.get() > 1.0 - flags.gc_disk_headroom) {
+      Try<Bytes> capacity = ::fs::size(flags.work_dir);
+      if (capacity.isError()) {
+        LOG(ERROR) << "Failed to get disk capacity: " << capacity.error();
+      } else {
+        excess = Bytes(static_cast<uint64_t>(std::ceil(
+            (usage.get() - (1.0 - flags.gc_disk_headroom)) *
+            capacity->bytes())));
+      }
+    }
+
+    if (excess.isSome()) {
+      gc->reclaim(excess.get());
+    } else {
+      // We prune all directories whose deletion time is within
+      // the next 'gc_delay - age'. Since a directory is always
+      // scheduled for deletion 'gc_delay' into the future, only
+      // directories that are at least 'age' old are deleted.
+      gc->prune(flags.gc_delay - executorDirectoryMaxAllowedAge);
+    }
   }
   delay(flags.disk_watch_interval, self(), &Slave::checkDiskUsage);
 }
@@ -5435,6 +5479,21 @@ Future<Nothing> Slave::recover(const Try<state::State>& state)
 
     info = slaveState.get().info.get(); // Recover the slave info.
 
+    // Write the checkpoint journal back to individual files if it is
+    // no longer used (e.g., before downgrading the agent), so that
+    // the checkpoints in it are not lost.
+    const string journalPath =
+      paths::getCheckpointJournalPath(metaDir, info.id());
+
+    if (!flags.checkpoint_journal && os::exists(journalPath)) {
+      Try<Nothing> materialize = state::Journal::materialize(journalPath);
+      if (materialize.isError()) {
+        return Failure(
+            "Failed to materialize checkpoint journal '" + journalPath +
+            "': " + materialize.error());
+      }
+    }
+
     if (slaveState.get().errors > 0) {
       LOG(WARNING) << "Errors encountered during agent recovery: "
                    << slaveState.get().errors;
@@ -5979,7 +6038,7 @@ Future<ResourceUsage> Slave::usage()
         }
       }
 
-      futures.push_back(containerizer->usage(executor->containerId));
+      futures.push_back(containerUsage(executor->containerId));
     }
   }
 
@@ -6013,6 +6072,50 @@ Future<ResourceUsage> Slave::usage()
 }
 
 
+Future<ResourceStatistics> Slave::containerUsage(
+    const ContainerID& containerId)
+{
+  Option<ContainerUsage> usage = containerUsages.get(containerId);
+
+  // Collect the statistics unless a collection is pending, or the
+  // statistics were collected within the interval. Note that failed
+  // (or discarded) collections are not reused.
+  if (usage.isNone() ||
+      usage->statistics.isFailed() ||
+      usage->statistics.isDiscarded() ||
+      (usage->time.isSome() &&
+       Clock::now() - usage->time.get() >= flags.usage_cache_interval)) {
+    usage = ContainerUsage{containerizer->usage(containerId), None()};
+
+    containerUsages[containerId] = usage.get();
+
+    // The statistics are as old as when they were collected rather
+    // than when they were requested, since the collection can take a
+    // while (e.g., for a busy cgroup).
+    usage->statistics
+      .onReady(defer(self(), [=](const ResourceStatistics&) {
+        if (containerUsages.contains(containerId) &&
+            containerUsages.at(containerId).statistics.isReady() &&
+            containerUsages.at(containerId).time.isNone()) {
+          containerUsages.at(containerId).time = Clock::now();
+        }
+      }));
+  }
+
+  // NOTE: Each caller gets its own future so that a caller discarding
+  // it does not discard the collection shared with the other callers.
+  Owned<Promise<ResourceStatistics>> promise(
+      new Promise<ResourceStatistics>());
+
+  usage->statistics
+    .onAny([promise](const Future<ResourceStatistics>& statistics) {
+      promise->associate(statistics);
+    });
+
+  return promise->future();
+}
+
+
 // TODO(dhamon): Move these to their own metrics.hpp|cpp.
 double Slave::_tasks_staging()
 {
@@ -6383,7 +6486,7 @@ void Framework::checkpointFramework() const
 
   VLOG(1) << "Checkpointing FrameworkInfo to '" << path << "'";
 
-  CHECK_SOME(state::checkpoint(path, info));
+  slave->checkpoint(path, info, false);
 
   // Checkpoint the framework pid, note that we checkpoint a
   // UPID() when it is None (for HTTP schedulers) because
@@ -6396,7 +6499,7 @@ void Framework::checkpointFramework() const
           << " '" << pid.getOrElse(UPID()) << "'"
           << " to '" << path << "'";
 
-  CHECK_SOME(state::checkpoint(path, pid.getOrElse(UPID())));
+  slave->checkpoint(path, pid.getOrElse(UPID()));
 }
 
 
@@ -6899,7 +7002,7 @@ void Executor::checkpointExecutor()
       slave->metaDir, slave->info.id(), frameworkId, id);
 
   VLOG(1) << "Checkpointing ExecutorInfo to '" << path << "'";
-  CHECK_SOME(state::checkpoint(path, info));
+  slave->checkpoint(path, info);
 
   // Create the meta executor directory.
   // NOTE: This creates the 'latest' symlink in the meta directory.
@@ -6908,7 +7011,7 @@ void Executor::checkpointExecutor()
 }
 
 
-void Executor::checkpointTask(const TaskInfo& task)
+void Executor::checkpointTask(const TaskInfo& task, bool commit)
 {
   CHECK(checkpoint);
 
@@ -6922,7 +7025,7 @@ void Executor::checkpointTask(const TaskInfo& task)
       t.task_id());
 
   VLOG(1) << "Checkpointing TaskInfo to '" << path << "'";
-  CHECK_SOME(state::checkpoint(path, t));
+  slave->checkpoint(path, t, commit);
 }
 
 
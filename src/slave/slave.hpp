@@ -436,6 +436,14 @@ public:
   // Returns the resource usage information for all executors.
   virtual process::Future<ResourceUsage> usage();
 
+  // Returns the resource statistics of a container. The statistics
+  // are collected from the containerizer at most once per
+  // '--usage_cache_interval' and shared by all callers, so that
+  // multiple consumers (e.g., the QoS controller, the resource
+  // estimator and HTTP pollers) do not each re-read them.
+  process::Future<ResourceStatistics> containerUsage(
+      const ContainerID& containerId);
+
   // Handle the second phase of shutting down an executor for those
   // executors that have not properly shutdown within a timeout.
   void shutdownExecutorTimeout(
@@ -739,6 +747,43 @@ private:
   void _forwardOversubscribed(
       const process::Future<Resources>& oversubscribable);
 
+  // Checkpoints 't' to 'path' (see `state::checkpoint`). With
+  // '--checkpoint_journal' the checkpoint is appended to the
+  // checkpoint journal instead, and is only durable once committed:
+  // pass 'commit = false' to group the checkpoints of an operation
+  // into a single write, followed by `commitCheckpoints`.
+  template <typename T>
+  void checkpoint(const std::string& path, const T& t, bool commit = true)
+  {
+    if (!flags.checkpoint_journal) {
+      CHECK_SOME(state::checkpoint(path, t));
+      return;
+    }
+
+    if (journal.get() == nullptr) {
+      const std::string journalPath =
+        paths::getCheckpointJournalPath(metaDir, info.id());
+
+      Try<std::shared_ptr<state::Journal>> open =
+        state::Journal::open(journalPath);
+
+      if (open.isError()) {
+        LOG(FATAL) << "Failed to open checkpoint journal '" << journalPath
+                   << "': " << open.error();
+      }
+
+      journal = open.get();
+    }
+
+    journal->add(path, t);
+
+    if (commit) {
+      commitCheckpoints();
+    }
+  }
+
+  void commitCheckpoints();
+
   const Flags flags;
 
   const Http http;
@@ -752,6 +797,21 @@ private:
   // `info.resources()` with checkpointed resources applied.
   Resources totalResources;
 
+  // The latest (or pending) resource statistics of each container,
+  // and when they were collected by the containerizer (None while the
+  // collection is pending).
+  struct ContainerUsage
+  {
+    process::Future<ResourceStatistics> statistics;
+    Option<process::Time> time;
+  };
+
+  hashmap<ContainerID, ContainerUsage> containerUsages;
+
+  // The checkpoint journal, opened on the first checkpoint when
+  // '--checkpoint_journal' is set.
+  std::shared_ptr<state::Journal> journal;
+
   Option<process::UPID> master;
 
   hashmap<FrameworkID, Framework*> frameworks;
@@ -888,7 +948,7 @@ struct Executor
   Task* addTask(const TaskInfo& task);
   void completeTask(const TaskID& taskId);
   void checkpointExecutor();
-  void checkpointTask(const TaskInfo& task);
+  void checkpointTask(const TaskInfo& task, bool commit = true);
   void recoverTask(const state::TaskState& state);
   Try<Nothing> updateTaskState(const TaskStatus& status);
 
@@ -17,12 +17,17 @@
 #include <glog/logging.h>
 
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
 
+#include <process/owned.hpp>
 #include <process/pid.hpp>
 
 #include <stout/check.hpp>
 #include <stout/error.hpp>
 #include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
 #include <stout/none.hpp>
 #include <stout/nothing.hpp>
 #include <stout/numify.hpp>
@@ -34,13 +39,19 @@
 #include <stout/os/bootid.hpp>
 #include <stout/os/close.hpp>
 #include <stout/os/exists.hpp>
+#include <stout/os/fsync.hpp>
 #include <stout/os/ftruncate.hpp>
 #include <stout/os/int_fd.hpp>
 #include <stout/os/ls.hpp>
 #include <stout/os/lseek.hpp>
+#include <stout/os/mktemp.hpp>
+#include <stout/os/open.hpp>
 #include <stout/os/read.hpp>
 #include <stout/os/realpath.hpp>
+#include <stout/os/rename.hpp>
+#include <stout/os/rm.hpp>
 #include <stout/os/stat.hpp>
+#include <stout/os/write.hpp>
 
 #include "messages/messages.hpp"
 
@@ -52,9 +63,60 @@ namespace internal {
 namespace slave {
 namespace state {
 
+using process::Owned;
+
 using std::list;
 using std::max;
 using std::string;
+using std::vector;
+
+
+// Helpers for reading a checkpointed file, whose latest checkpoint
+// might be in the checkpoint journal (i.e., in 'checkpoints') rather
+// than in the file itself.
+static bool exists(const Checkpoints& checkpoints, const string& path)
+{
+  return checkpoints.contains(path) || os::exists(path);
+}
+
+
+static Try<string> read(const Checkpoints& checkpoints, const string& path)
+{
+  if (checkpoints.contains(path)) {
+    return checkpoints.at(path);
+  }
+
+  return os::read(path);
+}
+
+
+template <typename T>
+static Result<T> read(const Checkpoints& checkpoints, const string& path)
+{
+  if (!checkpoints.contains(path)) {
+    return ::protobuf::read<T>(path);
+  }
+
+  // See `internal::serialize` for the format.
+  const string& data = checkpoints.at(path);
+
+  if (data.empty()) {
+    return None();
+  }
+
+  uint32_t size;
+  if (data.size() < sizeof(size)) {
+    return Error("Failed to read size: possible corruption");
+  }
+
+  memcpy(&size, data.data(), sizeof(size));
+
+  if (data.size() - sizeof(size) < size) {
+    return Error("Failed to read message: possible corruption");
+  }
+
+  return ::protobuf::deserialize<T>(data.substr(sizeof(size), size));
+}
 
 
 Try<State> recover(const string& rootDir, bool strict)
@@ -171,6 +233,27 @@ Try<SlaveState> SlaveState::recover(
 
   state.info = slaveInfo.get();
 
+  // Read the checkpoints in the checkpoint journal, if any.
+  Checkpoints checkpoints;
+
+  const string& journal = paths::getCheckpointJournalPath(rootDir, slaveId);
+  if (os::exists(journal)) {
+    Try<Checkpoints> read = Journal::read(journal);
+
+    if (read.isError()) {
+      const string& message = "Failed to read checkpoint journal '" +
+                              journal + "': " + read.error();
+      if (strict) {
+        return Error(message);
+      } else {
+        LOG(WARNING) << message;
+        state.errors++;
+      }
+    } else {
+      checkpoints = read.get();
+    }
+  }
+
   // Find the frameworks.
   Try<list<string>> frameworks = paths::getFrameworkPaths(rootDir, slaveId);
 
@@ -184,8 +267,8 @@ Try<SlaveState> SlaveState::recover(
     FrameworkID frameworkId;
     frameworkId.set_value(Path(path).basename());
 
-    Try<FrameworkState> framework =
-      FrameworkState::recover(rootDir, slaveId, frameworkId, strict);
+    Try<FrameworkState> framework = FrameworkState::recover(
+        rootDir, slaveId, frameworkId, strict, checkpoints);
 
     if (framework.isError()) {
       return Error("Failed to recover framework " + frameworkId.value() +
@@ -204,7 +287,8 @@ Try<FrameworkState> FrameworkState::recover(
     const string& rootDir,
     const SlaveID& slaveId,
     const FrameworkID& frameworkId,
-    bool strict)
+    bool strict,
+    const Checkpoints& checkpoints)
 {
   FrameworkState state;
   state.id = frameworkId;
@@ -212,7 +296,7 @@ Try<FrameworkState> FrameworkState::recover(
 
   // Read the framework info.
   string path = paths::getFrameworkInfoPath(rootDir, slaveId, frameworkId);
-  if (!os::exists(path)) {
+  if (!exists(checkpoints, path)) {
     // This could happen if the slave died after creating the
     // framework directory but before it checkpointed the framework
     // info.
@@ -221,7 +305,7 @@ Try<FrameworkState> FrameworkState::recover(
   }
 
   const Result<FrameworkInfo>& frameworkInfo =
-    ::protobuf::read<FrameworkInfo>(path);
+    read<FrameworkInfo>(checkpoints, path);
 
   if (frameworkInfo.isError()) {
     message = "Failed to read framework info from '" + path + "': " +
@@ -247,14 +331,14 @@ Try<FrameworkState> FrameworkState::recover(
 
   // Read the framework pid.
   path = paths::getFrameworkPidPath(rootDir, slaveId, frameworkId);
-  if (!os::exists(path)) {
+  if (!exists(checkpoints, path)) {
     // This could happen if the slave died after creating the
     // framework info but before it checkpointed the framework pid.
     LOG(WARNING) << "Failed to framework pid file '" << path << "'";
     return state;
   }
 
-  Try<string> pid = os::read(path);
+  Try<string> pid = read(checkpoints, path);
 
   if (pid.isError()) {
     message =
@@ -293,8 +377,8 @@ Try<FrameworkState> FrameworkState::recover(
     ExecutorID executorId;
     executorId.set_value(Path(path).basename());
 
-    Try<ExecutorState> executor =
-      ExecutorState::recover(rootDir, slaveId, frameworkId, executorId, strict);
+    Try<ExecutorState> executor = ExecutorState::recover(
+        rootDir, slaveId, frameworkId, executorId, strict, checkpoints);
 
     if (executor.isError()) {
       return Error("Failed to recover executor '" + executorId.value() +
@@ -314,7 +398,8 @@ Try<ExecutorState> ExecutorState::recover(
     const SlaveID& slaveId,
     const FrameworkID& frameworkId,
     const ExecutorID& executorId,
-    bool strict)
+    bool strict,
+    const Checkpoints& checkpoints)
 {
   ExecutorState state;
   state.id = executorId;
@@ -354,7 +439,13 @@ Try<ExecutorState> ExecutorState::recover(
       containerId.set_value(Path(path).basename());
 
       Try<RunState> run = RunState::recover(
-          rootDir, slaveId, frameworkId, executorId, containerId, strict);
+          rootDir,
+          slaveId,
+          frameworkId,
+          executorId,
+          containerId,
+          strict,
+          checkpoints);
 
       if (run.isError()) {
         return Error(
@@ -380,7 +471,7 @@ Try<ExecutorState> ExecutorState::recover(
   // Read the executor info.
   const string& path =
     paths::getExecutorInfoPath(rootDir, slaveId, frameworkId, executorId);
-  if (!os::exists(path)) {
+  if (!exists(checkpoints, path)) {
     // This could happen if the slave died after creating the executor
     // directory but before it checkpointed the executor info.
     LOG(WARNING) << "Failed to find executor info file '" << path << "'";
@@ -388,7 +479,7 @@ Try<ExecutorState> ExecutorState::recover(
   }
 
   const Result<ExecutorInfo>& executorInfo =
-    ::protobuf::read<ExecutorInfo>(path);
+    read<ExecutorInfo>(checkpoints, path);
 
   if (executorInfo.isError()) {
     message = "Failed to read executor info from '" + path + "': " +
@@ -422,7 +513,8 @@ Try<RunState> RunState::recover(
     const FrameworkID& frameworkId,
     const ExecutorID& executorId,
     const ContainerID& containerId,
-    bool strict)
+    bool strict,
+    const Checkpoints& checkpoints)
 {
   RunState state;
   state.id = containerId;
@@ -457,7 +549,14 @@ Try<RunState> RunState::recover(
     taskId.set_value(Path(path).basename());
 
     Try<TaskState> task = TaskState::recover(
-        rootDir, slaveId, frameworkId, executorId, containerId, taskId, strict);
+        rootDir,
+        slaveId,
+        frameworkId,
+        executorId,
+        containerId,
+        taskId,
+        strict,
+        checkpoints);
 
     if (task.isError()) {
       return Error(
@@ -471,14 +570,14 @@ Try<RunState> RunState::recover(
   // Read the forked pid.
   path = paths::getForkedPidPath(
       rootDir, slaveId, frameworkId, executorId, containerId);
-  if (!os::exists(path)) {
+  if (!exists(checkpoints, path)) {
     // This could happen if the slave died before the isolator
     // checkpointed the forked pid.
     LOG(WARNING) << "Failed to find executor forked pid file '" << path << "'";
     return state;
   }
 
-  Try<string> pid = os::read(path);
+  Try<string> pid = read(checkpoints, path);
 
   if (pid.isError()) {
     message = "Failed to read executor forked pid from '" + path +
@@ -512,8 +611,8 @@ Try<RunState> RunState::recover(
   path = paths::getLibprocessPidPath(
       rootDir, slaveId, frameworkId, executorId, containerId);
 
-  if (os::exists(path)) {
-    pid = os::read(path);
+  if (exists(checkpoints, path)) {
+    pid = read(checkpoints, path);
 
     if (pid.isError()) {
       message = "Failed to read executor libprocess pid from '" + path +
@@ -545,7 +644,7 @@ Try<RunState> RunState::recover(
   path = paths::getExecutorHttpMarkerPath(
       rootDir, slaveId, frameworkId, executorId, containerId);
 
-  if (!os::exists(path)) {
+  if (!exists(checkpoints, path)) {
     // This could happen if the slave died before the executor
     // registered with the slave.
     LOG(WARNING) << "Failed to find executor libprocess pid/http marker file";
@@ -565,7 +664,8 @@ Try<TaskState> TaskState::recover(
     const ExecutorID& executorId,
     const ContainerID& containerId,
     const TaskID& taskId,
-    bool strict)
+    bool strict,
+    const Checkpoints& checkpoints)
 {
   TaskState state;
   state.id = taskId;
@@ -574,14 +674,14 @@ Try<TaskState> TaskState::recover(
   // Read the task info.
   string path = paths::getTaskInfoPath(
       rootDir, slaveId, frameworkId, executorId, containerId, taskId);
-  if (!os::exists(path)) {
+  if (!exists(checkpoints, path)) {
     // This could happen if the slave died after creating the task
     // directory but before it checkpointed the task info.
     LOG(WARNING) << "Failed to find task info file '" << path << "'";
     return state;
   }
 
-  const Result<Task>& task = ::protobuf::read<Task>(path);
+  const Result<Task>& task = read<Task>(checkpoints, path);
 
   if (task.isError()) {
     message = "Failed to read task info from '" + path + "': " + task.error();
@@ -813,6 +913,325 @@ Try<Resources> ResourcesState::recoverResources(
   return resources;
 }
 
+
+
+// Compaction is not worth it for a small journal.
+static const size_t JOURNAL_COMPACTION_MINIMUM_SIZE = 1024 * 1024;
+
+
+// Reads the records of the journal (each framed as with
+// `::protobuf::write`) from 'fd' into 'checkpoints' (by relative
+// path) and returns the offset after the last complete
+// record, ignoring a partially written record at the end.
+static Try<off_t> replay(int_fd fd, hashmap<string, string>* checkpoints)
+{
+  Result<CheckpointRecord> record = None();
+  while (true) {
+    // Ignore errors due to partial protobuf read and enable undoing
+    // failed reads by reverting to the previous seek position.
+    record = ::protobuf::read<CheckpointRecord>(fd, true, true);
+
+    if (!record.isSome()) {
+      break;
+    }
+
+    foreach (const CheckpointRecord::Checkpoint& checkpoint,
+             record->checkpoints()) {
+      (*checkpoints)[checkpoint.path()] = checkpoint.data();
+    }
+  }
+
+  if (record.isError()) {
+    return Error(record.error());
+  }
+
+  return os::lseek(fd, 0, SEEK_CUR);
+}
+
+
+// The open journals by their path, see `Journal::open`.
+static std::mutex* journalsMutex = new std::mutex();
+static hashmap<string, std::weak_ptr<Journal>>* journals =
+  new hashmap<string, std::weak_ptr<Journal>>();
+
+
+Try<std::shared_ptr<Journal>> Journal::open(const string& path)
+{
+  std::lock_guard<std::mutex> lock(*journalsMutex);
+
+  if (journals->contains(path)) {
+    std::shared_ptr<Journal> journal = journals->at(path).lock();
+    if (journal.get() != nullptr) {
+      return journal;
+    }
+  }
+
+  Try<int_fd> fd = os::open(
+      path,
+      O_RDWR | O_CREAT | O_CLOEXEC,
+      S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+
+  if (fd.isError()) {
+    return Error("Failed to open '" + path + "': " + fd.error());
+  }
+
+  std::shared_ptr<Journal> journal(new Journal(path, fd.get()));
+
+  Try<off_t> offset = replay(fd.get(), &journal->checkpoints);
+  if (offset.isError()) {
+    return Error("Failed to read '" + path + "': " + offset.error());
+  }
+
+  // Drop a group that was partially written when the agent died, so
+  // that it does not corrupt the groups appended after it.
+  Try<Nothing> truncated = os::ftruncate(fd.get(), offset.get());
+  if (truncated.isError()) {
+    return Error("Failed to truncate '" + path + "': " + truncated.error());
+  }
+
+  journal->size = offset.get();
+
+  if (journal->size > 0) {
+    Try<Nothing> compact = journal->compact();
+    if (compact.isError()) {
+      return Error("Failed to compact '" + path + "': " + compact.error());
+    }
+  }
+
+  (*journals)[path] = journal;
+
+  return journal;
+}
+
+
+Try<Checkpoints> Journal::read(const string& path)
+{
+  Try<int_fd> fd = os::open(path, O_RDONLY | O_CLOEXEC);
+  if (fd.isError()) {
+    return Error("Failed to open '" + path + "': " + fd.error());
+  }
+
+  hashmap<string, string> checkpoints;
+
+  Try<off_t> offset = replay(fd.get(), &checkpoints);
+
+  os::close(fd.get());
+
+  if (offset.isError()) {
+    return Error(offset.error());
+  }
+
+  const string directory = Path(path).dirname();
+
+  Checkpoints result;
+  foreachpair (const string& file, const string& data, checkpoints) {
+    result[path::join(directory, file)] = data;
+  }
+
+  return result;
+}
+
+
+Try<Nothing> Journal::materialize(const string& path)
+{
+  Try<Checkpoints> checkpoints = read(path);
+  if (checkpoints.isError()) {
+    return Error(checkpoints.error());
+  }
+
+  foreachpair (const string& file, const string& data, checkpoints.get()) {
+    // Skip the files whose directory no longer exists, see `compact`.
+    if (!os::exists(Path(file).dirname())) {
+      continue;
+    }
+
+    Try<Nothing> checkpoint = state::checkpoint(file, data);
+    if (checkpoint.isError()) {
+      return Error(checkpoint.error());
+    }
+  }
+
+  return os::rm(path);
+}
+
+
+Journal::Journal(const string& _path, int_fd _fd)
+  : path(_path),
+    directory(Path(_path).dirname()),
+    fd(_fd),
+    size(0),
+    compacted(0) {}
+
+
+Journal::~Journal()
+{
+  os::close(fd);
+}
+
+
+void Journal::_add(const string& file, string&& data)
+{
+  CHECK(strings::startsWith(file, path::join(directory, "")))
+    << "'" << file << "' is not within '" << directory << "'";
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  CheckpointRecord::Checkpoint* checkpoint = group.add_checkpoints();
+  checkpoint->set_path(file.substr(directory.size() + 1));
+  checkpoint->set_data(std::move(data));
+}
+
+
+Try<Nothing> Journal::commit()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+
+  if (group.checkpoints().empty()) {
+    return Nothing();
+  }
+
+  CheckpointRecord record;
+  record.Swap(&group);
+
+  return _commit(std::move(record));
+}
+
+
+Try<Nothing> Journal::_append(const string& file, string&& data)
+{
+  CHECK(strings::startsWith(file, path::join(directory, "")))
+    << "'" << file << "' is not within '" << directory << "'";
+
+  CheckpointRecord record;
+  CheckpointRecord::Checkpoint* checkpoint = record.add_checkpoints();
+  checkpoint->set_path(file.substr(directory.size() + 1));
+  checkpoint->set_data(std::move(data));
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  return _commit(std::move(record));
+}
+
+
+Try<Nothing> Journal::_commit(CheckpointRecord&& record)
+{
+  foreach (const CheckpointRecord::Checkpoint& checkpoint,
+           record.checkpoints()) {
+    // NOTE: We only create the directory of a file if necessary, as
+    // creating it recursively is much more expensive than a `stat`.
+    const string base = Path(path::join(directory, checkpoint.path())).dirname();
+
+    if (!os::exists(base)) {
+      Try<Nothing> mkdir = os::mkdir(base);
+      if (mkdir.isError()) {
+        return Error(
+            "Failed to create directory '" + base + "': " + mkdir.error());
+      }
+    }
+  }
+
+  const string data = internal::serialize(record);
+
+  Try<Nothing> write = os::write(fd, data);
+  if (write.isError()) {
+    // Remove any partially written data so that subsequent groups
+    // are not appended after it.
+    os::ftruncate(fd, size);
+    os::lseek(fd, size, SEEK_SET);
+
+    return Error("Failed to append to '" + path + "': " + write.error());
+  }
+
+  size += data.size();
+
+  foreach (CheckpointRecord::Checkpoint& checkpoint,
+           *record.mutable_checkpoints()) {
+    checkpoints[checkpoint.path()] = std::move(*checkpoint.mutable_data());
+  }
+
+  if (size > JOURNAL_COMPACTION_MINIMUM_SIZE && size > 2 * compacted) {
+    // NOTE: The group has been committed even if the compaction
+    // fails, the journal is left as is in that case.
+    Try<Nothing> compact = this->compact();
+    if (compact.isError()) {
+      LOG(WARNING) << "Failed to compact checkpoint journal '" << path
+                   << "': " << compact.error();
+    }
+  }
+
+  return Nothing();
+}
+
+
+Try<Nothing> Journal::compact()
+{
+  // Write the latest checkpoints to a temporary file which then
+  // (atomically) replaces the journal, as in `checkpoint`.
+  Try<string> temp = os::mktemp(path::join(directory, "XXXXXX"));
+  if (temp.isError()) {
+    return Error("Failed to create temporary file: " + temp.error());
+  }
+
+  Try<int_fd> _fd = os::open(
+      temp.get(),
+      O_RDWR | O_CLOEXEC,
+      S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+
+  if (_fd.isError()) {
+    os::rm(temp.get());
+    return Error("Failed to open '" + temp.get() + "': " + _fd.error());
+  }
+
+  // Write each checkpoint as its own record to keep the records small.
+  // Files whose directory has been removed are dropped.
+  string data;
+  vector<string> removed;
+
+  foreachpair (const string& file, const string& contents, checkpoints) {
+    if (!os::exists(Path(path::join(directory, file)).dirname())) {
+      removed.push_back(file);
+      continue;
+    }
+
+    CheckpointRecord record;
+    CheckpointRecord::Checkpoint* checkpoint = record.add_checkpoints();
+    checkpoint->set_path(file);
+    checkpoint->set_data(contents);
+
+    data += internal::serialize(record);
+  }
+
+  Try<Nothing> write = os::write(_fd.get(), data);
+  if (write.isSome()) {
+    write = os::fsync(_fd.get());
+  }
+
+  if (write.isError()) {
+    os::close(_fd.get());
+    os::rm(temp.get());
+    return Error("Failed to write '" + temp.get() + "': " + write.error());
+  }
+
+  Try<Nothing> rename = os::rename(temp.get(), path);
+  if (rename.isError()) {
+    os::close(_fd.get());
+    os::rm(temp.get());
+    return Error("Failed to rename '" + temp.get() + "' to '" + path +
+                 "': " + rename.error());
+  }
+
+  os::close(fd);
+  fd = _fd.get();
+
+  foreach (const string& file, removed) {
+    checkpoints.erase(file);
+  }
+
+  size = compacted = data.size();
+
+  return Nothing();
+}
+
 } // namespace state {
 } // namespace slave {
 } // namespace internal {
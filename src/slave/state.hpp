@@ -21,14 +21,18 @@
 #include <unistd.h>
 #endif // __WINDOWS__
 
+#include <memory>
+#include <mutex>
 #include <vector>
 
 #include <mesos/resources.hpp>
 #include <mesos/type_utils.hpp>
 
+#include <process/owned.hpp>
 #include <process/pid.hpp>
 
 #include <stout/hashmap.hpp>
+#include <stout/foreach.hpp>
 #include <stout/hashset.hpp>
 #include <stout/path.hpp>
 #include <stout/protobuf.hpp>
@@ -36,6 +40,7 @@
 #include <stout/utils.hpp>
 #include <stout/uuid.hpp>
 
+#include <stout/os/int_fd.hpp>
 #include <stout/os/mkdir.hpp>
 #include <stout/os/mktemp.hpp>
 #include <stout/os/rename.hpp>
@@ -107,6 +112,46 @@ inline Try<Nothing> checkpoint(
   return checkpoint(path, messages);
 }
 
+
+// Returns the contents of the file written by `checkpoint` above.
+inline std::string serialize(const std::string& message)
+{
+  return message;
+}
+
+
+inline std::string serialize(const google::protobuf::Message& message)
+{
+  // NOTE: This is the same format as `::protobuf::write`, i.e., the
+  // size of the message followed by the message.
+  uint32_t size = message.ByteSize();
+
+  std::string data(reinterpret_cast<const char*>(&size), sizeof(size));
+  message.AppendToString(&data);
+
+  return data;
+}
+
+
+template <typename T>
+std::string serialize(const google::protobuf::RepeatedPtrField<T>& messages)
+{
+  std::string data;
+
+  foreach (const T& message, messages) {
+    data += serialize(message);
+  }
+
+  return data;
+}
+
+
+inline std::string serialize(const Resources& resources)
+{
+  const google::protobuf::RepeatedPtrField<Resource>& messages = resources;
+  return serialize(messages);
+}
+
 }  // namespace internal {
 
 
@@ -168,6 +213,111 @@ Try<Nothing> checkpoint(const std::string& path, const T& t)
 }
 
 
+// The contents of checkpointed files by their path, e.g., the
+// checkpoints found in a `Journal`.
+typedef hashmap<std::string, std::string> Checkpoints;
+
+
+// An append-only journal of checkpoints, to be used instead of
+// `checkpoint` for small files that are checkpointed frequently:
+// rather than creating, writing and renaming a temporary file per
+// checkpoint, each group of checkpoints is a single append to the
+// journal.
+//
+// Checkpoints are added to a group which is then committed with a
+// single write, and a group is recovered either entirely or not at
+// all (e.g., a group that was partially written when the agent died
+// is discarded). This provides the same all-or-nothing semantics as
+// `checkpoint`, for all the files in a group.
+//
+// As the latest checkpoint of a file supersedes the previous ones,
+// the journal is compacted (i.e., rewritten with only the latest
+// checkpoint of each file) when it is opened and whenever it doubles
+// in size since the last compaction. Checkpoints of files whose
+// directory no longer exists (e.g., it was garbage collected) are
+// dropped when compacting.
+//
+// NOTE: The directory of each checkpointed file is still created, as
+// with `checkpoint`, since recovery finds the checkpointed state by
+// walking the directory layout.
+//
+// A journal is shared by all its users within the agent (e.g., the
+// agent checkpoints the tasks and the containerizer checkpoints the
+// forked pid of an executor), and is safe to use concurrently.
+class Journal
+{
+public:
+  // Opens the journal at 'path', creating it if it does not exist,
+  // or returns the journal at 'path' if it is already open.
+  static Try<std::shared_ptr<Journal>> open(const std::string& path);
+
+  // Returns the latest checkpoints in the journal at 'path' by the
+  // (absolute) path of the files.
+  static Try<Checkpoints> read(const std::string& path);
+
+  // Writes the latest checkpoints in the journal at 'path' to their
+  // own files (using `checkpoint`) and then removes the journal.
+  static Try<Nothing> materialize(const std::string& path);
+
+  ~Journal();
+
+  // Adds a checkpoint of 't' at 'path' to the current group, see
+  // `checkpoint` for the supported types. The file must be within
+  // the directory of the journal.
+  template <typename T>
+  void add(const std::string& path, const T& t)
+  {
+    _add(path, internal::serialize(t));
+  }
+
+  // Appends the current group of checkpoints to the journal.
+  Try<Nothing> commit();
+
+  // Appends a checkpoint of 't' at 'path' to the journal as a group
+  // of its own, leaving the current group as is. This is meant for
+  // users of the journal other than the one building the current
+  // group (e.g., the containerizer).
+  template <typename T>
+  Try<Nothing> append(const std::string& path, const T& t)
+  {
+    return _append(path, internal::serialize(t));
+  }
+
+private:
+  Journal(const std::string& path, int_fd fd);
+
+  void _add(const std::string& path, std::string&& data);
+
+  Try<Nothing> _append(const std::string& path, std::string&& data);
+
+  // Writes the group to the journal, compacting it if necessary.
+  Try<Nothing> _commit(CheckpointRecord&& record);
+
+  Try<Nothing> compact();
+
+  const std::string path;
+
+  // Serializes the users of the journal.
+  std::mutex mutex;
+
+  // The directory of the journal, to which the paths of checkpoints
+  // in the journal are relative.
+  const std::string directory;
+
+  int_fd fd;
+
+  // The size of the journal, and its size after the last compaction.
+  size_t size;
+  size_t compacted;
+
+  // The current group of checkpoints.
+  CheckpointRecord group;
+
+  // The latest checkpoint of each file, by its relative path.
+  hashmap<std::string, std::string> checkpoints;
+};
+
+
 // NOTE: The *State structs (e.g., TaskState, RunState, etc) are
 // defined in reverse dependency order because many of them have
 // Option<*State> dependencies which means we need them declared in
@@ -185,7 +335,8 @@ struct TaskState
       const ExecutorID& executorId,
       const ContainerID& containerId,
       const TaskID& taskId,
-      bool strict);
+      bool strict,
+      const Checkpoints& checkpoints);
 
   TaskID id;
   Option<Task> info;
@@ -205,7 +356,8 @@ struct RunState
       const FrameworkID& frameworkId,
       const ExecutorID& executorId,
       const ContainerID& containerId,
-      bool strict);
+      bool strict,
+      const Checkpoints& checkpoints);
 
   Option<ContainerID> id;
   hashmap<TaskID, TaskState> tasks;
@@ -232,7 +384,8 @@ struct ExecutorState
       const SlaveID& slaveId,
       const FrameworkID& frameworkId,
       const ExecutorID& executorId,
-      bool strict);
+      bool strict,
+      const Checkpoints& checkpoints);
 
   ExecutorID id;
   Option<ExecutorInfo> info;
@@ -250,7 +403,8 @@ struct FrameworkState
       const std::string& rootDir,
       const SlaveID& slaveId,
       const FrameworkID& frameworkId,
-      bool strict);
+      bool strict,
+      const Checkpoints& checkpoints);
 
   FrameworkID id;
   Option<FrameworkInfo> info;
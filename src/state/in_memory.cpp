@@ -16,6 +16,8 @@
 
 #include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <mesos/state/in_memory.hpp>
 #include <mesos/state/storage.hpp>
@@ -25,6 +27,7 @@
 #include <process/id.hpp>
 #include <process/process.hpp>
 
+#include <stout/foreach.hpp>
 #include <stout/hashmap.hpp>
 #include <stout/option.hpp>
 #include <stout/uuid.hpp>
@@ -33,7 +36,9 @@ using namespace process;
 
 // Note that we don't add 'using std::set' here because we need
 // 'std::' to disambiguate the 'set' member.
+using std::pair;
 using std::string;
+using std::vector;
 
 using mesos::internal::state::Entry;
 
@@ -88,6 +93,42 @@ public:
     return std::set<string>(keys.begin(), keys.end());
   }
 
+  bool transact(
+      const vector<pair<Entry, UUID>>& sets,
+      const vector<Entry>& expunges)
+  {
+    // Check all the versions first so that nothing gets changed
+    // unless everything can be.
+    foreach (const auto& entry, sets) {
+      const Option<Entry>& option = entries.get(entry.first.name());
+
+      if (option.isSome() &&
+          UUID::fromBytes(option.get().uuid()).get() != entry.second) {
+        return false;
+      }
+    }
+
+    foreach (const Entry& entry, expunges) {
+      const Option<Entry>& option = entries.get(entry.name());
+
+      if (option.isNone() ||
+          UUID::fromBytes(option.get().uuid()).get() !=
+            UUID::fromBytes(entry.uuid()).get()) {
+        return false;
+      }
+    }
+
+    foreach (const auto& entry, sets) {
+      entries.put(entry.first.name(), entry.first);
+    }
+
+    foreach (const Entry& entry, expunges) {
+      entries.erase(entry.name());
+    }
+
+    return true;
+  }
+
 private:
   hashmap<string, Entry> entries;
 };
@@ -132,5 +173,17 @@ Future<std::set<string>> InMemoryStorage::names()
   return dispatch(process, &InMemoryStorageProcess::names);
 }
 
+
+Future<bool> InMemoryStorage::transact(
+    const vector<pair<Entry, UUID>>& entries,
+    const vector<Entry>& expunged)
+{
+  return dispatch(
+      process,
+      &InMemoryStorageProcess::transact,
+      entries,
+      expunged);
+}
+
 } // namespace state {
 } // namespace mesos {
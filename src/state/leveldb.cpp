@@ -15,6 +15,7 @@
 // limitations under the License
 
 #include <leveldb/db.h>
+#include <leveldb/write_batch.h>
 
 #include <google/protobuf/message.h>
 
@@ -22,6 +23,8 @@
 
 #include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <mesos/state/leveldb.hpp>
 #include <mesos/state/storage.hpp>
@@ -32,6 +35,7 @@
 #include <process/process.hpp>
 
 #include <stout/error.hpp>
+#include <stout/foreach.hpp>
 #include <stout/none.hpp>
 #include <stout/option.hpp>
 #include <stout/some.hpp>
@@ -44,7 +48,9 @@ using namespace process;
 
 // Note that we don't add 'using std::set' here because we need
 // 'std::' to disambiguate the 'set' member.
+using std::pair;
 using std::string;
+using std::vector;
 
 using mesos::internal::state::Entry;
 
@@ -65,6 +71,9 @@ public:
   Future<bool> set(const Entry& entry, const UUID& uuid);
   Future<bool> expunge(const Entry& entry);
   Future<std::set<string>> names();
+  Future<bool> transact(
+      const vector<pair<Entry, UUID>>& entries,
+      const vector<Entry>& expunged);
 
 private:
   // Helpers for interacting with leveldb.
@@ -222,6 +231,68 @@ Future<bool> LevelDBStorageProcess::expunge(const Entry& entry)
 }
 
 
+Future<bool> LevelDBStorageProcess::transact(
+    const vector<pair<Entry, UUID>>& entries,
+    const vector<Entry>& expunged)
+{
+  if (error.isSome()) {
+    return Failure(error.get());
+  }
+
+  // Like 'set' and 'expunge' we check all the versions first, and
+  // then apply all the changes in a single (atomic) write batch.
+  leveldb::WriteBatch batch;
+
+  foreach (const auto& entry, entries) {
+    Try<Option<Entry>> option = read(entry.first.name());
+
+    if (option.isError()) {
+      return Failure(option.error());
+    }
+
+    if (option.get().isSome() &&
+        UUID::fromBytes(option.get().get().uuid()).get() != entry.second) {
+      return false;
+    }
+
+    string value;
+
+    if (!entry.first.SerializeToString(&value)) {
+      return Failure("Failed to serialize Entry");
+    }
+
+    batch.Put(entry.first.name(), value);
+  }
+
+  foreach (const Entry& entry, expunged) {
+    Try<Option<Entry>> option = read(entry.name());
+
+    if (option.isError()) {
+      return Failure(option.error());
+    }
+
+    if (option.get().isNone() ||
+        UUID::fromBytes(option.get().get().uuid()).get() !=
+          UUID::fromBytes(entry.uuid()).get()) {
+      return false;
+    }
+
+    batch.Delete(entry.name());
+  }
+
+  leveldb::WriteOptions options;
+  options.sync = true;
+
+  leveldb::Status status = db->Write(options, &batch);
+
+  if (!status.ok()) {
+    return Failure(status.ToString());
+  }
+
+  return true;
+}
+
+
 Try<Option<Entry>> LevelDBStorageProcess::read(const string& name)
 {
   CHECK_NONE(error);
@@ -311,5 +382,17 @@ Future<std::set<string>> LevelDBStorage::names()
   return dispatch(process, &LevelDBStorageProcess::names);
 }
 
+
+Future<bool> LevelDBStorage::transact(
+    const vector<pair<Entry, UUID>>& entries,
+    const vector<Entry>& expunged)
+{
+  return dispatch(
+      process,
+      &LevelDBStorageProcess::transact,
+      entries,
+      expunged);
+}
+
 } // namespace state {
 } // namespace mesos {
@@ -21,6 +21,8 @@
 #include <list>
 #include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <mesos/log/log.hpp>
 
@@ -55,7 +57,9 @@ using namespace process;
 // Note that we don't add 'using std::set' here because we need
 // 'std::' to disambiguate the 'set' member.
 using std::list;
+using std::pair;
 using std::string;
+using std::vector;
 
 using mesos::log::Log;
 
@@ -93,6 +97,9 @@ public:
   Future<bool> set(const Entry& entry, const UUID& uuid);
   Future<bool> expunge(const Entry& entry);
   Future<std::set<string>> names();
+  Future<bool> transact(
+      const vector<pair<Entry, UUID>>& entries,
+      const vector<Entry>& expunged);
 
 protected:
   virtual void finalize();
@@ -110,10 +117,17 @@ private:
   // Helper for performing truncation.
   void truncate();
   Future<Nothing> _truncate();
-  Future<Nothing> __truncate(
+  Future<Nothing> __truncate();
+  Future<Nothing> ___truncate(
       const Log::Position& minimum,
       const Option<Log::Position>& position);
 
+  // Helpers for compacting the log, see '_truncate'.
+  Future<Nothing> compact(const vector<Entry>& entries);
+  Future<Nothing> _compact(
+      const vector<Entry>& entries,
+      const Option<Log::Position>& position);
+
   // Continuations.
   Future<Option<Entry>> _get(const string& name);
 
@@ -132,6 +146,17 @@ private:
 
   Future<std::set<string>> _names();
 
+  Future<bool> _transact(
+      const vector<pair<Entry, UUID>>& entries,
+      const vector<Entry>& expunged);
+  Future<bool> __transact(
+      const vector<pair<Entry, UUID>>& entries,
+      const vector<Entry>& expunged);
+  Future<bool> ___transact(
+      const vector<pair<Entry, UUID>>& entries,
+      const vector<Entry>& expunged,
+      const Option<Log::Position>& position);
+
   Log::Reader reader;
   Log::Writer writer;
 
@@ -360,6 +385,28 @@ Future<Nothing> LogStorageProcess::apply(const list<Log::Entry>& entries)
           break;
         }
 
+        case Operation::TRANSACTION: {
+          CHECK(operation.has_transaction());
+
+          foreach (const Operation& nested,
+                   operation.transaction().operations()) {
+            if (nested.type() == Operation::SNAPSHOT) {
+              CHECK(nested.has_snapshot());
+
+              Snapshot snapshot(entry.position, nested.snapshot().entry());
+              snapshots.put(snapshot.entry.name(), snapshot);
+            } else if (nested.type() == Operation::EXPUNGE) {
+              CHECK(nested.has_expunge());
+              snapshots.erase(nested.expunge().name());
+            } else {
+              return Failure(
+                  "Unexpected operation in transaction: " +
+                  stringify(nested.type()));
+            }
+          }
+          break;
+        }
+
         default:
           return Failure("Unknown operation: " + stringify(operation.type()));
       }
@@ -372,14 +419,21 @@ Future<Nothing> LogStorageProcess::apply(const list<Log::Entry>& entries)
 }
 
 
+// Returns the offset of the position in the log, which lets us
+// measure how many entries there are between two positions.
+static uint64_t offset(const Log::Position& position)
+{
+  uint64_t value = 0;
+  foreach (char byte, position.identity()) {
+    value = (value << 8) | static_cast<unsigned char>(byte);
+  }
+  return value;
+}
+
+
 // TODO(benh): Truncation could be optimized by saving the "oldest"
 // snapshot and only doing a truncation if/when we update that
 // snapshot.
-// TODO(benh): Truncation is not enough to keep the log size small as
-// the log could get very fragmented. We'll need a way to defragment
-// the log as some state entries might not get set over a long period
-// of time and their associated snapshots are causing the log to grow
-// very big.
 void LogStorageProcess::truncate()
 {
   // We lock the truncation since it includes a call to
@@ -392,6 +446,51 @@ void LogStorageProcess::truncate()
 
 
 Future<Nothing> LogStorageProcess::_truncate()
+{
+  // Truncation alone is not enough to keep the log small: a snapshot
+  // that doesn't get set over a long period of time (e.g., the shard
+  // of a long-lived agent in the registry) keeps every entry after it
+  // in the log even if those entries have since been overwritten. So
+  // once less than half of the entries after the oldest snapshot are
+  // still needed (i.e., are a snapshot or one of its diffs) we
+  // "compact/defrag" the log by rewriting the snapshots in the older
+  // half at the end of the log within a single TRANSACTION, applying
+  // any diffs along the way, which lets the truncation move past them.
+  if (index.isSome() && !snapshots.empty()) {
+    Option<uint64_t> minimum = None();
+    std::set<uint64_t> positions;
+    size_t diffs = 0;
+
+    foreachvalue (const Snapshot& snapshot, snapshots) {
+      const uint64_t position = offset(snapshot.position);
+      minimum = min(minimum, position);
+      positions.insert(position);
+      diffs += snapshot.diffs;
+    }
+
+    CHECK_SOME(minimum);
+
+    const uint64_t span = offset(index.get()) - minimum.get() + 1;
+
+    if (span > 2 * (positions.size() + diffs)) {
+      const uint64_t middle = minimum.get() + span / 2;
+
+      vector<Entry> entries;
+      foreachvalue (const Snapshot& snapshot, snapshots) {
+        if (offset(snapshot.position) < middle) {
+          entries.push_back(snapshot.entry);
+        }
+      }
+
+      return compact(entries);
+    }
+  }
+
+  return __truncate();
+}
+
+
+Future<Nothing> LogStorageProcess::__truncate()
 {
   // Determine the minimum necessary position for all the snapshots.
   Option<Log::Position> minimum = None();
@@ -400,18 +499,11 @@ Future<Nothing> LogStorageProcess::_truncate()
     minimum = min(minimum, snapshot.position);
   }
 
-  // TODO(benh): It's possible that the minimum position we've found
-  // will leave a lot of "unnecessary" entries in the log (e.g., a
-  // snapshot that has been overwritten at a later position). In this
-  // circumstance we should "compact/defrag" the log by writing/moving
-  // snapshots to the end of the log first applying any diffs as
-  // necessary.
-
   CHECK_SOME(truncated);
 
   if (minimum.isSome() && minimum.get() > truncated.get()) {
     return writer.truncate(minimum.get())
-      .then(defer(self(), &Self::__truncate, minimum.get(), lambda::_1));
+      .then(defer(self(), &Self::___truncate, minimum.get(), lambda::_1));
 
     // NOTE: Any failure from Log::Writer::truncate doesn't propagate
     // since the expectation is any subsequent Log::Writer::append
@@ -424,7 +516,7 @@ Future<Nothing> LogStorageProcess::_truncate()
 }
 
 
-Future<Nothing> LogStorageProcess::__truncate(
+Future<Nothing> LogStorageProcess::___truncate(
     const Log::Position& minimum,
     const Option<Log::Position>& position)
 {
@@ -440,6 +532,53 @@ Future<Nothing> LogStorageProcess::__truncate(
 }
 
 
+Future<Nothing> LogStorageProcess::compact(const vector<Entry>& entries)
+{
+  VLOG(2) << "Compacting the log (" << entries.size() << " snapshots)";
+
+  // The entries keep their UUIDs so that compacting the log doesn't
+  // change what a subsequent 'set' or 'transact' expects to find.
+  Operation operation;
+  operation.set_type(Operation::TRANSACTION);
+
+  foreach (const Entry& entry, entries) {
+    Operation* nested = operation.mutable_transaction()->add_operations();
+    nested->set_type(Operation::SNAPSHOT);
+    nested->mutable_snapshot()->mutable_entry()->CopyFrom(entry);
+  }
+
+  string value;
+  if (!operation.SerializeToString(&value)) {
+    return Failure("Failed to serialize TRANSACTION Operation");
+  }
+
+  return writer.append(value)
+    .then(defer(self(), &Self::_compact, entries, lambda::_1));
+}
+
+
+Future<Nothing> LogStorageProcess::_compact(
+    const vector<Entry>& entries,
+    const Option<Log::Position>& position)
+{
+  // Like a failed truncation, a failed compaction is simply retried
+  // the next time 'truncate()' gets called.
+  if (position.isNone()) {
+    starting = None(); // Reset 'starting' so we try again.
+    return Nothing();
+  }
+
+  index = max(index, position);
+
+  foreach (const Entry& entry, entries) {
+    Snapshot snapshot(position.get(), entry);
+    snapshots.put(snapshot.entry.name(), snapshot);
+  }
+
+  return __truncate();
+}
+
+
 Future<Option<Entry>> LogStorageProcess::get(const string& name)
 {
   return start()
@@ -658,6 +797,107 @@ Future<std::set<string>> LogStorageProcess::_names()
 }
 
 
+Future<bool> LogStorageProcess::transact(
+    const vector<pair<Entry, UUID>>& entries,
+    const vector<Entry>& expunged)
+{
+  return mutex.lock()
+    .then(defer(self(), &Self::_transact, entries, expunged))
+    .onAny(lambda::bind(&Mutex::unlock, mutex));
+}
+
+
+Future<bool> LogStorageProcess::_transact(
+    const vector<pair<Entry, UUID>>& entries,
+    const vector<Entry>& expunged)
+{
+  return start()
+    .then(defer(self(), &Self::__transact, entries, expunged));
+}
+
+
+Future<bool> LogStorageProcess::__transact(
+    const vector<pair<Entry, UUID>>& entries,
+    const vector<Entry>& expunged)
+{
+  // Check all the versions first, like 'set' and 'expunge' do.
+  foreach (const auto& entry, entries) {
+    Option<Snapshot> snapshot = snapshots.get(entry.first.name());
+
+    if (snapshot.isSome() &&
+        UUID::fromBytes(snapshot.get().entry.uuid()).get() != entry.second) {
+      return false;
+    }
+  }
+
+  foreach (const Entry& entry, expunged) {
+    Option<Snapshot> snapshot = snapshots.get(entry.name());
+
+    if (snapshot.isNone() ||
+        UUID::fromBytes(snapshot.get().entry.uuid()).get() !=
+          UUID::fromBytes(entry.uuid()).get()) {
+      return false;
+    }
+  }
+
+  // Now append a single transaction operation so that all the
+  // snapshots and expunges are applied atomically. Note that we
+  // always write full snapshots here rather than diffs, the entries
+  // used in transactions are expected to be small.
+  Operation operation;
+  operation.set_type(Operation::TRANSACTION);
+
+  foreach (const auto& entry, entries) {
+    Operation* nested = operation.mutable_transaction()->add_operations();
+    nested->set_type(Operation::SNAPSHOT);
+    nested->mutable_snapshot()->mutable_entry()->CopyFrom(entry.first);
+  }
+
+  foreach (const Entry& entry, expunged) {
+    Operation* nested = operation.mutable_transaction()->add_operations();
+    nested->set_type(Operation::EXPUNGE);
+    nested->mutable_expunge()->set_name(entry.name());
+  }
+
+  string value;
+  if (!operation.SerializeToString(&value)) {
+    return Failure("Failed to serialize TRANSACTION Operation");
+  }
+
+  return writer.append(value)
+    .then(defer(self(), &Self::___transact, entries, expunged, lambda::_1));
+}
+
+
+Future<bool> LogStorageProcess::___transact(
+    const vector<pair<Entry, UUID>>& entries,
+    const vector<Entry>& expunged,
+    const Option<Log::Position>& position)
+{
+  if (position.isNone()) {
+    starting = None(); // Reset 'starting' so we try again.
+    return false;
+  }
+
+  index = max(index, position);
+
+  foreach (const auto& entry, entries) {
+    Snapshot snapshot(position.get(), entry.first);
+    snapshots.put(snapshot.entry.name(), snapshot);
+  }
+
+  foreach (const Entry& entry, expunged) {
+    CHECK(snapshots.contains(entry.name()));
+    snapshots.erase(entry.name());
+  }
+
+  // And truncate the log if necessary.
+  truncate();
+
+  return true;
+}
+
+
 LogStorage::LogStorage(Log* log, size_t diffsBetweenSnapshots)
 {
   process = new LogStorageProcess(log, diffsBetweenSnapshots);
@@ -696,5 +936,13 @@ Future<std::set<string>> LogStorage::names()
   return dispatch(process, &LogStorageProcess::names);
 }
 
+
+Future<bool> LogStorage::transact(
+    const vector<pair<Entry, UUID>>& entries,
+    const vector<Entry>& expunged)
+{
+  return dispatch(process, &LogStorageProcess::transact, entries, expunged);
+}
+
 } // namespace state {
 } // namespace mesos {
@@ -357,6 +357,10 @@ public:
 
   virtual ~TestAllocator() {}
 
+  // Explicitly unhide the 'initialize' that takes the options (and
+  // calls the mocked one) to silence a compiler warning from clang.
+  using mesos::allocator::Allocator::initialize;
+
   MOCK_METHOD5(initialize, void(
       const Duration&,
       const lambda::function<
@@ -14,6 +14,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <iostream>
 #include <string>
 #include <tuple>
 
@@ -36,6 +37,7 @@
 #include <stout/jsonify.hpp>
 #include <stout/nothing.hpp>
 #include <stout/recordio.hpp>
+#include <stout/stopwatch.hpp>
 #include <stout/stringify.hpp>
 #include <stout/try.hpp>
 
@@ -89,6 +91,8 @@ using process::Promise;
 
 using recordio::Decoder;
 
+using std::cout;
+using std::endl;
 using std::string;
 using std::tuple;
 using std::vector;
@@ -1761,6 +1765,162 @@ TEST_P(MasterAPITest, Subscribe)
 }
 
 
+// This test verifies that subscribers with different content types
+// that are attached at the same time receive the same events, and that
+// task events are only sent to the subscribers that are authorized to
+// view the task.
+TEST_F(MasterAPITest, SubscribersWithDifferentContentTypes)
+{
+  ACLs acls;
+
+  {
+    // The default principal can see all tasks.
+    mesos::ACL::ViewTask* acl = acls.add_view_tasks();
+    acl->mutable_principals()->add_values(DEFAULT_CREDENTIAL.principal());
+    acl->mutable_users()->set_type(ACL::Entity::ANY);
+  }
+
+  {
+    // No other principal can see tasks running under any user.
+    mesos::ACL::ViewTask* acl = acls.add_view_tasks();
+    acl->mutable_principals()->set_type(ACL::Entity::ANY);
+    acl->mutable_users()->set_type(ACL::Entity::NONE);
+  }
+
+  master::Flags masterFlags = CreateMasterFlags();
+  masterFlags.acls = acls;
+
+  Try<Owned<cluster::Master>> master = StartMaster(masterFlags);
+  ASSERT_SOME(master);
+
+  MockExecutor exec(DEFAULT_EXECUTOR_ID);
+  TestContainerizer containerizer(&exec);
+
+  Owned<MasterDetector> detector = master.get()->createDetector();
+  Try<Owned<cluster::Slave>> slave = StartSlave(detector.get(), &containerizer);
+  ASSERT_SOME(slave);
+
+  // Subscribes to the event stream with the credential and content
+  // type and returns a reader of the decoded events.
+  auto subscribe = [&](const Credential& credential, ContentType contentType)
+      -> Owned<Reader<v1::master::Event>> {
+    v1::master::Call v1Call;
+    v1Call.set_type(v1::master::Call::SUBSCRIBE);
+
+    http::Headers headers = createBasicAuthHeaders(credential);
+    headers["Accept"] = stringify(contentType);
+
+    Future<http::Response> response = http::streaming::post(
+        master.get()->pid,
+        "api/v1",
+        headers,
+        serialize(contentType, v1Call),
+        stringify(contentType));
+
+    AWAIT_EXPECT_RESPONSE_STATUS_EQ(http::OK().status, response);
+    EXPECT_EQ(http::Response::PIPE, response->type);
+    EXPECT_SOME(response->reader);
+
+    auto deserializer =
+      lambda::bind(deserialize<v1::master::Event>, contentType, lambda::_1);
+
+    return Owned<Reader<v1::master::Event>>(new Reader<v1::master::Event>(
+        Decoder<v1::master::Event>(deserializer),
+        response->reader.get()));
+  };
+
+  Owned<Reader<v1::master::Event>> json =
+    subscribe(DEFAULT_CREDENTIAL, ContentType::JSON);
+
+  Owned<Reader<v1::master::Event>> protobuf =
+    subscribe(DEFAULT_CREDENTIAL, ContentType::PROTOBUF);
+
+  Owned<Reader<v1::master::Event>> unauthorized =
+    subscribe(DEFAULT_CREDENTIAL_2, ContentType::PROTOBUF);
+
+  const vector<Owned<Reader<v1::master::Event>>> readers =
+    {json, protobuf, unauthorized};
+
+  foreach (const Owned<Reader<v1::master::Event>>& reader, readers) {
+    Future<Result<v1::master::Event>> event = reader->read();
+    AWAIT_READY(event);
+    ASSERT_SOME(event.get());
+
+    EXPECT_EQ(v1::master::Event::SUBSCRIBED, event->get().type());
+  }
+
+  Future<Result<v1::master::Event>> unauthorizedEvent = unauthorized->read();
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(
+      &sched, DEFAULT_FRAMEWORK_INFO, master.get()->pid, DEFAULT_CREDENTIAL);
+
+  EXPECT_CALL(sched, registered(&driver, _, _));
+
+  Future<vector<Offer>> offers;
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(FutureArg<1>(&offers))
+    .WillRepeatedly(Return()); // Ignore subsequent offers.
+
+  driver.start();
+
+  AWAIT_READY(offers);
+  ASSERT_EQ(1u, offers->size());
+
+  TaskInfo task = createTask(offers.get()[0], "", DEFAULT_EXECUTOR_ID);
+
+  EXPECT_CALL(exec, registered(_, _, _, _));
+
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillOnce(SendStatusUpdateFromTask(TASK_RUNNING));
+
+  Future<TaskStatus> status;
+  EXPECT_CALL(sched, statusUpdate(&driver, _))
+    .WillOnce(FutureArg<1>(&status));
+
+  driver.launchTasks(offers.get()[0].id(), {task});
+
+  AWAIT_READY(status);
+  EXPECT_EQ(TASK_RUNNING, status->state());
+
+  // Both authorized subscribers decode the same `TASK_ADDED` and
+  // `TASK_UPDATED` events, regardless of their content type.
+  const vector<v1::master::Event::Type> types =
+    {v1::master::Event::TASK_ADDED, v1::master::Event::TASK_UPDATED};
+
+  foreach (v1::master::Event::Type type, types) {
+    Future<Result<v1::master::Event>> jsonEvent = json->read();
+    Future<Result<v1::master::Event>> protobufEvent = protobuf->read();
+
+    AWAIT_READY(jsonEvent);
+    AWAIT_READY(protobufEvent);
+
+    ASSERT_SOME(jsonEvent.get());
+    ASSERT_SOME(protobufEvent.get());
+
+    EXPECT_EQ(type, jsonEvent->get().type());
+    EXPECT_EQ(
+        jsonEvent->get().SerializeAsString(),
+        protobufEvent->get().SerializeAsString());
+  }
+
+  // The subscriber that is not authorized to view the task does not
+  // receive any of its events.
+  Clock::pause();
+  Clock::settle();
+
+  EXPECT_TRUE(unauthorizedEvent.isPending());
+
+  Clock::resume();
+
+  EXPECT_CALL(exec, shutdown(_))
+    .Times(AtMost(1));
+
+  driver.stop();
+  driver.join();
+}
+
+
 // This test verifies if we can retrieve the current quota status through
 // `GET_QUOTA` call, after we set quota resources through `SET_QUOTA` call.
 TEST_P(MasterAPITest, GetQuota)
@@ -2306,6 +2466,131 @@ TEST_P(MasterAPITest, ReadFileInvalidPath)
 }
 
 
+class MasterAPISubscribers_BENCHMARK_Test
+  : public MesosTest,
+    public WithParamInterface<size_t> {};
+
+
+// The subscribers benchmark tests are parameterized by the number of
+// clients subscribed to the master's event stream.
+INSTANTIATE_TEST_CASE_P(
+    Subscribers,
+    MasterAPISubscribers_BENCHMARK_Test,
+    ::testing::Values(0U, 1U, 10U, 50U, 100U));
+
+
+// This benchmark measures how long it takes to launch tasks and
+// process their status updates while clients are subscribed to the
+// master's event stream, i.e., the cost of sending the resulting
+// `TASK_ADDED` and `TASK_UPDATED` events to all subscribers.
+TEST_P(MasterAPISubscribers_BENCHMARK_Test, TaskEvents)
+{
+  const size_t subscriberCount = GetParam();
+  const size_t taskCount = 1000;
+
+  Try<Owned<cluster::Master>> master = StartMaster();
+  ASSERT_SOME(master);
+
+  MockExecutor exec(DEFAULT_EXECUTOR_ID);
+  TestContainerizer containerizer(&exec);
+
+  slave::Flags flags = CreateSlaveFlags();
+  flags.resources =
+    "cpus:" + stringify(taskCount) + ";mem:" + stringify(taskCount * 32);
+
+  Owned<MasterDetector> detector = master.get()->createDetector();
+  Try<Owned<cluster::Slave>> slave =
+    StartSlave(detector.get(), &containerizer, flags);
+  ASSERT_SOME(slave);
+
+  // Subscribe the clients, alternating between the content types. The
+  // readers are kept open but never read from during the benchmark.
+  vector<http::Pipe::Reader> readers;
+
+  for (size_t i = 0; i < subscriberCount; i++) {
+    ContentType contentType =
+      i % 2 == 0 ? ContentType::PROTOBUF : ContentType::JSON;
+
+    v1::master::Call v1Call;
+    v1Call.set_type(v1::master::Call::SUBSCRIBE);
+
+    http::Headers headers = createBasicAuthHeaders(DEFAULT_CREDENTIAL);
+    headers["Accept"] = stringify(contentType);
+
+    Future<http::Response> response = http::streaming::post(
+        master.get()->pid,
+        "api/v1",
+        headers,
+        serialize(contentType, v1Call),
+        stringify(contentType));
+
+    AWAIT_EXPECT_RESPONSE_STATUS_EQ(http::OK().status, response);
+    ASSERT_EQ(http::Response::PIPE, response->type);
+    ASSERT_SOME(response->reader);
+
+    readers.push_back(response->reader.get());
+  }
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(
+      &sched, DEFAULT_FRAMEWORK_INFO, master.get()->pid, DEFAULT_CREDENTIAL);
+
+  EXPECT_CALL(sched, registered(&driver, _, _));
+
+  Future<vector<Offer>> offers;
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(FutureArg<1>(&offers))
+    .WillRepeatedly(Return()); // Ignore subsequent offers.
+
+  driver.start();
+
+  AWAIT_READY(offers);
+  ASSERT_EQ(1u, offers->size());
+
+  vector<TaskInfo> tasks;
+
+  for (size_t i = 0; i < taskCount; i++) {
+    TaskInfo task;
+    task.set_name("test");
+    task.mutable_task_id()->set_value(stringify(i));
+    task.mutable_slave_id()->MergeFrom(offers.get()[0].slave_id());
+    task.mutable_resources()->MergeFrom(
+        Resources::parse("cpus:1;mem:32").get());
+    task.mutable_executor()->MergeFrom(DEFAULT_EXECUTOR_INFO);
+
+    tasks.push_back(task);
+  }
+
+  EXPECT_CALL(exec, registered(_, _, _, _));
+
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillRepeatedly(SendStatusUpdateFromTask(TASK_RUNNING));
+
+  EXPECT_CALL(sched, statusUpdate(&driver, _))
+    .Times(taskCount)
+    .WillRepeatedly(Return());
+
+  Stopwatch watch;
+  watch.start();
+
+  driver.launchTasks(offers.get()[0].id(), tasks);
+
+  Clock::pause();
+  Clock::settle();
+
+  cout << "Launching " << taskCount << " tasks took " << watch.elapsed()
+       << " with " << subscriberCount << " subscribers" << endl;
+
+  Clock::resume();
+
+  EXPECT_CALL(exec, shutdown(_))
+    .Times(AtMost(1));
+
+  driver.stop();
+  driver.join();
+}
+
+
 class AgentAPITest
   : public MesosTest,
     public WithParamInterface<ContentType>
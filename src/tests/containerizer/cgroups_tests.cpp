@@ -22,6 +22,7 @@
 #include <string.h>
 #include <unistd.h>
 
+#include <iostream>
 #include <set>
 #include <string>
 #include <thread>
@@ -46,6 +47,7 @@
 #include <stout/os.hpp>
 #include <stout/path.hpp>
 #include <stout/proc.hpp>
+#include <stout/stopwatch.hpp>
 #include <stout/stringify.hpp>
 #include <stout/strings.hpp>
 
@@ -64,6 +66,8 @@ using namespace process;
 using cgroups::memory::pressure::Level;
 using cgroups::memory::pressure::Counter;
 
+using std::cout;
+using std::endl;
 using std::set;
 using std::string;
 using std::vector;
@@ -1032,6 +1036,25 @@ TEST_F(CgroupsAnyHierarchyWithPerfEventTest, ROOT_CGROUPS_PERF_PerfTest)
   ASSERT_TRUE(statistics->at(TEST_CGROUPS_ROOT).has_task_clock());
   EXPECT_LT(0.0, statistics->at(TEST_CGROUPS_ROOT).task_clock());
 
+  // Count the same events in-process.
+  Try<Owned<perf::Counters>> counters =
+    perf::Counters::create(events, path::join(hierarchy, TEST_CGROUPS_ROOT));
+
+  ASSERT_SOME(counters);
+
+  os::sleep(Seconds(1));
+
+  Try<mesos::PerfStatistics> sample = counters.get()->sample();
+  ASSERT_SOME(sample);
+
+  EXPECT_LE(1.0, sample->duration());
+  ASSERT_TRUE(sample->has_cycles());
+  ASSERT_TRUE(sample->has_task_clock());
+
+  // The child is busy looping, i.e., it runs for about as long as
+  // the sample takes (in milliseconds).
+  EXPECT_LT(0.0, sample->task_clock());
+
   // Kill the child process.
   ASSERT_NE(-1, ::kill(pid, SIGKILL));
 
@@ -1044,6 +1067,71 @@ TEST_F(CgroupsAnyHierarchyWithPerfEventTest, ROOT_CGROUPS_PERF_PerfTest)
 }
 
 
+class CgroupsAnyHierarchyWithPerfEvent_BENCHMARK_Test
+  : public CgroupsAnyHierarchyWithPerfEventTest {};
+
+
+// Measures the overhead of sampling many cgroups, with `perf stat`
+// and with in-process counters.
+TEST_F(
+    CgroupsAnyHierarchyWithPerfEvent_BENCHMARK_Test,
+    ROOT_CGROUPS_PERF_Sample)
+{
+  const size_t cgroupCount = 200;
+
+  const string hierarchy = path::join(baseHierarchy, "perf_event");
+
+  set<string> cgroups;
+  for (size_t i = 0; i < cgroupCount; i++) {
+    const string cgroup = path::join(TEST_CGROUPS_ROOT, stringify(i));
+    ASSERT_SOME(cgroups::create(hierarchy, cgroup, true));
+
+    cgroups.insert(cgroup);
+  }
+
+  const set<string> events = {"cycles", "instructions", "task-clock"};
+
+  Stopwatch watch;
+  watch.start();
+
+  Future<hashmap<string, mesos::PerfStatistics>> statistics =
+    perf::sample(events, cgroups, Seconds(0));
+
+  AWAIT_READY(statistics);
+
+  cout << "Sampled " << cgroupCount << " cgroups using perf stat in "
+       << watch.elapsed() << endl;
+
+  vector<Owned<perf::Counters>> counters;
+
+  watch.start();
+
+  foreach (const string& cgroup, cgroups) {
+    Try<Owned<perf::Counters>> _counters =
+      perf::Counters::create(events, path::join(hierarchy, cgroup));
+
+    ASSERT_SOME(_counters);
+    counters.push_back(_counters.get());
+  }
+
+  cout << "Opened counters for " << cgroupCount << " cgroups in "
+       << watch.elapsed() << endl;
+
+  watch.start();
+
+  foreach (const Owned<perf::Counters>& _counters, counters) {
+    ASSERT_SOME(_counters->sample());
+  }
+
+  cout << "Sampled " << cgroupCount << " cgroups using counters in "
+       << watch.elapsed() << endl;
+
+  counters.clear();
+
+  AWAIT_READY(cgroups::destroy(hierarchy, TEST_CGROUPS_ROOT));
+}
+
+
 class CgroupsAnyHierarchyMemoryPressureTest
   : public CgroupsAnyHierarchyTest
 {
@@ -15,19 +15,30 @@
 // limitations under the License.
 
 #include <list>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
 #include <gtest/gtest.h>
 
+#include <process/address.hpp>
 #include <process/future.hpp>
 #include <process/gtest.hpp>
+#include <process/http.hpp>
+#include <process/loop.hpp>
 #include <process/owned.hpp>
+#include <process/socket.hpp>
 #include <process/subprocess.hpp>
 
 #include <stout/duration.hpp>
+#include <stout/hashmap.hpp>
 #include <stout/option.hpp>
 #include <stout/gtest.hpp>
+#include <stout/stringify.hpp>
+#include <stout/synchronized.hpp>
+
+#include <stout/tests/utils.hpp>
 
 #include "docker/docker.hpp"
 
@@ -39,6 +50,8 @@
 
 using namespace process;
 
+namespace unix = process::network::unix;
+
 using std::list;
 using std::string;
 using std::vector;
@@ -942,6 +955,400 @@ TEST_F(DockerTest, ROOT_DOCKER_ConflictingVolumeDrivers)
   ASSERT_TRUE(run.isFailed());
 }
 
+// A fake docker daemon serving the parts of the Docker Engine API
+// used by the `Docker` abstraction on a unix socket. It records the
+// requests that it receives.
+class FakeDockerDaemon
+{
+public:
+  static Try<Owned<FakeDockerDaemon>> create(const string& path)
+  {
+    Try<unix::Socket> server = unix::Socket::create();
+    if (server.isError()) {
+      return Error(server.error());
+    }
+
+    Try<unix::Address> address = unix::Address::create(path);
+    if (address.isError()) {
+      return Error(address.error());
+    }
+
+    Try<unix::Address> bind = server->bind(address.get());
+    if (bind.isError()) {
+      return Error(bind.error());
+    }
+
+    Try<Nothing> listen = server->listen(64);
+    if (listen.isError()) {
+      return Error(listen.error());
+    }
+
+    return Owned<FakeDockerDaemon>(new FakeDockerDaemon(server.get()));
+  }
+
+  ~FakeDockerDaemon()
+  {
+    serving.discard();
+
+    synchronized (state->mutex) {
+      foreach (http::Pipe::Writer writer, state->events) {
+        writer.close();
+      }
+    }
+  }
+
+  // Adds a container which is not started yet.
+  void add(const string& name)
+  {
+    synchronized (state->mutex) {
+      state->containers[name] = false;
+    }
+  }
+
+  // Starts the container and sends the event to the subscribers.
+  void start(const string& name)
+  {
+    synchronized (state->mutex) {
+      state->containers[name] = true;
+
+      foreach (http::Pipe::Writer writer, state->events) {
+        writer.write(
+            "{\"status\":\"start\",\"id\":\"" + name + "-id\","
+            "\"Type\":\"container\",\"Action\":\"start\","
+            "\"Actor\":{\"ID\":\"" + name + "-id\","
+            "\"Attributes\":{\"name\":\"" + name + "\"}}}\n");
+      }
+    }
+  }
+
+  // Ends the streams of events.
+  void interrupt()
+  {
+    synchronized (state->mutex) {
+      foreach (http::Pipe::Writer writer, state->events) {
+        writer.close();
+      }
+
+      state->events.clear();
+    }
+  }
+
+  size_t subscribers()
+  {
+    synchronized (state->mutex) {
+      return state->events.size();
+    }
+  }
+
+  vector<string> requests()
+  {
+    synchronized (state->mutex) {
+      return state->requests;
+    }
+  }
+
+private:
+  struct State
+  {
+    std::mutex mutex;
+    hashmap<string, bool> containers;
+    vector<http::Pipe::Writer> events;
+    vector<string> requests;
+  };
+
+  explicit FakeDockerDaemon(const unix::Socket& server)
+    : state(new State())
+  {
+    std::shared_ptr<State> state = this->state;
+
+    serving = loop(
+        None(),
+        [server]() {
+          unix::Socket socket = server; // Remove const.
+          return socket.accept();
+        },
+        [state](const unix::Socket& socket) -> ControlFlow<Nothing> {
+          http::serve(socket, [state](const http::Request& request) {
+            return handle(state, request);
+          });
+
+          return Continue();
+        });
+  }
+
+  static Future<http::Response> handle(
+      const std::shared_ptr<State>& state,
+      const http::Request& request)
+  {
+    const vector<string> path = strings::tokenize(request.url.path, "/");
+
+    vector<string> query;
+    foreachpair (const string& key, const string& value, request.url.query) {
+      query.push_back(key + "=" + value);
+    }
+
+    synchronized (state->mutex) {
+      state->requests.push_back(
+          request.method + " " + request.url.path +
+          (query.empty() ? "" : "?" + strings::join("&", query)));
+
+      if (request.method == "GET" && request.url.path == "/version") {
+        return http::OK("{\"Version\":\"1.12.3\",\"ApiVersion\":\"1.24\"}");
+      }
+
+      if (request.method == "GET" && request.url.path == "/events") {
+        http::Pipe pipe;
+        state->events.push_back(pipe.writer());
+
+        http::OK ok;
+        ok.type = http::Response::PIPE;
+        ok.reader = pipe.reader();
+        return ok;
+      }
+
+      if (request.method == "GET" && request.url.path == "/containers/json") {
+        JSON::Array array;
+        foreachpair (const string& name, bool started, state->containers) {
+          if (started || request.url.query.contains("all")) {
+            JSON::Object container;
+            container.values["Id"] = name + "-id";
+
+            JSON::Array names;
+            names.values.push_back("/" + name);
+            container.values["Names"] = names;
+            array.values.push_back(container);
+          }
+        }
+
+        return http::OK(stringify(array));
+      }
+
+      if (path.size() < 2 || path[0] != "containers") {
+        return http::NotFound();
+      }
+
+      const string& name = path[1];
+      if (!state->containers.contains(name)) {
+        return http::NotFound(
+            "{\"message\":\"No such container: " + name + "\"}");
+      }
+
+      if (request.method == "GET" && path.size() == 3 && path[2] == "json") {
+        const bool started = state->containers[name];
+
+        return http::OK(
+            "{\"Id\":\"" + name + "-id\",\"Name\":\"/" + name + "\","
+            "\"State\":{\"Pid\":" + (started ? "42" : "0") + ","
+            "\"StartedAt\":\"" +
+            (started ? "2017-01-01T00:00:00Z" : "0001-01-01T00:00:00Z") +
+            "\"},\"NetworkSettings\":{\"IPAddress\":\"\"}}");
+      }
+
+      if (request.method == "POST" && path.size() == 3 &&
+          (path[2] == "stop" || path[2] == "kill")) {
+        if (!state->containers[name]) {
+          return http::Response(http::Status::NOT_MODIFIED);
+        }
+
+        state->containers[name] = false;
+        return http::Response(http::Status::NO_CONTENT);
+      }
+
+      if (request.method == "DELETE" && path.size() == 2) {
+        if (state->containers[name] && !request.url.query.contains("force")) {
+          return http::Conflict(
+              "{\"message\":\"You cannot remove a running container\"}");
+        }
+
+        state->containers.erase(name);
+        return http::Response(http::Status::NO_CONTENT);
+      }
+    }
+
+    return http::NotFound();
+  }
+
+  std::shared_ptr<State> state;
+  Future<Nothing> serving;
+};
+
+
+class DockerEngineTest : public TemporaryDirectoryTest
+{
+protected:
+  virtual void SetUp()
+  {
+    TemporaryDirectoryTest::SetUp();
+
+    socket = path::join(os::getcwd(), "docker.sock");
+
+    Try<Owned<FakeDockerDaemon>> create = FakeDockerDaemon::create(socket);
+    ASSERT_SOME(create);
+    daemon = create.get();
+  }
+
+  virtual void TearDown()
+  {
+    daemon.reset();
+
+    TemporaryDirectoryTest::TearDown();
+  }
+
+  string socket;
+  Owned<FakeDockerDaemon> daemon;
+};
+
+
+// This test verifies that the docker abstraction manages containers
+// using the Docker Engine API rather than the docker CLI.
+TEST_F(DockerEngineTest, Containers)
+{
+  Try<Owned<Docker>> docker =
+    Docker::create("/nonexistent/docker", socket, false, None(), true);
+
+  ASSERT_SOME(docker);
+
+  Future<Version> version = docker.get()->version();
+  AWAIT_EXPECT_EQ(Version(1, 12, 3), version);
+
+  daemon->add(NAME_PREFIX + "-1");
+  daemon->add(NAME_PREFIX + "-2");
+  daemon->add("other");
+
+  daemon->start(NAME_PREFIX + "-1");
+  daemon->start("other");
+
+  Future<Docker::Container> container =
+    docker.get()->inspect(NAME_PREFIX + "-1");
+
+  AWAIT_READY(container);
+  EXPECT_EQ(NAME_PREFIX + "-1-id", container->id);
+  EXPECT_EQ("/" + NAME_PREFIX + "-1", container->name);
+  EXPECT_SOME_EQ(42, container->pid);
+  EXPECT_TRUE(container->started);
+
+  AWAIT_FAILED(docker.get()->inspect("nonexistent"));
+
+  Future<list<Docker::Container>> containers =
+    docker.get()->ps(false, NAME_PREFIX);
+
+  AWAIT_READY(containers);
+  ASSERT_EQ(1u, containers->size());
+  EXPECT_EQ(NAME_PREFIX + "-1-id", containers->front().id);
+
+  containers = docker.get()->ps(true, NAME_PREFIX);
+
+  AWAIT_READY(containers);
+  EXPECT_EQ(2u, containers->size());
+
+  AWAIT_READY(docker.get()->kill(NAME_PREFIX + "-1", SIGTERM));
+
+  // Stopping a container which is not running is not an error.
+  AWAIT_READY(docker.get()->stop(NAME_PREFIX + "-1", Seconds(5)));
+
+  AWAIT_READY(docker.get()->rm(NAME_PREFIX + "-1"));
+  AWAIT_FAILED(docker.get()->rm(NAME_PREFIX + "-1"));
+
+  // A running container is removed forcibly if stopping it fails.
+  AWAIT_FAILED(docker.get()->rm("other"));
+  AWAIT_READY(docker.get()->stop("other", Seconds(0), true));
+
+  containers = docker.get()->ps(true);
+
+  AWAIT_READY(containers);
+  ASSERT_EQ(1u, containers->size());
+  EXPECT_EQ(NAME_PREFIX + "-2-id", containers->front().id);
+
+  const vector<string> requests = daemon->requests();
+
+  EXPECT_NE(
+      std::find(
+          requests.begin(),
+          requests.end(),
+          "POST /containers/" + NAME_PREFIX + "-1/kill?signal=15"),
+      requests.end());
+
+  EXPECT_NE(
+      std::find(
+          requests.begin(),
+          requests.end(),
+          "POST /containers/" + NAME_PREFIX + "-1/stop?t=5"),
+      requests.end());
+}
+
+
+// This test verifies that inspecting a container until it starts
+// waits for the start event rather than the retry interval.
+TEST_F(DockerEngineTest, InspectWaitsForEvent)
+{
+  Try<Owned<Docker>> docker =
+    Docker::create("/nonexistent/docker", socket, false, None(), true);
+
+  ASSERT_SOME(docker);
+
+  // Wait for the subscription to the events.
+  Duration waited = Duration::zero();
+  while (daemon->subscribers() == 0 && waited < Seconds(15)) {
+    os::sleep(Milliseconds(10));
+    waited += Milliseconds(10);
+  }
+
+  ASSERT_EQ(1u, daemon->subscribers());
+
+  const string name = NAME_PREFIX + "-1";
+
+  daemon->add(name);
+
+  Future<Docker::Container> container =
+    docker.get()->inspect(name, Minutes(10));
+
+  // Wait until the container was inspected (and found not started).
+  waited = Duration::zero();
+  while (daemon->requests().size() < 2 && waited < Seconds(15)) {
+    os::sleep(Milliseconds(10));
+    waited += Milliseconds(10);
+  }
+
+  ASSERT_TRUE(container.isPending());
+
+  daemon->start(name);
+
+  AWAIT_READY(container);
+  EXPECT_TRUE(container->started);
+
+  // A container which does not exist yet is inspected again when the
+  // subscription to the events is lost, since events might have been
+  // missed.
+  container = docker.get()->inspect(NAME_PREFIX + "-2", Minutes(10));
+
+  const size_t requests = daemon->requests().size();
+
+  daemon->add(NAME_PREFIX + "-2");
+  daemon->interrupt();
+
+  // Wait until the container was inspected again and the
+  // subscription to the events is restored.
+  waited = Duration::zero();
+  while ((daemon->requests().size() < requests + 2 ||
+          daemon->subscribers() == 0) &&
+         waited < Seconds(15)) {
+    os::sleep(Milliseconds(10));
+    waited += Milliseconds(10);
+  }
+
+  ASSERT_TRUE(container.isPending());
+
+  daemon->start(NAME_PREFIX + "-2");
+
+  AWAIT_READY(container);
+  EXPECT_TRUE(container->started);
+
+  container = docker.get()->inspect(NAME_PREFIX + "-3", Minutes(10));
+  container.discard();
+
+  AWAIT_DISCARDED(container);
+}
+
 } // namespace tests {
 } // namespace internal {
 } // namespace mesos {
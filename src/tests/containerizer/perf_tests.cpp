@@ -16,7 +16,10 @@
 
 #include <sys/prctl.h>
 
+#include <iostream>
 #include <set>
+#include <string>
+#include <vector>
 
 #include <gmock/gmock.h>
 
@@ -25,12 +28,16 @@
 
 #include <stout/gtest.hpp>
 #include <stout/os.hpp>
+#include <stout/stopwatch.hpp>
 #include <stout/stringify.hpp>
 
 #include "linux/perf.hpp"
 
+using std::cout;
+using std::endl;
 using std::set;
 using std::string;
+using std::vector;
 
 using namespace process;
 
@@ -123,6 +130,52 @@ TEST_F(PerfTest, Parse)
 }
 
 
+TEST_F(PerfTest, CountersSupported)
+{
+  EXPECT_TRUE(perf::Counters::supported(
+      {"cycles", "task-clock", "L1-dcache-load-misses", "dTLB-loads"}));
+
+  // Events without a PerfStatistics field, or raw events, can only
+  // be sampled using `perf stat`.
+  EXPECT_FALSE(perf::Counters::supported({"cycles", "cpu-cycles"}));
+  EXPECT_FALSE(perf::Counters::supported({"r003c"}));
+}
+
+
+class Perf_BENCHMARK_Test : public PerfTest {};
+
+
+// Measures parsing a `perf stat` sample of many cgroups.
+TEST_F(Perf_BENCHMARK_Test, Parse)
+{
+  const size_t cgroupCount = 200;
+
+  const vector<string> events = {
+    "cycles", "instructions", "cache-misses", "branch-misses",
+    "task-clock"};
+
+  string output;
+  for (size_t i = 0; i < cgroupCount; i++) {
+    foreach (const string& event, events) {
+      output += "123456789,," + event + ",mesos/" + stringify(i) +
+                ",1000000,100.00\n";
+    }
+  }
+
+  Stopwatch watch;
+  watch.start();
+
+  Try<hashmap<string, mesos::PerfStatistics>> parse =
+    perf::parse(output, Version(4, 1, 0));
+
+  ASSERT_SOME(parse);
+  EXPECT_EQ(cgroupCount, parse->size());
+
+  cout << "Parsed a sample of " << events.size() << " events for "
+       << cgroupCount << " cgroups in " << watch.elapsed() << endl;
+}
+
+
 // Test whether we can parse the perf version. Note that this avoids
 // the "PERF_" filter to verify that we can parse the version even if
 // the version check performed in the test filter fails.
@@ -14,13 +14,19 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <iostream>
+#include <tuple>
+
 #include <process/gtest.hpp>
 
+#include <stout/bytes.hpp>
 #include <stout/foreach.hpp>
+#include <stout/fs.hpp>
 #include <stout/gtest.hpp>
 #include <stout/os.hpp>
 #include <stout/os/permissions.hpp>
 #include <stout/path.hpp>
+#include <stout/stopwatch.hpp>
 #include <stout/strings.hpp>
 
 #include <stout/tests/utils.hpp>
@@ -46,6 +52,8 @@ using mesos::internal::slave::BIND_BACKEND;
 using mesos::internal::slave::COPY_BACKEND;
 using mesos::internal::slave::OVERLAY_BACKEND;
 
+using std::cout;
+using std::endl;
 using std::string;
 using std::vector;
 
@@ -344,6 +352,127 @@ TEST_F(CopyBackendTest, ROOT_CopyBackend)
   EXPECT_FALSE(os::exists(rootfs));
 }
 
+// Provision a rootfs with the copy backend and verify that the
+// metadata (e.g., modes, links) is preserved and whiteouts applied.
+TEST_F(CopyBackendTest, CopyMetadata)
+{
+  string layer1 = path::join(sandbox.get(), "source1");
+  ASSERT_SOME(os::mkdir(path::join(layer1, "dir")));
+  ASSERT_SOME(os::write(path::join(layer1, "dir", "removed"), "removed"));
+  ASSERT_SOME(os::write(path::join(layer1, "dir", "kept"), "kept"));
+
+  string layer2 = path::join(sandbox.get(), "source2");
+  ASSERT_SOME(os::mkdir(path::join(layer2, "dir")));
+  ASSERT_SOME(os::write(path::join(layer2, "dir", ".wh.removed"), ""));
+  ASSERT_SOME(os::write(path::join(layer2, "dir", "file"), "file"));
+  ASSERT_SOME(os::chmod(path::join(layer2, "dir", "file"), 0640));
+  ASSERT_SOME(os::chmod(path::join(layer2, "dir"), 0750));
+
+  ASSERT_EQ(0, ::link(
+      path::join(layer2, "dir", "file").c_str(),
+      path::join(layer2, "link").c_str()));
+
+  ASSERT_SOME(::fs::symlink("dir/file", path::join(layer2, "symlink")));
+
+  string rootfs = path::join(sandbox.get(), "rootfs");
+
+  hashmap<string, Owned<Backend>> backends = Backend::create(slave::Flags());
+  ASSERT_TRUE(backends.contains(COPY_BACKEND));
+
+  AWAIT_READY(backends[COPY_BACKEND]->provision(
+      {layer1, layer2},
+      rootfs,
+      sandbox.get()));
+
+  EXPECT_SOME_EQ("kept", os::read(path::join(rootfs, "dir", "kept")));
+  EXPECT_FALSE(os::exists(path::join(rootfs, "dir", "removed")));
+  EXPECT_FALSE(os::exists(path::join(rootfs, "dir", ".wh.removed")));
+
+  Try<mode_t> mode = os::stat::mode(path::join(rootfs, "dir"));
+  ASSERT_SOME(mode);
+  EXPECT_EQ(0750u, mode.get() & 0777);
+
+  mode = os::stat::mode(path::join(rootfs, "dir", "file"));
+  ASSERT_SOME(mode);
+  EXPECT_EQ(0640u, mode.get() & 0777);
+
+  // The files are copied (rather than linked to the layer) but the
+  // links within the layer are preserved.
+  EXPECT_NE(
+      os::stat::inode(path::join(layer2, "dir", "file")).get(),
+      os::stat::inode(path::join(rootfs, "dir", "file")).get());
+
+  EXPECT_EQ(
+      os::stat::inode(path::join(rootfs, "dir", "file")).get(),
+      os::stat::inode(path::join(rootfs, "link")).get());
+
+  EXPECT_TRUE(os::stat::islink(path::join(rootfs, "symlink")));
+  EXPECT_SOME_EQ("file", os::read(path::join(rootfs, "symlink")));
+
+  AWAIT_READY(backends[COPY_BACKEND]->destroy(rootfs, sandbox.get()));
+
+  EXPECT_FALSE(os::exists(rootfs));
+}
+
+
+class CopyBackend_BENCHMARK_Test
+  : public TemporaryDirectoryTest,
+    public ::testing::WithParamInterface<std::tuple<size_t, Bytes>> {};
+
+
+INSTANTIATE_TEST_CASE_P(
+    FilesAndSize,
+    CopyBackend_BENCHMARK_Test,
+    ::testing::Values(
+        std::make_tuple(5000U, Megabytes(100)),
+        std::make_tuple(50000U, Gigabytes(1))));
+
+
+// Measures provisioning (and destroying) a rootfs from a single layer
+// with many files in 100 directories.
+TEST_P(CopyBackend_BENCHMARK_Test, Provision)
+{
+  size_t files;
+  Bytes size;
+
+  std::tie(files, size) = GetParam();
+
+  const string layer = path::join(sandbox.get(), "layer");
+  const string contents(size.bytes() / files, 'x');
+
+  for (size_t i = 0; i < files; i++) {
+    const string directory = path::join(layer, stringify(i % 100));
+
+    if (i < 100) {
+      ASSERT_SOME(os::mkdir(directory));
+    }
+
+    ASSERT_SOME(os::write(path::join(directory, stringify(i)), contents));
+  }
+
+  hashmap<string, Owned<Backend>> backends = Backend::create(slave::Flags());
+  ASSERT_TRUE(backends.contains(COPY_BACKEND));
+
+  const string rootfs = path::join(sandbox.get(), "rootfs");
+
+  Stopwatch watch;
+  watch.start();
+
+  AWAIT_READY_FOR(
+      backends[COPY_BACKEND]->provision({layer}, rootfs, sandbox.get()),
+      Minutes(10));
+
+  cout << "Provisioned " << files << " files (" << size << ") in "
+       << watch.elapsed() << endl;
+
+  watch.start();
+
+  AWAIT_READY(backends[COPY_BACKEND]->destroy(rootfs, sandbox.get()));
+
+  cout << "Destroyed the rootfs in " << watch.elapsed() << endl;
+}
+
+
 } // namespace tests {
 } // namespace internal {
 } // namespace mesos {
@@ -14,20 +14,36 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <atomic>
+#include <list>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include <gmock/gmock.h>
 
 #include <stout/gtest.hpp>
+#include <stout/hashset.hpp>
 #include <stout/json.hpp>
 #include <stout/os.hpp>
 #include <stout/path.hpp>
 #include <stout/stringify.hpp>
+#include <stout/strings.hpp>
 
 #include <process/future.hpp>
 #include <process/gmock.hpp>
+#include <process/loop.hpp>
 #include <process/owned.hpp>
+#include <process/shared.hpp>
 
 #include <mesos/docker/spec.hpp>
 
+#include <mesos/uri/fetcher.hpp>
+
+#include "common/command_utils.hpp"
+
 #ifdef __linux__
 #include "linux/fs.hpp"
 #endif
@@ -53,6 +69,7 @@ namespace paths = mesos::internal::slave::docker::paths;
 namespace slave = mesos::internal::slave;
 namespace spec = ::docker::spec;
 
+using std::list;
 using std::string;
 using std::vector;
 
@@ -60,6 +77,7 @@ using process::Future;
 using process::Owned;
 using process::PID;
 using process::Promise;
+using process::Shared;
 
 using master::Master;
 
@@ -72,6 +90,7 @@ using mesos::master::detector::MasterDetector;
 using slave::ImageInfo;
 using slave::Slave;
 
+using slave::docker::MetadataManager;
 using slave::docker::Puller;
 using slave::docker::RegistryPuller;
 using slave::docker::Store;
@@ -365,6 +384,407 @@ TEST_F(ProvisionerDockerLocalStoreTest, PullingSameImageSimutanuously)
 }
 
 
+// This test verifies that the metadata manager reports all the images
+// that it stores, including those recovered from disk.
+TEST_F(ProvisionerDockerLocalStoreTest, MetadataManagerImages)
+{
+  slave::Flags flags;
+  flags.docker_store_dir = path::join(os::getcwd(), "store");
+
+  Try<Owned<MetadataManager>> metadataManager =
+    MetadataManager::create(flags);
+
+  ASSERT_SOME(metadataManager);
+
+  Try<spec::ImageReference> abc = spec::parseImageReference("abc");
+  ASSERT_SOME(abc);
+
+  Try<spec::ImageReference> xyz = spec::parseImageReference("xyz");
+  ASSERT_SOME(xyz);
+
+  AWAIT_READY(metadataManager.get()->put(abc.get(), {"123", "456"}));
+  AWAIT_READY(metadataManager.get()->put(xyz.get(), {"123", "789"}));
+
+  Future<slave::docker::Images> images = metadataManager.get()->images();
+  AWAIT_READY(images);
+  EXPECT_EQ(2, images->images_size());
+
+  metadataManager.get().reset();
+  metadataManager = MetadataManager::create(flags);
+  ASSERT_SOME(metadataManager);
+
+  AWAIT_READY(metadataManager.get()->recover());
+
+  images = metadataManager.get()->images();
+  AWAIT_READY(images);
+  ASSERT_EQ(2, images->images_size());
+
+  hashset<string> layerIds;
+  foreach (const slave::docker::Image& image, images->images()) {
+    foreach (const string& layerId, image.layer_ids()) {
+      layerIds.insert(layerId);
+    }
+  }
+
+  EXPECT_EQ(hashset<string>({"123", "456", "789"}), layerIds);
+}
+
+
+class ProvisionerDockerRegistryPullerTest : public TemporaryDirectoryTest
+{
+protected:
+  // A fetcher plugin that serves the manifests and the blobs of a
+  // registry from a directory (rather than over HTTP).
+  class RegistryPlugin : public uri::Fetcher::Plugin
+  {
+  public:
+    explicit RegistryPlugin(const string& _directory)
+      : directory(_directory), blobs(0) {}
+
+    virtual std::set<string> schemes() const
+    {
+      return {"docker-manifest", "docker-blob"};
+    }
+
+    virtual string name() const
+    {
+      return "registry";
+    }
+
+    virtual Future<Nothing> fetch(
+        const URI& uri,
+        const string& directory) const
+    {
+      // NOTE: The path of the URI is the repository and the query is
+      // the reference (i.e., the tag or digest), see 'uri::docker'.
+      string source;
+      string target;
+
+      if (uri.scheme() == "docker-manifest") {
+        source = path::join(this->directory, uri.path(), "manifest");
+        target = path::join(directory, "manifest");
+      } else {
+        source = path::join(this->directory, "blobs", uri.query());
+        target = path::join(directory, uri.query());
+
+        blobs++;
+      }
+
+      Try<string> read = os::read(source);
+      if (read.isError()) {
+        return process::Failure(read.error());
+      }
+
+      Try<Nothing> write = os::write(target, read.get());
+      if (write.isError()) {
+        return process::Failure(write.error());
+      }
+
+      return Nothing();
+    }
+
+    virtual Future<Nothing> stream(
+        const URI& uri,
+        const uri::Fetcher::Consumer& consume) const
+    {
+      Try<string> read =
+        os::read(path::join(this->directory, "blobs", uri.query()));
+
+      if (read.isError()) {
+        return process::Failure(read.error());
+      }
+
+      blobs++;
+
+      // The blob is streamed in small chunks so that the consumer sees
+      // it arrive in pieces, as it would from a registry.
+      const string data = read.get();
+      std::shared_ptr<size_t> offset(new size_t(0));
+
+      return process::loop(
+          [=]() {
+            const string chunk = data.substr(*offset, 1024);
+            *offset += chunk.size();
+            return consume(chunk);
+          },
+          [=](const Nothing&) -> process::ControlFlow<Nothing> {
+            if (*offset < data.size()) {
+              return process::Continue();
+            }
+
+            return process::Break();
+          });
+    }
+
+    const string directory;
+
+    // The number of blobs fetched or streamed.
+    mutable std::atomic_int blobs;
+  };
+
+  virtual void SetUp()
+  {
+    TemporaryDirectoryTest::SetUp();
+
+    registry = path::join(os::getcwd(), "registry");
+    ASSERT_SOME(os::mkdir(path::join(registry, "blobs")));
+
+    plugin = new RegistryPlugin(registry);
+
+    fetcher = Shared<uri::Fetcher>(
+        new uri::Fetcher({Owned<uri::Fetcher::Plugin>(plugin)}));
+
+    flags.docker_registry = "https://registry.example.com";
+    flags.docker_store_dir = path::join(os::getcwd(), "store");
+    flags.image_provisioner_backend = COPY_BACKEND;
+  }
+
+  // Adds a blob with a layer containing the file 'temp' to the
+  // registry, and returns its blob sum.
+  string addBlob(const string& contents)
+  {
+    const string layer = path::join(os::getcwd(), "layer");
+    const string tar = path::join(os::getcwd(), "layer.tar");
+
+    string sha256;
+
+    [&]() {
+      ASSERT_SOME(os::mkdir(layer));
+      ASSERT_SOME(os::write(path::join(layer, "temp"), contents));
+
+      AWAIT_ASSERT_READY(command::tar(Path("."), Path(tar), Path(layer)));
+      ASSERT_SOME(os::rmdir(layer));
+
+#ifdef __linux__
+      Try<string> shasum = os::shell("sha256sum " + tar);
+#else
+      Try<string> shasum = os::shell("shasum -a 256 " + tar);
+#endif // __linux__
+
+      ASSERT_SOME(shasum);
+
+      vector<string> tokens = strings::tokenize(shasum.get(), " ");
+      ASSERT_FALSE(tokens.empty());
+
+      sha256 = tokens[0];
+    }();
+
+    const string blobSum = "sha256:" + sha256;
+
+    EXPECT_SOME(os::rename(tar, path::join(registry, "blobs", blobSum)));
+
+    return blobSum;
+  }
+
+  // Adds the manifest of an image with the given layers (ids and blob
+  // sums, from the child to the parent as in 'fsLayers') to the
+  // registry.
+  void addImage(
+      const string& repository,
+      const vector<std::pair<string, string>>& layers)
+  {
+    JSON::Array fsLayers;
+    JSON::Array history;
+
+    for (size_t i = 0; i < layers.size(); i++) {
+      JSON::Object v1;
+      v1.values["id"] = layers[i].first;
+
+      if (i + 1 < layers.size()) {
+        v1.values["parent"] = layers[i + 1].first;
+      }
+
+      JSON::Object fsLayer;
+      fsLayer.values["blobSum"] = layers[i].second;
+      fsLayers.values.push_back(fsLayer);
+
+      JSON::Object v1Compatibility;
+      v1Compatibility.values["v1Compatibility"] = stringify(v1);
+      history.values.push_back(v1Compatibility);
+    }
+
+    JSON::Object header;
+    header.values["alg"] = "ES256";
+
+    JSON::Object signature;
+    signature.values["header"] = header;
+    signature.values["signature"] = "signature";
+    signature.values["protected"] = "protected";
+
+    JSON::Array signatures;
+    signatures.values.push_back(signature);
+
+    JSON::Object manifest;
+    manifest.values["name"] = repository;
+    manifest.values["tag"] = "latest";
+    manifest.values["architecture"] = "amd64";
+    manifest.values["schemaVersion"] = 1;
+    manifest.values["fsLayers"] = fsLayers;
+    manifest.values["history"] = history;
+    manifest.values["signatures"] = signatures;
+
+    ASSERT_SOME(os::mkdir(path::join(registry, repository)));
+    ASSERT_SOME(os::write(
+        path::join(registry, repository, "manifest"),
+        stringify(manifest)));
+  }
+
+  string registry;
+  RegistryPlugin* plugin;
+  Shared<uri::Fetcher> fetcher;
+  slave::Flags flags;
+};
+
+
+// This test verifies that the registry puller extracts each blob into
+// all the layers extracted from it, and that the layers in the store
+// are reused (rather than fetched again) for other images with layers
+// extracted from the same blobs.
+TEST_F(ProvisionerDockerRegistryPullerTest, ReuseStoredLayers)
+{
+  const string blob1 = addBlob("foo");
+  const string blob2 = addBlob("bar");
+
+  // NOTE: Layers with different ids can be extracted from the same
+  // blob (e.g., empty layers).
+  addImage("abc", {{"456", blob2}, {"234", blob1}, {"123", blob1}});
+  addImage("xyz", {{"789", blob1}});
+
+  Try<Owned<Puller>> puller = RegistryPuller::create(flags, fetcher);
+  ASSERT_SOME(puller);
+
+  Try<Owned<slave::Store>> store = Store::create(flags, puller.get());
+  ASSERT_SOME(store);
+
+  Image image;
+  image.set_type(Image::DOCKER);
+  image.mutable_docker()->set_name("abc");
+
+  Future<ImageInfo> imageInfo = store.get()->get(image, COPY_BACKEND);
+  AWAIT_READY(imageInfo);
+
+  EXPECT_EQ(2, plugin->blobs);
+
+  vector<string> layers;
+  foreach (const string& layerId, vector<string>({"123", "234", "456"})) {
+    layers.push_back(paths::getImageLayerRootfsPath(
+        flags.docker_store_dir,
+        layerId,
+        COPY_BACKEND));
+  }
+
+  EXPECT_EQ(layers, imageInfo->layers);
+
+  EXPECT_SOME_EQ("foo", os::read(path::join(layers[0], "temp")));
+  EXPECT_SOME_EQ("foo", os::read(path::join(layers[1], "temp")));
+  EXPECT_SOME_EQ("bar", os::read(path::join(layers[2], "temp")));
+
+  image.mutable_docker()->set_name("xyz");
+
+  imageInfo = store.get()->get(image, COPY_BACKEND);
+  AWAIT_READY(imageInfo);
+
+  // No blob is fetched for the layer already in the store.
+  EXPECT_EQ(2, plugin->blobs);
+
+  ASSERT_EQ(1u, imageInfo->layers.size());
+  EXPECT_SOME_EQ("foo", os::read(path::join(imageInfo->layers[0], "temp")));
+
+#ifdef __linux__
+  // The files of the layers are hard linked.
+  EXPECT_SOME_EQ(
+      os::stat::inode(path::join(layers[0], "temp")).get(),
+      os::stat::inode(path::join(imageInfo->layers[0], "temp")));
+#endif // __linux__
+}
+
+
+// This test verifies that the registry puller fails to pull an image
+// with a blob that does not match its digest.
+TEST_F(ProvisionerDockerRegistryPullerTest, DigestMismatch)
+{
+  const string blob1 = addBlob("foo");
+  const string blob2 = addBlob("bar");
+
+  ASSERT_SOME(os::rename(
+      path::join(registry, "blobs", blob2),
+      path::join(registry, "blobs", blob1)));
+
+  addImage("abc", {{"123", blob1}});
+
+  Try<Owned<Puller>> puller = RegistryPuller::create(flags, fetcher);
+  ASSERT_SOME(puller);
+
+  Try<Owned<slave::Store>> store = Store::create(flags, puller.get());
+  ASSERT_SOME(store);
+
+  Image image;
+  image.set_type(Image::DOCKER);
+  image.mutable_docker()->set_name("abc");
+
+  AWAIT_FAILED(store.get()->get(image, COPY_BACKEND));
+
+  EXPECT_FALSE(os::exists(paths::getImageLayerRootfsPath(
+      flags.docker_store_dir,
+      "123",
+      COPY_BACKEND)));
+}
+
+
+// This test verifies that the layers in the store are pruned once
+// they are no longer referenced by an image nor by a container.
+TEST_F(ProvisionerDockerRegistryPullerTest, PruneUnreferencedLayers)
+{
+  const string blob1 = addBlob("foo");
+  const string blob2 = addBlob("bar");
+
+  addImage("abc", {{"123", blob1}});
+
+  Try<Owned<Puller>> puller = RegistryPuller::create(flags, fetcher);
+  ASSERT_SOME(puller);
+
+  Try<Owned<slave::Store>> store = Store::create(flags, puller.get());
+  ASSERT_SOME(store);
+
+  Image image;
+  image.set_type(Image::DOCKER);
+  image.mutable_docker()->set_name("abc");
+
+  Future<ImageInfo> imageInfo = store.get()->get(image, COPY_BACKEND);
+  AWAIT_READY(imageInfo);
+
+  ASSERT_EQ(1u, imageInfo->layers.size());
+
+  const string layer1 = imageInfo->layers[0];
+
+  // The image is updated in the registry, after which the layer of
+  // the previous image is only referenced by the container using it.
+  addImage("abc", {{"456", blob2}});
+
+  image.set_cached(false);
+
+  imageInfo = store.get()->get(image, COPY_BACKEND);
+  AWAIT_READY(imageInfo);
+
+  ASSERT_EQ(1u, imageInfo->layers.size());
+
+  const string layer2 = imageInfo->layers[0];
+
+  AWAIT_READY(store.get()->prune({layer1}));
+
+  EXPECT_TRUE(os::exists(layer1));
+  EXPECT_TRUE(os::exists(layer2));
+
+  AWAIT_READY(store.get()->prune(hashset<string>()));
+
+  EXPECT_FALSE(os::exists(layer1));
+  EXPECT_TRUE(os::exists(layer2));
+
+  Try<list<string>> gc = os::ls(paths::getGcDir(flags.docker_store_dir));
+  ASSERT_SOME(gc);
+  EXPECT_TRUE(gc->empty());
+}
+
 #ifdef __linux__
 class ProvisionerDockerPullerTest : public MesosTest {};
 
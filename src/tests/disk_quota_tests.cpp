@@ -14,6 +14,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <iostream>
 #include <string>
 #include <vector>
 
@@ -30,6 +31,7 @@
 #include <stout/gtest.hpp>
 #include <stout/os.hpp>
 #include <stout/path.hpp>
+#include <stout/stopwatch.hpp>
 #include <stout/try.hpp>
 
 #include "master/master.hpp"
@@ -49,11 +51,14 @@
 
 using namespace process;
 
+using std::cout;
+using std::endl;
 using std::string;
 using std::vector;
 
 using testing::_;
 using testing::Return;
+using testing::WithParamInterface;
 
 using mesos::internal::master::Master;
 
@@ -172,6 +177,158 @@ TEST_F(DiskUsageCollectorTest, ExcludeRelativePath)
 #endif
 
 
+// This test verifies that the incremental collector agrees with 'du',
+// including for excluded paths and hard links.
+TEST_F(DiskUsageCollectorTest, IncrementalMatchesDu)
+{
+  const string directory = path::join(os::getcwd(), "directory");
+  ASSERT_SOME(os::mkdir(path::join(directory, "a", "b")));
+
+  ASSERT_SOME(os::write(
+      path::join(directory, "file"),
+      string(Kilobytes(64).bytes(), 'x')));
+
+  ASSERT_SOME(os::write(
+      path::join(directory, "a", "b", "file"),
+      string(Kilobytes(128).bytes(), 'x')));
+
+  ASSERT_SOME(os::write(
+      path::join(directory, "a", "excluded"),
+      string(Kilobytes(256).bytes(), 'x')));
+
+  // A hard link to a file is only counted once.
+  ASSERT_EQ(0, ::link(
+      path::join(directory, "file").c_str(),
+      path::join(directory, "a", "link").c_str()));
+
+  DiskUsageCollector du(Milliseconds(1));
+  DiskUsageCollector incremental(Milliseconds(1), true);
+
+  Future<Bytes> expected = du.usage(directory, {"excluded"});
+  AWAIT_READY(expected);
+
+  Future<Bytes> usage = incremental.usage(directory, {"excluded"});
+  AWAIT_READY(usage);
+
+  // NOTE: 'du' rounds the usage up to kilobytes.
+  EXPECT_LE(usage.get(), expected.get());
+  EXPECT_GT(usage.get() + Kilobytes(1), expected.get());
+
+  EXPECT_GE(usage.get(), Kilobytes(192));
+  EXPECT_LT(usage.get(), Kilobytes(256));
+}
+
+
+// This test verifies that the incremental collector picks up the
+// changes to a directory between checks.
+TEST_F(DiskUsageCollectorTest, IncrementalChanges)
+{
+  const string directory = path::join(os::getcwd(), "directory");
+  ASSERT_SOME(os::mkdir(path::join(directory, "a")));
+
+  const string file = path::join(directory, "a", "file");
+  ASSERT_SOME(os::write(file, string(Kilobytes(64).bytes(), 'x')));
+
+  DiskUsageCollector collector(Milliseconds(1), true);
+
+  Future<Bytes> usage1 = collector.usage(directory, {});
+  AWAIT_READY(usage1);
+  EXPECT_GE(usage1.get(), Kilobytes(64));
+  EXPECT_LT(usage1.get(), Kilobytes(128));
+
+  // Growing a file does not modify its directory.
+  ASSERT_SOME(os::write(file, string(Kilobytes(256).bytes(), 'x')));
+
+  Future<Bytes> usage2 = collector.usage(directory, {});
+  AWAIT_READY(usage2);
+  EXPECT_GE(usage2.get(), Kilobytes(256));
+  EXPECT_LT(usage2.get(), Kilobytes(320));
+
+  // Add a file to a directory which was already listed.
+  ASSERT_SOME(os::write(
+      path::join(directory, "file"),
+      string(Kilobytes(128).bytes(), 'x')));
+
+  Future<Bytes> usage3 = collector.usage(directory, {});
+  AWAIT_READY(usage3);
+  EXPECT_GE(usage3.get(), Kilobytes(384));
+  EXPECT_LT(usage3.get(), Kilobytes(448));
+
+  // Remove a directory which was already listed.
+  ASSERT_SOME(os::rmdir(path::join(directory, "a")));
+
+  Future<Bytes> usage4 = collector.usage(directory, {});
+  AWAIT_READY(usage4);
+  EXPECT_GE(usage4.get(), Kilobytes(128));
+  EXPECT_LT(usage4.get(), Kilobytes(192));
+
+  // Remove the directory itself.
+  ASSERT_SOME(os::rmdir(directory));
+
+  AWAIT_FAILED(collector.usage(directory, {}));
+}
+
+
+class DiskUsageCollector_BENCHMARK_Test
+  : public TemporaryDirectoryTest,
+    public WithParamInterface<size_t> {};
+
+
+INSTANTIATE_TEST_CASE_P(
+    FileCount,
+    DiskUsageCollector_BENCHMARK_Test,
+    ::testing::Values(10000U, 100000U));
+
+
+// Measures repeated checks of a sandbox with many small files in 100
+// directories, using 'du' and using the incremental collector.
+TEST_P(DiskUsageCollector_BENCHMARK_Test, Usage)
+{
+  const size_t fileCount = GetParam();
+  const size_t directoryCount = 100;
+  const size_t checkCount = 5;
+
+  const string sandbox = path::join(os::getcwd(), "sandbox");
+
+  for (size_t i = 0; i < directoryCount; i++) {
+    ASSERT_SOME(os::mkdir(path::join(sandbox, stringify(i))));
+  }
+
+  for (size_t i = 0; i < fileCount; i++) {
+    ASSERT_SOME(os::write(
+        path::join(sandbox, stringify(i % directoryCount), stringify(i)),
+        "x"));
+  }
+
+  // Let the modification times of the directories settle, see the
+  // incremental collector.
+  os::sleep(Seconds(2));
+
+  for (bool incremental : {false, true}) {
+    DiskUsageCollector collector(Milliseconds(1), incremental);
+
+    Stopwatch watch;
+    watch.start();
+
+    Future<Bytes> usage = collector.usage(sandbox, {});
+    AWAIT_READY_FOR(usage, Minutes(5));
+
+    const Duration first = watch.elapsed();
+
+    for (size_t i = 1; i < checkCount; i++) {
+      usage = collector.usage(sandbox, {});
+      AWAIT_READY_FOR(usage, Minutes(5));
+    }
+
+    cout << "Checked the usage (" << usage.get() << ") of " << fileCount
+         << " files " << checkCount << " times "
+         << (incremental ? "incrementally" : "using 'du'") << " in "
+         << watch.elapsed() << " (first check took " << first << ")"
+         << endl;
+  }
+}
+
+
 class DiskQuotaTest : public MesosTest {};
 
 
@@ -14,7 +14,12 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif // __linux__
+
 #include <string>
+#include <vector>
 
 #include <gmock/gmock.h>
 
@@ -26,6 +31,7 @@
 #include <process/pid.hpp>
 #include <process/process.hpp>
 
+#include <stout/foreach.hpp>
 #include <stout/gtest.hpp>
 #include <stout/json.hpp>
 #include <stout/os.hpp>
@@ -53,6 +59,7 @@ using process::http::Response;
 using process::http::Unauthorized;
 
 using std::string;
+using std::vector;
 
 using mesos::http::authentication::BasicAuthenticatorFactory;
 
@@ -238,6 +245,163 @@ TEST_F(FilesTest, ReadTest)
 }
 
 
+// Tests that the raw data of a file, or a range of it, is read with
+// 'format=binary', and that a read of the end of the file waits for
+// it to grow if a timeout is given.
+TEST_F(FilesTest, ReadBinaryTest)
+{
+  Files files;
+  process::UPID upid("files", process::address());
+
+  ASSERT_SOME(os::write("file", "body"));
+  AWAIT_EXPECT_READY(files.attach("file", "myname"));
+
+  Future<Response> response =
+    process::http::get(upid, "read", "path=myname&format=unknown");
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(BadRequest().status, response);
+  AWAIT_EXPECT_RESPONSE_BODY_EQ("Unsupported format 'unknown'.\n", response);
+
+  response = process::http::get(upid, "read", "path=myname&format=binary");
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, response);
+  AWAIT_EXPECT_RESPONSE_HEADER_EQ(
+      "application/octet-stream",
+      "Content-Type",
+      response);
+  AWAIT_EXPECT_RESPONSE_BODY_EQ("body", response);
+
+  process::http::Headers headers;
+  headers["Range"] = "bytes=1-2";
+
+  response = process::http::get(
+      upid, "read", "path=myname&format=binary", headers);
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(
+      process::http::Status::string(process::http::Status::PARTIAL_CONTENT),
+      response);
+  AWAIT_EXPECT_RESPONSE_BODY_EQ("od", response);
+
+  // Without a timeout a read of the end of the file returns right away.
+  headers["Range"] = "bytes=4-";
+
+  response = process::http::get(
+      upid, "read", "path=myname&format=binary", headers);
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(
+      process::http::Status::string(
+          process::http::Status::REQUESTED_RANGE_NOT_SATISFIABLE),
+      response);
+
+  // A read of the end of the file waits for the file to grow.
+  response = process::http::get(
+      upid, "read", "path=myname&format=binary&timeout=1mins", headers);
+
+  // Let the request be processed before appending to the file.
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(
+      OK().status,
+      process::http::get(upid, "read", "path=myname&format=binary"));
+
+  EXPECT_TRUE(response.isPending());
+
+  Try<int_fd> fd = os::open("file", O_WRONLY | O_APPEND | O_CLOEXEC);
+  ASSERT_SOME(fd);
+
+  ASSERT_SOME(os::write(fd.get(), " and more"));
+  ASSERT_SOME(os::close(fd.get()));
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(
+      process::http::Status::string(process::http::Status::PARTIAL_CONTENT),
+      response);
+  AWAIT_EXPECT_RESPONSE_BODY_EQ(" and more", response);
+
+  // The range is still not satisfiable if the file does not grow
+  // before the timeout.
+  headers["Range"] = "bytes=13-";
+
+  response = process::http::get(
+      upid, "read", "path=myname&format=binary&timeout=10ms", headers);
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(
+      process::http::Status::string(
+          process::http::Status::REQUESTED_RANGE_NOT_SATISFIABLE),
+      response);
+
+  // Test binary reads with authorization enabled.
+  auto authorization = [](const Option<string>&) { return false; };
+
+  AWAIT_EXPECT_READY(files.attach("file", "unauthorized", authorization));
+
+  response =
+    process::http::get(upid, "read", "path=unauthorized&format=binary");
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(Forbidden().status, response);
+}
+
+
+#ifdef __linux__
+// Tests that a read of the end of a file still waits for the file to
+// grow when it cannot be watched with inotify (here because the limit
+// of inotify instances was reached), rather than failing right away.
+TEST_F(FilesTest, ReadBinaryWithoutInotifyTest)
+{
+  Files files;
+  process::UPID upid("files", process::address());
+
+  ASSERT_SOME(os::write("file", "body"));
+  AWAIT_EXPECT_READY(files.attach("file", "myname"));
+
+  // Use up the inotify instances available to this user.
+  vector<int> fds;
+  while (fds.size() < 65536) {
+    int fd = ::inotify_init1(IN_CLOEXEC);
+    if (fd < 0) {
+      break;
+    }
+
+    fds.push_back(fd);
+  }
+
+  if (fds.size() == 65536) {
+    foreach (int fd, fds) {
+      os::close(fd);
+    }
+
+    LOG(WARNING) << "Skipping test: failed to exhaust inotify instances";
+    return;
+  }
+
+  process::http::Headers headers;
+  headers["Range"] = "bytes=4-";
+
+  Future<Response> response = process::http::get(
+      upid, "read", "path=myname&format=binary&timeout=1mins", headers);
+
+  // Let the request be processed before appending to the file.
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(
+      OK().status,
+      process::http::get(upid, "read", "path=myname&format=binary"));
+
+  EXPECT_TRUE(response.isPending());
+
+  foreach (int fd, fds) {
+    os::close(fd);
+  }
+
+  Try<int_fd> fd = os::open("file", O_WRONLY | O_APPEND | O_CLOEXEC);
+  ASSERT_SOME(fd);
+
+  ASSERT_SOME(os::write(fd.get(), " and more"));
+  ASSERT_SOME(os::close(fd.get()));
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(
+      process::http::Status::string(process::http::Status::PARTIAL_CONTENT),
+      response);
+  AWAIT_EXPECT_RESPONSE_BODY_EQ(" and more", response);
+}
+#endif // __linux__
+
+
 TEST_F_TEMP_DISABLED_ON_WINDOWS(FilesTest, ResolveTest)
 {
   Files files;
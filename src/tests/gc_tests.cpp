@@ -25,6 +25,7 @@
 #include <mesos/resources.hpp>
 #include <mesos/scheduler.hpp>
 
+#include <process/collect.hpp>
 #include <process/dispatch.hpp>
 #include <process/future.hpp>
 #include <process/gmock.hpp>
@@ -34,11 +35,15 @@
 #include <process/process.hpp>
 #include <process/timeout.hpp>
 
+#include <stout/bytes.hpp>
 #include <stout/duration.hpp>
+#include <stout/foreach.hpp>
 #include <stout/gtest.hpp>
 #include <stout/nothing.hpp>
 #include <stout/os.hpp>
 #include <stout/path.hpp>
+#include <stout/stopwatch.hpp>
+#include <stout/stringify.hpp>
 
 #ifdef __linux__
 #include "linux/fs.hpp"
@@ -74,6 +79,8 @@ using process::Owned;
 using process::PID;
 using process::Timeout;
 
+using std::cout;
+using std::endl;
 using std::list;
 using std::map;
 using std::string;
@@ -83,6 +90,7 @@ using testing::_;
 using testing::AtMost;
 using testing::Return;
 using testing::SaveArg;
+using testing::WithParamInterface;
 
 namespace mesos {
 namespace internal {
@@ -254,6 +262,213 @@ TEST_F(GarbageCollectorTest, Prune)
 }
 
 
+// This test verifies that reclaiming disk space removes the oldest
+// scheduled directories first, and only as many as needed.
+TEST_F(GarbageCollectorTest, Reclaim)
+{
+  GarbageCollector gc;
+
+  // Make some sandboxes with some (nested) files to reclaim, more
+  // than are removed concurrently.
+  const size_t sandboxCount = slave::GC_MAX_CONCURRENT_REMOVALS + 2;
+
+  vector<string> sandboxes;
+  for (size_t i = 0; i < sandboxCount; i++) {
+    const string sandbox = "sandbox" + stringify(i);
+
+    ASSERT_SOME(os::mkdir(path::join(sandbox, "nested")));
+    ASSERT_SOME(os::write(
+        path::join(sandbox, "nested", "stdout"),
+        string(Kilobytes(64).bytes(), 'x')));
+
+    ASSERT_SOME(os::touch(path::join(sandbox, "stderr")));
+
+    sandboxes.push_back(sandbox);
+  }
+
+  Clock::pause();
+
+  vector<Future<Nothing>> schedules;
+  for (size_t i = 0; i < sandboxCount; i++) {
+    schedules.push_back(gc.schedule(Seconds(10 + i), sandboxes[i]));
+  }
+
+  Future<Bytes> reclaim = gc.reclaim(Bytes(1));
+
+  AWAIT_READY(reclaim);
+  EXPECT_LE(Bytes(1), reclaim.get());
+
+  // The oldest sandbox has been removed, while the newest ones (which
+  // would not have been removed concurrently) have not.
+  AWAIT_READY(schedules.front());
+  EXPECT_FALSE(os::exists(sandboxes.front()));
+
+  for (size_t i = slave::GC_MAX_CONCURRENT_REMOVALS; i < sandboxCount; i++) {
+    EXPECT_TRUE(schedules[i].isPending());
+    EXPECT_TRUE(os::exists(sandboxes[i]));
+  }
+
+  // Reclaiming more disk space than is used removes all sandboxes.
+  reclaim = gc.reclaim(Gigabytes(1));
+
+  AWAIT_READY(reclaim);
+
+  for (size_t i = 0; i < sandboxCount; i++) {
+    AWAIT_READY(schedules[i]);
+    EXPECT_FALSE(os::exists(sandboxes[i]));
+  }
+
+  // There is nothing left to reclaim.
+  AWAIT_EXPECT_EQ(Bytes(0), gc.reclaim(Bytes(1)));
+
+  JSON::Object metrics = Metrics();
+
+  EXPECT_EQ(sandboxCount, metrics.values["gc/path_removals_succeeded"]);
+  EXPECT_EQ(0u, metrics.values["gc/path_removals_failed"]);
+  EXPECT_EQ(0u, metrics.values["gc/path_removals_pending"]);
+  EXPECT_EQ(0u, metrics.values["gc/path_removals_active"]);
+
+  Clock::resume();
+}
+
+
+// This test verifies that directories nested deeper than those kept
+// open during the removal are removed as well.
+TEST_F(GarbageCollectorTest, DeepDirectory)
+{
+  GarbageCollector gc;
+
+  string directory = "sandbox";
+  for (size_t i = 0; i < 2 * slave::GC_MAX_OPEN_DIRECTORIES; i++) {
+    directory = path::join(directory, stringify(i));
+
+    ASSERT_SOME(os::mkdir(directory));
+    ASSERT_SOME(os::touch(path::join(directory, "stdout")));
+  }
+
+  Clock::pause();
+
+  Future<Nothing> schedule = gc.schedule(Seconds(10), "sandbox");
+
+  Clock::advance(Seconds(10));
+
+  AWAIT_READY(schedule);
+  EXPECT_FALSE(os::exists("sandbox"));
+
+  Clock::resume();
+}
+
+
+// This test verifies that unscheduling a path that is being removed
+// waits for the removal to finish, so that the path can't be
+// recreated meanwhile.
+TEST_F(GarbageCollectorTest, UnscheduleWhileRemoving)
+{
+  GarbageCollector gc;
+
+  const string& sandbox = "sandbox";
+
+  ASSERT_SOME(os::mkdir(sandbox));
+
+  for (size_t i = 0; i < 1000; i++) {
+    ASSERT_SOME(os::touch(path::join(sandbox, stringify(i))));
+  }
+
+  Clock::pause();
+
+  Future<Nothing> schedule = gc.schedule(Seconds(10), sandbox);
+
+  // Reclaiming disk space starts removing the sandbox right away,
+  // i.e., before the sandbox is unscheduled.
+  Future<Bytes> reclaim = gc.reclaim(Bytes(1));
+
+  AWAIT_EXPECT_FALSE(gc.unschedule(sandbox));
+
+  EXPECT_TRUE(schedule.isReady());
+  EXPECT_FALSE(os::exists(sandbox));
+
+  AWAIT_READY(reclaim);
+
+  Clock::resume();
+}
+
+
+class GarbageCollector_BENCHMARK_Test
+  : public TemporaryDirectoryTest,
+    public WithParamInterface<size_t> {};
+
+
+// The garbage collector benchmark tests are parameterized by the
+// number of sandboxes to remove.
+INSTANTIATE_TEST_CASE_P(
+    SandboxCount,
+    GarbageCollector_BENCHMARK_Test,
+    ::testing::Values(1000U, 10000U, 100000U));
+
+
+// Measures the time to remove sandboxes that are due for removal at
+// the same time (e.g., when pruning under disk pressure), compared to
+// removing them one after the other with `os::rmdir`.
+TEST_P(GarbageCollector_BENCHMARK_Test, RemoveSandboxes)
+{
+  const size_t sandboxCount = GetParam();
+
+  // Each sandbox resembles that of a command task: the executor's
+  // output as well as a (small) file written by the task.
+  auto create = [](const string& sandbox) -> Try<Nothing> {
+    Try<Nothing> mkdir = os::mkdir(path::join(sandbox, "data"));
+    if (mkdir.isError()) {
+      return mkdir;
+    }
+
+    foreach (const string& file, vector<string>({"stdout", "stderr"})) {
+      Try<Nothing> write =
+        os::write(path::join(sandbox, file), "Starting task\n");
+
+      if (write.isError()) {
+        return write;
+      }
+    }
+
+    return os::write(path::join(sandbox, "data", "output"), "data");
+  };
+
+  vector<string> sandboxes;
+  for (size_t i = 0; i < sandboxCount; i++) {
+    sandboxes.push_back(path::join("run", stringify(i)));
+    ASSERT_SOME(create(sandboxes.back()));
+  }
+
+  Stopwatch watch;
+  watch.start();
+
+  foreach (const string& sandbox, sandboxes) {
+    ASSERT_SOME(os::rmdir(sandbox, true, true, true));
+  }
+
+  cout << "Removed " << sandboxCount << " sandboxes sequentially in "
+       << watch.elapsed() << endl;
+
+  foreach (const string& sandbox, sandboxes) {
+    ASSERT_SOME(create(sandbox));
+  }
+
+  GarbageCollector gc;
+
+  watch.start();
+
+  list<Future<Nothing>> schedules;
+  foreach (const string& sandbox, sandboxes) {
+    schedules.push_back(gc.schedule(Seconds(0), sandbox));
+  }
+
+  AWAIT_READY_FOR(collect(schedules), Minutes(10));
+
+  cout << "Removed " << sandboxCount << " sandboxes by the garbage "
+       << "collector in " << watch.elapsed() << endl;
+}
+
+
 class GarbageCollectorIntegrationTest : public MesosTest {};
 
 
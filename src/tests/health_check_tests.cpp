@@ -14,12 +14,19 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <atomic>
+#include <memory>
+
 #include <mesos/executor.hpp>
 #include <mesos/scheduler.hpp>
 
 #include <process/future.hpp>
 #include <process/owned.hpp>
 #include <process/pid.hpp>
+#include <process/queue.hpp>
+#include <process/socket.hpp>
+
+#include <stout/stopwatch.hpp>
 
 #include "checks/health_checker.hpp"
 
@@ -42,6 +49,7 @@
 #endif // __linux__
 
 namespace http = process::http;
+namespace inet = process::network::inet;
 
 using mesos::internal::master::Master;
 
@@ -60,13 +68,18 @@ using mesos::slave::ContainerTermination;
 using process::Future;
 using process::Owned;
 using process::PID;
+using process::Promise;
+using process::Queue;
 using process::Shared;
 
 using testing::_;
 using testing::AtMost;
 using testing::Eq;
 using testing::Return;
+using testing::WithParamInterface;
 
+using std::cout;
+using std::endl;
 using std::vector;
 using std::queue;
 using std::string;
@@ -2105,6 +2118,242 @@ TEST_F(HealthCheckTest, ROOT_DOCKER_DockerHealthyTaskViaTCP)
   }
 }
 
+
+// Serves the given HTTP response on every connection accepted on the
+// (listening) socket.
+static void serve(inet::Socket server, const string& response)
+{
+  server.accept()
+    .onReady([server, response](const inet::Socket& accepted) {
+      inet::Socket socket = accepted;
+
+      // Receive the request before sending the response, so that
+      // closing the connection does not reset it.
+      socket.recv()
+        .then([socket, response](const string&) mutable {
+          return socket.send(response);
+        });
+
+      serve(server, response);
+    });
+}
+
+
+// Returns a socket listening on an ephemeral port of the address the
+// health checks are performed against.
+static Try<inet::Socket> listen()
+{
+  Try<inet::Socket> server = inet::Socket::create();
+  if (server.isError()) {
+    return Error(server.error());
+  }
+
+  Try<inet::Address> address =
+    server->bind(inet::Address(net::IP::parse("127.0.0.1", AF_INET).get(), 0));
+
+  if (address.isError()) {
+    return Error(address.error());
+  }
+
+  Try<Nothing> listen = server->listen(128);
+  if (listen.isError()) {
+    return Error(listen.error());
+  }
+
+  return server;
+}
+
+
+// Verifies that the HTTP health checks performed in-process consider
+// the response code as curl did.
+TEST_F(HealthCheckTest, HealthyTaskViaInProcessHTTP)
+{
+  Try<inet::Socket> unhealthy = listen();
+  ASSERT_SOME(unhealthy);
+
+  Try<inet::Socket> healthy = listen();
+  ASSERT_SOME(healthy);
+
+  serve(
+      unhealthy.get(),
+      "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n");
+
+  serve(healthy.get(), "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n");
+
+  HealthCheck healthCheck;
+  healthCheck.set_type(HealthCheck::HTTP);
+  healthCheck.set_delay_seconds(0);
+  healthCheck.set_interval_seconds(0);
+  healthCheck.set_grace_period_seconds(0);
+  healthCheck.mutable_http()->set_path("/health");
+
+  TaskID taskId;
+  taskId.set_value("1");
+
+  Queue<TaskHealthStatus> statuses;
+
+  lambda::function<void(const TaskHealthStatus&)> callback =
+    [statuses](const TaskHealthStatus& status) mutable {
+      statuses.put(status);
+    };
+
+  healthCheck.mutable_http()->set_port(unhealthy->address()->port);
+
+  Try<Owned<checks::HealthChecker>> checker = checks::HealthChecker::create(
+      healthCheck,
+      getLauncherDir(),
+      callback,
+      taskId,
+      None(),
+      vector<string>());
+
+  ASSERT_SOME(checker);
+
+  Future<TaskHealthStatus> status = statuses.get();
+
+  AWAIT_READY(status);
+  EXPECT_EQ(taskId, status->task_id());
+  EXPECT_FALSE(status->healthy());
+
+  checker->reset();
+
+  healthCheck.mutable_http()->set_port(healthy->address()->port);
+
+  checker = checks::HealthChecker::create(
+      healthCheck,
+      getLauncherDir(),
+      callback,
+      taskId,
+      None(),
+      vector<string>());
+
+  ASSERT_SOME(checker);
+
+  // Skip the statuses sent by the first checker before it stopped.
+  do {
+    status = statuses.get();
+    AWAIT_READY(status);
+  } while (!status->healthy());
+
+  EXPECT_EQ(taskId, status->task_id());
+}
+
+
+class HealthCheck_BENCHMARK_Test
+  : public MesosTest,
+    public WithParamInterface<std::tr1::tuple<HealthCheck::Type, size_t>> {};
+
+
+// The health check benchmark tests are parameterized by the type of
+// the health checks and the number of health checkers (i.e., tasks).
+INSTANTIATE_TEST_CASE_P(
+    TypeAndCheckerCount,
+    HealthCheck_BENCHMARK_Test,
+    ::testing::Combine(
+      ::testing::Values(
+          HealthCheck::COMMAND,
+          HealthCheck::HTTP,
+          HealthCheck::TCP),
+      ::testing::Values(10U, 100U, 200U))
+    );
+
+
+// Measures the overhead of performing health checks from an executor
+// on the agent. All health checks fail immediately (which is reported
+// to the executor for each of them) so that the time taken is spent
+// performing them rather than waiting for the task.
+TEST_P(HealthCheck_BENCHMARK_Test, Overhead)
+{
+  const HealthCheck::Type type = std::tr1::get<0>(GetParam());
+  const size_t checkerCount = std::tr1::get<1>(GetParam());
+
+  const size_t CHECKS_PER_CHECKER = 10;
+
+  HealthCheck healthCheck;
+  healthCheck.set_type(type);
+  healthCheck.set_delay_seconds(0);
+  healthCheck.set_interval_seconds(0);
+  healthCheck.set_grace_period_seconds(0);
+
+  // NOTE: The sockets are kept open until the end of the test.
+  Try<inet::Socket> server = listen();
+  ASSERT_SOME(server);
+
+  Try<inet::Socket> closed = inet::Socket::create();
+  ASSERT_SOME(closed);
+
+  switch (type) {
+    case HealthCheck::COMMAND: {
+      healthCheck.mutable_command()->set_value("exit 1");
+      break;
+    }
+    case HealthCheck::HTTP: {
+      serve(
+          server.get(),
+          "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n");
+
+      healthCheck.mutable_http()->set_port(server->address()->port);
+      break;
+    }
+    case HealthCheck::TCP: {
+      // A port that is bound but not listened on refuses connections.
+      Try<inet::Address> address = closed->bind(
+          inet::Address(net::IP::parse("127.0.0.1", AF_INET).get(), 0));
+
+      ASSERT_SOME(address);
+
+      healthCheck.mutable_tcp()->set_port(address->port);
+      break;
+    }
+    case HealthCheck::UNKNOWN: {
+      FAIL() << "Unexpected health check type";
+    }
+  }
+
+  const size_t total = checkerCount * CHECKS_PER_CHECKER;
+
+  std::shared_ptr<std::atomic<size_t>> performed(new std::atomic<size_t>(0));
+  std::shared_ptr<Promise<Nothing>> done(new Promise<Nothing>());
+
+  lambda::function<void(const TaskHealthStatus&)> callback =
+    [performed, done, total](const TaskHealthStatus& status) {
+      if (++(*performed) == total) {
+        done->set(Nothing());
+      }
+    };
+
+  Stopwatch watch;
+  watch.start();
+
+  vector<Owned<checks::HealthChecker>> checkers;
+  checkers.reserve(checkerCount);
+
+  for (size_t i = 0; i < checkerCount; i++) {
+    TaskID taskId;
+    taskId.set_value(stringify(i));
+
+    Try<Owned<checks::HealthChecker>> checker = checks::HealthChecker::create(
+        healthCheck,
+        getLauncherDir(),
+        callback,
+        taskId,
+        None(),
+        vector<string>());
+
+    ASSERT_SOME(checker);
+
+    checkers.push_back(checker.get());
+  }
+
+  AWAIT_READY_FOR(done->future(), Minutes(5));
+
+  cout << "Performed " << total << " " << HealthCheck::Type_Name(type)
+       << " health checks with " << checkerCount << " checkers in "
+       << watch.elapsed() << endl;
+
+  checkers.clear();
+}
+
 } // namespace tests {
 } // namespace internal {
 } // namespace mesos {
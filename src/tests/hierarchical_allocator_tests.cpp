@@ -173,12 +173,17 @@ protected:
         };
     }
 
+    mesos::allocator::Options options;
+    options.allocationInterval = flags.allocation_interval;
+    options.fairnessExcludeResourceNames =
+      flags.fair_sharing_excluded_resource_names;
+    options.allocationParallelism = flags.allocation_parallelism;
+
     allocator->initialize(
-        flags.allocation_interval,
+        options,
         offerCallback.get(),
         inverseOfferCallback.get(),
-        {},
-        flags.fair_sharing_excluded_resource_names);
+        {});
   }
 
   SlaveInfo createSlaveInfo(const Resources& resources)
@@ -3721,6 +3726,64 @@ TEST_F(HierarchicalAllocatorTest, DisproportionateQuotaVsAllocation)
 }
 
 
+// Tests that when allocating in parallel the resources of the agents
+// are offered as they would be by a serial allocation, i.e., that the
+// frameworks that are not eligible for the resources of an agent (here
+// because the agent has GPUs) are skipped.
+TEST_F(HierarchicalAllocatorTest, AllocationParallelism)
+{
+  // Pausing the clock is not necessary, but ensures that the test
+  // doesn't rely on the batch allocation in the allocator, which
+  // would slow down the test.
+  Clock::pause();
+
+  master::Flags flags_;
+  flags_.allocation_parallelism = 4;
+
+  initialize(flags_);
+
+  SlaveInfo agent1 = createSlaveInfo("cpus:2;mem:1024;disk:0;gpus:1");
+  allocator->addSlave(agent1.id(), agent1, None(), agent1.resources(), {});
+
+  SlaveInfo agent2 = createSlaveInfo("cpus:2;mem:1024;disk:0;gpus:1");
+  allocator->addSlave(agent2.id(), agent2, None(), agent2.resources(), {});
+
+  SlaveInfo agent3 = createSlaveInfo("cpus:2;mem:1024;disk:0");
+  allocator->addSlave(agent3.id(), agent3, None(), agent3.resources(), {});
+
+  SlaveInfo agent4 = createSlaveInfo("cpus:2;mem:1024;disk:0");
+  allocator->addSlave(agent4.id(), agent4, None(), agent4.resources(), {});
+
+  // Wait for the agents to be added so that all of them take part in
+  // the allocation triggered by adding the framework.
+  Clock::settle();
+
+  // framework1 is not capable of receiving GPUs, hence it is only
+  // offered the resources of the agents without GPUs.
+  FrameworkInfo framework1 = createFrameworkInfo("role1");
+  allocator->addFramework(framework1.id(), framework1, {}, true);
+
+  Allocation expected = Allocation(
+      framework1.id(),
+      {{"role1", {{agent3.id(), agent3.resources()},
+                  {agent4.id(), agent4.resources()}}}});
+
+  AWAIT_EXPECT_EQ(expected, allocations.get());
+
+  FrameworkInfo framework2 = createFrameworkInfo(
+      "role1", {FrameworkInfo::Capability::GPU_RESOURCES});
+
+  allocator->addFramework(framework2.id(), framework2, {}, true);
+
+  expected = Allocation(
+      framework2.id(),
+      {{"role1", {{agent1.id(), agent1.resources()},
+                  {agent2.id(), agent2.resources()}}}});
+
+  AWAIT_EXPECT_EQ(expected, allocations.get());
+}
+
+
 class HierarchicalAllocatorTestWithParam
   : public HierarchicalAllocatorTestBase,
     public WithParamInterface<bool> {};
@@ -4602,6 +4665,239 @@ TEST_P(HierarchicalAllocator_BENCHMARK_Test, AllocatorBacklog)
        << " allocation runs" << endl;
 }
 
+
+// This benchmark measures allocation runs in a busy cluster where the
+// resources of almost all agents are in use. Every round a small number
+// of agents free up some resources, and the subsequent allocation run
+// should only pay for those agents and for the allocations it makes.
+TEST_P(HierarchicalAllocator_BENCHMARK_Test, BusyCluster)
+{
+  size_t agentCount = std::tr1::get<0>(GetParam());
+  size_t frameworkCount = std::tr1::get<1>(GetParam());
+
+  // Pause the clock because we want to manually drive the allocations.
+  Clock::pause();
+
+  struct OfferedResources
+  {
+    FrameworkID   frameworkId;
+    SlaveID       slaveId;
+    Resources     resources;
+  };
+
+  vector<OfferedResources> offers;
+
+  auto offerCallback = [&offers](
+      const FrameworkID& frameworkId,
+      const hashmap<string, hashmap<SlaveID, Resources>>& resources_)
+  {
+    foreachkey (const string& role, resources_) {
+      foreachpair (const SlaveID& slaveId,
+                   const Resources& resources,
+                   resources_.at(role)) {
+        offers.push_back(OfferedResources{frameworkId, slaveId, resources});
+      }
+    }
+  };
+
+  cout << "Using " << agentCount << " agents and "
+       << frameworkCount << " frameworks" << endl;
+
+  initialize(master::Flags(), offerCallback);
+
+  vector<FrameworkInfo> frameworks;
+  frameworks.reserve(frameworkCount);
+
+  for (size_t i = 0; i < frameworkCount; i++) {
+    frameworks.push_back(createFrameworkInfo("*"));
+    allocator->addFramework(frameworks[i].id(), frameworks[i], {}, true);
+  }
+
+  const Resources agentResources =
+    Resources::parse("cpus:24;mem:4096;disk:4096").get();
+
+  // All the resources of each agent are in use by a single framework.
+  // We round-robin through the frameworks when allocating.
+  const Resources allocation = allocatedResources(agentResources, "*");
+
+  // The resources that a task finishing on an agent frees up.
+  const Resources task =
+    allocatedResources(Resources::parse("cpus:2;mem:512").get(), "*");
+
+  vector<SlaveInfo> agents;
+  agents.reserve(agentCount);
+
+  for (size_t i = 0; i < agentCount; i++) {
+    agents.push_back(createSlaveInfo(agentResources));
+
+    hashmap<FrameworkID, Resources> used;
+    used[frameworks[i % frameworkCount].id()] = allocation;
+
+    allocator->addSlave(
+        agents[i].id(), agents[i], None(), agents[i].resources(), used);
+  }
+
+  // Wait for all the `addSlave` operations to be processed.
+  Clock::settle();
+
+  Stopwatch watch;
+
+  // Every round 1% of the agents have a task finish on them.
+  const size_t finishedCount = agentCount / 100;
+
+  for (size_t round = 0; round < 10; round++) {
+    // The frameworks hold on to the offers they received in the
+    // previous round, and tasks finish on the next batch of agents.
+    offers.clear();
+
+    for (size_t i = 0; i < finishedCount; i++) {
+      size_t index = (round * finishedCount + i) % agentCount;
+
+      allocator->recoverResources(
+          frameworks[index % frameworkCount].id(),
+          agents[index].id(),
+          task,
+          None());
+    }
+
+    // Wait for the `recoverResources` operations to be processed.
+    Clock::settle();
+
+    watch.start();
+
+    // Advance the clock and trigger a background allocation cycle.
+    Clock::advance(flags.allocation_interval);
+    Clock::settle();
+
+    watch.stop();
+
+    cout << "round " << round
+         << " allocate() took " << watch.elapsed()
+         << " to make " << offers.size() << " offers"
+         << " after " << finishedCount << " agents freed resources" << endl;
+  }
+
+  Clock::resume();
+}
+
+
+class HierarchicalAllocatorParallel_BENCHMARK_Test
+  : public HierarchicalAllocatorTestBase,
+    public WithParamInterface<std::tr1::tuple<size_t, size_t, size_t>> {};
+
+
+// The parallel allocation benchmark tests are parameterized by the
+// number of slaves, the number of frameworks and the number of
+// threads used to compute allocations.
+INSTANTIATE_TEST_CASE_P(
+    SlaveFrameworkAndThreadCount,
+    HierarchicalAllocatorParallel_BENCHMARK_Test,
+    ::testing::Combine(
+      ::testing::Values(1000U, 10000U, 30000U),
+      ::testing::Values(50U, 200U),
+      ::testing::Values(1U, 2U, 4U, 8U))
+    );
+
+
+// This benchmark measures allocation runs in which most frameworks
+// have filtered the resources of most agents, which makes determining
+// the eligible frameworks for each agent the bulk of the work.
+TEST_P(HierarchicalAllocatorParallel_BENCHMARK_Test, DeclineOffers)
+{
+  size_t slaveCount = std::tr1::get<0>(GetParam());
+  size_t frameworkCount = std::tr1::get<1>(GetParam());
+  size_t threadCount = std::tr1::get<2>(GetParam());
+
+  // Pause the clock because we want to manually drive the allocations.
+  Clock::pause();
+
+  struct OfferedResources
+  {
+    FrameworkID   frameworkId;
+    SlaveID       slaveId;
+    Resources     resources;
+  };
+
+  vector<OfferedResources> offers;
+
+  auto offerCallback = [&offers](
+      const FrameworkID& frameworkId,
+      const hashmap<string, hashmap<SlaveID, Resources>>& resources_)
+  {
+    foreachkey (const string& role, resources_) {
+      foreachpair (const SlaveID& slaveId,
+                   const Resources& resources,
+                   resources_.at(role)) {
+        offers.push_back(OfferedResources{frameworkId, slaveId, resources});
+      }
+    }
+  };
+
+  cout << "Using " << slaveCount << " agents, "
+       << frameworkCount << " frameworks and "
+       << threadCount << " allocation threads" << endl;
+
+  master::Flags flags_;
+  flags_.allocation_parallelism = threadCount;
+
+  initialize(flags_, offerCallback);
+
+  for (size_t i = 0; i < frameworkCount; i++) {
+    FrameworkInfo framework = createFrameworkInfo("*");
+    allocator->addFramework(framework.id(), framework, {}, true);
+  }
+
+  const Resources agentResources = Resources::parse(
+      "cpus:24;mem:4096;disk:4096;ports:[31000-32000]").get();
+
+  for (size_t i = 0; i < slaveCount; i++) {
+    SlaveInfo slave = createSlaveInfo(agentResources);
+    allocator->addSlave(slave.id(), slave, None(), slave.resources(), {});
+  }
+
+  // Wait for all the `addFramework` and `addSlave` operations to be
+  // processed, which also makes the initial offers.
+  Clock::settle();
+
+  Stopwatch watch;
+  Duration total;
+  size_t declinedOfferCount = 0;
+
+  // Loop enough times for all the frameworks to get offered all the resources.
+  for (size_t i = 0; i < frameworkCount * 2; i++) {
+    // Permanently decline any offered resources.
+    foreach (const OfferedResources& offer, offers) {
+      Filters filters;
+
+      filters.set_refuse_seconds(INT_MAX);
+      allocator->recoverResources(
+          offer.frameworkId, offer.slaveId, offer.resources, filters);
+    }
+
+    declinedOfferCount += offers.size();
+
+    // Wait for the declined offers.
+    Clock::settle();
+    offers.clear();
+
+    watch.start();
+
+    // Advance the clock and trigger a background allocation cycle.
+    Clock::advance(flags.allocation_interval);
+    Clock::settle();
+
+    watch.stop();
+
+    total += watch.elapsed();
+  }
+
+  cout << frameworkCount * 2 << " allocation runs took " << total
+       << " after filtering " << declinedOfferCount << " offers" << endl;
+
+  Clock::resume();
+}
+
+
 } // namespace tests {
 } // namespace internal {
 } // namespace mesos {
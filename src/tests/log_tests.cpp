@@ -321,6 +321,95 @@ TYPED_TEST(LogStorageTest, TruncateWithManyHoles)
 }
 
 
+TYPED_TEST(LogStorageTest, PersistAndReadRange)
+{
+  TypeParam storage;
+
+  Try<Storage::State> state = storage.restore(os::getcwd() + "/.log");
+  ASSERT_SOME(state);
+
+  // Append from position 0 to position 9, except position 5 (i.e.,
+  // a hole), in a single batch.
+  list<Action> actions;
+
+  for (uint64_t i = 0; i < 10; i++) {
+    if (i == 5) {
+      continue;
+    }
+
+    Action action;
+    action.set_position(i);
+    action.set_promised(1);
+    action.set_performed(1);
+    action.set_learned(true);
+    action.set_type(Action::APPEND);
+    action.mutable_append()->set_bytes(stringify(i));
+
+    actions.push_back(action);
+  }
+
+  ASSERT_SOME(storage.persist(actions));
+
+  Try<list<Action>> range = storage.read(2, 7);
+  ASSERT_SOME(range);
+  ASSERT_EQ(5u, range.get().size());
+
+  uint64_t position = 2;
+
+  foreach (const Action& action, range.get()) {
+    if (position == 5) {
+      position++;
+    }
+
+    EXPECT_EQ(position, action.position());
+    EXPECT_TRUE(action.learned());
+    EXPECT_EQ(Action::APPEND, action.type());
+    ASSERT_TRUE(action.has_append());
+    EXPECT_EQ(stringify(position), action.append().bytes());
+
+    position++;
+  }
+
+  // Append at position 10 and truncate to position 3 (at position 11)
+  // in a single batch.
+  actions.clear();
+
+  Action append;
+  append.set_position(10);
+  append.set_promised(1);
+  append.set_performed(1);
+  append.set_learned(true);
+  append.set_type(Action::APPEND);
+  append.mutable_append()->set_bytes(stringify(10));
+
+  actions.push_back(append);
+
+  Action truncate;
+  truncate.set_position(11);
+  truncate.set_promised(1);
+  truncate.set_performed(1);
+  truncate.set_learned(true);
+  truncate.set_type(Action::TRUNCATE);
+  truncate.mutable_truncate()->set_to(3);
+
+  actions.push_back(truncate);
+
+  ASSERT_SOME(storage.persist(actions));
+
+  range = storage.read(0, 20);
+  ASSERT_SOME(range);
+  ASSERT_EQ(8u, range.get().size());
+  EXPECT_EQ(3u, range.get().front().position());
+  EXPECT_EQ(11u, range.get().back().position());
+  EXPECT_EQ(Action::TRUNCATE, range.get().back().type());
+
+  // Reading past the end of the log returns no actions.
+  range = storage.read(12, 20);
+  ASSERT_SOME(range);
+  EXPECT_TRUE(range.get().empty());
+}
+
+
 class ReplicaTest : public TemporaryDirectoryTest
 {
 protected:
@@ -1205,6 +1294,225 @@ TEST_F(CoordinatorTest, MultipleAppends)
 }
 
 
+// Verifies that with the default window a write made while another
+// write is in progress is rejected rather than queued.
+TEST_F(CoordinatorTest, ConcurrentWritesRejected)
+{
+  const string path1 = os::getcwd() + "/.log1";
+  initializer.flags.path = path1;
+  ASSERT_SOME(initializer.execute());
+
+  const string path2 = os::getcwd() + "/.log2";
+  initializer.flags.path = path2;
+  ASSERT_SOME(initializer.execute());
+
+  Shared<Replica> replica1(new Replica(path1));
+  Shared<Replica> replica2(new Replica(path2));
+
+  set<UPID> pids;
+  pids.insert(replica1->pid());
+  pids.insert(replica2->pid());
+
+  Shared<Network> network(new Network(pids));
+
+  Coordinator coord(2, replica1, network);
+
+  {
+    Future<Option<uint64_t>> electing = coord.elect();
+    AWAIT_READY(electing);
+    EXPECT_SOME_EQ(0u, electing.get());
+  }
+
+  Future<Option<uint64_t>> appending1 = coord.append("hello world");
+  Future<Option<uint64_t>> appending2 = coord.append("hello hello");
+  Future<Option<uint64_t>> truncating = coord.truncate(1);
+
+  AWAIT_EXPECT_FAILED(appending2);
+  AWAIT_EXPECT_FAILED(truncating);
+
+  AWAIT_READY(appending1);
+  EXPECT_SOME_EQ(1u, appending1.get());
+
+  // The coordinator can write again once the write has completed.
+  {
+    Future<Option<uint64_t>> appending = coord.append("hello hello");
+    AWAIT_READY(appending);
+    EXPECT_SOME_EQ(2u, appending.get());
+  }
+}
+
+
+// Verifies that appends are written concurrently (up to the window)
+// and complete in order.
+TEST_F(CoordinatorTest, PipelinedAppends)
+{
+  const string path1 = os::getcwd() + "/.log1";
+  initializer.flags.path = path1;
+  ASSERT_SOME(initializer.execute());
+
+  const string path2 = os::getcwd() + "/.log2";
+  initializer.flags.path = path2;
+  ASSERT_SOME(initializer.execute());
+
+  Shared<Replica> replica1(new Replica(path1));
+  Shared<Replica> replica2(new Replica(path2));
+
+  set<UPID> pids;
+  pids.insert(replica1->pid());
+  pids.insert(replica2->pid());
+
+  Shared<Network> network(new Network(pids));
+
+  Coordinator coord(2, replica1, network, 4);
+
+  {
+    Future<Option<uint64_t>> electing = coord.elect();
+    AWAIT_READY(electing);
+    EXPECT_SOME_EQ(0u, electing.get());
+  }
+
+  list<Future<Option<uint64_t>>> appendings;
+  for (uint64_t position = 1; position <= 10; position++) {
+    appendings.push_back(coord.append(stringify(position)));
+  }
+
+  uint64_t position = 1;
+  foreach (const Future<Option<uint64_t>>& appending, appendings) {
+    AWAIT_READY(appending);
+    EXPECT_SOME_EQ(position++, appending.get());
+  }
+
+  {
+    Future<list<Action>> actions = replica1->read(1, 10);
+    AWAIT_READY(actions);
+    EXPECT_EQ(10u, actions->size());
+    foreach (const Action& action, actions.get()) {
+      ASSERT_TRUE(action.has_type());
+      ASSERT_EQ(Action::APPEND, action.type());
+      EXPECT_EQ(stringify(action.position()), action.append().bytes());
+    }
+  }
+
+  // The other replica has learned the appends too (possibly in
+  // batches), since the learned messages are sent before the appends
+  // complete.
+  {
+    Future<IntervalSet<uint64_t>> missing = replica2->missing(1, 10);
+    AWAIT_READY(missing);
+    EXPECT_TRUE(missing->empty()) << missing.get();
+  }
+}
+
+
+// Verifies that the pending appends return none once the coordinator
+// has been demoted.
+TEST_F(CoordinatorTest, PipelinedAppendsDemoted)
+{
+  const string path1 = os::getcwd() + "/.log1";
+  initializer.flags.path = path1;
+  ASSERT_SOME(initializer.execute());
+
+  const string path2 = os::getcwd() + "/.log2";
+  initializer.flags.path = path2;
+  ASSERT_SOME(initializer.execute());
+
+  Shared<Replica> replica1(new Replica(path1));
+  Shared<Replica> replica2(new Replica(path2));
+
+  set<UPID> pids;
+  pids.insert(replica1->pid());
+  pids.insert(replica2->pid());
+
+  Shared<Network> network1(new Network(pids));
+
+  Coordinator coord1(2, replica1, network1, 2);
+
+  {
+    Future<Option<uint64_t>> electing = coord1.elect();
+    AWAIT_READY(electing);
+    EXPECT_SOME_EQ(0u, electing.get());
+  }
+
+  Shared<Network> network2(new Network(pids));
+
+  Coordinator coord2(2, replica2, network2, 2);
+
+  {
+    Future<Option<uint64_t>> electing = coord2.elect();
+    AWAIT_READY(electing);
+    EXPECT_SOME_EQ(0u, electing.get());
+  }
+
+  list<Future<Option<uint64_t>>> appendings;
+  for (int i = 0; i < 3; i++) {
+    appendings.push_back(coord1.append("hello world"));
+  }
+
+  foreach (const Future<Option<uint64_t>>& appending, appendings) {
+    AWAIT_READY(appending);
+    EXPECT_NONE(appending.get());
+  }
+
+  {
+    Future<Option<uint64_t>> appending = coord2.append("hello hello");
+    AWAIT_READY(appending);
+    EXPECT_SOME_EQ(1u, appending.get());
+  }
+}
+
+
+// Verifies that discarding an append discards the other pending
+// appends as well and demotes the coordinator.
+TEST_F(CoordinatorTest, PipelinedAppendDiscarded)
+{
+  const string path1 = os::getcwd() + "/.log1";
+  initializer.flags.path = path1;
+  ASSERT_SOME(initializer.execute());
+
+  const string path2 = os::getcwd() + "/.log2";
+  initializer.flags.path = path2;
+  ASSERT_SOME(initializer.execute());
+
+  Shared<Replica> replica1(new Replica(path1));
+  Shared<Replica> replica2(new Replica(path2));
+
+  set<UPID> pids;
+  pids.insert(replica1->pid());
+  pids.insert(replica2->pid());
+
+  Shared<Network> network(new Network(pids));
+
+  Coordinator coord(2, replica1, network, 4);
+
+  {
+    Future<Option<uint64_t>> electing = coord.elect();
+    AWAIT_READY(electing);
+    EXPECT_SOME_EQ(0u, electing.get());
+  }
+
+  process::terminate(replica2->pid());
+  process::wait(replica2->pid());
+  replica2.reset();
+
+  Future<Option<uint64_t>> appending1 = coord.append("hello world");
+  Future<Option<uint64_t>> appending2 = coord.append("hello moto");
+
+  ASSERT_TRUE(appending1.isPending());
+  ASSERT_TRUE(appending2.isPending());
+
+  appending2.discard();
+
+  AWAIT_DISCARDED(appending1);
+  AWAIT_DISCARDED(appending2);
+
+  {
+    Future<Option<uint64_t>> appending = coord.append("hello hello");
+    AWAIT_READY(appending);
+    EXPECT_NONE(appending.get());
+  }
+}
+
+
 TEST_F(CoordinatorTest, MultipleAppendsNotLearnedFill)
 {
   const string path1 = os::getcwd() + "/.log1";
@@ -1810,6 +2118,11 @@ TEST_F(RecoverTest, CatchupRetry)
 
   Shared<Network> network2(new Network(pids));
 
+  // Drop the fetch requests to replica1 so that the catch-up process
+  // has to fall back to filling the positions (once fetching them
+  // times out) since replica2 hasn't learned any of them.
+  DROP_PROTOBUFS(FetchRequest(), _, Eq(replica1->pid()));
+
   // Drop a promise request to replica1 so that the catch-up process
   // won't be able to get a quorum of explicit promises. Also, since
   // learned messages are blocked from being sent replica2, the
@@ -1823,6 +2136,10 @@ TEST_F(RecoverTest, CatchupRetry)
 
   Clock::pause();
 
+  // Wait for the fetch to time out.
+  Clock::settle();
+  Clock::advance(Seconds(10));
+
   // Wait for the retry timer in 'catchup' to be setup.
   Clock::settle();
 
@@ -1844,6 +2161,91 @@ TEST_F(RecoverTest, CatchupRetry)
 }
 
 
+// This test verifies that the catch-up process fetches the learned
+// positions from the other replicas in bulk rather than filling them
+// one by one.
+TEST_F(RecoverTest, CatchupFetch)
+{
+  const string path1 = os::getcwd() + "/.log1";
+  initializer.flags.path = path1;
+  ASSERT_SOME(initializer.execute());
+
+  const string path2 = os::getcwd() + "/.log2";
+  initializer.flags.path = path2;
+  ASSERT_SOME(initializer.execute());
+
+  const string path3 = os::getcwd() + "/.log3";
+
+  Shared<Replica> replica1(new Replica(path1));
+  Shared<Replica> replica2(new Replica(path2));
+
+  set<UPID> pids;
+  pids.insert(replica1->pid());
+  pids.insert(replica2->pid());
+
+  Shared<Network> network1(new Network(pids));
+
+  // Pipeline the appends to speed up the test.
+  Coordinator coord(2, replica1, network1, 64);
+
+  {
+    Future<Option<uint64_t>> electing = coord.elect();
+    AWAIT_READY(electing);
+    EXPECT_SOME_EQ(0u, electing.get());
+  }
+
+  list<Future<Option<uint64_t>>> appendings;
+  for (uint64_t position = 1; position <= 2000; position++) {
+    appendings.push_back(coord.append(stringify(position)));
+  }
+
+  IntervalSet<uint64_t> positions;
+
+  uint64_t position = 1;
+  foreach (const Future<Option<uint64_t>>& appending, appendings) {
+    AWAIT_READY(appending);
+    EXPECT_SOME_EQ(position, appending.get());
+    positions += position++;
+  }
+
+  Shared<Replica> replica3(new Replica(path3));
+
+  pids.insert(replica3->pid());
+
+  Shared<Network> network2(new Network(pids));
+
+  // Drop all the promise requests so that the positions can't be
+  // filled, i.e., the catch-up process has to fetch them.
+  DROP_PROTOBUFS(PromiseRequest(), _, _);
+
+  Future<FetchRequest> fetchRequest =
+    FUTURE_PROTOBUF(FetchRequest(), _, _);
+
+  Future<Nothing> catching =
+    catchup(2, replica3, network2, None(), positions, Seconds(10));
+
+  AWAIT_READY(fetchRequest);
+  EXPECT_EQ(1u, fetchRequest.get().from());
+
+  AWAIT_READY(catching);
+
+  Future<list<Action>> actions = replica3->read(1, 2000);
+  AWAIT_READY(actions);
+  ASSERT_EQ(2000u, actions.get().size());
+
+  position = 1;
+
+  foreach (const Action& action, actions.get()) {
+    EXPECT_EQ(position, action.position());
+    EXPECT_TRUE(action.learned());
+    ASSERT_TRUE(action.has_append());
+    EXPECT_EQ(stringify(position), action.append().bytes());
+
+    position++;
+  }
+}
+
+
 TEST_F(RecoverTest, AutoInitialization)
 {
   const string path1 = os::getcwd() + "/.log1";
@@ -4055,6 +4055,168 @@ TEST_F(MasterTest, StateSummaryEndpoint)
 }
 
 
+// This test verifies that the master serves the state endpoints from
+// a cache as long as its state did not change, even if it handled
+// messages (here an agent ping) and requests to other endpoints in
+// between, and that each principal is served its own document.
+TEST_F(MasterTest, StateEndpointsCached)
+{
+  master::Flags masterFlags = CreateMasterFlags();
+
+  Try<Owned<cluster::Master>> master = StartMaster(masterFlags);
+  ASSERT_SOME(master);
+
+  Future<SlaveRegisteredMessage> slaveRegisteredMessage =
+    FUTURE_PROTOBUF(SlaveRegisteredMessage(), _, _);
+
+  Owned<MasterDetector> detector = master.get()->createDetector();
+  Try<Owned<cluster::Slave>> slave = StartSlave(detector.get());
+  ASSERT_SOME(slave);
+
+  AWAIT_READY(slaveRegisteredMessage);
+
+  auto get = [&master](const string& endpoint, const Credential& credential) {
+    return process::http::get(
+        master.get()->pid,
+        endpoint,
+        None(),
+        createBasicAuthHeaders(credential));
+  };
+
+  Clock::pause();
+
+  Future<Response> response1 = get("state", DEFAULT_CREDENTIAL);
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, response1);
+
+  Future<PongSlaveMessage> pong = FUTURE_PROTOBUF(PongSlaveMessage(), _, _);
+
+  // Trigger a ping of the agent, to which the master handles the pong.
+  Clock::advance(masterFlags.agent_ping_timeout);
+
+  AWAIT_READY(pong);
+  Clock::settle();
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(
+      OK().status, get("frameworks", DEFAULT_CREDENTIAL));
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(
+      OK().status, get("tasks", DEFAULT_CREDENTIAL));
+
+  Future<Response> response2 = get("state", DEFAULT_CREDENTIAL);
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, response2);
+  AWAIT_EXPECT_RESPONSE_HEADER_EQ(APPLICATION_JSON, "Content-Type", response2);
+
+  EXPECT_EQ(response1->body, response2->body);
+
+  JSON::Object metrics = Metrics();
+  EXPECT_EQ(1u, metrics.values["master/state_cache_misses"]);
+  EXPECT_EQ(1u, metrics.values["master/state_cache_hits"]);
+
+  // Since there is an authorizer, another principal is not served
+  // the document rendered for the first one.
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(
+      OK().status, get("state", DEFAULT_CREDENTIAL_2));
+
+  metrics = Metrics();
+  EXPECT_EQ(2u, metrics.values["master/state_cache_misses"]);
+  EXPECT_EQ(1u, metrics.values["master/state_cache_hits"]);
+
+  Clock::resume();
+}
+
+
+// This test verifies that a task launched after the state endpoints
+// were cached shows up in them right away.
+TEST_F(MasterTest, StateEndpointsCacheInvalidated)
+{
+  Try<Owned<cluster::Master>> master = StartMaster();
+  ASSERT_SOME(master);
+
+  MockExecutor exec(DEFAULT_EXECUTOR_ID);
+  TestContainerizer containerizer(&exec);
+
+  Owned<MasterDetector> detector = master.get()->createDetector();
+  Try<Owned<cluster::Slave>> slave = StartSlave(detector.get(), &containerizer);
+  ASSERT_SOME(slave);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(
+      &sched, DEFAULT_FRAMEWORK_INFO, master.get()->pid, DEFAULT_CREDENTIAL);
+
+  EXPECT_CALL(sched, registered(&driver, _, _));
+
+  Future<vector<Offer>> offers;
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(FutureArg<1>(&offers))
+    .WillRepeatedly(Return()); // Ignore subsequent offers.
+
+  driver.start();
+
+  AWAIT_READY(offers);
+  ASSERT_FALSE(offers->empty());
+
+  // Returns the number of tasks of the framework in the `/state`
+  // document, or none if the document could not be retrieved.
+  auto tasks = [&master]() -> Option<size_t> {
+    Future<Response> response = process::http::get(
+        master.get()->pid,
+        "state",
+        None(),
+        createBasicAuthHeaders(DEFAULT_CREDENTIAL));
+
+    AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, response);
+
+    if (!response.isReady()) {
+      return None();
+    }
+
+    Try<JSON::Object> parse = JSON::parse<JSON::Object>(response->body);
+    if (parse.isError()) {
+      return None();
+    }
+
+    Result<JSON::Array> tasks =
+      parse->find<JSON::Array>("frameworks[0].tasks");
+
+    if (!tasks.isSome()) {
+      return None();
+    }
+
+    return tasks->values.size();
+  };
+
+  EXPECT_SOME_EQ(0u, tasks());
+  EXPECT_SOME_EQ(0u, tasks());
+
+  TaskInfo task = createTask(offers.get()[0], "", DEFAULT_EXECUTOR_ID);
+
+  EXPECT_CALL(exec, registered(_, _, _, _));
+
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillOnce(SendStatusUpdateFromTask(TASK_RUNNING));
+
+  Future<TaskStatus> status;
+  EXPECT_CALL(sched, statusUpdate(&driver, _))
+    .WillOnce(FutureArg<1>(&status));
+
+  driver.launchTasks(offers.get()[0].id(), {task});
+
+  AWAIT_READY(status);
+  EXPECT_EQ(TASK_RUNNING, status->state());
+
+  EXPECT_SOME_EQ(1u, tasks());
+
+  JSON::Object metrics = Metrics();
+  EXPECT_EQ(2u, metrics.values["master/state_cache_misses"]);
+  EXPECT_EQ(1u, metrics.values["master/state_cache_hits"]);
+
+  EXPECT_CALL(exec, shutdown(_))
+    .Times(AtMost(1));
+
+  driver.stop();
+  driver.join();
+}
+
+
 // This test verifies that recovered but yet to reregister agents are returned
 // in `recovered_slaves` field of `/state` and `/slaves` endpoints.
 TEST_F(MasterTest, RecoveredSlaves)
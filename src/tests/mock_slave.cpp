@@ -58,6 +58,9 @@ MockGarbageCollector::MockGarbageCollector()
 
   EXPECT_CALL(*this, prune(_))
     .WillRepeatedly(Return());
+
+  EXPECT_CALL(*this, reclaim(_))
+    .WillRepeatedly(Return(Bytes(0)));
 }
 
 
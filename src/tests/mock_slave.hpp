@@ -30,6 +30,7 @@
 #include <process/future.hpp>
 #include <process/pid.hpp>
 
+#include <stout/bytes.hpp>
 #include <stout/duration.hpp>
 #include <stout/none.hpp>
 #include <stout/option.hpp>
@@ -62,6 +63,9 @@ public:
   MOCK_METHOD1(
       prune,
       void(const Duration& d));
+  MOCK_METHOD1(
+      reclaim,
+      process::Future<Bytes>(const Bytes& bytes));
 };
 
 
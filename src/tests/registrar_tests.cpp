@@ -1068,6 +1068,122 @@ TEST_F(RegistrarTest, Bootstrap)
 }
 
 
+// Tests that a sharded registry is stored as separate entries for
+// each (unreachable) agent and section, and recovered from them.
+TEST_F(RegistrarTest, Sharded)
+{
+  flags.registry_sharded = true;
+
+  SlaveInfo slave2;
+  slave2.set_hostname("localhost");
+  slave2.mutable_id()->set_value("2");
+
+  TimeInfo unreachableTime = protobuf::getCurrentTime();
+
+  {
+    Registrar registrar(flags, state);
+    AWAIT_READY(registrar.recover(master));
+
+    AWAIT_TRUE(registrar.apply(Owned<Operation>(new AdmitSlave(slave))));
+    AWAIT_TRUE(registrar.apply(Owned<Operation>(new AdmitSlave(slave2))));
+
+    AWAIT_TRUE(registrar.apply(
+        Owned<Operation>(new MarkSlaveUnreachable(slave2, unreachableTime))));
+
+    AWAIT_TRUE(registrar.apply(
+        Owned<Operation>(new UpdateWeights(getWeightInfos({{"role", 2.0}})))));
+  }
+
+  Future<set<string>> names = state->names();
+  AWAIT_READY(names);
+  EXPECT_EQ(
+      (set<string>{
+          "registry/master",
+          "registry/slaves/1",
+          "registry/unreachable/2",
+          "registry/weights"}),
+      names.get());
+
+  {
+    Registrar registrar(flags, state);
+
+    Future<Registry> registry = registrar.recover(master);
+    AWAIT_READY(registry);
+
+    EXPECT_EQ(master, registry.get().master().info());
+
+    ASSERT_EQ(1, registry.get().slaves().slaves().size());
+    EXPECT_EQ(slave, registry.get().slaves().slaves(0).info());
+
+    ASSERT_EQ(1, registry.get().unreachable().slaves().size());
+    EXPECT_EQ(slave2.id(), registry.get().unreachable().slaves(0).id());
+    EXPECT_EQ(
+        unreachableTime,
+        registry.get().unreachable().slaves(0).timestamp());
+
+    ASSERT_EQ(1, registry.get().weights().size());
+    EXPECT_EQ("role", registry.get().weights(0).info().role());
+
+    AWAIT_TRUE(registrar.apply(Owned<Operation>(new RemoveSlave(slave))));
+  }
+
+  names = state->names();
+  AWAIT_READY(names);
+  EXPECT_EQ(
+      (set<string>{
+          "registry/master",
+          "registry/unreachable/2",
+          "registry/weights"}),
+      names.get());
+}
+
+
+// Tests that the registry is migrated to the sharded layout and back.
+TEST_F(RegistrarTest, MigrateSharded)
+{
+  {
+    Registrar registrar(flags, state);
+    AWAIT_READY(registrar.recover(master));
+
+    AWAIT_TRUE(registrar.apply(Owned<Operation>(new AdmitSlave(slave))));
+  }
+
+  flags.registry_sharded = true;
+
+  {
+    Registrar registrar(flags, state);
+
+    Future<Registry> registry = registrar.recover(master);
+    AWAIT_READY(registry);
+
+    ASSERT_EQ(1, registry.get().slaves().slaves().size());
+    EXPECT_EQ(slave, registry.get().slaves().slaves(0).info());
+  }
+
+  Future<set<string>> names = state->names();
+  AWAIT_READY(names);
+  EXPECT_EQ(
+      (set<string>{"registry/master", "registry/slaves/1"}),
+      names.get());
+
+  flags.registry_sharded = false;
+
+  {
+    Registrar registrar(flags, state);
+
+    Future<Registry> registry = registrar.recover(master);
+    AWAIT_READY(registry);
+
+    ASSERT_EQ(1, registry.get().slaves().slaves().size());
+    EXPECT_EQ(slave, registry.get().slaves().slaves(0).info());
+  }
+
+  names = state->names();
+  AWAIT_READY(names);
+  EXPECT_EQ(set<string>{"registry"}, names.get());
+}
+
+
 class MockStorage : public Storage
 {
 public:
@@ -1085,6 +1201,9 @@ TEST_F(RegistrarTest, FetchTimeout)
   MockStorage storage;
   State state(&storage);
 
+  EXPECT_CALL(storage, names())
+    .WillOnce(Return(set<string>({"registry"})));
+
   Future<Nothing> get;
   EXPECT_CALL(storage, get(_))
     .WillOnce(DoAll(FutureSatisfy(&get),
@@ -1116,6 +1235,9 @@ TEST_F(RegistrarTest, StoreTimeout)
 
   Registrar registrar(flags, &state);
 
+  EXPECT_CALL(storage, names())
+    .WillOnce(Return(set<string>()));
+
   EXPECT_CALL(storage, get(_))
     .WillOnce(Return(None()));
 
@@ -1146,6 +1268,9 @@ TEST_F(RegistrarTest, Abort)
 
   Registrar registrar(flags, &state);
 
+  EXPECT_CALL(storage, names())
+    .WillOnce(Return(set<string>()));
+
   EXPECT_CALL(storage, get(_))
     .WillOnce(Return(None()));
 
@@ -2997,6 +2997,18 @@ public:
     }
     reservations.totalOperations = 10;
 
+    // Test a large amount of allocations to distinct roles. This
+    // occurs when aggregating the allocations of many roles, e.g.,
+    // in the allocator.
+    ScalarArithmeticParameter allocations;
+    for (int i = 0; i < 1000; ++i) {
+      Resources allocated = scalars.resources;
+      allocated.allocate(stringify(i));
+
+      allocations.resources += allocated;
+    }
+    allocations.totalOperations = 10;
+
     // Test the performance of ranges using a fragmented range of
     // ports: [1-2,4-5,7-8,...,1000]. Note that the benchmark will
     // continuously sum together the same port range, which does
@@ -3026,6 +3038,7 @@ public:
 
     parameters_.push_back(std::move(scalars));
     parameters_.push_back(std::move(reservations));
+    parameters_.push_back(std::move(allocations));
     parameters_.push_back(std::move(ranges));
     parameters_.push_back(std::move(shared));
 
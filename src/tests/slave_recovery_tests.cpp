@@ -17,6 +17,7 @@
 #include <stdint.h>
 #include <unistd.h>
 
+#include <iostream>
 #include <string>
 
 #include <gtest/gtest.h>
@@ -44,6 +45,7 @@
 #include <stout/option.hpp>
 #include <stout/os.hpp>
 #include <stout/path.hpp>
+#include <stout/stopwatch.hpp>
 #include <stout/uuid.hpp>
 
 #include "common/protobuf_utils.hpp"
@@ -89,6 +91,8 @@ using mesos::slave::ContainerTermination;
 
 using mesos::v1::executor::Call;
 
+using std::cout;
+using std::endl;
 using std::map;
 using std::string;
 using std::vector;
@@ -99,6 +103,7 @@ using testing::DoAll;
 using testing::Eq;
 using testing::Return;
 using testing::SaveArg;
+using testing::WithParamInterface;
 
 namespace mesos {
 namespace internal {
@@ -151,6 +156,516 @@ TEST_F(SlaveStateTest, CheckpointRepeatedProtobufMessages)
 }
 
 
+// Tests that the checkpoints committed to the checkpoint journal are
+// recovered, and that a group that was partially written when the
+// agent died is discarded.
+TEST_F(SlaveStateTest, CheckpointJournal)
+{
+  const string rootDir = path::join(os::getcwd(), "meta");
+
+  SlaveID slaveId;
+  slaveId.set_value("agent");
+
+  SlaveInfo slaveInfo;
+  slaveInfo.set_hostname("localhost");
+  slaveInfo.mutable_id()->CopyFrom(slaveId);
+
+  ASSERT_SOME(slave::state::checkpoint(
+      paths::getSlaveInfoPath(rootDir, slaveId), slaveInfo));
+
+  FrameworkInfo frameworkInfo = DEFAULT_FRAMEWORK_INFO;
+  frameworkInfo.mutable_id()->set_value("framework");
+
+  ExecutorInfo executorInfo = DEFAULT_EXECUTOR_INFO;
+  executorInfo.mutable_framework_id()->CopyFrom(frameworkInfo.id());
+
+  ContainerID containerId;
+  containerId.set_value(UUID::random().toString());
+
+  auto createTask = [&](const string& id) {
+    Task task;
+    task.set_name(id);
+    task.mutable_task_id()->set_value(id);
+    task.mutable_slave_id()->CopyFrom(slaveId);
+    task.mutable_framework_id()->CopyFrom(frameworkInfo.id());
+    task.mutable_executor_id()->CopyFrom(executorInfo.executor_id());
+    task.set_state(TASK_STAGING);
+    return task;
+  };
+
+  auto taskInfoPath = [&](const Task& task) {
+    return paths::getTaskInfoPath(
+        rootDir,
+        slaveId,
+        frameworkInfo.id(),
+        executorInfo.executor_id(),
+        containerId,
+        task.task_id());
+  };
+
+  const UPID pid("scheduler@127.0.0.1:5050");
+
+  const string path = paths::getCheckpointJournalPath(rootDir, slaveId);
+
+  {
+    Try<std::shared_ptr<slave::state::Journal>> journal =
+      slave::state::Journal::open(path);
+
+    ASSERT_SOME(journal);
+
+    journal.get()->add(
+        paths::getFrameworkInfoPath(rootDir, slaveId, frameworkInfo.id()),
+        frameworkInfo);
+
+    journal.get()->add(
+        paths::getFrameworkPidPath(rootDir, slaveId, frameworkInfo.id()),
+        pid);
+
+    ASSERT_SOME(journal.get()->commit());
+
+    journal.get()->add(
+        paths::getExecutorInfoPath(
+            rootDir, slaveId, frameworkInfo.id(), executorInfo.executor_id()),
+        executorInfo);
+
+    ASSERT_SOME(journal.get()->commit());
+
+    paths::createExecutorDirectory(
+        rootDir,
+        slaveId,
+        frameworkInfo.id(),
+        executorInfo.executor_id(),
+        containerId);
+
+    const Task task = createTask("task1");
+    journal.get()->add(taskInfoPath(task), task);
+
+    ASSERT_SOME(journal.get()->commit());
+  }
+
+  // The checkpoints are not written to their own files.
+  EXPECT_FALSE(os::exists(
+      paths::getFrameworkInfoPath(rootDir, slaveId, frameworkInfo.id())));
+
+  // Append a partially written group.
+  const uint32_t size = 1024;
+  ASSERT_SOME(os::write(
+      path,
+      os::read(path).get() +
+      string(reinterpret_cast<const char*>(&size), sizeof(size)) +
+      "partial"));
+
+  Try<slave::state::SlaveState> state =
+    slave::state::SlaveState::recover(rootDir, slaveId, true);
+
+  ASSERT_SOME(state);
+  EXPECT_EQ(0u, state->errors);
+  ASSERT_TRUE(state->frameworks.contains(frameworkInfo.id()));
+
+  const slave::state::FrameworkState& framework =
+    state->frameworks.at(frameworkInfo.id());
+
+  EXPECT_SOME_EQ(frameworkInfo, framework.info);
+  EXPECT_SOME_EQ(pid, framework.pid);
+  ASSERT_TRUE(framework.executors.contains(executorInfo.executor_id()));
+
+  const slave::state::ExecutorState& executor =
+    framework.executors.at(executorInfo.executor_id());
+
+  EXPECT_SOME_EQ(executorInfo, executor.info);
+  ASSERT_TRUE(executor.runs.contains(containerId));
+  EXPECT_EQ(1u, executor.runs.at(containerId).tasks.size());
+
+  // Reopening the journal discards the partially written group, so
+  // that the groups committed after it can be recovered.
+  {
+    Try<std::shared_ptr<slave::state::Journal>> journal =
+      slave::state::Journal::open(path);
+
+    ASSERT_SOME(journal);
+
+    const Task task = createTask("task2");
+    journal.get()->add(taskInfoPath(task), task);
+
+    ASSERT_SOME(journal.get()->commit());
+  }
+
+  state = slave::state::SlaveState::recover(rootDir, slaveId, true);
+
+  ASSERT_SOME(state);
+  EXPECT_EQ(
+      2u,
+      state->frameworks.at(frameworkInfo.id())
+        .executors.at(executorInfo.executor_id())
+        .runs.at(containerId).tasks.size());
+
+  // Materializing the journal writes the checkpoints to their own
+  // files, from which they are recovered.
+  ASSERT_SOME(slave::state::Journal::materialize(path));
+  EXPECT_FALSE(os::exists(path));
+
+  const Task task = createTask("task1");
+  EXPECT_SOME_EQ(task, ::protobuf::read<Task>(taskInfoPath(task)));
+
+  state = slave::state::SlaveState::recover(rootDir, slaveId, true);
+
+  ASSERT_SOME(state);
+  EXPECT_SOME_EQ(
+      frameworkInfo,
+      state->frameworks.at(frameworkInfo.id()).info);
+  EXPECT_EQ(
+      2u,
+      state->frameworks.at(frameworkInfo.id())
+        .executors.at(executorInfo.executor_id())
+        .runs.at(containerId).tasks.size());
+}
+
+
+// Tests that compacting the checkpoint journal keeps only the latest
+// checkpoint of each file, and drops the checkpoints of files whose
+// directory has been removed.
+TEST_F(SlaveStateTest, CheckpointJournalCompaction)
+{
+  const string directory = os::getcwd();
+  const string path = path::join(directory, "checkpoints.journal");
+
+  const string data(1024, 'x');
+
+  {
+    Try<std::shared_ptr<slave::state::Journal>> journal =
+      slave::state::Journal::open(path);
+
+    ASSERT_SOME(journal);
+
+    for (size_t i = 0; i < 1024; i++) {
+      journal.get()->add(path::join(directory, "a", "file"), stringify(i));
+      journal.get()->add(path::join(directory, "b", "file"), data);
+
+      ASSERT_SOME(journal.get()->commit());
+    }
+  }
+
+  ASSERT_SOME(os::rmdir(path::join(directory, "b")));
+
+  // Compaction is done when the journal is opened.
+  ASSERT_SOME(slave::state::Journal::open(path));
+
+  Try<Bytes> size = os::stat::size(path);
+  ASSERT_SOME(size);
+  EXPECT_GT(Kilobytes(1), size.get());
+
+  Try<slave::state::Checkpoints> checkpoints =
+    slave::state::Journal::read(path);
+
+  ASSERT_SOME(checkpoints);
+  ASSERT_EQ(1u, checkpoints->size());
+  EXPECT_EQ("1023", checkpoints->at(path::join(directory, "a", "file")));
+}
+
+
+// Tests that the agent state is recovered from a checkpoint journal
+// whose last group was torn at any byte (e.g., when the agent died
+// while appending it), and that the forked pid of an executor, which
+// the containerizer appends to the journal, is recovered with it.
+TEST_F(SlaveStateTest, CheckpointJournalTornTail)
+{
+  const string rootDir = path::join(os::getcwd(), "meta");
+
+  SlaveID slaveId;
+  slaveId.set_value("agent");
+
+  SlaveInfo slaveInfo;
+  slaveInfo.set_hostname("localhost");
+  slaveInfo.mutable_id()->CopyFrom(slaveId);
+
+  ASSERT_SOME(slave::state::checkpoint(
+      paths::getSlaveInfoPath(rootDir, slaveId), slaveInfo));
+
+  FrameworkInfo frameworkInfo = DEFAULT_FRAMEWORK_INFO;
+  frameworkInfo.mutable_id()->set_value("framework");
+
+  ExecutorInfo executorInfo = DEFAULT_EXECUTOR_INFO;
+  executorInfo.mutable_framework_id()->CopyFrom(frameworkInfo.id());
+
+  ContainerID containerId;
+  containerId.set_value(UUID::random().toString());
+
+  Task task;
+  task.set_name("task");
+  task.mutable_task_id()->set_value("task");
+  task.mutable_slave_id()->CopyFrom(slaveId);
+  task.mutable_framework_id()->CopyFrom(frameworkInfo.id());
+  task.mutable_executor_id()->CopyFrom(executorInfo.executor_id());
+  task.set_state(TASK_STAGING);
+
+  const string path = paths::getCheckpointJournalPath(rootDir, slaveId);
+
+  // The size of the journal before the forked pid is appended.
+  Try<Bytes> committed = Error("Not committed");
+
+  {
+    Try<std::shared_ptr<slave::state::Journal>> journal =
+      slave::state::Journal::open(path);
+
+    ASSERT_SOME(journal);
+
+    journal.get()->add(
+        paths::getFrameworkInfoPath(rootDir, slaveId, frameworkInfo.id()),
+        frameworkInfo);
+
+    journal.get()->add(
+        paths::getExecutorInfoPath(
+            rootDir, slaveId, frameworkInfo.id(), executorInfo.executor_id()),
+        executorInfo);
+
+    paths::createExecutorDirectory(
+        rootDir,
+        slaveId,
+        frameworkInfo.id(),
+        executorInfo.executor_id(),
+        containerId);
+
+    journal.get()->add(
+        paths::getTaskInfoPath(
+            rootDir,
+            slaveId,
+            frameworkInfo.id(),
+            executorInfo.executor_id(),
+            containerId,
+            task.task_id()),
+        task);
+
+    ASSERT_SOME(journal.get()->commit());
+
+    committed = os::stat::size(path);
+    ASSERT_SOME(committed);
+
+    // The journal is shared with the containerizer, which appends
+    // the forked pid of the executor.
+    Try<std::shared_ptr<slave::state::Journal>> shared =
+      slave::state::Journal::open(path);
+
+    ASSERT_SOME(shared);
+    EXPECT_EQ(journal->get(), shared->get());
+
+    ASSERT_SOME(shared.get()->append(
+        paths::getForkedPidPath(
+            rootDir,
+            slaveId,
+            frameworkInfo.id(),
+            executorInfo.executor_id(),
+            containerId),
+        stringify(1234)));
+  }
+
+  Try<string> contents = os::read(path);
+  ASSERT_SOME(contents);
+  ASSERT_LT(committed->bytes(), contents->size());
+
+  // Returns the run of the executor recovered from the journal.
+  auto recover = [&]() -> Option<slave::state::RunState> {
+    Try<slave::state::SlaveState> state =
+      slave::state::SlaveState::recover(rootDir, slaveId, true);
+
+    if (state.isError()) {
+      ADD_FAILURE() << "Failed to recover: " << state.error();
+      return None();
+    }
+
+    EXPECT_EQ(0u, state->errors);
+
+    if (!state->frameworks.contains(frameworkInfo.id())) {
+      ADD_FAILURE() << "Failed to recover framework " << frameworkInfo.id();
+      return None();
+    }
+
+    const slave::state::FrameworkState& framework =
+      state->frameworks.at(frameworkInfo.id());
+
+    if (!framework.executors.contains(executorInfo.executor_id()) ||
+        !framework.executors.at(executorInfo.executor_id())
+          .runs.contains(containerId)) {
+      ADD_FAILURE() << "Failed to recover container " << containerId;
+      return None();
+    }
+
+    return framework.executors.at(executorInfo.executor_id())
+      .runs.at(containerId);
+  };
+
+  // Tear the group holding the forked pid at every byte. The groups
+  // committed before it are recovered, and the torn one is not.
+  for (size_t size = committed->bytes(); size < contents->size(); size++) {
+    ASSERT_SOME(os::write(path, contents->substr(0, size)));
+
+    Option<slave::state::RunState> run = recover();
+    ASSERT_SOME(run) << "Journal torn at " << size;
+
+    EXPECT_EQ(1u, run->tasks.size());
+    EXPECT_NONE(run->forkedPid) << "Journal torn at " << size;
+  }
+
+  // Reopening the journal drops the torn group, after which appended
+  // groups are recovered.
+  {
+    Try<std::shared_ptr<slave::state::Journal>> journal =
+      slave::state::Journal::open(path);
+
+    ASSERT_SOME(journal);
+
+    ASSERT_SOME(journal.get()->append(
+        paths::getForkedPidPath(
+            rootDir,
+            slaveId,
+            frameworkInfo.id(),
+            executorInfo.executor_id(),
+            containerId),
+        stringify(5678)));
+  }
+
+  Option<slave::state::RunState> run = recover();
+  ASSERT_SOME(run);
+
+  EXPECT_EQ(1u, run->tasks.size());
+  EXPECT_SOME_EQ(5678, run->forkedPid);
+}
+
+
+class SlaveState_BENCHMARK_Test
+  : public TemporaryDirectoryTest,
+    public WithParamInterface<size_t> {};
+
+
+INSTANTIATE_TEST_CASE_P(
+    TaskCount,
+    SlaveState_BENCHMARK_Test,
+    ::testing::Values(1000U, 10000U));
+
+
+// Measures checkpointing the tasks of an agent, and recovering them,
+// when each checkpoint is written to its own file and when the
+// checkpoints are appended to the checkpoint journal.
+TEST_P(SlaveState_BENCHMARK_Test, CheckpointAndRecoverTasks)
+{
+  const size_t taskCount = GetParam();
+
+  SlaveInfo slaveInfo;
+  slaveInfo.set_hostname("localhost");
+  slaveInfo.mutable_id()->set_value("agent");
+
+  const SlaveID& slaveId = slaveInfo.id();
+
+  FrameworkInfo frameworkInfo = DEFAULT_FRAMEWORK_INFO;
+  frameworkInfo.mutable_id()->set_value("framework");
+
+  for (bool journaled : {false, true}) {
+    const string rootDir =
+      path::join(os::getcwd(), journaled ? "journal" : "files");
+
+    ASSERT_SOME(slave::state::checkpoint(
+        paths::getSlaveInfoPath(rootDir, slaveId), slaveInfo));
+
+    const string frameworkPath =
+      paths::getFrameworkInfoPath(rootDir, slaveId, frameworkInfo.id());
+
+    const string pidPath =
+      paths::getFrameworkPidPath(rootDir, slaveId, frameworkInfo.id());
+
+    std::shared_ptr<slave::state::Journal> journal;
+    if (journaled) {
+      Try<std::shared_ptr<slave::state::Journal>> open =
+        slave::state::Journal::open(
+            paths::getCheckpointJournalPath(rootDir, slaveId));
+
+      ASSERT_SOME(open);
+      journal = open.get();
+
+      journal->add(frameworkPath, frameworkInfo);
+      journal->add(pidPath, UPID());
+      ASSERT_SOME(journal->commit());
+    } else {
+      ASSERT_SOME(slave::state::checkpoint(frameworkPath, frameworkInfo));
+      ASSERT_SOME(slave::state::checkpoint(pidPath, UPID()));
+    }
+
+    // Checkpoint each task as the agent does when launching it, i.e.,
+    // with its own executor.
+    Stopwatch watch;
+    watch.start();
+
+    for (size_t i = 0; i < taskCount; i++) {
+      ExecutorInfo executorInfo = DEFAULT_EXECUTOR_INFO;
+      executorInfo.mutable_executor_id()->set_value(stringify(i));
+      executorInfo.mutable_framework_id()->CopyFrom(frameworkInfo.id());
+
+      ContainerID containerId;
+      containerId.set_value(stringify(i));
+
+      Task task;
+      task.set_name(stringify(i));
+      task.mutable_task_id()->set_value(stringify(i));
+      task.mutable_slave_id()->CopyFrom(slaveId);
+      task.mutable_framework_id()->CopyFrom(frameworkInfo.id());
+      task.mutable_executor_id()->CopyFrom(executorInfo.executor_id());
+      task.set_state(TASK_STAGING);
+
+      const string executorPath = paths::getExecutorInfoPath(
+          rootDir, slaveId, frameworkInfo.id(), executorInfo.executor_id());
+
+      const string taskPath = paths::getTaskInfoPath(
+          rootDir,
+          slaveId,
+          frameworkInfo.id(),
+          executorInfo.executor_id(),
+          containerId,
+          task.task_id());
+
+      if (journaled) {
+        journal->add(executorPath, executorInfo);
+        ASSERT_SOME(journal->commit());
+      } else {
+        ASSERT_SOME(slave::state::checkpoint(executorPath, executorInfo));
+      }
+
+      paths::createExecutorDirectory(
+          rootDir,
+          slaveId,
+          frameworkInfo.id(),
+          executorInfo.executor_id(),
+          containerId);
+
+      if (journaled) {
+        journal->add(taskPath, task);
+        ASSERT_SOME(journal->commit());
+      } else {
+        ASSERT_SOME(slave::state::checkpoint(taskPath, task));
+      }
+    }
+
+    cout << "Checkpointed " << taskCount << " tasks "
+         << (journaled ? "to the journal" : "to files")
+         << " in " << watch.elapsed() << endl;
+
+    journal.reset();
+
+    watch.start();
+
+    Try<slave::state::SlaveState> state =
+      slave::state::SlaveState::recover(rootDir, slaveId, true);
+
+    ASSERT_SOME(state);
+    ASSERT_TRUE(state->frameworks.contains(frameworkInfo.id()));
+    EXPECT_EQ(
+        taskCount,
+        state->frameworks.at(frameworkInfo.id()).executors.size());
+
+    cout << "Recovered " << taskCount << " tasks "
+         << (journaled ? "from the journal" : "from files")
+         << " in " << watch.elapsed() << endl;
+  }
+}
+
+
 template <typename T>
 class SlaveRecoveryTest : public ContainerizerTest<T>
 {
@@ -1932,6 +1932,154 @@ TEST_F(SlaveTest, StatisticsEndpointMissingStatistics)
 }
 
 
+// This test verifies that the resource statistics of a container are
+// collected once, and shared by the consumers of resource usage,
+// within '--usage_cache_interval'.
+TEST_F(SlaveTest, StatisticsEndpointCachedUsage)
+{
+  Try<Owned<cluster::Master>> master = StartMaster();
+  ASSERT_SOME(master);
+
+  MockExecutor exec(DEFAULT_EXECUTOR_ID);
+  TestContainerizer containerizer(&exec);
+  StandaloneMasterDetector detector(master.get()->pid);
+
+  slave::Flags flags = CreateSlaveFlags();
+
+  MockSlave slave(flags, &detector, &containerizer);
+  spawn(slave);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(
+      &sched, DEFAULT_FRAMEWORK_INFO, master.get()->pid, DEFAULT_CREDENTIAL);
+
+  EXPECT_CALL(sched, registered(_, _, _));
+  EXPECT_CALL(exec, registered(_, _, _, _));
+
+  Future<vector<Offer>> offers;
+
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(FutureArg<1>(&offers))
+    .WillRepeatedly(Return()); // Ignore subsequent offers.
+
+  driver.start();
+
+  AWAIT_READY(offers);
+  EXPECT_NE(0u, offers.get().size());
+
+  const Offer& offer = offers.get()[0];
+
+  TaskInfo task = createTask(
+      offer.slave_id(),
+      Resources::parse("cpus:0.1;mem:32").get(),
+      SLEEP_COMMAND(1000),
+      exec.id);
+
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillOnce(SendStatusUpdateFromTask(TASK_RUNNING));
+
+  Future<TaskStatus> status;
+  EXPECT_CALL(sched, statusUpdate(&driver, _))
+    .WillOnce(FutureArg<1>(&status));
+
+  driver.launchTasks(offer.id(), {task});
+
+  AWAIT_READY(status);
+  EXPECT_EQ(TASK_RUNNING, status.get().state());
+
+  Clock::pause();
+
+  ResourceStatistics statistics;
+  statistics.set_mem_limit_bytes(2048);
+
+  // The statistics are collected once for both requests.
+  EXPECT_CALL(containerizer, usage(_))
+    .WillOnce(Return(statistics));
+
+  Future<Response> response1 = process::http::get(
+      slave.self(),
+      "monitor/statistics",
+      None(),
+      createBasicAuthHeaders(DEFAULT_CREDENTIAL));
+
+  Future<Response> response2 = process::http::get(
+      slave.self(),
+      "monitor/statistics",
+      None(),
+      createBasicAuthHeaders(DEFAULT_CREDENTIAL));
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, response1);
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, response2);
+
+  EXPECT_TRUE(strings::contains(response1->body, "\"mem_limit_bytes\":2048"));
+  EXPECT_TRUE(strings::contains(response2->body, "\"mem_limit_bytes\":2048"));
+
+  // The statistics are collected again after the interval.
+  statistics.set_mem_limit_bytes(4096);
+
+  EXPECT_CALL(containerizer, usage(_))
+    .WillOnce(Return(statistics));
+
+  Clock::advance(flags.usage_cache_interval);
+
+  Future<Response> response = process::http::get(
+      slave.self(),
+      "monitor/statistics",
+      None(),
+      createBasicAuthHeaders(DEFAULT_CREDENTIAL));
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, response);
+  EXPECT_TRUE(strings::contains(response->body, "\"mem_limit_bytes\":4096"));
+
+  // The statistics are as old as when they were collected, so they
+  // are reused within the interval even if the collection took
+  // longer than the interval.
+  Future<Nothing> usage;
+  Promise<ResourceStatistics> promise;
+  EXPECT_CALL(containerizer, usage(_))
+    .WillOnce(DoAll(FutureSatisfy(&usage),
+                    Return(promise.future())));
+
+  Clock::advance(flags.usage_cache_interval);
+
+  response1 = process::http::get(
+      slave.self(),
+      "monitor/statistics",
+      None(),
+      createBasicAuthHeaders(DEFAULT_CREDENTIAL));
+
+  AWAIT_READY(usage);
+
+  Clock::advance(flags.usage_cache_interval);
+
+  statistics.set_mem_limit_bytes(8192);
+  promise.set(statistics);
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, response1);
+  EXPECT_TRUE(strings::contains(response1->body, "\"mem_limit_bytes\":8192"));
+
+  response2 = process::http::get(
+      slave.self(),
+      "monitor/statistics",
+      None(),
+      createBasicAuthHeaders(DEFAULT_CREDENTIAL));
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, response2);
+  EXPECT_TRUE(strings::contains(response2->body, "\"mem_limit_bytes\":8192"));
+
+  Clock::resume();
+
+  EXPECT_CALL(exec, shutdown(_))
+    .Times(AtMost(1));
+
+  driver.stop();
+  driver.join();
+
+  terminate(slave);
+  wait(slave);
+}
+
+
 // This test verifies the correct response of /monitor/statistics endpoint
 // when ResourceUsage collection fails.
 TEST_F(SlaveTest, StatisticsEndpointGetResourceUsageFailed)
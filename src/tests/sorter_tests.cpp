@@ -902,6 +902,112 @@ TEST_P(Sorter_BENCHMARK_Test, FullSort)
        << watch.elapsed() << endl;
 }
 
+
+class SorterResources_BENCHMARK_Test
+  : public ::testing::Test,
+    public ::testing::WithParamInterface<std::tr1::tuple<size_t, size_t>> {};
+
+
+// These sorter benchmark tests are parameterized by
+// the number of clients and resource names.
+INSTANTIATE_TEST_CASE_P(
+    ClientAndResourceCount,
+    SorterResources_BENCHMARK_Test,
+    ::testing::Combine(
+      ::testing::Values(1000U, 10000U),
+      ::testing::Values(4U, 100U))
+    );
+
+
+// This benchmark simulates an allocation cycle: resources are
+// repeatedly allocated to the client that is first in the sort
+// order, after which the clients are sorted again.
+TEST_P(SorterResources_BENCHMARK_Test, AllocateAndSort)
+{
+  size_t clientCount = std::tr1::get<0>(GetParam());
+  size_t resourceCount = std::tr1::get<1>(GetParam());
+
+  cout << "Using " << clientCount << " clients and "
+       << resourceCount << " resource names" << endl;
+
+  DRFSorter sorter;
+  Stopwatch watch;
+
+  SlaveID slaveId;
+  slaveId.set_value("agent");
+
+  // Each client is allocated one unit of a few of the resources.
+  hashmap<string, Resources> allocations;
+
+  Resources total;
+
+  for (size_t i = 0; i < resourceCount; i++) {
+    total += Resources::parse(
+        "resource" + stringify(i),
+        stringify(clientCount * 10),
+        "*").get();
+  }
+
+  sorter.add(slaveId, total);
+
+  watch.start();
+  {
+    for (size_t i = 0; i < clientCount; i++) {
+      const string client = stringify(i);
+
+      sorter.add(client);
+
+      Resources allocation;
+      for (size_t j = 0; j < 3; j++) {
+        allocation += Resources::parse(
+            "resource" + stringify((i + j) % resourceCount),
+            stringify(1 + (i + j) % 5),
+            "*").get();
+      }
+
+      sorter.allocated(client, slaveId, allocation);
+      allocations[client] = allocation;
+    }
+  }
+  watch.stop();
+
+  cout << "Added " << clientCount << " clients in "
+       << watch.elapsed() << endl;
+
+  watch.start();
+  {
+    sorter.sort();
+  }
+  watch.stop();
+
+  cout << "Full sort of " << clientCount << " clients took "
+       << watch.elapsed() << endl;
+
+  watch.start();
+  {
+    sorter.sort();
+  }
+  watch.stop();
+
+  cout << "No-op sort of " << clientCount << " clients took "
+       << watch.elapsed() << endl;
+
+  const size_t allocationCount = 1000;
+
+  watch.start();
+  {
+    for (size_t i = 0; i < allocationCount; i++) {
+      const string client = sorter.sort().front();
+
+      sorter.allocated(client, slaveId, allocations.at(client));
+    }
+  }
+  watch.stop();
+
+  cout << "Made " << allocationCount << " allocations to the first of "
+       << clientCount << " clients in " << watch.elapsed() << endl;
+}
+
 } // namespace tests {
 } // namespace internal {
 } // namespace mesos {
@@ -327,6 +327,71 @@ void Names(State* state)
 }
 
 
+void Transaction(State* state)
+{
+  Future<Variable<Slaves>> future1 = state->fetch<Slaves>("slaves1");
+  AWAIT_READY(future1);
+
+  Future<Variable<Slaves>> future2 = state->fetch<Slaves>("slaves2");
+  AWAIT_READY(future2);
+
+  Slaves slaves;
+  Slave* slave = slaves.add_slaves();
+  slave->mutable_info()->set_hostname("localhost");
+
+  vector<Variable<Slaves>> variables = {
+    future1.get().mutate(slaves),
+    future2.get().mutate(slaves)};
+
+  Future<Option<vector<Variable<Slaves>>>> future3 =
+    state->store(variables, {});
+
+  AWAIT_READY(future3);
+  ASSERT_SOME(future3.get());
+  ASSERT_EQ(2u, future3.get().get().size());
+
+  Variable<Slaves> variable1 = future3.get().get()[0];
+  Variable<Slaves> variable2 = future3.get().get()[1];
+
+  // Atomically update 'slaves1', create 'slaves3' and expunge
+  // 'slaves2'.
+  Future<Variable<Slaves>> future4 = state->fetch<Slaves>("slaves3");
+  AWAIT_READY(future4);
+
+  slave->mutable_info()->set_hostname("localhost2");
+
+  variables = {variable1.mutate(slaves), future4.get().mutate(slaves)};
+
+  future3 = state->store(variables, {variable2});
+  AWAIT_READY(future3);
+  ASSERT_SOME(future3.get());
+
+  Future<set<string>> names = state->names();
+  AWAIT_READY(names);
+  EXPECT_EQ((set<string>{"slaves1", "slaves3"}), names.get());
+
+  future1 = state->fetch<Slaves>("slaves1");
+  AWAIT_READY(future1);
+  ASSERT_EQ(1, future1.get().get().slaves().size());
+  EXPECT_EQ("localhost2", future1.get().get().slaves(0).info().hostname());
+
+  // Now a transaction which includes a stale variable ('variable1'
+  // has since been stored) should not change anything.
+  Future<Variable<Slaves>> future5 = state->fetch<Slaves>("slaves4");
+  AWAIT_READY(future5);
+
+  variables = {future5.get().mutate(slaves), variable1.mutate(slaves)};
+
+  future3 = state->store(variables, {});
+  AWAIT_READY(future3);
+  EXPECT_NONE(future3.get());
+
+  names = state->names();
+  AWAIT_READY(names);
+  EXPECT_EQ((set<string>{"slaves1", "slaves3"}), names.get());
+}
+
+
 class InMemoryStateTest : public ::testing::Test
 {
 public:
@@ -394,6 +459,12 @@ TEST_F(InMemoryStateTest, Names)
 }
 
 
+TEST_F(InMemoryStateTest, Transaction)
+{
+  Transaction(state);
+}
+
+
 class LevelDBStateTest : public TemporaryDirectoryTest
 {
 public:
@@ -471,6 +542,12 @@ TEST_F(LevelDBStateTest, Names)
 }
 
 
+TEST_F(LevelDBStateTest, Transaction)
+{
+  Transaction(state);
+}
+
+
 class LogStateTest : public TemporaryDirectoryTest
 {
 public:
@@ -570,6 +647,93 @@ TEST_F(LogStateTest, Names)
 }
 
 
+TEST_F(LogStateTest, Transaction)
+{
+  Transaction(state);
+}
+
+
+// Tests that the entries stored and expunged by a transaction are
+// recovered from the log.
+TEST_F(LogStateTest, TransactionRecover)
+{
+  Transaction(state);
+
+  mesos::state::LogStorage storage2(log, 1024);
+  State state2(&storage2);
+
+  Future<set<string>> names = state2.names();
+  AWAIT_READY(names);
+  EXPECT_EQ((set<string>{"slaves1", "slaves3"}), names.get());
+
+  Future<Variable<Slaves>> variable = state2.fetch<Slaves>("slaves1");
+  AWAIT_READY(variable);
+  ASSERT_EQ(1, variable.get().get().slaves().size());
+  EXPECT_EQ("localhost2", variable.get().get().slaves(0).info().hostname());
+}
+
+
+// Tests that an entry which doesn't get stored again (e.g., the
+// registry shard of a long-lived agent) doesn't keep the log from
+// being truncated: the log gets compacted by rewriting the entry at
+// the end of the log.
+TEST_F(LogStateTest, Compaction)
+{
+  Log::Reader reader(log);
+
+  Future<Variable<Slaves>> future1 = state->fetch<Slaves>("agent");
+  AWAIT_READY(future1);
+
+  Slaves slaves;
+  slaves.add_slaves()->mutable_info()->set_hostname("localhost");
+
+  Future<Option<vector<Variable<Slaves>>>> future2 =
+    state->store(vector<Variable<Slaves>>{future1.get().mutate(slaves)}, {});
+
+  AWAIT_READY(future2);
+  ASSERT_SOME(future2.get());
+
+  // The position of the entry we never store again.
+  Future<Log::Position> position = reader.ending();
+  AWAIT_READY(position);
+
+  Future<Variable<Slaves>> future3 = state->fetch<Slaves>("master");
+  AWAIT_READY(future3);
+
+  Variable<Slaves> variable = future3.get();
+
+  for (int i = 0; i < 10; i++) {
+    slaves.mutable_slaves(0)->mutable_info()->set_hostname(
+        "localhost" + stringify(i));
+
+    future2 =
+      state->store(vector<Variable<Slaves>>{variable.mutate(slaves)}, {});
+    AWAIT_READY(future2);
+    ASSERT_SOME(future2.get());
+
+    variable = future2.get().get()[0];
+  }
+
+  Future<Log::Position> beginning = reader.beginning();
+  AWAIT_READY(beginning);
+  EXPECT_GT(beginning.get(), position.get());
+
+  // The compacted entry is recovered from the log.
+  mesos::state::LogStorage storage2(log, 1024);
+  State state2(&storage2);
+
+  Future<Variable<Slaves>> future4 = state2.fetch<Slaves>("agent");
+  AWAIT_READY(future4);
+  ASSERT_EQ(1, future4.get().get().slaves().size());
+  EXPECT_EQ("localhost", future4.get().get().slaves(0).info().hostname());
+
+  future4 = state2.fetch<Slaves>("master");
+  AWAIT_READY(future4);
+  ASSERT_EQ(1, future4.get().get().slaves().size());
+  EXPECT_EQ("localhost9", future4.get().get().slaves(0).info().hostname());
+}
+
+
 Future<Option<Variable<Slaves>>> timeout(
     Future<Option<Variable<Slaves>>> future)
 {
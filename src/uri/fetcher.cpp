@@ -79,6 +79,15 @@ Try<Owned<Fetcher>> create(const Option<Flags>& _flags)
 
 } // namespace fetcher {
 
+
+Future<Nothing> Fetcher::Plugin::stream(
+    const URI& uri,
+    const Consumer& consume) const
+{
+  return Failure("Plugin '" + name() + "' does not support streaming");
+}
+
+
 Fetcher::Fetcher(const vector<Owned<Plugin>>& plugins)
 {
   foreach (Owned<Plugin> _plugin, plugins) {
@@ -127,5 +136,17 @@ Future<Nothing> Fetcher::fetch(
   return pluginsByName.at(name)->fetch(uri, directory);
 }
 
+
+Future<Nothing> Fetcher::stream(
+    const URI& uri,
+    const Consumer& consume) const
+{
+  if (!pluginsByScheme.contains(uri.scheme())) {
+    return Failure("Scheme '" + uri.scheme() + "' is not supported");
+  }
+
+  return pluginsByScheme.at(uri.scheme())->stream(uri, consume);
+}
+
 } // namespace uri {
 } // namespace mesos {
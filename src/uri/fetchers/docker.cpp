@@ -15,6 +15,7 @@
 // limitations under the License.
 
 #include <list>
+#include <memory>
 #include <string>
 #include <tuple>
 #include <vector>
@@ -24,6 +25,7 @@
 #include <process/http.hpp>
 #include <process/id.hpp>
 #include <process/io.hpp>
+#include <process/loop.hpp>
 #include <process/process.hpp>
 #include <process/subprocess.hpp>
 
@@ -58,6 +60,9 @@ using process::spawn;
 using process::terminate;
 using process::wait;
 
+using process::Break;
+using process::Continue;
+using process::ControlFlow;
 using process::Failure;
 using process::Future;
 using process::Owned;
@@ -287,6 +292,220 @@ static Future<int> download(
     });
 }
 
+
+namespace {
+
+// The state of a response that is being streamed, see 'stream'.
+struct Streaming
+{
+  // Whether the body of the final response is being streamed.
+  bool streaming() const
+  {
+    return response.isSome() && response->code == http::Status::OK;
+  }
+
+  // The output of curl whose header has not been parsed yet.
+  string buffer;
+
+  // The final response (without its body), once its header has been
+  // parsed. Only the body of a '200 OK' response is streamed.
+  Option<http::Response> response;
+};
+
+} // namespace {
+
+
+// Parses the header (i.e., the status line and the header fields) of
+// an HTTP response. The body of the response is not included.
+static Try<http::Response> parseHeader(const string& header)
+{
+  vector<string> lines = strings::split(header, "\r\n");
+
+  // The status line looks like 'HTTP/1.1 200 OK'.
+  vector<string> tokens = strings::tokenize(lines.front(), " ");
+  if (tokens.size() < 2) {
+    return Error("Malformed status line '" + lines.front() + "'");
+  }
+
+  Try<int> code = numify<int>(tokens[1]);
+  if (code.isError()) {
+    return Error("Malformed status line '" + lines.front() + "'");
+  }
+
+  http::Response response;
+  response.code = code.get();
+  response.status = http::Status::string(code.get());
+
+  for (size_t i = 1; i < lines.size(); i++) {
+    size_t colon = lines[i].find(':');
+    if (colon != string::npos) {
+      response.headers[strings::trim(lines[i].substr(0, colon))] =
+        strings::trim(lines[i].substr(colon + 1));
+    }
+  }
+
+  return response;
+}
+
+
+// Uses the curl command to send an HTTP request to the given URI, and
+// streams the body of the response to 'consume' as it arrives if it is
+// a '200 OK' response. Otherwise (e.g., for a '401 Unauthorized'
+// response) nothing is streamed and the response is returned, without
+// its body.
+static Future<Option<http::Response>> stream(
+    const URI& uri,
+    const Fetcher::Consumer& consume,
+    const http::Headers& headers = http::Headers())
+{
+  vector<string> argv = {
+    "curl",
+    "-s",       // Don't show progress meter or error messages.
+    "-S",       // Make curl show an error message if it fails.
+    "-L",       // Follow HTTP 3xx redirects.
+    "-i",       // Include the HTTP-header in the output.
+  };
+
+  // Add additional headers.
+  foreachpair (const string& key, const string& value, headers) {
+    argv.push_back("-H");
+    argv.push_back(key + ": " + value);
+  }
+
+  argv.push_back(strings::trim(stringify(uri)));
+
+  // NOTE: If the returned future is discarded, curl gets killed by a
+  // SIGPIPE once its stdout is closed.
+  Try<Subprocess> s = subprocess(
+      "curl",
+      argv,
+      Subprocess::PATH("/dev/null"),
+      Subprocess::PIPE(),
+      Subprocess::PIPE());
+
+  if (s.isError()) {
+    return Failure("Failed to exec the curl subprocess: " + s.error());
+  }
+
+  const Subprocess curl = s.get();
+
+  // NOTE: The error is read as it is written so that curl never blocks
+  // on a full pipe.
+  const Future<string> error = io::read(curl.err().get());
+
+  // See the comment in 'curl' above (and MESOS-6010).
+  const bool hasProxy =
+    os::getenv("https_proxy").isSome() ||
+    os::getenv("HTTPS_PROXY").isSome();
+
+  std::shared_ptr<Streaming> streaming(new Streaming());
+
+  return process::loop(
+      [=]() {
+        return io::read(curl.out().get());
+      },
+      [=](const string& data) -> Future<ControlFlow<Nothing>> {
+        if (data.empty()) {
+          return Break();
+        }
+
+        if (streaming->streaming()) {
+          return consume(data)
+            .then([]() -> ControlFlow<Nothing> { return Continue(); });
+        }
+
+        // The body of other responses is dropped.
+        if (streaming->response.isSome()) {
+          return Continue();
+        }
+
+        streaming->buffer += data;
+
+        // The output starts with the header of every response, i.e.,
+        // those of the redirects that curl follows (whose body is not
+        // output) before that of the final response.
+        while (streaming->response.isNone()) {
+          size_t end = streaming->buffer.find("\r\n\r\n");
+          if (end == string::npos) {
+            return Continue();
+          }
+
+          Try<http::Response> response =
+            parseHeader(streaming->buffer.substr(0, end));
+
+          if (response.isError()) {
+            return Failure(
+                "Unexpected output from 'curl': " + response.error());
+          }
+
+          streaming->buffer.erase(0, end + 4);
+
+          // Skip the informational responses and the redirects, and
+          // the response to the 'CONNECT' request if the request is
+          // tunneled through a proxy.
+          const bool connect = hasProxy &&
+            response->code == http::Status::OK &&
+            !response->headers.contains("Content-Length") &&
+            response->headers.get("Transfer-Encoding") != Some("chunked");
+
+          if ((response->code >= 100 && response->code < 200) ||
+              (response->code >= 300 && response->code < 400) ||
+              connect) {
+            continue;
+          }
+
+          streaming->response = response.get();
+        }
+
+        const string body = std::move(streaming->buffer);
+        streaming->buffer.clear();
+
+        if (!streaming->streaming() || body.empty()) {
+          return Continue();
+        }
+
+        return consume(body)
+          .then([]() -> ControlFlow<Nothing> { return Continue(); });
+      })
+    .then([=]() {
+      return await(curl.status(), error);
+    })
+    .then([=](const tuple<Future<Option<int>>, Future<string>>& t)
+        -> Future<Option<http::Response>> {
+      Future<Option<int>> status = std::get<0>(t);
+      if (!status.isReady()) {
+        return Failure(
+            "Failed to get the exit status of the curl subprocess: " +
+            (status.isFailed() ? status.failure() : "discarded"));
+      }
+
+      if (status->isNone()) {
+        return Failure("Failed to reap the curl subprocess");
+      }
+
+      if (status->get() != 0) {
+        Future<string> error = std::get<1>(t);
+        if (!error.isReady()) {
+          return Failure(
+              "Failed to perform 'curl'. Reading stderr failed: " +
+              (error.isFailed() ? error.failure() : "discarded"));
+        }
+
+        return Failure("Failed to perform 'curl': " + error.get());
+      }
+
+      if (streaming->response.isNone()) {
+        return Failure("Unexpected output from 'curl': no HTTP response");
+      }
+
+      if (streaming->streaming()) {
+        return None();
+      }
+
+      return streaming->response;
+    });
+}
+
 //-------------------------------------------------------------------
 // DockerFetcherPlugin implementation.
 //-------------------------------------------------------------------
@@ -301,6 +520,11 @@ public:
 
   Future<Nothing> fetch(const URI& uri, const string& directory);
 
+  Future<Nothing> streamBlob(
+      const URI& uri,
+      const Fetcher::Consumer& consume,
+      const http::Headers& authHeaders);
+
 private:
   Future<Nothing> _fetch(
       const URI& uri,
@@ -412,6 +636,33 @@ Future<Nothing> DockerFetcherPlugin::fetch(
 }
 
 
+Future<Nothing> DockerFetcherPlugin::stream(
+    const URI& uri,
+    const Fetcher::Consumer& consume) const
+{
+  if (uri.scheme() != "docker-blob") {
+    return Failure(
+        "Docker fetcher plugin does not support streaming "
+        "'" + uri.scheme() + "' URIs");
+  }
+
+  if (!uri.has_host()) {
+    return Failure("Registry host (uri.host) is not specified");
+  }
+
+  if (!uri.has_query()) {
+    return Failure("Blob digest (uri.query) is not specified");
+  }
+
+  return dispatch(
+      process.get(),
+      &DockerFetcherPluginProcess::streamBlob,
+      uri,
+      consume,
+      http::Headers());
+}
+
+
 Future<Nothing> DockerFetcherPluginProcess::fetch(
     const URI& uri,
     const string& directory)
@@ -609,6 +860,41 @@ Future<Nothing> DockerFetcherPluginProcess::_fetchBlob(
 }
 
 
+Future<Nothing> DockerFetcherPluginProcess::streamBlob(
+    const URI& uri,
+    const Fetcher::Consumer& consume,
+    const http::Headers& authHeaders)
+{
+  URI blobUri = getBlobUri(uri);
+
+  return stream(blobUri, consume, authHeaders)
+    .then(defer(self(), [=](const Option<http::Response>& response)
+        -> Future<Nothing> {
+      if (response.isNone()) {
+        return Nothing();
+      }
+
+      // Unlike for 'download', the '401 Unauthorized' response has the
+      // header to authenticate with. Note that if 'authHeaders' is not
+      // empty, but we still get a '401 Unauthorized' response, we
+      // return a Failure to prevent an infinite loop.
+      if (response->code == http::Status::UNAUTHORIZED &&
+          authHeaders.empty()) {
+        return getAuthHeader(blobUri, response.get())
+          .then(defer(self(),
+                      &Self::streamBlob,
+                      uri,
+                      consume,
+                      lambda::_1));
+      }
+
+      return Failure(
+          "Unexpected HTTP response '" + response->status + "' "
+          "when trying to stream the blob");
+    }));
+}
+
+
 static http::Headers getAuthHeaderBasic(
     const Option<string>& credential)
 {
@@ -56,6 +56,11 @@ public:
       const URI& uri,
       const std::string& directory) const;
 
+  // Only blobs (i.e., 'docker-blob' URIs) can be streamed.
+  virtual process::Future<Nothing> stream(
+      const URI& uri,
+      const Fetcher::Consumer& consume) const;
+
 private:
   explicit DockerFetcherPlugin(
       process::Owned<DockerFetcherPluginProcess> _process);
@@ -21,6 +21,8 @@
 #include <string>
 #include <vector>
 
+#include <boost/functional/hash.hpp>
+
 #include <glog/logging.h>
 
 #include <google/protobuf/repeated_field.h>
@@ -887,6 +889,40 @@ bool Resources::isShared(const Resource& resource)
 // Public member functions.
 /////////////////////////////////////////////////
 
+size_t Resources::Resource_::hash(const Resource& resource)
+{
+  // NOTE: Only fields that need to be equal for resources to be
+  // addable or subtractable can contribute to the hash. For the
+  // reservation and disk info we only hash the fields that identify
+  // them, which is cheaper than hashing the complete protobufs.
+  size_t seed = 0;
+
+  boost::hash_combine(seed, resource.name());
+  boost::hash_combine(seed, static_cast<int>(resource.type()));
+  boost::hash_combine(seed, resource.role());
+
+  boost::hash_combine(seed, resource.has_allocation_info());
+  if (resource.has_allocation_info()) {
+    boost::hash_combine(seed, resource.allocation_info().role());
+  }
+
+  boost::hash_combine(seed, resource.has_reservation());
+  if (resource.has_reservation()) {
+    boost::hash_combine(seed, resource.reservation().principal());
+  }
+
+  boost::hash_combine(seed, resource.has_disk());
+  if (resource.has_disk() && resource.disk().has_persistence()) {
+    boost::hash_combine(seed, resource.disk().persistence().id());
+  }
+
+  boost::hash_combine(seed, resource.has_revocable());
+  boost::hash_combine(seed, resource.has_shared());
+
+  return seed;
+}
+
+
 Option<Error> Resources::Resource_::validate() const
 {
   if (isShared() && sharedCount.get() < 0) {
@@ -914,6 +950,11 @@ bool Resources::Resource_::contains(const Resource_& that) const
     return false;
   }
 
+  // Resource_ objects with different keys are not subtractable.
+  if (key.isSome() && that.key.isSome() && key.get() != that.key.get()) {
+    return false;
+  }
+
   // Assuming the wrapped Resource objects are equal, the 'contains'
   // relationship is determined by the relationship of the counters
   // for shared resources.
@@ -977,6 +1018,10 @@ bool Resources::Resource_::operator==(const Resource_& that) const
     return false;
   }
 
+  if (key.isSome() && that.key.isSome() && key.get() != that.key.get()) {
+    return false;
+  }
+
   return resource == that.resource;
 }
 
@@ -1060,6 +1105,7 @@ void Resources::allocate(const string& role)
 {
   foreach (Resource_& resource_, resources) {
     resource_.resource.mutable_allocation_info()->set_role(role);
+    resource_.rehash();
   }
 }
 
@@ -1069,6 +1115,7 @@ void Resources::unallocate()
   foreach (Resource_& resource_, resources) {
     if (resource_.resource.has_allocation_info()) {
       resource_.resource.clear_allocation_info();
+      resource_.rehash();
     }
   }
 }
@@ -1188,6 +1235,7 @@ Try<Resources> Resources::flatten(
     } else {
       resource_.resource.mutable_reservation()->CopyFrom(reservation.get());
     }
+    resource_.rehash();
     flattened.add(resource_);
   }
 
@@ -1656,8 +1704,14 @@ Option<Value::Ranges> Resources::ephemeral_ports() const
 
 bool Resources::_contains(const Resource_& that) const
 {
+  if (resources.empty()) {
+    return false;
+  }
+
+  const size_t key = that.getKey();
+
   foreach (const Resource_& resource_, resources) {
-    if (resource_.contains(that)) {
+    if (resource_.key.get() == key && resource_.contains(that)) {
       return true;
     }
   }
@@ -1769,9 +1823,12 @@ void Resources::add(const Resource_& that)
     return;
   }
 
+  const size_t key = that.getKey();
+
   bool found = false;
   foreach (Resource_& resource_, resources) {
-    if (internal::addable(resource_.resource, that)) {
+    if (resource_.key.get() == key &&
+        internal::addable(resource_.resource, that)) {
       resource_ += that;
       found = true;
       break;
@@ -1781,6 +1838,7 @@ void Resources::add(const Resource_& that)
   // Cannot be combined with any existing Resource object.
   if (!found) {
     resources.push_back(that);
+    resources.back().key = key;
   }
 }
 
@@ -1839,14 +1897,17 @@ Resources Resources::operator-(const Resources& that) const
 
 void Resources::subtract(const Resource_& that)
 {
-  if (that.isEmpty()) {
+  if (that.isEmpty() || resources.empty()) {
     return;
   }
 
+  const size_t key = that.getKey();
+
   for (size_t i = 0; i < resources.size(); i++) {
     Resource_& resource_ = resources[i];
 
-    if (internal::subtractable(resource_.resource, that)) {
+    if (resource_.key.get() == key &&
+        internal::subtractable(resource_.resource, that)) {
       resource_ -= that;
 
       // Remove the resource if it has become negative or empty.